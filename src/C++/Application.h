@@ -61,6 +61,8 @@ public:
   /// Notification of app message being received from target
   virtual void fromApp( const Message&, const SessionID& )
   throw( FieldNotFound, IncorrectDataFormat, IncorrectTagValue, UnsupportedMessageType ) = 0;
+  /// Notification of outbound data queueing up behind a slow target
+  virtual void onHighWatermark( const SessionID&, size_t ) {}
 };
 
 /**
@@ -95,6 +97,8 @@ public:
   void fromApp( const Message& message, const SessionID& sessionID )
   throw( FieldNotFound, IncorrectDataFormat, IncorrectTagValue, UnsupportedMessageType )
   { Locker l( m_mutex ); app().fromApp( message, sessionID ); }
+  void onHighWatermark( const SessionID& sessionID, size_t queueDepth )
+  { Locker l( m_mutex ); app().onHighWatermark( sessionID, queueDepth ); }
 
   Mutex m_mutex;
 
@@ -0,0 +1,263 @@
+/****************************************************************************
+** Copyright (c) 2001-2014
+**
+** This file is part of the QuickFIX FIX Engine
+**
+** This file may be distributed under the terms of the quickfixengine.org
+** license as defined by quickfixengine.org and appearing in the file
+** LICENSE included in the packaging of this file.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** See http://www.quickfixengine.org/LICENSE for licensing information.
+**
+** Contact ask@quickfixengine.org if any conditions of this licensing are
+** not clear to you.
+**
+****************************************************************************/
+
+#ifdef _MSC_VER
+#include "stdafx.h"
+#else
+#include "config.h"
+#endif
+
+#include "BinaryLog.h"
+#include "FieldConvertors.h"
+
+namespace FIX
+{
+namespace
+{
+void putInt( char* buffer, unsigned long long value, int size )
+{
+  for ( int i = 0; i < size; ++i )
+    buffer[ i ] = (char)( ( value >> ( 8 * i ) ) & 0xff );
+}
+
+unsigned long long getInt( const char* buffer, int size )
+{
+  unsigned long long value = 0;
+  for ( int i = 0; i < size; ++i )
+    value |= (unsigned long long)(unsigned char)buffer[ i ] << ( 8 * i );
+  return value;
+}
+
+const unsigned long MAX_RECORD_SIZE = 64 * 1024 * 1024;
+}
+
+const char BinaryLogRecord::SIGNATURE[] = "QFBLOG01";
+
+void BinaryLogRecord::encodeHeader( char* header, long long time, int session,
+                                    Kind kind, size_t size )
+{
+  putInt( header, HEADER_SIZE - 4 + size, 4 );
+  putInt( header + 4, (unsigned long long)time, 8 );
+  putInt( header + 12, (unsigned long long)session, 4 );
+  header[ 16 ] = (char)kind;
+}
+const long BinaryLogFactory::DEFAULT_FLUSH_INTERVAL = 1000;
+
+Log* BinaryLogFactory::create()
+{
+  if ( !m_useSettings )
+    return create( Dictionary(), "GLOBAL" );
+  return create( SessionSettings::instance().get(), "GLOBAL" );
+}
+
+Log* BinaryLogFactory::create( const SessionID& s )
+{
+  if ( !m_useSettings )
+    return create( Dictionary(), s.toString() );
+  return create( SessionSettings::instance().get( s ), s.toString() );
+}
+
+Log* BinaryLogFactory::create( const Dictionary& settings, const std::string& name )
+{
+  std::string path = m_path;
+  long flushInterval = m_flushInterval;
+  if ( m_useSettings )
+  {
+    path = settings.getString( BINARY_LOG_PATH );
+    if ( settings.has( BINARY_LOG_FLUSH_INTERVAL ) )
+      flushInterval = settings.getInt( BINARY_LOG_FLUSH_INTERVAL );
+    if ( flushInterval <= 0 )
+      throw ConfigError( std::string( BINARY_LOG_FLUSH_INTERVAL ) + " must be positive" );
+  }
+
+  std::shared_ptr < BinaryLogFile > pFile = open( path, flushInterval );
+  return new BinaryLog( pFile, pFile->addSession( name ) );
+}
+
+std::shared_ptr < BinaryLogFile > BinaryLogFactory::open
+  ( const std::string& path, long flushInterval )
+{
+  Locker l( m_mutex );
+  std::shared_ptr < BinaryLogFile > pFile = m_files[ path ].lock();
+  if ( !pFile )
+  {
+    pFile.reset( new BinaryLogFile( path, flushInterval ) );
+    m_files[ path ] = pFile;
+  }
+  return pFile;
+}
+
+void BinaryLogFactory::destroy( Log* pLog )
+{
+  delete pLog;
+}
+
+void BinaryLog::clear()
+{
+  m_pOutput->write( m_session, BinaryLogRecord::CLEAR, "" );
+}
+
+void BinaryLog::backup()
+{
+  m_pOutput->write( m_session, BinaryLogRecord::BACKUP, "" );
+}
+
+void BinaryLog::onIncoming( const std::string& value )
+{
+  m_pOutput->write( m_session, BinaryLogRecord::INCOMING, value );
+}
+
+void BinaryLog::onOutgoing( const std::string& value )
+{
+  m_pOutput->write( m_session, BinaryLogRecord::OUTGOING, value );
+}
+
+void BinaryLog::onEvent( const std::string& value )
+{
+  m_pOutput->write( m_session, BinaryLogRecord::EVENT, value );
+}
+
+BinaryLogFile::BinaryLogFile( const std::string& path, long flushInterval )
+throw( ConfigError )
+: m_file( 0 )
+{
+  std::string directory = path.empty() ? "." : path;
+  file_mkdir( directory.c_str() );
+  m_fileName = file_appendpath( directory, "log.current.bin" );
+
+  m_file = file_fopen( m_fileName.c_str(), "ab" );
+  if ( !m_file )
+    throw ConfigError( "Could not open binary log file: " + m_fileName );
+  setvbuf( m_file, 0, _IOFBF, 64 * 1024 );
+  fseek( m_file, 0, SEEK_END );
+  if ( ftell( m_file ) == 0 )
+    fwrite( BinaryLogRecord::SIGNATURE, 1, BinaryLogRecord::SIGNATURE_SIZE, m_file );
+
+  StoreSyncer::instance().add( this, SessionID( "", "", "" ),
+    SyncPolicy( SyncPolicy::INTERVAL, 0, flushInterval ) );
+}
+
+BinaryLogFile::~BinaryLogFile()
+{
+  StoreSyncer::instance().remove( this );
+  if ( m_file ) file_fclose( m_file );
+}
+
+int BinaryLogFile::addSession( const std::string& name )
+{
+  Locker l( m_mutex );
+  for ( size_t i = 0; i < m_sessions.size(); ++i )
+  {
+    if ( m_sessions[ i ] == name ) return (int)i;
+  }
+
+  int session = (int)m_sessions.size();
+  m_sessions.push_back( name );
+  writeRecord( time_nanoseconds(), session, BinaryLogRecord::SESSION, name );
+  return session;
+}
+
+void BinaryLogFile::write( int session, BinaryLogRecord::Kind kind,
+                           const std::string& data )
+{
+  {
+    Locker l( m_mutex );
+    writeRecord( time_nanoseconds(), session, kind, data );
+  }
+  StoreSyncer::instance().written( this );
+}
+
+void BinaryLogFile::writeRecord( long long time, int session,
+                                 BinaryLogRecord::Kind kind,
+                                 const std::string& data )
+{
+  char header[ BinaryLogRecord::HEADER_SIZE ];
+  BinaryLogRecord::encodeHeader( header, time, session, kind, data.size() );
+  fwrite( header, 1, BinaryLogRecord::HEADER_SIZE, m_file );
+  fwrite( data.data(), 1, data.size(), m_file );
+}
+
+bool BinaryLogFile::sync()
+{
+  Locker l( m_mutex );
+  return fflush( m_file ) == 0;
+}
+
+BinaryLogReader::BinaryLogReader( const std::string& fileName )
+throw( ConfigError )
+: m_stream( fileName.c_str(), std::ios::in | std::ios::binary ),
+  m_fileName( fileName )
+{
+  if ( !m_stream.is_open() )
+    throw ConfigError( "Could not open binary log file: " + fileName );
+
+  char signature[ BinaryLogRecord::SIGNATURE_SIZE ];
+  m_stream.read( signature, BinaryLogRecord::SIGNATURE_SIZE );
+  if ( m_stream.gcount() != (std::streamsize)BinaryLogRecord::SIGNATURE_SIZE
+       || std::string( signature, BinaryLogRecord::SIGNATURE_SIZE )
+          != BinaryLogRecord::SIGNATURE )
+    throw ConfigError( fileName + " is not a binary log file" );
+}
+
+bool BinaryLogReader::next( BinaryLogRecord& record ) throw( IOException )
+{
+  char header[ BinaryLogRecord::HEADER_SIZE ];
+  while ( true )
+  {
+    // a record cut short by a crash ends the file
+    m_stream.read( header, BinaryLogRecord::HEADER_SIZE );
+    if ( m_stream.gcount() != (std::streamsize)BinaryLogRecord::HEADER_SIZE )
+      return false;
+
+    unsigned long length = (unsigned long)getInt( header, 4 );
+    if ( length < BinaryLogRecord::HEADER_SIZE - 4 || length > MAX_RECORD_SIZE
+         || header[ 16 ] > BinaryLogRecord::BACKUP || header[ 16 ] < 0 )
+      throw IOException( "Corrupt record in " + m_fileName );
+
+    record.time = (long long)getInt( header + 4, 8 );
+    record.session = (int)getInt( header + 12, 4 );
+    record.kind = (BinaryLogRecord::Kind)header[ 16 ];
+    record.data.resize( length - ( BinaryLogRecord::HEADER_SIZE - 4 ) );
+    if ( record.data.size() )
+    {
+      m_stream.read( &record.data[ 0 ], record.data.size() );
+      if ( m_stream.gcount() != (std::streamsize)record.data.size() )
+        return false;
+    }
+
+    if ( record.kind != BinaryLogRecord::SESSION )
+      return true;
+    m_sessions[ record.session ] = record.data;
+  }
+}
+
+std::string BinaryLogReader::getSession( int index ) const
+{
+  std::map < int, std::string > ::const_iterator i = m_sessions.find( index );
+  return i == m_sessions.end() ? "" : i->second;
+}
+
+std::string BinaryLogReader::formatTime( long long time )
+{
+  UtcTimeStamp stamp( (time_t)( time / 1000000000 ),
+                      (int)( ( time / 1000000 ) % 1000 ) );
+  return UtcTimeStampConvertor::convert( stamp, true );
+}
+
+} //namespace FIX
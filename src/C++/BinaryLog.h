@@ -0,0 +1,191 @@
+/* -*- C++ -*- */
+
+/****************************************************************************
+** Copyright (c) 2001-2014
+**
+** This file is part of the QuickFIX FIX Engine
+**
+** This file may be distributed under the terms of the quickfixengine.org
+** license as defined by quickfixengine.org and appearing in the file
+** LICENSE included in the packaging of this file.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** See http://www.quickfixengine.org/LICENSE for licensing information.
+**
+** Contact ask@quickfixengine.org if any conditions of this licensing are
+** not clear to you.
+**
+****************************************************************************/
+
+#ifndef FIX_BINARYLOG_H
+#define FIX_BINARYLOG_H
+
+#ifdef _MSC_VER
+#pragma warning( disable : 4503 4355 4786 4290 )
+#endif
+
+#include "Log.h"
+#include "Exceptions.h"
+#include "Mutex.h"
+#include "StoreSyncer.h"
+#include "SessionSettings.h"
+#include <fstream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace FIX
+{
+/**
+ * A record of a binary log file.
+ *
+ * The file starts with an 8 byte signature.  Each record is a header of
+ * a 4 byte length of the rest of the record, an 8 byte UTC time in
+ * nanoseconds, a 4 byte session index and a 1 byte kind, all little
+ * endian, followed by the raw bytes that were logged.  SESSION records
+ * name the session that later records with their index belong to, CLEAR
+ * and BACKUP records mark where the session's log was cleared or backed
+ * up.
+ */
+struct BinaryLogRecord
+{
+  enum Kind { INCOMING, OUTGOING, EVENT, SESSION, CLEAR, BACKUP };
+
+  static const char SIGNATURE[];
+  static const size_t SIGNATURE_SIZE = 8;
+  static const size_t HEADER_SIZE = 17;
+
+  /// Fill in the header of a record with size bytes of data.
+  static void encodeHeader( char* header, long long time, int session,
+                            Kind kind, size_t size );
+
+  long long time;
+  int session;
+  Kind kind;
+  std::string data;
+};
+
+/// Where a BinaryLog writes its records.
+class BinaryLogOutput
+{
+public:
+  virtual ~BinaryLogOutput() {}
+  /// Index of the named session, recording the name if it is new.
+  virtual int addSession( const std::string& name ) = 0;
+  virtual void write( int session, BinaryLogRecord::Kind kind,
+                      const std::string& data ) = 0;
+};
+
+class BinaryLogFile;
+
+/**
+ * Creates a binary file based implementation of Log.
+ *
+ * Sessions logging to the same directory share one file.
+ */
+class BinaryLogFactory : public LogFactory
+{
+public:
+  static const long DEFAULT_FLUSH_INTERVAL;
+
+  BinaryLogFactory()
+  : m_flushInterval( DEFAULT_FLUSH_INTERVAL ), m_useSettings( true ) {}
+  BinaryLogFactory( const std::string& path,
+                    long flushInterval = DEFAULT_FLUSH_INTERVAL )
+  : m_path( path ), m_flushInterval( flushInterval ), m_useSettings( false ) {}
+
+  Log* create();
+  Log* create( const SessionID& );
+  void destroy( Log* log );
+
+private:
+  Log* create( const Dictionary& settings, const std::string& name );
+  std::shared_ptr < BinaryLogFile > open( const std::string& path, long flushInterval );
+
+  typedef std::map < std::string, std::weak_ptr < BinaryLogFile > > Files;
+
+  std::string m_path;
+  long m_flushInterval;
+  bool m_useSettings;
+  Files m_files;
+  Mutex m_mutex;
+};
+
+/**
+ * Binary file based implementation of Log.
+ *
+ * Lines are written as BinaryLogRecords without formatting, and turned
+ * back into FileLog text by the logdecode tool.  Clearing or backing up
+ * only marks the session's place in the shared output.
+ */
+class BinaryLog : public Log
+{
+public:
+  BinaryLog( const std::shared_ptr < BinaryLogOutput > & pOutput, int session )
+  : m_pOutput( pOutput ), m_session( session ) {}
+
+  void clear();
+  void backup();
+
+  void onIncoming( const std::string& value );
+  void onOutgoing( const std::string& value );
+  void onEvent( const std::string& value );
+
+  bool isThreadSafe() const { return true; }
+
+private:
+  std::shared_ptr < BinaryLogOutput > m_pOutput;
+  int m_session;
+};
+
+/**
+ * File written by the BinaryLogs of one directory.
+ *
+ * Records are buffered and flushed to the operating system by the
+ * StoreSyncer thread.
+ */
+class BinaryLogFile : public BinaryLogOutput, public Syncable
+{
+public:
+  BinaryLogFile( const std::string& path, long flushInterval ) throw( ConfigError );
+  ~BinaryLogFile();
+
+  int addSession( const std::string& name );
+  void write( int session, BinaryLogRecord::Kind kind, const std::string& data );
+  bool sync();
+
+private:
+  void writeRecord( long long time, int session, BinaryLogRecord::Kind kind,
+                    const std::string& data );
+
+  std::string m_fileName;
+  FILE* m_file;
+  std::vector < std::string > m_sessions;
+  Mutex m_mutex;
+};
+
+/// Reads the records of a binary log file.
+class BinaryLogReader
+{
+public:
+  BinaryLogReader( const std::string& fileName ) throw( ConfigError );
+
+  /// Read the next message, event or marker, false at the end of the file.
+  bool next( BinaryLogRecord& record ) throw( IOException );
+  /// Name of the session with the index, as given by SessionID::toString.
+  std::string getSession( int index ) const;
+
+  /// Format a record time the way FileLog does.
+  static std::string formatTime( long long time );
+
+private:
+  std::ifstream m_stream;
+  std::string m_fileName;
+  std::map < int, std::string > m_sessions;
+};
+}
+
+#endif //FIX_BINARYLOG_H
@@ -41,6 +41,7 @@ public:
 #ifdef _MSC_VER
     m_event = CreateEvent( 0, false, false, 0 );
 #else
+    m_signaled = false;
     pthread_mutex_init( &m_mutex, 0 );
     pthread_cond_init( &m_event, 0 );
 #endif
@@ -62,6 +63,7 @@ public:
     SetEvent( m_event );
 #else
     pthread_mutex_lock( &m_mutex );
+    m_signaled = true;
     pthread_cond_broadcast( &m_event );
     pthread_mutex_unlock( &m_mutex );
 #endif
@@ -73,11 +75,21 @@ public:
     WaitForSingleObject( m_event, (long)(s * 1000) );
 #else
     pthread_mutex_lock( &m_mutex );
-    timespec time, remainder;
+    // pthread_cond_timedwait takes an absolute time, and a signal
+    // raised while nobody was waiting must still wake the next wait
+    timeval now;
+    gettimeofday( &now, 0 );
     double intpart;
-    time.tv_nsec = (long)(modf(s, &intpart) * 1e9);
-    time.tv_sec = (int)intpart;
-    pthread_cond_timedwait( &m_event, &m_mutex, &time );
+    long nsec = now.tv_usec * 1000 + (long)(modf(s, &intpart) * 1e9);
+    timespec time;
+    time.tv_sec = now.tv_sec + (time_t)intpart + nsec / 1000000000;
+    time.tv_nsec = nsec % 1000000000;
+    while( !m_signaled )
+    {
+      if( pthread_cond_timedwait( &m_event, &m_mutex, &time ) == ETIMEDOUT )
+        break;
+    }
+    m_signaled = false;
     pthread_mutex_unlock( &m_mutex );
 #endif
   }
@@ -88,6 +100,7 @@ private:
 #else
   pthread_cond_t m_event;
   pthread_mutex_t m_mutex;
+  bool m_signaled;
 #endif
 };
 }
@@ -157,6 +157,12 @@ namespace FIX
 		m_groups.clear();
 	}
 
+	void FieldMap::swap(FieldMap& rhs)
+	{
+		m_fields.swap(rhs.m_fields);
+		m_groups.swap(rhs.m_groups);
+	}
+
 	bool FieldMap::isEmpty()
 	{
 		return m_fields.size() == 0;
@@ -196,6 +196,8 @@ namespace FIX
 
 		/// Clear all fields from the map
 		void clear();
+		/// Exchange contents with another map without copying fields
+		void swap(FieldMap& rhs);
 		/// Check if map contains any fields
 		bool isEmpty();
 
@@ -27,6 +27,67 @@
 
 namespace FIX
 {
+LogRotationPolicy::LogRotationPolicy( const Dictionary& dict )
+throw( ConfigError )
+: m_size( 0 ), m_retain( 0 )
+{
+  if ( dict.has( FILE_LOG_ROTATE_SIZE ) )
+  {
+    // a number of bytes, optionally followed by K, M or G
+    std::string value = string_toUpper( dict.getString( FILE_LOG_ROTATE_SIZE ) );
+    long long unit = 1;
+    if ( value.size() )
+    {
+      switch ( value[ value.size() - 1 ] )
+      {
+      case 'K': unit = 1024LL; break;
+      case 'M': unit = 1024LL * 1024; break;
+      case 'G': unit = 1024LL * 1024 * 1024; break;
+      }
+      if ( unit != 1 ) value.erase( value.size() - 1 );
+    }
+    for ( std::string::size_type i = 0; i < value.size(); ++i )
+    {
+      if ( value[ i ] < '0' || value[ i ] > '9' ) { m_size = 0; break; }
+      m_size = m_size * 10 + ( value[ i ] - '0' );
+    }
+    if ( m_size <= 0 )
+      throw ConfigError( std::string( FILE_LOG_ROTATE_SIZE ) + " must be a positive size" );
+    m_size *= unit;
+  }
+
+  if ( dict.has( FILE_LOG_RETAIN_COUNT ) )
+    m_retain = dict.getInt( FILE_LOG_RETAIN_COUNT );
+  if ( m_retain < 0 )
+    throw ConfigError( std::string( FILE_LOG_RETAIN_COUNT ) + " must not be negative" );
+
+  if ( !dict.has( FILE_LOG_ROTATE_SCHEDULE ) || !dict.getBool( FILE_LOG_ROTATE_SCHEDULE ) )
+    return;
+
+  int startDay = dict.has( START_DAY ) ? dict.getDay( START_DAY ) : -1;
+  int endDay = dict.has( END_DAY ) ? dict.getDay( END_DAY ) : -1;
+  UtcTimeOnly startTime = UtcTimeOnlyConvertor::convert( dict.getString( START_TIME ) );
+  UtcTimeOnly endTime = UtcTimeOnlyConvertor::convert( dict.getString( END_TIME ) );
+
+  if ( dict.has( USE_LOCAL_TIME ) && dict.getBool( USE_LOCAL_TIME ) )
+  {
+    m_schedule.reset( new TimeRange
+      ( LocalTimeOnly( startTime.getHour(), startTime.getMinute(), startTime.getSecond() ),
+        LocalTimeOnly( endTime.getHour(), endTime.getMinute(), endTime.getSecond() ),
+        startDay, endDay ) );
+  }
+  else
+    m_schedule.reset( new TimeRange( startTime, endTime, startDay, endDay ) );
+}
+
+bool LogRotationPolicy::isDue( long long size, const UtcTimeStamp& opened,
+                               const UtcTimeStamp& now ) const
+{
+  if ( m_size > 0 && size >= m_size ) return true;
+  if ( !m_schedule.get() ) return false;
+  return m_schedule->isInRange( now ) && !m_schedule->isInSameRange( opened, now );
+}
+
 Log* FileLogFactory::create()
 {
   m_globalLogCount++;
@@ -34,7 +95,13 @@ Log* FileLogFactory::create()
 
   try
   {
-    if ( m_path.size() ) return new FileLog( m_path );
+    if ( m_path.size() )
+    {
+      FileLog* pLog = new FileLog( m_path );
+      pLog->setAsync( m_policy );
+      pLog->setRotation( m_rotation );
+      return pLog;
+    }
     std::string path;
     std::string backupPath;
 
@@ -44,7 +111,12 @@ Log* FileLogFactory::create()
     if( settings.has( FILE_LOG_BACKUP_PATH ) )
       backupPath = settings.getString( FILE_LOG_BACKUP_PATH );
 
-    return m_globalLog = new FileLog( path, backupPath );
+    AsyncLogPolicy policy( settings );
+    LogRotationPolicy rotation( settings );
+    FileLog* pLog = new FileLog( path, backupPath );
+    pLog->setAsync( policy );
+    pLog->setRotation( rotation );
+    return m_globalLog = pLog;
   }
   catch( ConfigError& )
   {
@@ -55,10 +127,14 @@ Log* FileLogFactory::create()
 
 Log* FileLogFactory::create( const SessionID& s )
 {
-  if ( m_path.size() && m_backupPath.size() )
-    return new FileLog( m_path, m_backupPath, s );
-  if ( m_path.size() ) 
-    return new FileLog( m_path, s );
+  if ( m_path.size() )
+  {
+    FileLog* pLog = m_backupPath.size()
+      ? new FileLog( m_path, m_backupPath, s ) : new FileLog( m_path, s );
+    pLog->setAsync( m_policy );
+    pLog->setRotation( m_rotation );
+    return pLog;
+  }
 
   std::string path;
   std::string backupPath;
@@ -68,7 +144,18 @@ Log* FileLogFactory::create( const SessionID& s )
   if( settings.has( FILE_LOG_BACKUP_PATH ) )
     backupPath = settings.getString( FILE_LOG_BACKUP_PATH );
 
-  return new FileLog( path, backupPath, s );
+  FileLog* pLog = new FileLog( path, backupPath, s );
+  try
+  {
+    pLog->setAsync( AsyncLogPolicy( settings ) );
+    pLog->setRotation( LogRotationPolicy( settings ) );
+  }
+  catch( ConfigError& )
+  {
+    delete pLog;
+    throw;
+  }
+  return pLog;
 }
 
 void FileLogFactory::destroy( Log* pLog )
@@ -89,25 +176,33 @@ void FileLogFactory::destroy( Log* pLog )
 }
 
 FileLog::FileLog( const std::string& path )
-: m_millisecondsInTimeStamp( true )
+: m_millisecondsInTimeStamp( true ), m_pRing( 0 ),
+  m_overflow( AsyncLogPolicy::BLOCK ), m_dropped( 0 ), m_reportedDropped( 0 ),
+  m_messagesSize( 0 ), m_eventSize( 0 ), m_checked( 0 )
 {
   init( path, path, "GLOBAL" );
 }
 
 FileLog::FileLog( const std::string& path, const std::string& backupPath )
-: m_millisecondsInTimeStamp( true )
+: m_millisecondsInTimeStamp( true ), m_pRing( 0 ),
+  m_overflow( AsyncLogPolicy::BLOCK ), m_dropped( 0 ), m_reportedDropped( 0 ),
+  m_messagesSize( 0 ), m_eventSize( 0 ), m_checked( 0 )
 {
   init( path, backupPath, "GLOBAL" );
 }
 
 FileLog::FileLog( const std::string& path, const SessionID& s )
-: m_millisecondsInTimeStamp( true )
+: m_millisecondsInTimeStamp( true ), m_pRing( 0 ),
+  m_overflow( AsyncLogPolicy::BLOCK ), m_dropped( 0 ), m_reportedDropped( 0 ),
+  m_messagesSize( 0 ), m_eventSize( 0 ), m_checked( 0 )
 {
   init( path, path, generatePrefix(s) );
 }
 
 FileLog::FileLog( const std::string& path, const std::string& backupPath, const SessionID& s )
-: m_millisecondsInTimeStamp( true )
+: m_millisecondsInTimeStamp( true ), m_pRing( 0 ),
+  m_overflow( AsyncLogPolicy::BLOCK ), m_dropped( 0 ), m_reportedDropped( 0 ),
+  m_messagesSize( 0 ), m_eventSize( 0 ), m_checked( 0 )
 {
   init( path, backupPath, generatePrefix(s) );
 }
@@ -137,51 +232,218 @@ void FileLog::init( std::string path, std::string backupPath, const std::string&
   if ( !m_messages.is_open() ) throw ConfigError( "Could not open messages file: " + m_messagesFileName );
   m_event.open( m_eventFileName.c_str(), std::ios::out | std::ios::app );
   if ( !m_event.is_open() ) throw ConfigError( "Could not open event file: " + m_eventFileName );
+
+  // appending continues the current files, so they count toward rotation
+  m_messages.seekp( 0, std::ios::end );
+  m_messagesSize = m_messages.tellp();
+  m_event.seekp( 0, std::ios::end );
+  m_eventSize = m_event.tellp();
 }
 
 FileLog::~FileLog()
 {
+  stopAsync();
   m_messages.close();
   m_event.close();
 }
 
 void FileLog::clear()
+{
+  if( m_pRing ) { queue( LogRing::CLEAR, std::string() ); return; }
+  Locker l( m_writeMutex );
+  clearFiles();
+}
+
+void FileLog::backup()
+{
+  if( m_pRing ) { queue( LogRing::BACKUP, std::string() ); return; }
+  Locker l( m_writeMutex );
+  backupFiles();
+}
+
+void FileLog::clearFiles()
 {
   m_messages.close();
   m_event.close();
 
   m_messages.open( m_messagesFileName.c_str(), std::ios::out | std::ios::trunc );
   m_event.open( m_eventFileName.c_str(), std::ios::out | std::ios::trunc );
+  m_messagesSize = m_eventSize = 0;
+  m_opened = UtcTimeStamp();
 }
 
-void FileLog::backup()
+std::string FileLog::backupFileName( const char* type, int index ) const
+{
+  std::stringstream fileName;
+  fileName << m_fullBackupPrefix << type << ".backup." << index << ".log";
+  return fileName.str();
+}
+
+void FileLog::backupFiles()
 {
   m_messages.close();
   m_event.close();
 
-  int i = 0;
-  while( true )
+  int i = 1;
+  while( file_exists( backupFileName( "messages", i ).c_str() )
+         || file_exists( backupFileName( "event", i ).c_str() ) )
+    ++i;
+
+  file_rename( m_messagesFileName.c_str(), backupFileName( "messages", i ).c_str() );
+  file_rename( m_eventFileName.c_str(), backupFileName( "event", i ).c_str() );
+  m_messages.open( m_messagesFileName.c_str(), std::ios::out | std::ios::trunc );
+  m_event.open( m_eventFileName.c_str(), std::ios::out | std::ios::trunc );
+  m_messagesSize = m_eventSize = 0;
+  m_opened = UtcTimeStamp();
+
+  int retain = m_rotation.getRetain();
+  if( retain <= 0 || i <= retain ) return;
+
+  // drop the oldest and renumber the rest, so backup 1 stays the oldest
+  int expired = i - retain;
+  for( int j = 1; j <= expired; ++j )
   {
-    std::stringstream messagesFileName;
-    std::stringstream eventFileName;
- 
-    messagesFileName << m_fullBackupPrefix << "messages.backup." << ++i << ".log";
-    eventFileName << m_fullBackupPrefix << "event.backup." << i << ".log";
-    FILE* messagesLogFile = file_fopen( messagesFileName.str().c_str(), "r" );
-    FILE* eventLogFile = file_fopen( eventFileName.str().c_str(), "r" );
+    file_unlink( backupFileName( "messages", j ).c_str() );
+    file_unlink( backupFileName( "event", j ).c_str() );
+  }
+  for( int j = expired + 1; j <= i; ++j )
+  {
+    file_rename( backupFileName( "messages", j ).c_str(),
+                 backupFileName( "messages", j - expired ).c_str() );
+    file_rename( backupFileName( "event", j ).c_str(),
+                 backupFileName( "event", j - expired ).c_str() );
+  }
+}
+
+void FileLog::setAsync( const AsyncLogPolicy& policy )
+{
+  stopAsync();
+
+  // rotation is done by the writer, so it needs the queue as well
+  if( !policy.getAsync() && !m_rotation.enabled() ) return;
+  m_pRing = new LogRing( policy.getQueueSize() );
+  m_overflow = policy.getOverflow();
+  FileLogWriter::instance().add( this, policy.getInterval() );
+}
+
+void FileLog::setRotation( const LogRotationPolicy& policy )
+{
+  {
+    Locker l( m_writeMutex );
+    m_rotation = policy;
+  }
+  if( m_rotation.enabled() && !m_pRing )
+    setAsync( AsyncLogPolicy( true ) );
+}
 
-    if( messagesLogFile == NULL && eventLogFile == NULL )
+void FileLog::stopAsync()
+{
+  if( !m_pRing ) return;
+  FileLogWriter::instance().remove( this );
+  flush();
+  delete m_pRing;
+  m_pRing = 0;
+}
+
+void FileLog::queue( LogRing::Kind kind, const std::string& value )
+{
+  if( m_pRing->push( kind, value ) )
+  {
+    // wake the writer early rather than let a burst fill the queue
+    if( m_pRing->size() == m_pRing->capacity() / 2 )
+      FileLogWriter::instance().wake();
+    return;
+  }
+
+  if( m_overflow == AsyncLogPolicy::DROP && kind <= LogRing::EVENT )
+  {
+    ++m_dropped;
+    return;
+  }
+
+  do
+  {
+    FileLogWriter::instance().wake();
+    process_sleep( 0.0001 );
+  } while( !m_pRing->push( kind, value ) );
+}
+
+void FileLog::flush()
+{
+  Locker l( m_writeMutex );
+  if( !m_pRing ) return;
+
+  // every line drained in one round shares the round's timestamp
+  UtcTimeStamp now;
+  std::string time
+    = UtcTimeStampConvertor::convert( now, m_millisecondsInTimeStamp );
+  LogRing::Kind kind;
+  while( m_pRing->pop( kind, m_line ) )
+  {
+    if( kind == LogRing::CLEAR || kind == LogRing::BACKUP )
     {
-      file_rename( m_messagesFileName.c_str(), messagesFileName.str().c_str() );
-      file_rename( m_eventFileName.c_str(), eventFileName.str().c_str() );
-      m_messages.open( m_messagesFileName.c_str(), std::ios::out | std::ios::trunc );
-      m_event.open( m_eventFileName.c_str(), std::ios::out | std::ios::trunc );
-      return;
+      // lines queued before the marker belong to the old files
+      writeBuffers();
+      if( kind == LogRing::CLEAR ) clearFiles();
+      else backupFiles();
+      continue;
     }
-    
-    if( messagesLogFile != NULL ) file_fclose( messagesLogFile );
-    if( eventLogFile != NULL ) file_fclose( eventLogFile );
+
+    std::string& buffer
+      = kind == LogRing::MESSAGE ? m_messagesBuffer : m_eventBuffer;
+    buffer += time;
+    buffer += " : ";
+    buffer += m_line;
+    buffer += '\n';
+  }
+
+  long dropped = m_dropped.load();
+  if( dropped != m_reportedDropped )
+  {
+    m_eventBuffer += time + " : Dropped "
+      + IntConvertor::convert( (int)( dropped - m_reportedDropped ) )
+      + " log lines, queue full\n";
+    m_reportedDropped = dropped;
   }
+
+  writeBuffers();
+  if( m_rotation.enabled() ) rotate( now );
+}
+
+void FileLog::writeBuffers()
+{
+  if( m_messagesBuffer.size() )
+  {
+    m_messages.write( m_messagesBuffer.data(), m_messagesBuffer.size() );
+    m_messages.flush();
+    m_messagesSize += m_messagesBuffer.size();
+    m_messagesBuffer.clear();
+  }
+  if( m_eventBuffer.size() )
+  {
+    m_event.write( m_eventBuffer.data(), m_eventBuffer.size() );
+    m_event.flush();
+    m_eventSize += m_eventBuffer.size();
+    m_eventBuffer.clear();
+  }
+}
+
+void FileLog::rotate( const UtcTimeStamp& now )
+{
+  long long size = std::max( m_messagesSize, m_eventSize );
+  bool full = m_rotation.getSize() > 0 && size >= m_rotation.getSize();
+
+  // the schedule only needs checking once a second
+  if( !full )
+  {
+    time_t second = now.getTimeT();
+    if( second == m_checked ) return;
+    m_checked = second;
+  }
+
+  if( !m_rotation.isDue( size, m_opened, now ) ) return;
+  if( size ) backupFiles();
+  else m_opened = now;
 }
 
 } //namespace FIX
@@ -27,11 +27,48 @@
 #endif
 
 #include "Log.h"
+#include "FileLogWriter.h"
 #include "SessionSettings.h"
+#include "TimeRange.h"
+#include <atomic>
 #include <fstream>
+#include <memory>
 
 namespace FIX
 {
+/**
+ * When a FileLog moves its current files to backups, and how many
+ * backups it keeps.
+ *
+ * Files rotate once either of them reaches the size limit, and on a
+ * schedule when a new session period of the time range begins.  Only
+ * the newest retain backups are kept, zero keeps them all.
+ */
+class LogRotationPolicy
+{
+public:
+  LogRotationPolicy( long long size = 0, int retain = 0 )
+  : m_size( size ), m_retain( retain ) {}
+  LogRotationPolicy( long long size, int retain, const TimeRange& schedule )
+  : m_size( size ), m_retain( retain ), m_schedule( new TimeRange( schedule ) ) {}
+
+  /// Read the FileLogRotate settings, and the session times for a schedule.
+  LogRotationPolicy( const Dictionary& dict ) throw( ConfigError );
+
+  bool enabled() const { return m_size > 0 || m_schedule.get(); }
+  long long getSize() const { return m_size; }
+  int getRetain() const { return m_retain; }
+
+  /// True when files of this size, opened at that time, are due for rotation.
+  bool isDue( long long size, const UtcTimeStamp& opened,
+              const UtcTimeStamp& now ) const;
+
+private:
+  long long m_size;
+  int m_retain;
+  std::shared_ptr < TimeRange > m_schedule;
+};
+
 /**
  * Creates a file based implementation of Log
  *
@@ -46,6 +83,11 @@ public:
 : m_path( path ), m_backupPath( path ), m_globalLog(0), m_globalLogCount(0) {};
   FileLogFactory( const std::string& path, const std::string& backupPath )
 : m_path( path ), m_backupPath( backupPath ), m_globalLog(0), m_globalLogCount(0) {};
+  FileLogFactory( const std::string& path, const std::string& backupPath,
+                  const AsyncLogPolicy& policy,
+                  const LogRotationPolicy& rotation = LogRotationPolicy() )
+: m_path( path ), m_backupPath( backupPath ), m_policy( policy ),
+  m_rotation( rotation ), m_globalLog(0), m_globalLogCount(0) {};
 
 public:
   Log* create();
@@ -55,6 +97,8 @@ public:
 private:
   std::string m_path;
   std::string m_backupPath;
+  AsyncLogPolicy m_policy;
+  LogRotationPolicy m_rotation;
   
   Log* m_globalLog;
   int m_globalLogCount;
@@ -66,8 +110,12 @@ private:
  * Two files are created by this implementation.  One for messages, 
  * and one for events.
  *
+ * In asynchronous mode lines are queued without locking and the
+ * FileLogWriter timestamps and writes them in batches.  Backups,
+ * clears and rotation are queued too and carried out by the writer,
+ * so the logging thread never waits on a close or rename.
  */
-class FileLog : public Log
+class FileLog : public Log, public AsyncLogSink
 {
 public:
   FileLog( const std::string& path );
@@ -80,11 +128,18 @@ public:
   void backup();
 
   void onIncoming( const std::string& value )
-  { m_messages << UtcTimeStampConvertor::convert(UtcTimeStamp(), m_millisecondsInTimeStamp) << " : " << value << std::endl; }
+  {
+    if( m_pRing ) { queue( LogRing::MESSAGE, value ); return; }
+    m_messages << UtcTimeStampConvertor::convert(UtcTimeStamp(), m_millisecondsInTimeStamp) << " : " << value << std::endl;
+  }
   void onOutgoing( const std::string& value )
-  { m_messages << UtcTimeStampConvertor::convert(UtcTimeStamp(), m_millisecondsInTimeStamp) << " : " << value << std::endl; }
+  {
+    if( m_pRing ) { queue( LogRing::MESSAGE, value ); return; }
+    m_messages << UtcTimeStampConvertor::convert(UtcTimeStamp(), m_millisecondsInTimeStamp) << " : " << value << std::endl;
+  }
   void onEvent( const std::string& value )
   {
+    if( m_pRing ) { queue( LogRing::EVENT, value ); return; }
     UtcTimeStamp now;
     m_event << UtcTimeStampConvertor::convert( now, m_millisecondsInTimeStamp )
             << " : " << value << std::endl;
@@ -95,9 +150,27 @@ public:
   void setMillisecondsInTimeStamp ( bool value )
   { m_millisecondsInTimeStamp = value; }
 
+  /// Switch to asynchronous writing, or back when the policy is not async.
+  void setAsync( const AsyncLogPolicy& policy );
+  /// Write queued lines to the files.
+  void flush();
+  /// Rotate files on the writer thread, which switches on queueing.
+  void setRotation( const LogRotationPolicy& policy );
+  /// Number of lines discarded because the queue was full.
+  long getDropped() const { return m_dropped.load(); }
+
+  bool isThreadSafe() const { return m_pRing != 0; }
+
 private:
   std::string generatePrefix( const SessionID& sessionID );
   void init( std::string path, std::string backupPath, const std::string& prefix );
+  void queue( LogRing::Kind kind, const std::string& value );
+  void stopAsync();
+  void writeBuffers();
+  void clearFiles();
+  void backupFiles();
+  void rotate( const UtcTimeStamp& now );
+  std::string backupFileName( const char* type, int index ) const;
 
   std::ofstream m_messages;
   std::ofstream m_event;
@@ -106,6 +179,21 @@ private:
   std::string m_fullPrefix;
   std::string m_fullBackupPrefix;
   bool m_millisecondsInTimeStamp;
+
+  LogRing* m_pRing;
+  AsyncLogPolicy::Overflow m_overflow;
+  std::atomic < long > m_dropped;
+  long m_reportedDropped;
+  std::string m_line;
+  std::string m_messagesBuffer;
+  std::string m_eventBuffer;
+  Mutex m_writeMutex;
+
+  LogRotationPolicy m_rotation;
+  long long m_messagesSize;
+  long long m_eventSize;
+  UtcTimeStamp m_opened;
+  time_t m_checked;
 };
 }
 
@@ -0,0 +1,181 @@
+/****************************************************************************
+** Copyright (c) 2001-2014
+**
+** This file is part of the QuickFIX FIX Engine
+**
+** This file may be distributed under the terms of the quickfixengine.org
+** license as defined by quickfixengine.org and appearing in the file
+** LICENSE included in the packaging of this file.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** See http://www.quickfixengine.org/LICENSE for licensing information.
+**
+** Contact ask@quickfixengine.org if any conditions of this licensing are
+** not clear to you.
+**
+****************************************************************************/
+
+#ifdef _MSC_VER
+#include "stdafx.h"
+#else
+#include "config.h"
+#endif
+
+#include "FileLogWriter.h"
+#include "SessionSettings.h"
+
+namespace FIX
+{
+AsyncLogPolicy::AsyncLogPolicy( const Dictionary& dict ) throw( ConfigError )
+: m_async( false ), m_queueSize( 8192 ), m_overflow( BLOCK ),
+  m_interval( 1000 )
+{
+  if ( dict.has( FILE_LOG_ASYNC ) )
+    m_async = dict.getBool( FILE_LOG_ASYNC );
+
+  if ( dict.has( FILE_LOG_ASYNC_QUEUE_SIZE ) )
+    m_queueSize = dict.getInt( FILE_LOG_ASYNC_QUEUE_SIZE );
+  if ( m_queueSize <= 0 )
+    throw ConfigError( std::string( FILE_LOG_ASYNC_QUEUE_SIZE ) + " must be positive" );
+
+  if ( dict.has( FILE_LOG_ASYNC_OVERFLOW ) )
+    m_overflow = overflow( FILE_LOG_ASYNC_OVERFLOW,
+                           dict.getString( FILE_LOG_ASYNC_OVERFLOW ) );
+
+  if ( dict.has( FILE_LOG_ASYNC_INTERVAL ) )
+    m_interval = dict.getInt( FILE_LOG_ASYNC_INTERVAL );
+  if ( m_interval <= 0 )
+    throw ConfigError( std::string( FILE_LOG_ASYNC_INTERVAL ) + " must be positive" );
+}
+
+AsyncLogPolicy::Overflow AsyncLogPolicy::overflow
+  ( const std::string& key, const std::string& value ) throw( ConfigError )
+{
+  std::string overflow = string_toUpper( value );
+  if ( overflow == "BLOCK" ) return BLOCK;
+  if ( overflow == "DROP" ) return DROP;
+  throw ConfigError( key + " must be BLOCK or DROP" );
+}
+
+LogRing::LogRing( int capacity )
+: m_slots( 0 ), m_mask( 0 ), m_tail( 0 ), m_head( 0 )
+{
+  size_t size = 1;
+  while ( size < (size_t)capacity ) size <<= 1;
+
+  m_slots = new Slot[ size ];
+  m_mask = size - 1;
+  for ( size_t i = 0; i < size; ++i )
+    m_slots[ i ].sequence.store( i, std::memory_order_relaxed );
+}
+
+LogRing::~LogRing()
+{
+  delete [] m_slots;
+}
+
+bool LogRing::push( Kind kind, const char* header, size_t headerSize,
+                    const std::string& text )
+{
+  // a slot is free for the push at position n when its sequence is n,
+  // and holds a line for the pop at position n when its sequence is n + 1
+  size_t position = m_tail.load( std::memory_order_relaxed );
+  Slot* pSlot;
+  while ( true )
+  {
+    pSlot = &m_slots[ position & m_mask ];
+    size_t sequence = pSlot->sequence.load( std::memory_order_acquire );
+    long difference = (long)( sequence - position );
+    if ( difference == 0 )
+    {
+      if ( m_tail.compare_exchange_weak
+           ( position, position + 1, std::memory_order_relaxed ) )
+        break;
+    }
+    else if ( difference < 0 )
+      return false;
+    else
+      position = m_tail.load( std::memory_order_relaxed );
+  }
+
+  pSlot->kind = kind;
+  if ( headerSize )
+  {
+    pSlot->text.assign( header, headerSize );
+    pSlot->text.append( text );
+  }
+  else
+    pSlot->text.assign( text );
+  pSlot->sequence.store( position + 1, std::memory_order_release );
+  return true;
+}
+
+bool LogRing::pop( Kind& kind, std::string& text )
+{
+  size_t position = m_head.load( std::memory_order_relaxed );
+  Slot& slot = m_slots[ position & m_mask ];
+  if ( slot.sequence.load( std::memory_order_acquire ) != position + 1 )
+    return false;
+
+  kind = slot.kind;
+  text.swap( slot.text );
+  slot.sequence.store( position + m_mask + 1, std::memory_order_release );
+  m_head.store( position + 1, std::memory_order_relaxed );
+  return true;
+}
+
+FileLogWriter::FileLogWriter()
+: m_thread( 0 ), m_running( false ), m_stop( false ), m_interval( 0 )
+{
+}
+
+FileLogWriter::~FileLogWriter()
+{
+  if ( !m_running ) return;
+  m_stop = true;
+  m_event.signal();
+  thread_join( m_thread );
+}
+
+void FileLogWriter::add( AsyncLogSink* pLog, long interval )
+{
+  Locker l( m_mutex );
+  m_logs.insert( pLog );
+  if ( !m_interval || interval < m_interval )
+    m_interval = interval;
+  if ( !m_running )
+    m_running = thread_spawn( &startThread, this, m_thread );
+}
+
+void FileLogWriter::remove( AsyncLogSink* pLog )
+{
+  // waits for a drain of the log in progress
+  Locker l( m_mutex );
+  m_logs.erase( pLog );
+}
+
+THREAD_PROC FileLogWriter::startThread( void* p )
+{
+  FileLogWriter* pWriter = static_cast < FileLogWriter* > ( p );
+
+  while ( !pWriter->m_stop )
+  {
+    long interval;
+    {
+      Locker l( pWriter->m_mutex );
+      interval = pWriter->m_interval;
+    }
+    pWriter->m_event.wait( interval / 1000000.0 );
+
+    Locker l( pWriter->m_mutex );
+    Logs::iterator i;
+    for ( i = pWriter->m_logs.begin(); i != pWriter->m_logs.end(); ++i )
+      (*i)->flush();
+  }
+
+  return 0;
+}
+
+} //namespace FIX
@@ -0,0 +1,174 @@
+/* -*- C++ -*- */
+
+/****************************************************************************
+** Copyright (c) 2001-2014
+**
+** This file is part of the QuickFIX FIX Engine
+**
+** This file may be distributed under the terms of the quickfixengine.org
+** license as defined by quickfixengine.org and appearing in the file
+** LICENSE included in the packaging of this file.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** See http://www.quickfixengine.org/LICENSE for licensing information.
+**
+** Contact ask@quickfixengine.org if any conditions of this licensing are
+** not clear to you.
+**
+****************************************************************************/
+
+#ifndef FIX_FILELOGWRITER_H
+#define FIX_FILELOGWRITER_H
+
+#ifdef _MSC_VER
+#pragma warning( disable : 4503 4355 4786 4290 )
+#endif
+
+#include "Dictionary.h"
+#include "Event.h"
+#include "Exceptions.h"
+#include "Mutex.h"
+#include "Utility.h"
+#include <atomic>
+#include <set>
+#include <string>
+
+namespace FIX
+{
+/**
+ * Whether a FileLog writes on the logging thread or hands lines to the
+ * FileLogWriter, and what a full queue does to the logging thread.
+ *
+ * BLOCK waits for the writer to make room, DROP discards the line and
+ * counts it.
+ */
+class AsyncLogPolicy
+{
+public:
+  enum Overflow { BLOCK, DROP };
+
+  AsyncLogPolicy( bool async = false, int queueSize = 8192,
+                  Overflow overflow = BLOCK, long interval = 1000 )
+  : m_async( async ), m_queueSize( queueSize ), m_overflow( overflow ),
+    m_interval( interval ) {}
+
+  /// Read the FileLogAsync settings from a dictionary.
+  AsyncLogPolicy( const Dictionary& dict ) throw( ConfigError );
+
+  /// Parse the value of an overflow setting.
+  static Overflow overflow( const std::string& key, const std::string& value )
+  throw( ConfigError );
+
+  bool getAsync() const { return m_async; }
+  int getQueueSize() const { return m_queueSize; }
+  Overflow getOverflow() const { return m_overflow; }
+  long getInterval() const { return m_interval; }
+
+private:
+  bool m_async;
+  int m_queueSize;
+  Overflow m_overflow;
+  long m_interval;
+};
+
+/**
+ * Bounded queue of log lines.
+ *
+ * Any number of threads may push, one thread pops.  Slots keep the
+ * capacity of their strings, so once warmed up a push only copies bytes.
+ */
+class LogRing
+{
+public:
+  /// CLEAR and BACKUP are markers carrying no text.
+  enum Kind { MESSAGE, EVENT, CLEAR, BACKUP };
+
+  /// Capacity is rounded up to a power of two.
+  LogRing( int capacity );
+  ~LogRing();
+
+  /// Queue a line, false if the ring is full.
+  bool push( Kind kind, const std::string& text )
+  { return push( kind, 0, 0, text ); }
+  /// Queue a line preceded by a header.
+  bool push( Kind kind, const char* header, size_t headerSize,
+             const std::string& text );
+  /// Take the oldest line, swapping its text into the argument.
+  bool pop( Kind& kind, std::string& text );
+
+  size_t capacity() const { return m_mask + 1; }
+  size_t size() const
+  { return m_tail.load( std::memory_order_relaxed )
+           - m_head.load( std::memory_order_relaxed ); }
+
+private:
+  struct Slot
+  {
+    std::atomic < size_t > sequence;
+    Kind kind;
+    std::string text;
+  };
+
+  LogRing( const LogRing& );
+  LogRing& operator=( const LogRing& );
+
+  Slot* m_slots;
+  size_t m_mask;
+  char m_pad1[ 64 ];
+  std::atomic < size_t > m_tail;
+  char m_pad2[ 64 ];
+  std::atomic < size_t > m_head;
+};
+
+/// Log output drained by the FileLogWriter.
+class AsyncLogSink
+{
+public:
+  virtual ~AsyncLogSink() {}
+  /// Write everything queued so far.
+  virtual void flush() = 0;
+};
+
+/**
+ * Background writer for asynchronous file logs.
+ *
+ * A single thread drains every registered sink at the shortest of
+ * their intervals, or sooner when a queue fills up, and writes each
+ * sink's lines with one call per file.
+ */
+class FileLogWriter
+{
+public:
+  static FileLogWriter& instance()
+  {
+    static FileLogWriter writer;
+    return writer;
+  }
+
+  void add( AsyncLogSink*, long interval );
+  /// Stop draining the sink, it flushes whatever is left itself.
+  void remove( AsyncLogSink* );
+  /// Drain all logs now.
+  void wake() { m_event.signal(); }
+
+private:
+  typedef std::set < AsyncLogSink* > Logs;
+
+  FileLogWriter();
+  ~FileLogWriter();
+
+  static THREAD_PROC startThread( void* p );
+
+  Logs m_logs;
+  Mutex m_mutex;
+  Event m_event;
+  thread_id m_thread;
+  bool m_running;
+  bool m_stop;
+  long m_interval;
+};
+}
+
+#endif //FIX_FILELOGWRITER_H
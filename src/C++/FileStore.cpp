@@ -27,12 +27,24 @@
 #include "SessionID.h"
 #include "Parser.h"
 #include "Utility.h"
+#include <algorithm>
 #include <fstream>
 
 namespace FIX
 {
-FileStore::FileStore( std::string path, const SessionID& s )
-: m_msgFile( 0 ), m_headerFile( 0 ), m_seqNumsFile( 0 ), m_sessionFile( 0 )
+namespace
+{
+const char CHECKPOINT_MAGIC[ 8 ] = { 'Q', 'F', 'C', 'K', 'P', 'T', '0', '1' };
+const size_t REPLAY_CHUNK = 4096;
+}
+
+FileStore::FileStore( std::string path, const SessionID& s,
+                      const SyncPolicy& policy, int checkpointInterval )
+: m_sessionID( s ), m_policy( policy ),
+  m_pCheckpoint( 0 ), m_checkpointSize( 0 ), m_pCheckpointRecords( 0 ),
+  m_checkpointCount( 0 ), m_indexLength( 0 ),
+  m_checkpointInterval( checkpointInterval ), m_sinceCheckpoint( 0 ),
+  m_msgFile( 0 ), m_indexFile( 0 ), m_sessionFile( 0 )
 {
   file_mkdir( path.c_str() );
   if ( path.empty() ) 
@@ -41,7 +53,10 @@ FileStore::FileStore( std::string path, const SessionID& s )
     = file_appendpath(path, s.getName() + ".");
 
   m_msgFileName = prefix + "body";
+  m_indexFileName = prefix + "index";
+  m_checkpointFileName = prefix + "checkpoint";
   m_headerFileName = prefix + "header";
+  m_seqPageFileName = prefix + "seqpage";
   m_seqNumsFileName = prefix + "seqnums";
   m_sessionFileName = prefix + "session";
 
@@ -57,28 +72,48 @@ FileStore::FileStore( std::string path, const SessionID& s )
 
 FileStore::~FileStore()
 {
-  if( m_msgFile ) fclose( m_msgFile );
-  if( m_headerFile ) fclose( m_headerFile );
-  if( m_seqNumsFile ) fclose( m_seqNumsFile );
-  if( m_sessionFile ) fclose( m_sessionFile );
+  StoreSyncer::instance().remove( this );
+
+  // checkpoint on a clean shutdown so the next open has nothing to replay
+  try
+  {
+    if ( m_indexFile && m_sinceCheckpoint ) checkpoint();
+  }
+  catch( std::exception& ) {}
+
+  close();
 }
 
-void FileStore::open( bool deleteFile )
+void FileStore::close()
 {
   if ( m_msgFile ) fclose( m_msgFile );
-  if ( m_headerFile ) fclose( m_headerFile );
-  if ( m_seqNumsFile ) fclose( m_seqNumsFile );
+  if ( m_indexFile ) fclose( m_indexFile );
   if ( m_sessionFile ) fclose( m_sessionFile );
 
   m_msgFile = 0;
-  m_headerFile = 0;
-  m_seqNumsFile = 0;
+  m_indexFile = 0;
   m_sessionFile = 0;
 
+  m_seqPage.close();
+
+  unmapCheckpoint();
+  m_offsets.clear();
+  m_indexLength = 0;
+  m_sinceCheckpoint = 0;
+}
+
+void FileStore::open( bool deleteFile )
+{
+  StoreSyncer::instance().remove( this );
+  close();
+
   if ( deleteFile )
   {
     file_unlink( m_msgFileName.c_str() );
+    file_unlink( m_indexFileName.c_str() );
+    file_unlink( m_checkpointFileName.c_str() );
     file_unlink( m_headerFileName.c_str() );
+    file_unlink( m_seqPageFileName.c_str() );
     file_unlink( m_seqNumsFileName.c_str() );
     file_unlink( m_sessionFileName.c_str() );
   }
@@ -88,13 +123,12 @@ void FileStore::open( bool deleteFile )
   if ( !m_msgFile ) m_msgFile = file_fopen( m_msgFileName.c_str(), "w+" );
   if ( !m_msgFile ) throw ConfigError( "Could not open body file: " + m_msgFileName );
 
-  m_headerFile = file_fopen( m_headerFileName.c_str(), "r+" );
-  if ( !m_headerFile ) m_headerFile = file_fopen( m_headerFileName.c_str(), "w+" );
-  if ( !m_headerFile ) throw ConfigError( "Could not open header file: " + m_headerFileName );
-
-  m_seqNumsFile = file_fopen( m_seqNumsFileName.c_str(), "r+" );
-  if ( !m_seqNumsFile ) m_seqNumsFile = file_fopen( m_seqNumsFileName.c_str(), "w+" );
-  if ( !m_seqNumsFile ) throw ConfigError( "Could not open seqnums file: " + m_seqNumsFileName );
+  m_indexFile = file_fopen( m_indexFileName.c_str(), "r+b" );
+  if ( !m_indexFile ) m_indexFile = file_fopen( m_indexFileName.c_str(), "w+b" );
+  if ( !m_indexFile ) throw ConfigError( "Could not open index file: " + m_indexFileName );
+  // a torn record at the end of the index is overwritten by the next one
+  if ( fseek( m_indexFile, (long)m_indexLength, SEEK_SET ) )
+    throw ConfigError( "Cannot seek in index file: " + m_indexFileName );
 
   bool setCreationTime = false;
   m_sessionFile = file_fopen( m_sessionFileName.c_str(), "r" );
@@ -108,34 +142,38 @@ void FileStore::open( bool deleteFile )
 
   setNextSenderMsgSeqNum( getNextSenderMsgSeqNum() );
   setNextTargetMsgSeqNum( getNextTargetMsgSeqNum() );
+
+  StoreSyncer::instance().add( this, m_sessionID, m_policy );
 }
 
 void FileStore::populateCache()
 {
-  FILE* headerFile = file_fopen( m_headerFileName.c_str(), "r+" );
-  if ( headerFile )
-  {
-    int num;
-    long offset;
-    size_t size;
+  if ( !file_exists( m_indexFileName.c_str() ) )
+    convertHeader( m_headerFileName.substr( 0, m_headerFileName.size() - 6 ) );
 
-    while ( FILE_FSCANF( headerFile, "%d,%ld,%lu ", &num, &offset, &size ) == 3 )
-      m_offsets[ num ] = std::make_pair( offset, size );
-    fclose( headerFile );
-  }
+  mapCheckpoint();
+  replayIndex();
 
-  FILE* seqNumsFile = file_fopen( m_seqNumsFileName.c_str(), "r+" );
+  // the text seqnums file of earlier versions is read before the page is
+  // touched, so a new page is seeded with its numbers in a single write
+  int sender = 1, target = 1;
+  bool migrate = false;
+  FILE* seqNumsFile = file_fopen( m_seqNumsFileName.c_str(), "r" );
   if ( seqNumsFile )
   {
-    int sender, target;
-    if ( FILE_FSCANF( seqNumsFile, "%d : %d", &sender, &target ) == 2 )
-    {
-      m_cache.setNextSenderMsgSeqNum( sender );
-      m_cache.setNextTargetMsgSeqNum( target );
-    }
+    migrate = FILE_FSCANF( seqNumsFile, "%d : %d", &sender, &target ) == 2;
     fclose( seqNumsFile );
+    if ( !migrate ) sender = target = 1;
   }
 
+  m_seqPage.open( m_seqPageFileName, sender, target );
+  m_cache.setNextSenderMsgSeqNum( m_seqPage.getSender() );
+  m_cache.setNextTargetMsgSeqNum( m_seqPage.getTarget() );
+
+  // only drop the old file once the page durably holds the numbers
+  if ( migrate && ( m_seqPage.loaded() || m_seqPage.sync() ) )
+    file_unlink( m_seqNumsFileName.c_str() );
+
   FILE* sessionFile = file_fopen( m_sessionFileName.c_str(), "r+" );
   if ( sessionFile )
   {
@@ -153,15 +191,216 @@ void FileStore::populateCache()
   }
 }
 
+void FileStore::mapCheckpoint()
+{
+  unmapCheckpoint();
+  if ( !file_exists( m_checkpointFileName.c_str() ) ) return;
+
+  size_t size = 0;
+  void* pCheckpoint = file_mmap( m_checkpointFileName.c_str(), size );
+  if ( !pCheckpoint ) return;
+
+  const CheckpointHeader* pHeader = (const CheckpointHeader*)pCheckpoint;
+  if ( size < sizeof( CheckpointHeader )
+       || memcmp( pHeader->magic, CHECKPOINT_MAGIC, sizeof( CHECKPOINT_MAGIC ) ) != 0
+       || pHeader->count < 0
+       || sizeof( CheckpointHeader ) + pHeader->count * sizeof( IndexRecord ) > size )
+  {
+    file_munmap( pCheckpoint, size );
+    return;
+  }
+
+  m_pCheckpoint = pCheckpoint;
+  m_checkpointSize = size;
+  m_pCheckpointRecords = (const IndexRecord*)( pHeader + 1 );
+  m_checkpointCount = (size_t)pHeader->count;
+  m_indexLength = pHeader->indexLength;
+}
+
+void FileStore::unmapCheckpoint()
+{
+  if ( m_pCheckpoint ) file_munmap( m_pCheckpoint, m_checkpointSize );
+  m_pCheckpoint = 0;
+  m_checkpointSize = 0;
+  m_pCheckpointRecords = 0;
+  m_checkpointCount = 0;
+}
+
+void FileStore::replayIndex()
+{
+  FILE* indexFile = file_fopen( m_indexFileName.c_str(), "rb" );
+  if ( !indexFile ) return;
+
+  // an index shorter than the checkpoint claims cannot be trusted,
+  // so fall back to replaying all of it
+  if ( fseek( indexFile, 0, SEEK_END ) == 0 && ftell( indexFile ) < m_indexLength )
+  {
+    unmapCheckpoint();
+    m_indexLength = 0;
+  }
+
+  if ( fseek( indexFile, (long)m_indexLength, SEEK_SET ) == 0 )
+  {
+    std::vector < IndexRecord > records( REPLAY_CHUNK );
+    size_t count;
+    while ( ( count = fread( &records[ 0 ], sizeof( IndexRecord ),
+                             records.size(), indexFile ) ) > 0 )
+    {
+      for ( size_t i = 0; i < count; ++i )
+      {
+        const IndexRecord& record = records[ i ];
+        m_offsets[ record.msgSeqNum ] = OffsetSize( record.offset, record.size );
+      }
+      m_indexLength += count * sizeof( IndexRecord );
+      m_sinceCheckpoint += (int)count;
+    }
+  }
+  fclose( indexFile );
+}
+
+void FileStore::checkpoint() throw ( IOException )
+{
+  if ( fflush( m_indexFile ) == EOF )
+    throw IOException( "Unable to flush file " + m_indexFileName );
+  if ( m_policy.sync() && !file_datasync( m_indexFile ) )
+    throw IOException( "Unable to sync file " + m_indexFileName );
+
+  std::vector < IndexRecord > records;
+  records.reserve( m_offsets.size() );
+  NumToOffset::const_iterator i;
+  for ( i = m_offsets.begin(); i != m_offsets.end(); ++i )
+  {
+    IndexRecord record = { i->first, (unsigned int)i->second.second, i->second.first };
+    records.push_back( record );
+  }
+
+  bool append = !m_checkpointCount || records.empty()
+    || records.front().msgSeqNum > m_pCheckpointRecords[ m_checkpointCount - 1 ].msgSeqNum;
+  if ( !append )
+  {
+    // sequence numbers went backwards, merge with the tail taking precedence
+    std::vector < IndexRecord > merged;
+    merged.reserve( m_checkpointCount + records.size() );
+    size_t c = 0, r = 0;
+    while ( c < m_checkpointCount || r < records.size() )
+    {
+      if ( r == records.size()
+           || ( c < m_checkpointCount
+                && m_pCheckpointRecords[ c ].msgSeqNum < records[ r ].msgSeqNum ) )
+        merged.push_back( m_pCheckpointRecords[ c++ ] );
+      else
+      {
+        if ( c < m_checkpointCount
+             && m_pCheckpointRecords[ c ].msgSeqNum == records[ r ].msgSeqNum )
+          ++c;
+        merged.push_back( records[ r++ ] );
+      }
+    }
+    records.swap( merged );
+  }
+
+  long long count = append ? m_checkpointCount + records.size() : records.size();
+  size_t skip = append ? m_checkpointCount : 0;
+  unmapCheckpoint();
+
+  if ( append )
+  {
+    writeCheckpoint( m_checkpointFileName, records, skip, count );
+  }
+  else
+  {
+    std::string tempFileName = m_checkpointFileName + ".tmp";
+    file_unlink( tempFileName.c_str() );
+    writeCheckpoint( tempFileName, records, 0, count );
+    file_unlink( m_checkpointFileName.c_str() );
+    if ( file_rename( tempFileName.c_str(), m_checkpointFileName.c_str() ) )
+      throw IOException( "Unable to rename " + tempFileName );
+  }
+
+  m_offsets.clear();
+  m_sinceCheckpoint = 0;
+  mapCheckpoint();
+}
+
+void FileStore::writeCheckpoint( const std::string& fileName,
+                                 const std::vector < IndexRecord > & records,
+                                 size_t skip, long long count )
+{
+  FILE* file = file_fopen( fileName.c_str(), "r+b" );
+  if ( !file ) file = file_fopen( fileName.c_str(), "w+b" );
+  if ( !file ) throw IOException( "Could not open checkpoint file: " + fileName );
+
+  CheckpointHeader header;
+  memcpy( header.magic, CHECKPOINT_MAGIC, sizeof( CHECKPOINT_MAGIC ) );
+  header.indexLength = m_indexLength;
+  header.count = count;
+
+  // records go in before the header that makes them visible
+  bool result =
+    fseek( file, (long)( sizeof( header ) + skip * sizeof( IndexRecord ) ), SEEK_SET ) == 0
+    && ( records.empty()
+         || fwrite( &records[ 0 ], sizeof( IndexRecord ), records.size(), file ) == records.size() )
+    && fflush( file ) == 0
+    && fseek( file, 0, SEEK_SET ) == 0
+    && fwrite( &header, sizeof( header ), 1, file ) == 1
+    && fflush( file ) == 0
+    && ( !m_policy.sync() || file_datasync( file ) );
+  fclose( file );
+
+  if ( !result )
+    throw IOException( "Unable to write checkpoint file " + fileName );
+}
+
+bool FileStore::convertHeader( const std::string& prefix ) throw ( IOException )
+{
+  std::string headerFileName = prefix + "header";
+  std::string indexFileName = prefix + "index";
+  std::string tempFileName = indexFileName + ".tmp";
+
+  FILE* headerFile = file_fopen( headerFileName.c_str(), "r" );
+  if ( !headerFile ) return false;
+
+  FILE* indexFile = file_fopen( tempFileName.c_str(), "wb" );
+  if ( !indexFile )
+  {
+    fclose( headerFile );
+    throw IOException( "Could not open index file: " + tempFileName );
+  }
+
+  int num;
+  long offset;
+  size_t size;
+  bool result = true;
+  while ( result
+          && FILE_FSCANF( headerFile, "%d,%ld,%lu ", &num, &offset, &size ) == 3 )
+  {
+    IndexRecord record = { num, (unsigned int)size, offset };
+    result = fwrite( &record, sizeof( record ), 1, indexFile ) == 1;
+  }
+  fclose( headerFile );
+  result = fflush( indexFile ) == 0 && file_datasync( indexFile ) && result;
+  fclose( indexFile );
+
+  if ( !result || file_rename( tempFileName.c_str(), indexFileName.c_str() ) )
+    throw IOException( "Unable to write index file: " + indexFileName );
+  file_unlink( headerFileName.c_str() );
+  return true;
+}
+
 MessageStore* FileStoreFactory::create( const SessionID& s )
 {
   if ( m_path.size() ) 
-	  return new FileStore( m_path, s );
+	  return new FileStore( m_path, s, m_policy );
 
   std::string path;
   Dictionary settings = SessionSettings::instance().get( s );
   path = settings.getString( FILE_STORE_PATH );
-  return new FileStore( path, s );
+  int checkpointInterval = FileStore::DEFAULT_CHECKPOINT_INTERVAL;
+  if ( settings.has( FILE_STORE_CHECKPOINT_INTERVAL ) )
+    checkpointInterval = settings.getInt( FILE_STORE_CHECKPOINT_INTERVAL );
+  if ( checkpointInterval <= 0 )
+    throw ConfigError( std::string( FILE_STORE_CHECKPOINT_INTERVAL ) + " must be positive" );
+  return new FileStore( path, s, SyncPolicy( settings ), checkpointInterval );
 }
 
 void FileStoreFactory::destroy( MessageStore* pStore )
@@ -174,24 +413,34 @@ throw ( IOException )
 {
   if ( fseek( m_msgFile, 0, SEEK_END ) ) 
     throw IOException( "Cannot seek to end of " + m_msgFileName );
-  if ( fseek( m_headerFile, 0, SEEK_END ) ) 
-    throw IOException( "Cannot seek to end of " + m_headerFileName );
 
   long offset = ftell( m_msgFile );
   if ( offset < 0 ) 
     throw IOException( "Unable to get file pointer position from " + m_msgFileName );
   size_t size = msg.size();
 
-  if ( fprintf( m_headerFile, "%d,%ld,%lu ", msgSeqNum, offset, size ) < 0 )
-    throw IOException( "Unable to write to file " + m_headerFileName );
-  m_offsets[ msgSeqNum ] = std::make_pair( offset, size );
   fwrite( msg.c_str(), sizeof( char ), msg.size(), m_msgFile );
   if ( ferror( m_msgFile ) ) 
     throw IOException( "Unable to write to file " + m_msgFileName );
-  if ( fflush( m_msgFile ) == EOF ) 
-    throw IOException( "Unable to flush file " + m_msgFileName );
-  if ( fflush( m_headerFile ) == EOF ) 
-    throw IOException( "Unable to flush file " + m_headerFileName );
+
+  IndexRecord record = { msgSeqNum, (unsigned int)size, offset };
+  if ( fwrite( &record, sizeof( record ), 1, m_indexFile ) != 1 )
+    throw IOException( "Unable to write to file " + m_indexFileName );
+  m_indexLength += sizeof( record );
+  m_offsets[ msgSeqNum ] = OffsetSize( offset, size );
+
+  if ( m_policy.flush() )
+  {
+    if ( fflush( m_msgFile ) == EOF ) 
+      throw IOException( "Unable to flush file " + m_msgFileName );
+    if ( fflush( m_indexFile ) == EOF ) 
+      throw IOException( "Unable to flush file " + m_indexFileName );
+    if ( m_policy.sync() )
+      StoreSyncer::instance().written( this );
+  }
+
+  if ( ++m_sinceCheckpoint >= m_checkpointInterval )
+    checkpoint();
   return true;
 }
 
@@ -276,13 +525,9 @@ void FileStore::refresh() throw ( IOException )
 
 void FileStore::setSeqNum()
 {
-  rewind( m_seqNumsFile );
-  fprintf( m_seqNumsFile, "%10.10d : %10.10d",
-           getNextSenderMsgSeqNum(), getNextTargetMsgSeqNum() );
-  if ( ferror( m_seqNumsFile ) ) 
-    throw IOException( "Unable to write to file " + m_seqNumsFileName );
-  if ( fflush( m_seqNumsFile ) ) 
-    throw IOException( "Unable to flush file " + m_seqNumsFileName );
+  m_seqPage.set( getNextSenderMsgSeqNum(), getNextTargetMsgSeqNum() );
+  if ( m_policy.sync() )
+    StoreSyncer::instance().written( this, false );
 }
 
 void FileStore::setSession()
@@ -296,13 +541,36 @@ void FileStore::setSession()
     throw IOException( "Unable to flush file " + m_sessionFileName );
 }
 
+bool FileStore::sync()
+{
+  return file_datasync( m_msgFile )
+         && file_datasync( m_indexFile )
+         && m_seqPage.sync();
+}
+
+bool FileStore::find( int msgSeqNum, OffsetSize& offset ) const
+{
+  NumToOffset::const_iterator i = m_offsets.find( msgSeqNum );
+  if ( i != m_offsets.end() )
+  {
+    offset = i->second;
+    return true;
+  }
+
+  const IndexRecord* begin = m_pCheckpointRecords;
+  const IndexRecord* end = m_pCheckpointRecords + m_checkpointCount;
+  const IndexRecord* record = std::lower_bound( begin, end, msgSeqNum, IndexRecordLess() );
+  if ( record == end || record->msgSeqNum != msgSeqNum ) return false;
+  offset = OffsetSize( record->offset, record->size );
+  return true;
+}
+
 bool FileStore::get( int msgSeqNum, std::string& msg ) const
 throw ( IOException )
 {
-  NumToOffset::const_iterator find = m_offsets.find( msgSeqNum );
-  if ( find == m_offsets.end() ) return false;
-  const OffsetSize& offset = find->second;
-  if ( fseek( m_msgFile, offset.first, SEEK_SET ) ) 
+  OffsetSize offset;
+  if ( !find( msgSeqNum, offset ) ) return false;
+  if ( fseek( m_msgFile, (long)offset.first, SEEK_SET ) ) 
     throw IOException( "Unable to seek in file " + m_msgFileName );
   char* buffer = new char[ offset.second + 1 ];
   size_t result = fread( buffer, sizeof( char ), offset.second, m_msgFile );
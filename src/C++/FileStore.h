@@ -28,6 +28,8 @@
 
 #include "MessageStore.h"
 #include "SessionSettings.h"
+#include "StoreSyncer.h"
+#include "SeqNumPage.h"
 #include <fstream>
 #include <string>
 
@@ -41,13 +43,15 @@ class FileStoreFactory : public MessageStoreFactory
 public:
   FileStoreFactory()
  {};
-  FileStoreFactory( const std::string& path )
-: m_path( path ) {};
+  FileStoreFactory( const std::string& path,
+                    const SyncPolicy& policy = SyncPolicy() )
+: m_path( path ), m_policy( policy ) {};
 
   MessageStore* create( const SessionID& );
   void destroy( MessageStore* );
 private:
   std::string m_path;
+  SyncPolicy m_policy;
   
 };
 /*! @} */
@@ -55,33 +59,50 @@ private:
 /**
  * File based implementation of MessageStore.
  *
- * Four files are created by this implementation.  One for storing outgoing
- * messages, one for indexing message locations, one for storing sequence numbers,
- * and one for storing the session creation time.
+ * Five files are created by this implementation.  One for storing outgoing
+ * messages, one for indexing message locations, one holding a sorted
+ * checkpoint of the index, one for storing sequence numbers, and one for
+ * storing the session creation time.
  *
  * The formats of the files are:<br>
  * &nbsp;&nbsp;
  *   [path]+[BeginString]-[SenderCompID]-[TargetCompID].body<br>
  * &nbsp;&nbsp;
- *   [path]+[BeginString]-[SenderCompID]-[TargetCompID].header<br>
+ *   [path]+[BeginString]-[SenderCompID]-[TargetCompID].index<br>
  * &nbsp;&nbsp;
- *   [path]+[BeginString]-[SenderCompID]-[TargetCompID].seqnums<br>
+ *   [path]+[BeginString]-[SenderCompID]-[TargetCompID].checkpoint<br>
+ * &nbsp;&nbsp;
+ *   [path]+[BeginString]-[SenderCompID]-[TargetCompID].seqpage<br>
  * &nbsp;&nbsp;
  *   [path]+[BeginString]-[SenderCompID]-[TargetCompID].session<br>
  *
  *
  * The messages file is a pure stream of %FIX messages.<br><br>
- * The sequence number file is in the format of<br>
+ * The index file is a stream of binary records appended as messages are
+ * stored<br>
+ * &nbsp;&nbsp;
+ *   [MsgSeqNum:4][Size:4][Offset:8]<br><br>
+ * Every checkpoint interval the records are merged into the checkpoint
+ * file, a header holding the length of index it covers followed by the
+ * records sorted by MsgSeqNum.  The checkpoint is mapped into memory on
+ * open, so recovery only replays the index written after it.  Stores with
+ * a text .header index from earlier versions are converted on open.<br><br>
+ * The sequence number file is a memory mapped SeqNumPage, updated in
+ * place for every message.  Text .seqnums files in the format of<br>
  * &nbsp;&nbsp;
  *   [SenderMsgSeqNum] : [TargetMsgSeqNum]<br><br>
+ * from earlier versions are migrated on open.<br><br>
  * The session file is a UTC timestamp in the format of<br>
  * &nbsp;&nbsp;
- *   YYYYMMDD-HH:MM:SS
+ *   YYYYMMDD-HH:MM:SS<br><br>
+ * Writes are flushed or synced to disk according to the SyncPolicy.
  */
-class FileStore : public MessageStore
+class FileStore : public MessageStore, public Syncable
 {
 public:
-  FileStore( std::string, const SessionID& s );
+  FileStore( std::string, const SessionID& s,
+             const SyncPolicy& policy = SyncPolicy(),
+             int checkpointInterval = DEFAULT_CHECKPOINT_INTERVAL );
   virtual ~FileStore();
 
   bool set( int, const std::string& ) throw ( IOException );
@@ -99,28 +120,79 @@ public:
   void reset() throw ( IOException );
   void refresh() throw ( IOException );
 
+  bool sync();
+
+  /// Merge the index written since the last checkpoint into the checkpoint.
+  void checkpoint() throw ( IOException );
+
+  /// Convert the text [prefix]header index of an earlier store version
+  /// into a binary [prefix]index.  Returns false if there is no header.
+  static bool convertHeader( const std::string& prefix ) throw ( IOException );
+
+  static const int DEFAULT_CHECKPOINT_INTERVAL = 10000;
+
 private:
-  typedef std::pair < int, int > OffsetSize;
+  struct IndexRecord
+  {
+    int msgSeqNum;
+    unsigned int size;
+    long long offset;
+  };
+
+  struct CheckpointHeader
+  {
+    char magic[ 8 ];
+    long long indexLength;
+    long long count;
+  };
+
+  struct IndexRecordLess
+  {
+    bool operator()( const IndexRecord& record, int msgSeqNum ) const
+    { return record.msgSeqNum < msgSeqNum; }
+  };
+
+  typedef std::pair < long long, size_t > OffsetSize;
   typedef std::map < int, OffsetSize > NumToOffset;
 
   void open( bool deleteFile );
+  void close();
   void populateCache();
+  void mapCheckpoint();
+  void unmapCheckpoint();
+  void replayIndex();
+  void writeCheckpoint( const std::string&, const std::vector < IndexRecord > &,
+                        size_t skip, long long count );
   void setSeqNum();
   void setSession();
 
+  bool find( int, OffsetSize& ) const;
   bool get( int, std::string& ) const throw ( IOException );
 
   MemoryStore m_cache;
   NumToOffset m_offsets;
+  SeqNumPage m_seqPage;
+  SessionID m_sessionID;
+  SyncPolicy m_policy;
+
+  void* m_pCheckpoint;
+  size_t m_checkpointSize;
+  const IndexRecord* m_pCheckpointRecords;
+  size_t m_checkpointCount;
+  long long m_indexLength;
+  int m_checkpointInterval;
+  int m_sinceCheckpoint;
 
   std::string m_msgFileName;
+  std::string m_indexFileName;
+  std::string m_checkpointFileName;
   std::string m_headerFileName;
+  std::string m_seqPageFileName;
   std::string m_seqNumsFileName;
   std::string m_sessionFileName;
 
   FILE* m_msgFile;
-  FILE* m_headerFile;
-  FILE* m_seqNumsFile;
+  FILE* m_indexFile;
   FILE* m_sessionFile;
 };
 }
@@ -0,0 +1,87 @@
+/****************************************************************************
+** Copyright (c) 2001-2014
+**
+** This file is part of the QuickFIX FIX Engine
+**
+** This file may be distributed under the terms of the quickfixengine.org
+** license as defined by quickfixengine.org and appearing in the file
+** LICENSE included in the packaging of this file.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** See http://www.quickfixengine.org/LICENSE for licensing information.
+**
+** Contact ask@quickfixengine.org if any conditions of this licensing are
+** not clear to you.
+**
+****************************************************************************/
+
+#ifdef _MSC_VER
+#include "stdafx.h"
+#else
+#include "config.h"
+#endif
+
+#include "GapQueue.h"
+
+namespace FIX
+{
+bool GapQueue::push( int msgSeqNum, const std::string& message )
+{
+  Index::iterator i = m_index.find( msgSeqNum );
+  size_t replaced = i == m_index.end() ? 0 : i->second.second;
+  if ( m_maxSize && m_size - replaced + message.size() > m_maxSize )
+    return false;
+
+  // a message received again replaces the earlier copy, which is left
+  // in the buffer until the next compaction
+  m_size -= replaced;
+  m_index[ msgSeqNum ] = std::make_pair( m_buffer.size(), message.size() );
+  m_buffer.append( message );
+  m_size += message.size();
+  return true;
+}
+
+bool GapQueue::pop( int msgSeqNum, std::string& message )
+{
+  Index::iterator i = m_index.find( msgSeqNum );
+  if ( i == m_index.end() ) return false;
+
+  message.assign( m_buffer, i->second.first, i->second.second );
+  m_size -= i->second.second;
+  m_index.erase( i );
+
+  if ( m_index.empty() )
+    clear();
+  else if ( m_buffer.size() - m_size > m_size )
+    compact();
+  return true;
+}
+
+void GapQueue::clear()
+{
+  // give back the memory of a large queue rather than keeping it
+  // around for the next gap
+  if ( m_buffer.capacity() > 64 * 1024 )
+    std::string().swap( m_buffer );
+  else
+    m_buffer.clear();
+  m_index.clear();
+  m_size = 0;
+}
+
+void GapQueue::compact()
+{
+  std::string buffer;
+  buffer.reserve( m_size );
+  for ( Index::iterator i = m_index.begin(); i != m_index.end(); ++i )
+  {
+    size_t offset = buffer.size();
+    buffer.append( m_buffer, i->second.first, i->second.second );
+    i->second.first = offset;
+  }
+  m_buffer.swap( buffer );
+}
+
+} //namespace FIX
@@ -0,0 +1,84 @@
+/* -*- C++ -*- */
+
+/****************************************************************************
+** Copyright (c) 2001-2014
+**
+** This file is part of the QuickFIX FIX Engine
+**
+** This file may be distributed under the terms of the quickfixengine.org
+** license as defined by quickfixengine.org and appearing in the file
+** LICENSE included in the packaging of this file.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** See http://www.quickfixengine.org/LICENSE for licensing information.
+**
+** Contact ask@quickfixengine.org if any conditions of this licensing are
+** not clear to you.
+**
+****************************************************************************/
+
+#ifndef FIX_GAPQUEUE_H
+#define FIX_GAPQUEUE_H
+
+#ifdef _MSC_VER
+#pragma warning( disable : 4503 4355 4786 4290 )
+#endif
+
+#include <map>
+#include <string>
+
+namespace FIX
+{
+/**
+ * Messages received ahead of a sequence gap.
+ *
+ * Messages are kept as the bytes received, back to back in one buffer,
+ * and only parsed again once the gap is filled.  The buffer is compacted
+ * as messages are taken out, and an optional limit on the bytes held
+ * bounds the memory a long gap on a busy session can use.
+ */
+class GapQueue
+{
+public:
+  /// What a session does when a message would exceed the limit.
+  enum Overflow
+  {
+    /// Disconnect, queued messages are requested again after logon.
+    DISCONNECT,
+    /// Drop the message, it is requested again once the gap is filled.
+    RESEND
+  };
+
+  GapQueue( size_t maxSize = 0 )
+  : m_maxSize( maxSize ), m_size( 0 ) {}
+
+  /// Queue a message, false if it would exceed the limit.
+  bool push( int msgSeqNum, const std::string& message );
+  /// Take out the message with this sequence number, if queued.
+  bool pop( int msgSeqNum, std::string& message );
+  void clear();
+
+  bool empty() const { return m_index.empty(); }
+  size_t count() const { return m_index.size(); }
+  /// Bytes of the messages queued.
+  size_t size() const { return m_size; }
+
+  /// Limit on bytes queued, 0 for no limit.
+  void setMaxSize( size_t value ) { m_maxSize = value; }
+  size_t getMaxSize() const { return m_maxSize; }
+
+private:
+  typedef std::map < int, std::pair < size_t, size_t > > Index;
+
+  void compact();
+
+  std::string m_buffer;
+  Index m_index;
+  size_t m_maxSize;
+  size_t m_size;
+};
+}
+
+#endif //FIX_GAPQUEUE_H
@@ -27,6 +27,7 @@
 #include "HttpMessage.h"
 #include "HtmlBuilder.h"
 #include "Session.h"
+#include "StoreSyncer.h"
 #include "Utility.h"
 
 using namespace HTML;
@@ -548,6 +549,10 @@ void HttpConnection::processSession
     showRow( b, REFRESH_ON_LOGON, pSession->getRefreshOnLogon(), url );
     showRow( b, MILLISECONDS_IN_TIMESTAMP, pSession->getMillisecondsInTimeStamp(), url );
     showRow( b, PERSIST_MESSAGES, pSession->getPersistMessages(), url );
+
+    StoreSyncer::Statistics statistics;
+    if( StoreSyncer::instance().getStatistics( sessionID, statistics ) )
+      showRow( b, "Store Sync", StoreSyncer::describe( statistics ) );
   }
   catch( std::exception& e )
   {
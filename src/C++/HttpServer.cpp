@@ -34,7 +34,7 @@ Mutex HttpServer::s_mutex;
 int HttpServer::s_count = 0;
 HttpServer* HttpServer::s_pServer = 0;
 
-void HttpServer::startGlobal() 
+void HttpServer::startGlobal( Log* pLog )
 throw ( ConfigError, RuntimeError )
 {
   Locker l( s_mutex );
@@ -47,6 +47,8 @@ throw ( ConfigError, RuntimeError )
   {
     s_pServer = new HttpServer();
     s_pServer->start();
+    if( pLog )
+      pLog->onEvent( "Http server thread " + s_pServer->m_placement );
   }
 }
 
@@ -69,7 +71,10 @@ HttpServer::HttpServer(  ) throw( ConfigError )
 void HttpServer::onConfigure()
 throw ( ConfigError )
 {  
-  m_port = SessionSettings::instance().get().getInt( HTTP_ACCEPT_PORT );
+  const Dictionary& settings = SessionSettings::instance().get();
+  m_port = settings.getInt( HTTP_ACCEPT_PORT );
+  m_threadSettings = ThreadSettings( settings, HTTP_THREAD_AFFINITY,
+    HTTP_THREAD_NAME, HTTP_THREAD_PRIORITY, "fix-http" );
 }
 
 void HttpServer::onInitialize()
@@ -94,6 +99,7 @@ void HttpServer::start() throw ( ConfigError, RuntimeError )
 
   if( !thread_spawn( &startThread, this, m_threadid ) )
     throw RuntimeError("Unable to spawn thread");
+  m_placement = m_threadSettings.apply( m_threadid );
 }
 
 void HttpServer::stop()
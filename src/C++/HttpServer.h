@@ -30,6 +30,8 @@
 #include "SessionSettings.h"
 #include "Exceptions.h"
 #include "Mutex.h"
+#include "ThreadSettings.h"
+#include "Log.h"
 
 namespace FIX
 {
@@ -39,7 +41,7 @@ class HttpServer : public SocketServer::Strategy
 public:
   HttpServer() throw( ConfigError );
 
-  static void startGlobal() throw ( ConfigError, RuntimeError );
+  static void startGlobal( Log* pLog = 0 ) throw ( ConfigError, RuntimeError );
   static void stopGlobal();
 
   void start() throw ( ConfigError, RuntimeError );
@@ -66,6 +68,8 @@ private:
   thread_id m_threadid;
   int m_port;
   bool m_stop;
+  ThreadSettings m_threadSettings;
+  std::string m_placement;
 
   static Mutex s_mutex;
   static int s_count;
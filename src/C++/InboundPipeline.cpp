@@ -0,0 +1,440 @@
+/****************************************************************************
+** Copyright (c) 2001-2014
+**
+** This file is part of the QuickFIX FIX Engine
+**
+** This file may be distributed under the terms of the quickfixengine.org
+** license as defined by quickfixengine.org and appearing in the file
+** LICENSE included in the packaging of this file.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** See http://www.quickfixengine.org/LICENSE for licensing information.
+**
+** Contact ask@quickfixengine.org if any conditions of this licensing are
+** not clear to you.
+**
+****************************************************************************/
+
+#ifdef _MSC_VER
+#include "stdafx.h"
+#else
+#include "config.h"
+#endif
+
+#include "InboundPipeline.h"
+#include "Session.h"
+#include "SessionSettings.h"
+#include "Utility.h"
+#include <algorithm>
+
+namespace FIX
+{
+struct InboundPipeline::Worker
+{
+  Worker( bool d )
+  : decode( d ), started( 0 ), finished( 0 ), draining( 0 ),
+    sleeping( false ), stop( false ), thread( 0 ) {}
+
+  /// Work through every lane once, true if anything moved.
+  bool run()
+  {
+    // fromApp runs without the mutex, so lanes can come and go meanwhile
+    size_t pass;
+    {
+      Locker l( mutex );
+      pass = ++started;
+      running.assign( lanes.begin(), lanes.end() );
+    }
+
+    bool busy = false;
+    std::vector < InboundLane* >::iterator i;
+    for( i = running.begin(); i != running.end(); ++i )
+      busy |= decode ? (*i)->decode() : (*i)->dispatch();
+    finished = pass;
+    if( draining )
+      passed.signal();
+    return busy;
+  }
+
+  /// Wait for a pass that may still see a lane just taken off this worker.
+  void drain()
+  {
+    size_t pass;
+    {
+      Locker l( mutex );
+      pass = started;
+    }
+
+    // announce the wait before looking, a pass ending in between either
+    // sees the count or is seen by the look
+    ++draining;
+    while( finished < pass )
+      passed.wait( 1 );
+    --draining;
+  }
+
+  /// Called after publishing to a lane of this worker.
+  void wake()
+  {
+    std::atomic_thread_fence( std::memory_order_seq_cst );
+    if( sleeping.load( std::memory_order_relaxed ) && sleeping.exchange( false ) )
+      event.signal();
+  }
+
+  bool decode;
+  std::vector < InboundLane* > lanes;
+  // the worker thread's copy of lanes for the pass in progress
+  std::vector < InboundLane* > running;
+  size_t started;
+  std::atomic < size_t > finished;
+  std::atomic < int > draining;
+  Mutex mutex;
+  Event event;
+  // signalled at the end of each pass while a drain waits for it
+  Event passed;
+  std::atomic < bool > sleeping;
+  std::atomic < bool > stop;
+  thread_id thread;
+};
+
+InboundPipeline::InboundPipeline( int decodeThreads, int applicationThreads,
+                                  int queueSize,
+                                  const ThreadSettings& threadSettings )
+: m_queueSize( queueSize ), m_threadSettings( threadSettings ),
+  m_next( 0 ), m_running( false )
+{
+  create( decodeThreads, applicationThreads );
+}
+
+InboundPipeline::InboundPipeline( const Dictionary& dict ) throw( ConfigError )
+: m_queueSize( 1024 ),
+  m_threadSettings( dict, INBOUND_THREAD_AFFINITY, INBOUND_THREAD_NAME,
+                    INBOUND_THREAD_PRIORITY, "fix-inbound" ),
+  m_next( 0 ), m_running( false )
+{
+  int decodeThreads = 1;
+  int applicationThreads = 1;
+
+  if( dict.has( INBOUND_DECODE_THREADS ) )
+    decodeThreads = dict.getInt( INBOUND_DECODE_THREADS );
+  if( decodeThreads <= 0 )
+    throw ConfigError( std::string( INBOUND_DECODE_THREADS ) + " must be positive" );
+
+  if( dict.has( INBOUND_APPLICATION_THREADS ) )
+    applicationThreads = dict.getInt( INBOUND_APPLICATION_THREADS );
+  if( applicationThreads <= 0 )
+    throw ConfigError( std::string( INBOUND_APPLICATION_THREADS ) + " must be positive" );
+
+  if( dict.has( INBOUND_QUEUE_SIZE ) )
+    m_queueSize = dict.getInt( INBOUND_QUEUE_SIZE );
+  if( m_queueSize <= 0 )
+    throw ConfigError( std::string( INBOUND_QUEUE_SIZE ) + " must be positive" );
+
+  create( decodeThreads, applicationThreads );
+}
+
+InboundPipeline::~InboundPipeline()
+{
+  stop();
+  Workers::iterator i;
+  for( i = m_decoders.begin(); i != m_decoders.end(); ++i )
+    delete *i;
+  for( i = m_dispatchers.begin(); i != m_dispatchers.end(); ++i )
+    delete *i;
+}
+
+void InboundPipeline::create( int decodeThreads, int applicationThreads )
+{
+  for( int i = 0; i < decodeThreads; ++i )
+    m_decoders.push_back( new Worker( true ) );
+  for( int i = 0; i < applicationThreads; ++i )
+    m_dispatchers.push_back( new Worker( false ) );
+}
+
+void InboundPipeline::start() throw( RuntimeError )
+{
+  Locker l( m_mutex );
+  if( m_running ) return;
+
+  Workers workers( m_decoders );
+  workers.insert( workers.end(), m_dispatchers.begin(), m_dispatchers.end() );
+  for( Workers::iterator i = workers.begin(); i != workers.end(); ++i )
+  {
+    (*i)->stop = false;
+    if( !thread_spawn( &startThread, *i, (*i)->thread ) )
+      throw RuntimeError( "Unable to spawn inbound pipeline thread" );
+    m_running = true;
+    m_threadSettings.apply( (*i)->thread );
+  }
+}
+
+void InboundPipeline::stop()
+{
+  Locker l( m_mutex );
+  if( !m_running ) return;
+
+  Workers workers( m_decoders );
+  workers.insert( workers.end(), m_dispatchers.begin(), m_dispatchers.end() );
+  for( Workers::iterator i = workers.begin(); i != workers.end(); ++i )
+  {
+    if( !(*i)->thread ) continue;
+    (*i)->stop = true;
+    (*i)->event.signal();
+    thread_join( (*i)->thread );
+    (*i)->thread = 0;
+  }
+  m_running = false;
+}
+
+InboundLane* InboundPipeline::add( Session* pSession, InboundSource* pSource )
+{
+  Worker* pDecoder;
+  Worker* pDispatcher;
+  {
+    Locker l( m_mutex );
+    pDecoder = m_decoders[ m_next % m_decoders.size() ];
+    pDispatcher = m_dispatchers[ m_next % m_dispatchers.size() ];
+    ++m_next;
+  }
+
+  InboundLane* pLane = new InboundLane
+    ( pSession, pSource, m_queueSize, pDecoder, pDispatcher );
+  {
+    Locker l( pDecoder->mutex );
+    pDecoder->lanes.push_back( pLane );
+  }
+  {
+    Locker l( pDispatcher->mutex );
+    pDispatcher->lanes.push_back( pLane );
+  }
+  pSession->setInboundLane( pLane );
+  return pLane;
+}
+
+void InboundPipeline::remove( InboundLane* pLane )
+{
+  SessionRegistry::Reference pSession( pLane->m_handle );
+  bool live = pSession.get() == pLane->getSession();
+  if( live && pSession->getInboundLane() == pLane )
+    pSession->setInboundLane( 0 );
+
+  // the session has already counted these, so they must still reach
+  // the application before the lane goes away, dispatch() signals the
+  // room like it does for deliver()
+  while( live && m_running )
+  {
+    pLane->m_waiting = true;
+    std::atomic_thread_fence( std::memory_order_seq_cst );
+    if( pLane->m_application.empty() )
+      break;
+    pLane->reject();
+    pLane->m_pDispatcher->wake();
+    pLane->m_room.wait( 1 );
+  }
+  pLane->m_waiting = false;
+
+  Worker* workers[] = { pLane->m_pDecoder, pLane->m_pDispatcher };
+  for( int i = 0; i < 2; ++i )
+  {
+    {
+      Locker l( workers[ i ]->mutex );
+      std::vector < InboundLane* >& lanes = workers[ i ]->lanes;
+      lanes.erase( std::remove( lanes.begin(), lanes.end(), pLane ), lanes.end() );
+    }
+    workers[ i ]->drain();
+  }
+
+  // nothing else reads the rejected ring now
+  pLane->reject();
+  delete pLane;
+}
+
+THREAD_PROC InboundPipeline::startThread( void* p )
+{
+  Worker* pWorker = static_cast < Worker* > ( p );
+
+  while( !pWorker->stop )
+  {
+    if( pWorker->run() )
+      continue;
+
+    // announce the sleep before looking once more, a lane published to
+    // in between either sees the flag or is seen by the second look
+    pWorker->sleeping = true;
+    std::atomic_thread_fence( std::memory_order_seq_cst );
+    if( !pWorker->run() )
+      pWorker->event.wait( 1 );
+    pWorker->sleeping = false;
+  }
+
+  return 0;
+}
+
+InboundLane::InboundLane( Session* pSession, InboundSource* pSource,
+                          int queueSize,
+                          InboundPipeline::Worker* pDecoder,
+                          InboundPipeline::Worker* pDispatcher )
+: m_pSession( pSession ), m_handle( pSession->getHandle() ),
+  m_pSource( pSource ),
+  m_pDecoder( pDecoder ), m_pDispatcher( pDispatcher ),
+  m_framed( queueSize ), m_decoded( queueSize ),
+  m_application( queueSize ), m_rejected( queueSize ),
+  m_held( false ), m_waiting( false )
+{
+}
+
+void InboundLane::pushFrame()
+{
+  m_framed.publish();
+  m_pDecoder->wake();
+}
+
+void InboundLane::popDecoded()
+{
+  // the decode thread may be waiting for the room
+  m_decoded.pop();
+  m_pDecoder->wake();
+}
+
+bool InboundLane::hold()
+{
+  if( !m_application.full() )
+    return false;
+
+  // announce before looking again, like a sleeping worker
+  m_held = true;
+  std::atomic_thread_fence( std::memory_order_seq_cst );
+  if( !m_application.full() )
+  {
+    m_held = false;
+    return false;
+  }
+  m_pDispatcher->wake();
+  return true;
+}
+
+void InboundLane::deliver( Message& message )
+{
+  // hold() keeps the connection thread from getting here with a full
+  // ring, unless one message releases several queued behind a gap
+  Message* pSlot;
+  while( !( pSlot = m_application.claim() ) )
+  {
+    // announce before looking again, dispatch() signals once it pops
+    m_waiting = true;
+    std::atomic_thread_fence( std::memory_order_seq_cst );
+    if( ( pSlot = m_application.claim() ) != 0 )
+    {
+      m_waiting = false;
+      break;
+    }
+    // the application stage may itself be waiting for rejects to go
+    reject();
+    m_pDispatcher->wake();
+    m_room.wait( 1 );
+    m_waiting = false;
+  }
+
+  pSlot->swap( message );
+  m_application.publish();
+  m_pDispatcher->wake();
+}
+
+bool InboundLane::reject()
+{
+  SessionRegistry::Reference pSession( m_handle );
+  if( pSession.get() != m_pSession )
+    return false;
+
+  size_t count = 0;
+  Rejected* pRejected;
+
+  while( ( pRejected = m_rejected.front() ) != 0 )
+  {
+    m_pSession->rejectApplication( pRejected->message, pRejected->error );
+    pRejected->error = std::exception_ptr();
+    m_rejected.pop();
+    ++count;
+  }
+
+  // the application thread may be waiting for the room
+  if( count )
+    m_pDispatcher->wake();
+  return count > 0;
+}
+
+bool InboundLane::decode()
+{
+  // a destroyed session leaves its lane idle until it is removed
+  SessionRegistry::Reference pSession( m_handle );
+  if( pSession.get() != m_pSession )
+    return false;
+
+  size_t count = 0;
+  std::string* pFrame;
+  Decoded* pDecoded;
+
+  while( count < m_framed.capacity()
+         && ( pFrame = m_framed.front() ) != 0
+         && ( pDecoded = m_decoded.claim() ) != 0 )
+  {
+    // swapping hands the buffer of the last message back for reuse
+    pDecoded->string.swap( *pFrame );
+    pDecoded->valid = m_pSession->decode( pDecoded->string, pDecoded->message );
+    m_framed.pop();
+    m_decoded.publish();
+    ++count;
+  }
+
+  if( count )
+    m_pSource->onDecoded();
+  return count > 0;
+}
+
+bool InboundLane::dispatch()
+{
+  SessionRegistry::Reference pSession( m_handle );
+  if( pSession.get() != m_pSession )
+    return false;
+
+  size_t count = 0;
+  size_t rejected = 0;
+  Message* pMessage;
+  Rejected* pRejected;
+
+  // a message is only taken with room for its reject, which is left to
+  // the connection thread along with everything else touching the session
+  while( count < m_application.capacity()
+         && ( pMessage = m_application.front() ) != 0
+         && ( pRejected = m_rejected.claim() ) != 0 )
+  {
+    try
+    {
+      m_pSession->nextApplication( *pMessage );
+    }
+    catch( std::exception& )
+    {
+      pRejected->message.swap( *pMessage );
+      pRejected->error = std::current_exception();
+      m_rejected.publish();
+      ++rejected;
+    }
+    m_application.pop();
+    ++count;
+  }
+
+  if( !count )
+    return false;
+
+  std::atomic_thread_fence( std::memory_order_seq_cst );
+  if( m_waiting.load( std::memory_order_relaxed ) && m_waiting.exchange( false ) )
+    m_room.signal();
+  if( rejected
+      || ( m_held.load( std::memory_order_relaxed ) && m_held.exchange( false ) ) )
+    m_pSource->onDecoded();
+  return true;
+}
+
+} //namespace FIX
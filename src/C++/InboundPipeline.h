@@ -0,0 +1,203 @@
+/* -*- C++ -*- */
+
+/****************************************************************************
+** Copyright (c) 2001-2014
+**
+** This file is part of the QuickFIX FIX Engine
+**
+** This file may be distributed under the terms of the quickfixengine.org
+** license as defined by quickfixengine.org and appearing in the file
+** LICENSE included in the packaging of this file.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** See http://www.quickfixengine.org/LICENSE for licensing information.
+**
+** Contact ask@quickfixengine.org if any conditions of this licensing are
+** not clear to you.
+**
+****************************************************************************/
+
+#ifndef FIX_INBOUNDPIPELINE_H
+#define FIX_INBOUNDPIPELINE_H
+
+#ifdef _MSC_VER
+#pragma warning( disable : 4503 4355 4786 4290 )
+#endif
+
+#include "Dictionary.h"
+#include "Exceptions.h"
+#include "Message.h"
+#include "Mutex.h"
+#include "SpscRing.h"
+#include "ThreadSettings.h"
+#include "Event.h"
+#include <atomic>
+#include <exception>
+#include <string>
+#include <vector>
+
+namespace FIX
+{
+class Session;
+class InboundLane;
+
+/// Connection feeding an InboundLane.
+class InboundSource
+{
+public:
+  virtual ~InboundSource() {}
+  /// Called from a pipeline thread when decoded messages or rejects are
+  /// waiting, or when a lane the connection held back has room again.
+  virtual void onDecoded() = 0;
+};
+
+/**
+ * Staged processing of inbound messages.
+ *
+ * The connection thread frames messages and runs the session, decode
+ * threads parse and validate them, and application threads call
+ * fromApp.  Each session gets a lane of four rings, and is served by
+ * one decode and one application thread, so its messages stay in order
+ * while different sessions are spread over the threads.  Exceptions
+ * from fromApp go back to the connection thread, which sends the
+ * rejects, so only that thread touches session state.
+ *
+ * Full rings push back on the stage before them, ending with the
+ * connection thread no longer reading from the socket.  Timers keep
+ * running on the connection thread throughout, so a slow fromApp no
+ * longer delays heartbeats.
+ *
+ * fromAdmin stays on the connection thread, since its outcome decides
+ * what the session does next.  It is therefore not ordered against
+ * fromApp: the application may see fromAdmin for a Logout or
+ * SequenceReset before fromApp for a message received earlier.
+ */
+class InboundPipeline
+{
+public:
+  InboundPipeline( int decodeThreads = 1, int applicationThreads = 1,
+                   int queueSize = 1024,
+                   const ThreadSettings& threadSettings
+                     = ThreadSettings( "fix-inbound" ) );
+  /// Read the Inbound settings from a dictionary.
+  InboundPipeline( const Dictionary& dict ) throw( ConfigError );
+  ~InboundPipeline();
+
+  /// Spawn the stage threads.
+  void start() throw( RuntimeError );
+  /// Join the stage threads, lanes still present stop moving.
+  void stop();
+
+  /// Give a session its lane, messages of the session delivered to the
+  /// application from now on go through it.
+  InboundLane* add( Session* pSession, InboundSource* pSource );
+  /// Connection thread: remove a lane once the application has seen
+  /// every message the session accepted and their rejects are sent,
+  /// messages not yet decoded are dropped.
+  void remove( InboundLane* pLane );
+
+  int getDecodeThreads() const { return (int)m_decoders.size(); }
+  int getApplicationThreads() const { return (int)m_dispatchers.size(); }
+  int getQueueSize() const { return m_queueSize; }
+
+  struct Worker;
+
+private:
+  typedef std::vector < Worker* > Workers;
+
+  void create( int decodeThreads, int applicationThreads );
+  static THREAD_PROC startThread( void* p );
+
+  Workers m_decoders;
+  Workers m_dispatchers;
+  int m_queueSize;
+  ThreadSettings m_threadSettings;
+  Mutex m_mutex;
+  size_t m_next;
+  std::atomic < bool > m_running;
+};
+
+/**
+ * The rings of one session in an InboundPipeline.
+ *
+ * Framed messages go from the connection thread to a decode thread,
+ * decoded messages back to the connection thread, messages the session
+ * accepted on to an application thread, and those fromApp threw for
+ * back to the connection thread.
+ */
+class InboundLane
+{
+public:
+  /// A message as framed, and parsed if it passed validation.
+  struct Decoded
+  {
+    Decoded() : valid( false ) {}
+    std::string string;
+    Message message;
+    bool valid;
+  };
+
+  /// A message fromApp threw for, already counted by the session.
+  struct Rejected
+  {
+    Message message;
+    std::exception_ptr error;
+  };
+
+  /// Connection thread: slot for the next framed message, 0 while full.
+  std::string* nextFrame() { return m_framed.claim(); }
+  void pushFrame();
+
+  /// Connection thread: oldest decoded message, 0 if none.
+  Decoded* nextDecoded() { return m_decoded.front(); }
+  void popDecoded();
+
+  /// Connection thread: true if the application stage is full, in which
+  /// case the source is told once there is room again.
+  bool hold();
+
+  /// Session: queue an accepted message for the application, waiting
+  /// for room if needed.  The message is swapped into the ring, leaving
+  /// the caller with whatever the slot held before.
+  void deliver( Message& message );
+
+  /// Connection thread: send rejects for messages fromApp threw for,
+  /// true if there were any.
+  bool reject();
+
+  Session* getSession() const { return m_pSession; }
+
+  /// Decode thread: parse and validate waiting messages.
+  bool decode();
+  /// Application thread: call fromApp for waiting messages.
+  bool dispatch();
+
+private:
+  friend class InboundPipeline;
+
+  InboundLane( Session* pSession, InboundSource* pSource, int queueSize,
+               InboundPipeline::Worker* pDecoder,
+               InboundPipeline::Worker* pDispatcher );
+
+  InboundLane( const InboundLane& );
+  InboundLane& operator=( const InboundLane& );
+
+  // pinned through its registry handle for each pass only
+  Session* m_pSession;
+  int m_handle;
+  InboundSource* m_pSource;
+  InboundPipeline::Worker* m_pDecoder;
+  InboundPipeline::Worker* m_pDispatcher;
+  SpscRing < std::string > m_framed;
+  SpscRing < Decoded > m_decoded;
+  SpscRing < Message > m_application;
+  SpscRing < Rejected > m_rejected;
+  std::atomic < bool > m_held;
+  std::atomic < bool > m_waiting;
+  Event m_room;
+};
+}
+
+#endif //FIX_INBOUNDPIPELINE_H
@@ -71,6 +71,11 @@ void Initiator::initialize() throw ( ConfigError )
   {
     if (SessionSettings::instance().get( *i ).getString( "ConnectionType" ) == "initiator" )
     {
+      // validate connection thread placement before any thread is spawned
+      const Dictionary& dict = SessionSettings::instance().get( *i );
+      ThreadSettings( dict, THREAD_AFFINITY, THREAD_NAME, THREAD_PRIORITY );
+      ThreadSettings::checkConnection
+        ( dict, dict.has( SOCKET_BUSY_POLL ) && dict.getBool( SOCKET_BUSY_POLL ) );
       m_sessionIDs.insert( *i );
       m_sessions[ *i ] = factory.create( *i, SessionSettings::instance().get( *i ) );
       setDisconnected( *i );
@@ -79,6 +84,10 @@ void Initiator::initialize() throw ( ConfigError )
 
   if ( !m_sessions.size() )
     throw ConfigError( "No sessions defined for initiator" );
+
+  m_threadSettings = ThreadSettings( SessionSettings::instance().get(),
+                                     ENGINE_THREAD_AFFINITY, ENGINE_THREAD_NAME,
+                                     ENGINE_THREAD_PRIORITY, "fix-initiator" );
 }
 
 Initiator::~Initiator()
@@ -176,7 +185,7 @@ void Initiator::start() throw ( ConfigError, RuntimeError )
   onConfigure(  );
   onInitialize(  );
 
-  HttpServer::startGlobal(  );
+  HttpServer::startGlobal( getLog() );
 
   if( !thread_spawn( &startThread, this, m_threadid ) )
     throw RuntimeError("Unable to spawn thread");
@@ -266,6 +275,8 @@ bool Initiator::isLoggedOn()
 THREAD_PROC Initiator::startThread( void* p )
 {
   Initiator * pInitiator = static_cast < Initiator* > ( p );
+  pInitiator->getLog()->onEvent( "Initiator thread "
+    + pInitiator->m_threadSettings.apply( thread_self() ) );
   pInitiator->onStart();
   return 0;
 }
@@ -34,6 +34,7 @@
 #include "Exceptions.h"
 #include "Mutex.h"
 #include "Session.h"
+#include "ThreadSettings.h"
 #include <set>
 #include <map>
 #include <string>
@@ -131,6 +132,7 @@ private:
   SessionState m_sessionState;
 
   thread_id m_threadid;
+  ThreadSettings m_threadSettings;
   Application& m_application;
   MessageStoreFactory& m_messageStoreFactory;
   LogFactory* m_pLogFactory;
@@ -0,0 +1,245 @@
+/****************************************************************************
+** Copyright (c) 2001-2014
+**
+** This file is part of the QuickFIX FIX Engine
+**
+** This file may be distributed under the terms of the quickfixengine.org
+** license as defined by quickfixengine.org and appearing in the file
+** LICENSE included in the packaging of this file.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** See http://www.quickfixengine.org/LICENSE for licensing information.
+**
+** Contact ask@quickfixengine.org if any conditions of this licensing are
+** not clear to you.
+**
+****************************************************************************/
+
+#ifdef _MSC_VER
+#include "stdafx.h"
+#else
+#include "config.h"
+#endif
+
+#ifdef HAVE_LIBURING
+
+#include "IoUring.h"
+#include "Utility.h"
+#include <poll.h>
+#include <algorithm>
+
+namespace FIX
+{
+IoUring::IoUring()
+: m_pBufferRing( 0 ), m_open( false ), m_recvUnsupported( false ),
+  m_socket( -1 ), m_wakeup( -1 )
+{
+}
+
+IoUring::~IoUring()
+{
+  close();
+}
+
+bool IoUring::open( int socket, int wakeup, std::string& error )
+{
+  int result = io_uring_queue_init( RING_ENTRIES, &m_ring, 0 );
+  if( result < 0 )
+  {
+    error = strerror( -result );
+    return false;
+  }
+  m_open = true;
+
+  m_pBufferRing = io_uring_setup_buf_ring( &m_ring, BUFFER_COUNT, 0, 0, &result );
+  if( !m_pBufferRing )
+  {
+    error = strerror( -result );
+    close();
+    return false;
+  }
+
+  m_buffers.resize( BUFFER_COUNT * BUFFER_SIZE );
+  for( unsigned i = 0; i < BUFFER_COUNT; ++i )
+  {
+    io_uring_buf_ring_add( m_pBufferRing, &m_buffers[ i * BUFFER_SIZE ], BUFFER_SIZE,
+                           i, io_uring_buf_ring_mask( BUFFER_COUNT ), i );
+  }
+  io_uring_buf_ring_advance( m_pBufferRing, BUFFER_COUNT );
+
+  m_socket = socket;
+  m_wakeup = wakeup;
+  armRecv();
+  armWakeup();
+  io_uring_submit( &m_ring );
+
+  // Kernels without multishot recv usually reject it as soon as it is
+  // submitted, later rejections are reported by isRecvUnsupported
+  io_uring_cqe* cqe = 0;
+  if( io_uring_peek_cqe( &m_ring, &cqe ) == 0
+      && io_uring_cqe_get_data64( cqe ) == RECV && isUnsupported( cqe->res ) )
+  {
+    error = "multishot receive not supported";
+    close();
+    return false;
+  }
+
+  return true;
+}
+
+void IoUring::close()
+{
+  if( !m_open ) return;
+
+  if( m_pBufferRing )
+    io_uring_free_buf_ring( &m_ring, m_pBufferRing, BUFFER_COUNT, 0 );
+  m_pBufferRing = 0;
+  io_uring_queue_exit( &m_ring );
+  m_open = false;
+}
+
+void IoUring::send( std::string& data )
+{
+  m_sends.assign( data );
+  prepareSends();
+}
+
+bool IoUring::wait( Parser& parser, long timeoutUsec )
+throw( SocketRecvFailed, SocketSendFailed )
+{
+  __kernel_timespec timeout;
+  timeout.tv_sec = timeoutUsec / 1000000;
+  timeout.tv_nsec = ( timeoutUsec % 1000000 ) * 1000;
+
+  io_uring_cqe* cqe = 0;
+  int result = io_uring_submit_and_wait_timeout( &m_ring, &cqe, 1, &timeout, 0 );
+  if( result < 0 && result != -ETIME && result != -EINTR )
+  {
+    errno = -result;
+    throw SocketRecvFailed( -1 );
+  }
+
+  unsigned head = 0;
+  unsigned count = 0;
+  io_uring_for_each_cqe( &m_ring, head, cqe )
+  {
+    try
+    {
+      complete( parser, cqe );
+    }
+    catch( ... )
+    {
+      io_uring_cq_advance( &m_ring, count + 1 );
+      throw;
+    }
+    ++count;
+  }
+  io_uring_cq_advance( &m_ring, count );
+  return count > 0;
+}
+
+io_uring_sqe* IoUring::getSqe()
+{
+  io_uring_sqe* sqe = io_uring_get_sqe( &m_ring );
+  if( !sqe )
+  {
+    io_uring_submit( &m_ring );
+    sqe = io_uring_get_sqe( &m_ring );
+  }
+  return sqe;
+}
+
+void IoUring::armRecv()
+{
+  io_uring_sqe* sqe = getSqe();
+  io_uring_prep_recv_multishot( sqe, m_socket, 0, 0, 0 );
+  sqe->flags |= IOSQE_BUFFER_SELECT;
+  sqe->buf_group = 0;
+  io_uring_sqe_set_data64( sqe, RECV );
+}
+
+void IoUring::armWakeup()
+{
+  io_uring_sqe* sqe = getSqe();
+  io_uring_prep_poll_multishot( sqe, m_wakeup, POLLIN );
+  io_uring_sqe_set_data64( sqe, WAKEUP );
+}
+
+void IoUring::prepareSends()
+{
+  // A chain must go to the kernel in a single submission, so it is kept
+  // well below the ring size and the rest follows once it completes.
+  // MSG_WAITALL makes a short send fail, which cancels the sends linked
+  // behind it instead of leaving a hole in the stream.
+  unsigned count = m_sends.prepare( SEND_CHUNK );
+  for( unsigned i = 0; i < count; ++i )
+  {
+    io_uring_sqe* sqe = getSqe();
+    io_uring_prep_send( sqe, m_socket, m_sends.data( i ), m_sends.length( i ),
+                        MSG_NOSIGNAL | MSG_WAITALL );
+    io_uring_sqe_set_data64( sqe, SEND | ( (unsigned long long)i << 8 ) );
+    if( i + 1 < count )
+      sqe->flags |= IOSQE_IO_LINK;
+  }
+}
+
+void IoUring::complete( Parser& parser, io_uring_cqe* cqe )
+throw( SocketRecvFailed, SocketSendFailed )
+{
+  unsigned long long data = io_uring_cqe_get_data64( cqe );
+  switch( data & 0xff )
+  {
+    case RECV:
+    if( cqe->res > 0 )
+    {
+      unsigned id = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+      char* buffer = &m_buffers[ id * BUFFER_SIZE ];
+      parser.addToStream( buffer, cqe->res );
+      io_uring_buf_ring_add( m_pBufferRing, buffer, BUFFER_SIZE, id,
+                             io_uring_buf_ring_mask( BUFFER_COUNT ), 0 );
+      io_uring_buf_ring_advance( m_pBufferRing, 1 );
+    }
+    else if( cqe->res == 0 )
+    {
+      throw SocketRecvFailed( 0 );
+    }
+    else if( isUnsupported( cqe->res ) )
+    {
+      m_recvUnsupported = true;
+      break;
+    }
+    else if( cqe->res != -ENOBUFS )
+    {
+      errno = -cqe->res;
+      throw SocketRecvFailed( -1 );
+    }
+    if( !( cqe->flags & IORING_CQE_F_MORE ) )
+      armRecv();
+    break;
+
+    case SEND:
+    if( cqe->res < 0 && cqe->res != -ECANCELED )
+    {
+      errno = -cqe->res;
+      throw SocketSendFailed();
+    }
+    // once the chain has finished, resume from whatever actually went out
+    if( m_sends.complete( (unsigned)( data >> 8 ), cqe->res ) && !m_sends.empty() )
+      prepareSends();
+    break;
+
+    case WAKEUP:
+    {
+      char wakeup[64];
+      recv( m_wakeup, wakeup, sizeof( wakeup ), 0 );
+      if( !( cqe->flags & IORING_CQE_F_MORE ) )
+        armWakeup();
+    }
+    break;
+  }
+}
+}
+
+#endif //HAVE_LIBURING
@@ -0,0 +1,184 @@
+/* -*- C++ -*- */
+
+/****************************************************************************
+** Copyright (c) 2001-2014
+**
+** This file is part of the QuickFIX FIX Engine
+**
+** This file may be distributed under the terms of the quickfixengine.org
+** license as defined by quickfixengine.org and appearing in the file
+** LICENSE included in the packaging of this file.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** See http://www.quickfixengine.org/LICENSE for licensing information.
+**
+** Contact ask@quickfixengine.org if any conditions of this licensing are
+** not clear to you.
+**
+****************************************************************************/
+
+#ifndef HAVE_LIBURING
+#error IoUring.h included, but HAVE_LIBURING not defined
+#endif
+
+#ifdef HAVE_LIBURING
+#ifndef FIX_IOURING_H
+#define FIX_IOURING_H
+
+#include "Parser.h"
+#include "Exceptions.h"
+#include <liburing.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace FIX
+{
+/**
+ * Outbound data split into a chain of sends.
+ *
+ * Each send remembers the range it covers, so once the chain completes
+ * the data resumes right after the last byte of the first short send,
+ * whatever the kernel reported for the sends cancelled behind it.
+ */
+class SendChain
+{
+public:
+  static const unsigned MAX_SENDS = 16;
+
+  SendChain() : m_offset( 0 ), m_count( 0 ), m_inFlight( 0 ) {}
+
+  /// Take over data, leaving the string empty.
+  void assign( std::string& data )
+  {
+    m_data.swap( data );
+    data.clear();
+    m_offset = 0;
+  }
+
+  /// Split what is left into sends of at most chunk bytes, returns how
+  /// many make up the chain.
+  unsigned prepare( size_t chunk )
+  {
+    size_t offset = m_offset;
+    m_count = 0;
+    while( offset < m_data.size() && m_count < MAX_SENDS )
+    {
+      Send& send = m_sends[ m_count++ ];
+      send.offset = offset;
+      send.length = std::min( chunk, m_data.size() - offset );
+      send.result = 0;
+      offset += send.length;
+    }
+    m_inFlight = m_count;
+    return m_count;
+  }
+
+  const char* data( unsigned i ) const { return m_data.data() + m_sends[ i ].offset; }
+  size_t length( unsigned i ) const { return m_sends[ i ].length; }
+
+  /// Record what send i wrote, true once the whole chain has completed.
+  bool complete( unsigned i, int result )
+  {
+    m_sends[ i ].result = result;
+    if( --m_inFlight )
+      return false;
+
+    for( unsigned j = 0; j < m_count; ++j )
+    {
+      size_t sent = m_sends[ j ].result > 0 ? m_sends[ j ].result : 0;
+      m_offset = m_sends[ j ].offset + sent;
+      if( sent < m_sends[ j ].length )
+        break;
+    }
+    if( m_offset == m_data.size() )
+    {
+      m_data.clear();
+      m_offset = 0;
+    }
+    return true;
+  }
+
+  bool empty() const { return m_data.empty(); }
+  size_t pending() const { return m_data.size() - m_offset; }
+
+private:
+  struct Send
+  {
+    size_t offset;
+    size_t length;
+    int result;
+  };
+
+  std::string m_data;
+  size_t m_offset;
+  Send m_sends[ MAX_SENDS ];
+  unsigned m_count;
+  unsigned m_inFlight;
+};
+
+/**
+ * io_uring transport for a single connection.
+ *
+ * Receives with a multishot recv into a ring of provided buffers that are
+ * handed straight to the Parser, and writes outbound data as a chain of
+ * linked sends. Everything prepared in one pass is submitted together with
+ * the wait for completions, so a busy connection costs one syscall per
+ * batch instead of one per recv or send.
+ */
+class IoUring
+{
+public:
+  IoUring();
+  ~IoUring();
+
+  /// Set up the ring, false if the kernel lacks the features used.
+  bool open( int socket, int wakeup, std::string& error );
+  void close();
+
+  /// Take over outbound data, leaving the string empty.
+  void send( std::string& data );
+  bool isSending() const { return !m_sends.empty(); }
+  size_t getSendPending() const { return m_sends.pending(); }
+  /// The kernel refused multishot recv after the ring was set up, the
+  /// caller should finish its sends and fall back to plain sockets.
+  bool isRecvUnsupported() const { return m_recvUnsupported; }
+
+  /// Submit prepared work and wait for completions, feeding received
+  /// data to the parser. Returns false if the timeout expired.
+  bool wait( Parser& parser, long timeoutUsec )
+  throw( SocketRecvFailed, SocketSendFailed );
+
+  static const unsigned RING_ENTRIES = 64;
+  static const unsigned BUFFER_COUNT = 64;
+  static const unsigned BUFFER_SIZE = 16384;
+  static const size_t SEND_CHUNK = 65536;
+
+private:
+  enum Operation { RECV = 1, SEND, WAKEUP };
+
+  io_uring_sqe* getSqe();
+  void armRecv();
+  void armWakeup();
+  void prepareSends();
+  void complete( Parser& parser, io_uring_cqe* cqe )
+  throw( SocketRecvFailed, SocketSendFailed );
+  static bool isUnsupported( int result )
+  { return result == -EINVAL || result == -EOPNOTSUPP; }
+
+  io_uring m_ring;
+  io_uring_buf_ring* m_pBufferRing;
+  std::vector<char> m_buffers;
+  bool m_open;
+  bool m_recvUnsupported;
+  int m_socket;
+  int m_wakeup;
+
+  SendChain m_sends;
+};
+}
+
+#endif //FIX_IOURING_H
+#endif //HAVE_LIBURING
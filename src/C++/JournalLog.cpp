@@ -0,0 +1,227 @@
+/****************************************************************************
+** Copyright (c) 2001-2014
+**
+** This file is part of the QuickFIX FIX Engine
+**
+** This file may be distributed under the terms of the quickfixengine.org
+** license as defined by quickfixengine.org and appearing in the file
+** LICENSE included in the packaging of this file.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** See http://www.quickfixengine.org/LICENSE for licensing information.
+**
+** Contact ask@quickfixengine.org if any conditions of this licensing are
+** not clear to you.
+**
+****************************************************************************/
+
+#ifdef _MSC_VER
+#include "stdafx.h"
+#else
+#include "config.h"
+#endif
+
+#include "JournalLog.h"
+#include "FieldConvertors.h"
+#include <algorithm>
+
+namespace FIX
+{
+namespace
+{
+/// Hash of a session name that does not change between runs.
+unsigned long journalHash( const std::string& name )
+{
+  unsigned long hash = 2166136261UL;
+  for ( std::string::const_iterator i = name.begin(); i != name.end(); ++i )
+    hash = ( ( hash ^ (unsigned char)*i ) * 16777619UL ) & 0xffffffffUL;
+  return hash;
+}
+}
+
+const int JournalLogFactory::DEFAULT_FILES = 4;
+
+Log* JournalLogFactory::create()
+{
+  return create( "GLOBAL" );
+}
+
+Log* JournalLogFactory::create( const SessionID& s )
+{
+  return create( s.toString() );
+}
+
+Log* JournalLogFactory::create( const std::string& name )
+{
+  Locker l( m_mutex );
+  if ( m_journals.empty() ) open();
+
+  std::shared_ptr < JournalFile > pJournal
+    = m_journals[ journalHash( name ) % m_journals.size() ];
+  return new BinaryLog( pJournal, pJournal->addSession( name ) );
+}
+
+void JournalLogFactory::open() throw( ConfigError )
+{
+  if ( m_useSettings )
+  {
+    const Dictionary& settings = SessionSettings::instance().get();
+    m_path = settings.getString( JOURNAL_LOG_PATH );
+    if ( settings.has( JOURNAL_LOG_FILES ) )
+      m_files = settings.getInt( JOURNAL_LOG_FILES );
+
+    int queueSize = m_policy.getQueueSize();
+    if ( settings.has( JOURNAL_LOG_QUEUE_SIZE ) )
+      queueSize = settings.getInt( JOURNAL_LOG_QUEUE_SIZE );
+    if ( queueSize <= 0 )
+      throw ConfigError( std::string( JOURNAL_LOG_QUEUE_SIZE ) + " must be positive" );
+
+    AsyncLogPolicy::Overflow overflow = m_policy.getOverflow();
+    if ( settings.has( JOURNAL_LOG_OVERFLOW ) )
+      overflow = AsyncLogPolicy::overflow
+        ( JOURNAL_LOG_OVERFLOW, settings.getString( JOURNAL_LOG_OVERFLOW ) );
+
+    m_policy = AsyncLogPolicy( true, queueSize, overflow, m_policy.getInterval() );
+  }
+  if ( m_files <= 0 )
+    throw ConfigError( std::string( JOURNAL_LOG_FILES ) + " must be positive" );
+
+  std::string path = m_path.empty() ? "." : m_path;
+  file_mkdir( path.c_str() );
+  for ( int i = 0; i < m_files; ++i )
+  {
+    std::string fileName = file_appendpath
+      ( path, "journal." + IntConvertor::convert( i ) + ".bin" );
+    m_journals.push_back
+      ( std::shared_ptr < JournalFile > ( new JournalFile( fileName, m_policy ) ) );
+  }
+}
+
+void JournalLogFactory::destroy( Log* pLog )
+{
+  delete pLog;
+}
+
+JournalFile::JournalFile( const std::string& fileName,
+                          const AsyncLogPolicy& policy ) throw( ConfigError )
+: m_fileName( fileName ), m_file( 0 ), m_ring( policy.getQueueSize() ),
+  m_overflow( policy.getOverflow() ), m_dropped( 0 ), m_reportedDropped( 0 )
+{
+  m_file = file_fopen( m_fileName.c_str(), "ab" );
+  if ( !m_file )
+    throw ConfigError( "Could not open journal file: " + m_fileName );
+  fseek( m_file, 0, SEEK_END );
+  if ( ftell( m_file ) == 0 )
+  {
+    fwrite( BinaryLogRecord::SIGNATURE, 1, BinaryLogRecord::SIGNATURE_SIZE, m_file );
+    fflush( m_file );
+  }
+
+  FileLogWriter::instance().add( this, policy.getInterval() );
+}
+
+JournalFile::~JournalFile()
+{
+  FileLogWriter::instance().remove( this );
+  flush();
+  file_fclose( m_file );
+}
+
+int JournalFile::addSession( const std::string& name )
+{
+  Locker l( m_mutex );
+  for ( size_t i = 0; i < m_sessions.size(); ++i )
+  {
+    if ( m_sessions[ i ] == name ) return (int)i;
+  }
+
+  int session = (int)m_sessions.size();
+  m_sessions.push_back( name );
+
+  // the name has to reach the journal ahead of the session's records
+  char header[ BinaryLogRecord::HEADER_SIZE ];
+  BinaryLogRecord::encodeHeader( header, time_nanoseconds(), session,
+                                 BinaryLogRecord::SESSION, name.size() );
+  while ( !m_ring.push( LogRing::MESSAGE, header, sizeof( header ), name ) )
+  {
+    FileLogWriter::instance().wake();
+    process_sleep( 0.0001 );
+  }
+  return session;
+}
+
+void JournalFile::write( int session, BinaryLogRecord::Kind kind,
+                         const std::string& data )
+{
+  char header[ BinaryLogRecord::HEADER_SIZE ];
+  BinaryLogRecord::encodeHeader( header, time_nanoseconds(), session,
+                                 kind, data.size() );
+  if ( m_ring.push( LogRing::MESSAGE, header, sizeof( header ), data ) )
+  {
+    if ( m_ring.size() == m_ring.capacity() / 2 )
+      FileLogWriter::instance().wake();
+    return;
+  }
+
+  // markers change what a whole log means, so they are never dropped
+  if ( m_overflow == AsyncLogPolicy::DROP
+       && kind != BinaryLogRecord::CLEAR && kind != BinaryLogRecord::BACKUP )
+  {
+    ++m_dropped;
+    return;
+  }
+
+  do
+  {
+    FileLogWriter::instance().wake();
+    process_sleep( 0.0001 );
+  } while( !m_ring.push( LogRing::MESSAGE, header, sizeof( header ), data ) );
+}
+
+void JournalFile::flush()
+{
+  Locker l( m_writeMutex );
+
+  LogRing::Kind kind;
+  while ( m_ring.pop( kind, m_line ) )
+    m_buffer += m_line;
+
+  long dropped = m_dropped.load();
+  if ( dropped != m_reportedDropped )
+  {
+    int global;
+    {
+      Locker sessionLock( m_mutex );
+      std::vector < std::string > ::iterator i
+        = std::find( m_sessions.begin(), m_sessions.end(), "GLOBAL" );
+      global = (int)( i - m_sessions.begin() );
+      if ( i == m_sessions.end() )
+      {
+        m_sessions.push_back( "GLOBAL" );
+        append( time_nanoseconds(), global, BinaryLogRecord::SESSION, "GLOBAL" );
+      }
+    }
+    append( time_nanoseconds(), global, BinaryLogRecord::EVENT,
+            "Dropped " + IntConvertor::convert( (int)( dropped - m_reportedDropped ) )
+            + " log lines, queue full" );
+    m_reportedDropped = dropped;
+  }
+
+  if ( m_buffer.empty() ) return;
+  fwrite( m_buffer.data(), 1, m_buffer.size(), m_file );
+  fflush( m_file );
+  m_buffer.clear();
+}
+
+void JournalFile::append( long long time, int session,
+                          BinaryLogRecord::Kind kind, const std::string& data )
+{
+  char header[ BinaryLogRecord::HEADER_SIZE ];
+  BinaryLogRecord::encodeHeader( header, time, session, kind, data.size() );
+  m_buffer.append( header, sizeof( header ) );
+  m_buffer += data;
+}
+
+} //namespace FIX
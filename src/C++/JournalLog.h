@@ -0,0 +1,116 @@
+/* -*- C++ -*- */
+
+/****************************************************************************
+** Copyright (c) 2001-2014
+**
+** This file is part of the QuickFIX FIX Engine
+**
+** This file may be distributed under the terms of the quickfixengine.org
+** license as defined by quickfixengine.org and appearing in the file
+** LICENSE included in the packaging of this file.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** See http://www.quickfixengine.org/LICENSE for licensing information.
+**
+** Contact ask@quickfixengine.org if any conditions of this licensing are
+** not clear to you.
+**
+****************************************************************************/
+
+#ifndef FIX_JOURNALLOG_H
+#define FIX_JOURNALLOG_H
+
+#ifdef _MSC_VER
+#pragma warning( disable : 4503 4355 4786 4290 )
+#endif
+
+#include "BinaryLog.h"
+#include "FileLogWriter.h"
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace FIX
+{
+class JournalFile;
+
+/**
+ * Creates logs that share a few journal files.
+ *
+ * Each session is assigned by name to one of the journals in a
+ * directory, so it keeps its journal across restarts.  The journals are
+ * written as BinaryLogRecords by the FileLogWriter thread, and the
+ * logdecode tool extracts a session's FileLog files from them.
+ */
+class JournalLogFactory : public LogFactory
+{
+public:
+  static const int DEFAULT_FILES;
+
+  JournalLogFactory()
+  : m_files( DEFAULT_FILES ), m_useSettings( true ) {}
+  JournalLogFactory( const std::string& path, int files = DEFAULT_FILES,
+                     const AsyncLogPolicy& policy = AsyncLogPolicy( true ) )
+  : m_path( path ), m_files( files ), m_policy( policy ),
+    m_useSettings( false ) {}
+
+  Log* create();
+  Log* create( const SessionID& );
+  void destroy( Log* log );
+
+private:
+  Log* create( const std::string& name );
+  void open() throw( ConfigError );
+
+  typedef std::vector < std::shared_ptr < JournalFile > > Journals;
+
+  std::string m_path;
+  int m_files;
+  AsyncLogPolicy m_policy;
+  bool m_useSettings;
+  Journals m_journals;
+  Mutex m_mutex;
+};
+
+/**
+ * Journal shared by the logs of many sessions.
+ *
+ * Records are queued without locking and written to the file in
+ * batches by the FileLogWriter thread.
+ */
+class JournalFile : public BinaryLogOutput, public AsyncLogSink
+{
+public:
+  JournalFile( const std::string& fileName, const AsyncLogPolicy& policy )
+  throw( ConfigError );
+  ~JournalFile();
+
+  int addSession( const std::string& name );
+  void write( int session, BinaryLogRecord::Kind kind, const std::string& data );
+  void flush();
+
+  /// Number of records discarded because the queue was full.
+  long getDropped() const { return m_dropped.load(); }
+
+private:
+  void append( long long time, int session, BinaryLogRecord::Kind kind,
+               const std::string& data );
+
+  std::string m_fileName;
+  FILE* m_file;
+  LogRing m_ring;
+  AsyncLogPolicy::Overflow m_overflow;
+  std::atomic < long > m_dropped;
+  long m_reportedDropped;
+  std::vector < std::string > m_sessions;
+  std::string m_line;
+  std::string m_buffer;
+  Mutex m_mutex;
+  Mutex m_writeMutex;
+};
+}
+
+#endif //FIX_JOURNALLOG_H
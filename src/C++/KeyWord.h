@@ -33,6 +33,36 @@ namespace FIX
 	const char SOCKET_NODELAY[] = "SOCKETNODELAY";
 	const char SOCKET_SEND_BUFFER_SIZE[] = "SENDBUFFERSIZE";
 	const char SOCKET_RECEIVE_BUFFER_SIZE[] = "RECEIVEBUFFERSIZE";
+	const char READ_BUFFER_MAX_SIZE[] = "READBUFFERMAXSIZE";
+	const char SOCKET_BUSY_POLL[] = "SOCKETBUSYPOLL";
+	const char SOCKET_BUSY_POLL_CPU[] = "SOCKETBUSYPOLLCPU";
+	const char SOCKET_BUSY_POLL_USEC[] = "SOCKETBUSYPOLLUSEC";
+	const char SOCKET_IO_URING[] = "SOCKETIOURING";
+	const char SEND_QUEUE_SIZE[] = "SENDQUEUESIZE";
+	const char INBOUND_PIPELINE[] = "INBOUNDPIPELINE";
+	const char INBOUND_DECODE_THREADS[] = "INBOUNDDECODETHREADS";
+	const char INBOUND_APPLICATION_THREADS[] = "INBOUNDAPPLICATIONTHREADS";
+	const char INBOUND_QUEUE_SIZE[] = "INBOUNDQUEUESIZE";
+	const char INBOUND_THREAD_AFFINITY[] = "INBOUNDTHREADAFFINITY";
+	const char INBOUND_THREAD_NAME[] = "INBOUNDTHREADNAME";
+	const char INBOUND_THREAD_PRIORITY[] = "INBOUNDTHREADPRIORITY";
+	const char SEND_QUEUE_HIGH_WATERMARK[] = "SENDQUEUEHIGHWATERMARK";
+	const char RESEND_PAGE_SIZE[] = "RESENDPAGESIZE";
+	const char DEFERRED_QUEUE_SIZE[] = "DEFERREDQUEUESIZE";
+	const char RAW_RESEND[] = "RAWRESEND";
+	const char GAP_QUEUE_SIZE[] = "GAPQUEUESIZE";
+	const char GAP_QUEUE_OVERFLOW[] = "GAPQUEUEOVERFLOW";
+	const char RESEND_REQUEST_CHUNK_SIZE[] = "RESENDREQUESTCHUNKSIZE";
+	const char LOG_INCLUDE_MSG_TYPES[] = "LOGINCLUDEMSGTYPES";
+	const char LOG_EXCLUDE_MSG_TYPES[] = "LOGEXCLUDEMSGTYPES";
+	const char LOG_SAMPLE_RATE[] = "LOGSAMPLERATE";
+	const char LOG_MAX_BYTES_PER_SECOND[] = "LOGMAXBYTESPERSECOND";
+	const char THREAD_AFFINITY[] = "THREADAFFINITY";
+	const char THREAD_NAME[] = "THREADNAME";
+	const char THREAD_PRIORITY[] = "THREADPRIORITY";
+	const char ENGINE_THREAD_AFFINITY[] = "ENGINETHREADAFFINITY";
+	const char ENGINE_THREAD_NAME[] = "ENGINETHREADNAME";
+	const char ENGINE_THREAD_PRIORITY[] = "ENGINETHREADPRIORITY";
 	const char RECONNECT_INTERVAL[] = "RECONNECTINTERVAL";
 	const char VALIDATE_LENGTH_AND_CHECKSUM[] = "VALIDATELENGTHANDCHECKSUM";
 	const char VALIDATE_FIELDS_OUT_OF_ORDER[] = "VALIDATEFIELDSOUTOFORDER";
@@ -40,7 +70,21 @@ namespace FIX
 	const char VALIDATE_USER_DEFINED_FIELDS[] = "VALIDATEUSERDEFINEDFIELDS";
 	const char LOGON_TIMEOUT[] = "LOGONTIMEOUT";
 	const char LOGOUT_TIMEOUT[] = "LOGOUTTIMEOUT";
+	const char STORE_SYNC_POLICY[] = "STORESYNCPOLICY";
+	const char STORE_SYNC_COUNT[] = "STORESYNCCOUNT";
+	const char STORE_SYNC_INTERVAL[] = "STORESYNCINTERVAL";
+	const char STORE_SYNC_REPORT_INTERVAL[] = "STORESYNCREPORTINTERVAL";
+	const char MEMORY_STORE_MAX_MESSAGES[] = "MEMORYSTOREMAXMESSAGES";
+	const char MEMORY_STORE_MAX_BYTES[] = "MEMORYSTOREMAXBYTES";
 	const char FILE_STORE_PATH[] = "FILESTOREPATH";
+	const char FILE_STORE_CHECKPOINT_INTERVAL[] = "FILESTORECHECKPOINTINTERVAL";
+	const char MMAP_STORE_PATH[] = "MMAPSTOREPATH";
+	const char MMAP_STORE_SEGMENT_SIZE[] = "MMAPSTORESEGMENTSIZE";
+	const char TIERED_STORE_DURABILITY[] = "TIEREDSTOREDURABILITY";
+	const char TIERED_STORE_FLUSH_INTERVAL[] = "TIEREDSTOREFLUSHINTERVAL";
+	const char TIERED_STORE_BATCH_SIZE[] = "TIEREDSTOREBATCHSIZE";
+	const char TIERED_STORE_MAX_LAG[] = "TIEREDSTOREMAXLAG";
+	const char TIERED_STORE_HOT_MESSAGES[] = "TIEREDSTOREHOTMESSAGES";
 	const char MYSQL_STORE_USECONNECTIONPOOL[] = "MYSQLSTOREUSECONNECTIONPOOL";
 	const char MYSQL_STORE_DATABASE[] = "MYSQLSTOREDATABASE";
 	const char MYSQL_STORE_USER[] = "MYSQLSTOREUSER";
@@ -58,6 +102,19 @@ namespace FIX
 	const char ODBC_STORE_CONNECTION_STRING[] = "ODBCSTORECONNECTIONSTRING";
 	const char FILE_LOG_PATH[] = "FILELOGPATH";
 	const char FILE_LOG_BACKUP_PATH[] = "FILELOGBACKUPPATH";
+	const char FILE_LOG_ASYNC[] = "FILELOGASYNC";
+	const char FILE_LOG_ASYNC_QUEUE_SIZE[] = "FILELOGASYNCQUEUESIZE";
+	const char FILE_LOG_ASYNC_OVERFLOW[] = "FILELOGASYNCOVERFLOW";
+	const char FILE_LOG_ASYNC_INTERVAL[] = "FILELOGASYNCINTERVAL";
+	const char FILE_LOG_ROTATE_SIZE[] = "FILELOGROTATESIZE";
+	const char FILE_LOG_ROTATE_SCHEDULE[] = "FILELOGROTATESCHEDULE";
+	const char FILE_LOG_RETAIN_COUNT[] = "FILELOGRETAINCOUNT";
+	const char BINARY_LOG_PATH[] = "BINARYLOGPATH";
+	const char BINARY_LOG_FLUSH_INTERVAL[] = "BINARYLOGFLUSHINTERVAL";
+	const char JOURNAL_LOG_PATH[] = "JOURNALLOGPATH";
+	const char JOURNAL_LOG_FILES[] = "JOURNALLOGFILES";
+	const char JOURNAL_LOG_QUEUE_SIZE[] = "JOURNALLOGQUEUESIZE";
+	const char JOURNAL_LOG_OVERFLOW[] = "JOURNALLOGOVERFLOW";
 	const char SCREEN_LOG_SHOW_INCOMING[] = "SCREENLOGSHOWINCOMING";
 	const char SCREEN_LOG_SHOW_OUTGOING[] = "SCREENLOGSHOWOUTGOING";
 	const char SCREEN_LOG_SHOW_EVENTS[] = "SCREENLOGSHOWEVENTS";
@@ -70,6 +127,8 @@ namespace FIX
 	const char MYSQL_LOG_INCOMING_TABLE[] = "MYSQLLOGINCOMINGTABLE";
 	const char MYSQL_LOG_OUTGOING_TABLE[] = "MYSQLLOGOUTGOINGTABLE";
 	const char MYSQL_LOG_EVENT_TABLE[] = "MYSQLLOGEVENTTABLE";
+	const char MYSQL_LOG_BATCH_SIZE[] = "MYSQLLOGBATCHSIZE";
+	const char MYSQL_LOG_BATCH_INTERVAL[] = "MYSQLLOGBATCHINTERVAL";
 	const char POSTGRESQL_LOG_USECONNECTIONPOOL[] = "POSTGRESQLLOGUSECONNECTIONPOOL";
 	const char POSTGRESQL_LOG_DATABASE[] = "POSTGRESQLLOGDATABASE";
 	const char POSTGRESQL_LOG_USER[] = "POSTGRESQLLOGUSER";
@@ -79,6 +138,8 @@ namespace FIX
 	const char POSTGRESQL_LOG_INCOMING_TABLE[] = "POSTGRESQLLOGINCOMINGTABLE";
 	const char POSTGRESQL_LOG_OUTGOING_TABLE[] = "POSTGRESQLLOGOUTGOINGTABLE";
 	const char POSTGRESQL_LOG_EVENT_TABLE[] = "POSTGRESQLLOGEVENTTABLE";
+	const char POSTGRESQL_LOG_BATCH_SIZE[] = "POSTGRESQLLOGBATCHSIZE";
+	const char POSTGRESQL_LOG_BATCH_INTERVAL[] = "POSTGRESQLLOGBATCHINTERVAL";
 	const char ODBC_LOG_USER[] = "ODBCLOGUSER";
 	const char ODBC_LOG_PASSWORD[] = "ODBCLOGPASSWORD";
 	const char ODBC_LOG_CONNECTION_STRING[] = "ODBCLOGCONNECTIONSTRING";
@@ -91,5 +152,8 @@ namespace FIX
 	const char REFRESH_ON_LOGON[] = "REFRESHONLOGON";
 	const char MILLISECONDS_IN_TIMESTAMP[] = "MILLISECONDSINTIMESTAMP";
 	const char HTTP_ACCEPT_PORT[] = "HTTPACCEPTPORT";
+	const char HTTP_THREAD_AFFINITY[] = "HTTPTHREADAFFINITY";
+	const char HTTP_THREAD_NAME[] = "HTTPTHREADNAME";
+	const char HTTP_THREAD_PRIORITY[] = "HTTPTHREADPRIORITY";
 	const char PERSIST_MESSAGES[] = "PERSISTMESSAGES";
 }
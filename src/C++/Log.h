@@ -87,6 +87,8 @@ public:
   virtual void onIncoming( const std::string& ) = 0;
   virtual void onOutgoing( const std::string& ) = 0;
   virtual void onEvent( const std::string& ) = 0;
+  /// Whether the on* callbacks may be called from several threads at once.
+  virtual bool isThreadSafe() const { return false; }
 };
 /*! @} */
 
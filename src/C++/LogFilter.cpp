@@ -0,0 +1,183 @@
+/****************************************************************************
+** Copyright (c) 2001-2014
+**
+** This file is part of the QuickFIX FIX Engine
+**
+** This file may be distributed under the terms of the quickfixengine.org
+** license as defined by quickfixengine.org and appearing in the file
+** LICENSE included in the packaging of this file.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** See http://www.quickfixengine.org/LICENSE for licensing information.
+**
+** Contact ask@quickfixengine.org if any conditions of this licensing are
+** not clear to you.
+**
+****************************************************************************/
+
+#ifdef _MSC_VER
+#include "stdafx.h"
+#else
+#include "config.h"
+#endif
+
+#include "LogFilter.h"
+#include "SessionSettings.h"
+#include "Utility.h"
+#include <string.h>
+#include <time.h>
+
+namespace FIX
+{
+LogFilter::LogFilter()
+: m_sampleRate( -1 ), m_maxBytesPerSecond( 0 ), m_enabled( false ),
+  m_rate( 1 ), m_sampled( 0 ), m_second( 0 ), m_bytes( 0 ), m_filtered( 0 )
+{
+}
+
+LogFilter::LogFilter( const Dictionary& dict ) throw( ConfigError )
+: m_sampleRate( -1 ), m_maxBytesPerSecond( 0 ), m_enabled( false ),
+  m_rate( 1 ), m_sampled( 0 ), m_second( 0 ), m_bytes( 0 ), m_filtered( 0 )
+{
+  if ( dict.has( LOG_INCLUDE_MSG_TYPES ) )
+    split( dict.getString( LOG_INCLUDE_MSG_TYPES ), m_include );
+  if ( dict.has( LOG_EXCLUDE_MSG_TYPES ) )
+    split( dict.getString( LOG_EXCLUDE_MSG_TYPES ), m_exclude );
+
+  if ( dict.has( LOG_SAMPLE_RATE ) )
+  {
+    m_sampleRate = dict.getInt( LOG_SAMPLE_RATE );
+    if ( m_sampleRate < 0 )
+      throw ConfigError( std::string( LOG_SAMPLE_RATE ) + " must not be negative" );
+  }
+
+  if ( dict.has( LOG_MAX_BYTES_PER_SECOND ) )
+  {
+    m_maxBytesPerSecond = dict.getInt( LOG_MAX_BYTES_PER_SECOND );
+    if ( m_maxBytesPerSecond <= 0 )
+      throw ConfigError( std::string( LOG_MAX_BYTES_PER_SECOND ) + " must be positive" );
+  }
+
+  update();
+}
+
+LogFilter::LogFilter( const LogFilter& copy )
+: m_include( copy.m_include ), m_exclude( copy.m_exclude ),
+  m_sampleRate( copy.m_sampleRate ),
+  m_maxBytesPerSecond( copy.m_maxBytesPerSecond ),
+  m_enabled( copy.m_enabled ), m_rate( copy.m_rate ),
+  m_sampled( 0 ), m_second( 0 ), m_bytes( 0 ), m_filtered( 0 )
+{
+}
+
+LogFilter& LogFilter::operator=( const LogFilter& rhs )
+{
+  m_include = rhs.m_include;
+  m_exclude = rhs.m_exclude;
+  m_sampleRate = rhs.m_sampleRate;
+  m_maxBytesPerSecond = rhs.m_maxBytesPerSecond;
+  update();
+  return *this;
+}
+
+void LogFilter::include( const std::string& msgType )
+{
+  m_include.push_back( msgType );
+  update();
+}
+
+void LogFilter::exclude( const std::string& msgType )
+{
+  m_exclude.push_back( msgType );
+  update();
+}
+
+void LogFilter::setSampleRate( int rate )
+{
+  m_sampleRate = rate;
+  update();
+}
+
+void LogFilter::setMaxBytesPerSecond( long bytes )
+{
+  m_maxBytesPerSecond = bytes;
+  update();
+}
+
+void LogFilter::update()
+{
+  m_rate = m_sampleRate >= 0 ? m_sampleRate : ( m_include.empty() ? 1 : 0 );
+  m_enabled = m_include.size() || m_exclude.size()
+              || m_rate != 1 || m_maxBytesPerSecond > 0;
+}
+
+void LogFilter::split( const std::string& value, std::vector < std::string >& types )
+{
+  std::string::size_type start = 0;
+  while ( start <= value.size() )
+  {
+    std::string::size_type end = value.find( ',', start );
+    if ( end == std::string::npos ) end = value.size();
+    std::string type = string_strip( value.substr( start, end - start ) );
+    if ( type.size() ) types.push_back( type );
+    start = end + 1;
+  }
+}
+
+bool LogFilter::contains( const std::vector < std::string >& types,
+                          const char* type, size_t size )
+{
+  std::vector < std::string > ::const_iterator i;
+  for ( i = types.begin(); i != types.end(); ++i )
+  {
+    if ( i->size() == size && memcmp( i->data(), type, size ) == 0 )
+      return true;
+  }
+  return false;
+}
+
+bool LogFilter::filter( const std::string& message )
+{
+  // MsgType is located in place, the message is never parsed or copied
+  const char* type = "";
+  size_t size = 0;
+  std::string::size_type pos = message.find( "\00135=" );
+  if ( pos != std::string::npos )
+  {
+    pos += 4;
+    std::string::size_type end = message.find( '\001', pos );
+    if ( end == std::string::npos ) end = message.size();
+    type = message.data() + pos;
+    size = end - pos;
+  }
+
+  if ( contains( m_exclude, type, size ) ) return reject();
+  if ( contains( m_include, type, size ) ) return true;
+  if ( size == 1 && strchr( "0A12345", *type ) ) return true;
+
+  if ( m_rate != 1 )
+  {
+    if ( m_rate == 0 || m_sampled++ % m_rate ) return reject();
+  }
+
+  if ( m_maxBytesPerSecond > 0 )
+  {
+    // a racing reset at the turn of a second only loosens the limit
+    long second = (long)time( 0 );
+    if ( m_second.load( std::memory_order_relaxed ) != second )
+    {
+      m_second.store( second, std::memory_order_relaxed );
+      m_bytes.store( 0, std::memory_order_relaxed );
+    }
+    long bytes = (long)message.size();
+    if ( m_bytes.fetch_add( bytes, std::memory_order_relaxed ) + bytes
+         > m_maxBytesPerSecond )
+      return reject();
+  }
+
+  return true;
+}
+
+} //namespace FIX
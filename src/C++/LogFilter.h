@@ -0,0 +1,89 @@
+/* -*- C++ -*- */
+
+/****************************************************************************
+** Copyright (c) 2001-2014
+**
+** This file is part of the QuickFIX FIX Engine
+**
+** This file may be distributed under the terms of the quickfixengine.org
+** license as defined by quickfixengine.org and appearing in the file
+** LICENSE included in the packaging of this file.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** See http://www.quickfixengine.org/LICENSE for licensing information.
+**
+** Contact ask@quickfixengine.org if any conditions of this licensing are
+** not clear to you.
+**
+****************************************************************************/
+
+#ifndef FIX_LOGFILTER_H
+#define FIX_LOGFILTER_H
+
+#ifdef _MSC_VER
+#pragma warning( disable : 4503 4355 4786 4290 )
+#endif
+
+#include "Dictionary.h"
+#include "Exceptions.h"
+#include <atomic>
+#include <string>
+#include <vector>
+
+namespace FIX
+{
+/**
+ * Decides which messages of a session reach its Log.
+ *
+ * Runs on the raw message, before any Log formats or copies it.
+ * Session level messages and included types are always logged, excluded
+ * types never are.  Of the remaining messages one in the sample rate is
+ * kept, up to a number of bytes per second.  Unless a sample rate is
+ * given that is all of them, or none when types are included.
+ */
+class LogFilter
+{
+public:
+  LogFilter();
+  /// Read the Log filter settings of a session.
+  LogFilter( const Dictionary& dict ) throw( ConfigError );
+  LogFilter( const LogFilter& );
+  LogFilter& operator=( const LogFilter& );
+
+  void include( const std::string& msgType );
+  void exclude( const std::string& msgType );
+  void setSampleRate( int rate );
+  void setMaxBytesPerSecond( long bytes );
+
+  /// True if the message should be logged.
+  bool accept( const std::string& message )
+  { return !m_enabled || filter( message ); }
+
+  /// Number of messages that were not logged.
+  long getFiltered() const { return m_filtered.load(); }
+
+private:
+  bool filter( const std::string& message );
+  bool reject() { ++m_filtered; return false; }
+  void update();
+  static void split( const std::string& value, std::vector < std::string >& types );
+  static bool contains( const std::vector < std::string >& types,
+                        const char* type, size_t size );
+
+  std::vector < std::string > m_include;
+  std::vector < std::string > m_exclude;
+  int m_sampleRate;
+  long m_maxBytesPerSecond;
+  bool m_enabled;
+  int m_rate;
+
+  std::atomic < unsigned > m_sampled;
+  std::atomic < long > m_second;
+  std::atomic < long > m_bytes;
+  std::atomic < long > m_filtered;
+};
+}
+
+#endif //FIX_LOGFILTER_H
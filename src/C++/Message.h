@@ -271,6 +271,16 @@ namespace FIX
 			m_trailer.clear();
 		}
 
+		/// Exchange contents with another message without copying fields
+		void swap(Message& rhs)
+		{
+			FieldMap::swap(rhs);
+			m_header.swap(rhs.m_header);
+			m_trailer.swap(rhs.m_trailer);
+			std::swap(m_validStructure, rhs.m_validStructure);
+			std::swap(m_field, rhs.m_field);
+		}
+
 		static bool isAdminMsgType(const MsgType& msgType)
 		{
 			if (msgType.getValue().length() != 1)
@@ -24,11 +24,36 @@
 #endif
 
 #include "MessageStore.h"
+#include <algorithm>
+#include <sstream>
+#include <cstring>
 
 namespace FIX
 {
+MemoryStoreFactory::MemoryStoreFactory( const Dictionary& dictionary )
+throw( ConfigError )
+: m_maxMessages( 0 ), m_maxBytes( 0 )
+{
+  if ( dictionary.has( MEMORY_STORE_MAX_MESSAGES ) )
+  {
+    int maxMessages = dictionary.getInt( MEMORY_STORE_MAX_MESSAGES );
+    if ( maxMessages < 0 )
+      throw ConfigError( std::string( MEMORY_STORE_MAX_MESSAGES ) + " must not be negative" );
+    m_maxMessages = maxMessages;
+  }
+  if ( dictionary.has( MEMORY_STORE_MAX_BYTES ) )
+  {
+    int maxBytes = dictionary.getInt( MEMORY_STORE_MAX_BYTES );
+    if ( maxBytes < 0 )
+      throw ConfigError( std::string( MEMORY_STORE_MAX_BYTES ) + " must not be negative" );
+    m_maxBytes = maxBytes;
+  }
+}
+
 MessageStore* MemoryStoreFactory::create( const SessionID& )
 {
+  if ( m_maxMessages || m_maxBytes )
+    return new BoundedMemoryStore( m_maxMessages, m_maxBytes );
   return new MemoryStore();
 }
 
@@ -49,11 +74,198 @@ void MemoryStore::get( int begin, int end,
 throw( IOException )
 {
   messages.clear();
-  Messages::const_iterator find = m_messages.find( begin );
+  Messages::const_iterator find = m_messages.lower_bound( begin );
   for ( ; find != m_messages.end() && find->first <= end; ++find )
     messages.push_back( find->second );
 }
 
+BoundedMemoryStore::BoundedMemoryStore( size_t maxMessages, size_t maxBytes )
+: m_maxMessages( maxMessages ), m_maxBytes( maxBytes ),
+  m_tail( 0 ), m_bytes( 0 ), m_evictedMessages( 0 ), m_evictedBytes( 0 ),
+  m_nextSenderMsgSeqNum( 1 ), m_nextTargetMsgSeqNum( 1 )
+{
+  size_t capacity = INITIAL_CAPACITY;
+  if ( maxBytes ) capacity = maxBytes;
+  m_ring.resize( capacity );
+}
+
+bool BoundedMemoryStore::set( int msgSeqNum, const std::string& msg )
+throw( IOException )
+{
+  if ( m_records.size() && msgSeqNum <= m_records.back().msgSeqNum )
+    truncate( msgSeqNum );
+
+  size_t size = msg.size();
+  if ( m_maxBytes && size > m_maxBytes )
+  {
+    // can never be retained, count it as evicted straight away
+    ++m_evictedMessages;
+    m_evictedBytes += size;
+    return true;
+  }
+
+  if ( m_maxMessages )
+    while ( m_records.size() >= m_maxMessages ) evict();
+
+  Record record = { msgSeqNum, place( size ), size };
+  if ( size ) memcpy( &m_ring[ record.offset ], msg.data(), size );
+  m_records.push_back( record );
+  m_tail = record.offset + size;
+  m_bytes += size;
+  return true;
+}
+
+struct BoundedMemoryStoreRecordLess
+{
+  template < typename R >
+  bool operator()( const R& record, int msgSeqNum ) const
+  { return record.msgSeqNum < msgSeqNum; }
+};
+
+void BoundedMemoryStore::get( int begin, int end,
+                              std::vector < std::string > & messages ) const
+throw( IOException )
+{
+  messages.clear();
+  Records::const_iterator i = std::lower_bound
+    ( m_records.begin(), m_records.end(), begin, BoundedMemoryStoreRecordLess() );
+  for ( ; i != m_records.end() && i->msgSeqNum <= end; ++i )
+    messages.push_back( std::string( &m_ring[ 0 ] + i->offset, i->size ) );
+}
+
+void BoundedMemoryStore::reset() throw( IOException )
+{
+  m_nextSenderMsgSeqNum = 1;
+  m_nextTargetMsgSeqNum = 1;
+  m_records.clear();
+  m_tail = 0;
+  m_bytes = 0;
+  m_creationTime.setCurrent();
+}
+
+void BoundedMemoryStore::getStatistics( Statistics& statistics ) const
+{
+  statistics = Statistics();
+  if ( m_records.size() )
+  {
+    statistics.firstSeqNum = m_records.front().msgSeqNum;
+    statistics.lastSeqNum = m_records.back().msgSeqNum;
+  }
+  statistics.messages = m_records.size();
+  statistics.bytes = m_bytes;
+  statistics.capacity = m_ring.size();
+  statistics.evictedMessages = m_evictedMessages;
+  statistics.evictedBytes = m_evictedBytes;
+}
+
+std::string BoundedMemoryStore::describe( const Statistics& statistics )
+{
+  std::stringstream stream;
+  if ( statistics.messages )
+    stream << "Retained " << statistics.firstSeqNum << " to "
+           << statistics.lastSeqNum << " (" << statistics.messages
+           << " messages, ";
+  else
+    stream << "Retained none (";
+  stream << statistics.bytes << " of " << statistics.capacity << " bytes)";
+  if ( statistics.evictedMessages )
+    stream << ", evicted " << statistics.evictedMessages << " messages ("
+           << statistics.evictedBytes << " bytes)";
+  return stream.str();
+}
+
+size_t BoundedMemoryStore::place( size_t size )
+{
+  while ( true )
+  {
+    size_t offset = m_tail + size > m_ring.size() ? 0 : m_tail;
+    if ( fits( offset, size ) )
+      return offset;
+    if ( m_maxBytes )
+      evict();
+    else
+      grow( size );
+  }
+}
+
+bool BoundedMemoryStore::fits( size_t offset, size_t size ) const
+{
+  // records without a body take no space, so a head on the tail only
+  // means a full ring while some bytes are retained
+  if ( m_records.empty() || !m_bytes )
+    return offset + size <= m_ring.size();
+
+  // live bytes run from the oldest record up to the tail, wrapping when
+  // the tail is behind the head
+  size_t head = m_records.front().offset;
+  if ( head < m_tail )
+    return offset == m_tail || offset + size <= head;
+  return offset == m_tail && offset + size <= head;
+}
+
+void BoundedMemoryStore::evict()
+{
+  const Record& record = m_records.front();
+  m_bytes -= record.size;
+  ++m_evictedMessages;
+  m_evictedBytes += record.size;
+  m_records.pop_front();
+  if ( m_records.empty() )
+    m_tail = 0;
+}
+
+void BoundedMemoryStore::truncate( int msgSeqNum )
+{
+  while ( m_records.size() && m_records.back().msgSeqNum >= msgSeqNum )
+  {
+    m_bytes -= m_records.back().size;
+    m_records.pop_back();
+  }
+  m_tail = m_records.empty() ? 0
+    : m_records.back().offset + m_records.back().size;
+}
+
+void BoundedMemoryStore::grow( size_t size )
+{
+  std::vector < char > ring( std::max( m_ring.size() * 2, m_bytes + size ) );
+  size_t offset = 0;
+  for ( Records::iterator i = m_records.begin(); i != m_records.end(); ++i )
+  {
+    if ( i->size ) memcpy( &ring[ offset ], &m_ring[ i->offset ], i->size );
+    i->offset = offset;
+    offset += i->size;
+  }
+  m_ring.swap( ring );
+  m_tail = offset;
+}
+
+MessageStoreCursor::MessageStoreCursor( const MessageStore& store,
+                                        int begin, int end, int pageSize )
+: m_store( store ), m_begin( begin ), m_end( end ), m_next( begin ),
+  m_pageSize( pageSize ), m_index( 0 )
+{
+  if ( m_pageSize <= 0 ) m_pageSize = DEFAULT_PAGE_SIZE;
+}
+
+bool MessageStoreCursor::next( std::string& message ) throw( IOException )
+{
+  while ( m_index == m_page.size() )
+  {
+    if ( m_next > m_end )
+      return false;
+
+    int last = m_end;
+    if ( m_end - m_next >= m_pageSize )
+      last = m_next + m_pageSize - 1;
+    m_store.get( m_next, last, m_page );
+    m_index = 0;
+    m_next = last + 1;
+  }
+
+  message.swap( m_page[ m_index++ ] );
+  return true;
+}
+
 MessageStore* MessageStoreFactoryExceptionWrapper::create( const SessionID& sessionID, bool& threw, ConfigError& ex )
 {
   threw = false;
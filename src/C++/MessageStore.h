@@ -27,7 +27,9 @@
 #endif
 
 #include "Message.h"
+#include "Dictionary.h"
 #include <map>
+#include <deque>
 #include <vector>
 #include <string>
 
@@ -51,12 +53,24 @@ public:
  *
  * This will lose all data on process termination. This class should only
  * be used for test applications, never in production.
+ *
+ * When a message or byte limit is given a BoundedMemoryStore is created
+ * instead, retaining only the most recent messages.
  */
 class MemoryStoreFactory : public MessageStoreFactory
 {
 public:
+  MemoryStoreFactory()
+  : m_maxMessages( 0 ), m_maxBytes( 0 ) {}
+  MemoryStoreFactory( size_t maxMessages, size_t maxBytes )
+  : m_maxMessages( maxMessages ), m_maxBytes( maxBytes ) {}
+  MemoryStoreFactory( const Dictionary& dictionary ) throw( ConfigError );
+
   MessageStore* create( const SessionID& );
   void destroy( MessageStore* );
+private:
+  size_t m_maxMessages;
+  size_t m_maxBytes;
 };
 
 /**
@@ -87,6 +101,36 @@ public:
 };
 /*! @} */
 
+/**
+ * Walks the messages stored between two sequence numbers a page at a time.
+ *
+ * Each page covers at most pageSize sequence numbers, so only that many
+ * messages are held in memory however large the range is.
+ */
+class MessageStoreCursor
+{
+public:
+  static const int DEFAULT_PAGE_SIZE = 1000;
+
+  MessageStoreCursor( const MessageStore& store, int begin, int end,
+                      int pageSize = DEFAULT_PAGE_SIZE );
+
+  /// Get the next stored message, false once the range is exhausted.
+  bool next( std::string& ) throw ( IOException );
+
+  int getBegin() const { return m_begin; }
+  int getEnd() const { return m_end; }
+
+private:
+  const MessageStore& m_store;
+  int m_begin;
+  int m_end;
+  int m_next;
+  int m_pageSize;
+  std::vector < std::string > m_page;
+  size_t m_index;
+};
+
 /**
  * Memory based implementation of MessageStore.
  *
@@ -137,6 +181,95 @@ private:
   UtcTimeStamp m_creationTime;
 };
 
+/**
+ * Memory based implementation of MessageStore with bounded retention.
+ *
+ * Messages are copied into a single contiguous byte ring.  Once the ring
+ * holds the maximum number of messages or bytes the oldest messages are
+ * evicted, and resend requests for evicted ranges are answered with a
+ * SequenceReset-GapFill.  A limit of zero is unlimited; without a byte
+ * limit the ring grows as needed.
+ */
+class BoundedMemoryStore : public MessageStore
+{
+public:
+  struct Statistics
+  {
+    Statistics()
+    : firstSeqNum( 0 ), lastSeqNum( 0 ), messages( 0 ), bytes( 0 ),
+      capacity( 0 ), evictedMessages( 0 ), evictedBytes( 0 ) {}
+
+    int firstSeqNum;
+    int lastSeqNum;
+    size_t messages;
+    size_t bytes;
+    size_t capacity;
+    size_t evictedMessages;
+    size_t evictedBytes;
+  };
+
+  static const size_t INITIAL_CAPACITY = 64 * 1024;
+
+  BoundedMemoryStore( size_t maxMessages, size_t maxBytes );
+
+  bool set( int, const std::string& ) throw ( IOException );
+  void get( int, int, std::vector < std::string > & ) const throw ( IOException );
+
+  int getNextSenderMsgSeqNum() const
+  { return m_nextSenderMsgSeqNum; }
+  int getNextTargetMsgSeqNum() const
+  { return m_nextTargetMsgSeqNum; }
+  void setNextSenderMsgSeqNum( int value )
+  { m_nextSenderMsgSeqNum = value; }
+  void setNextTargetMsgSeqNum( int value )
+  { m_nextTargetMsgSeqNum = value; }
+  void incrNextSenderMsgSeqNum()
+  { ++m_nextSenderMsgSeqNum; }
+  void incrNextTargetMsgSeqNum()
+  { ++m_nextTargetMsgSeqNum; }
+
+  void setCreationTime( const UtcTimeStamp& creationTime )
+  { m_creationTime = creationTime; }
+  UtcTimeStamp getCreationTime() const throw ( IOException )
+  { return m_creationTime; }
+
+  void reset() throw ( IOException );
+  void refresh() throw ( IOException ) {}
+
+  size_t getMaxMessages() const { return m_maxMessages; }
+  size_t getMaxBytes() const { return m_maxBytes; }
+
+  void getStatistics( Statistics& ) const;
+  static std::string describe( const Statistics& );
+
+private:
+  struct Record
+  {
+    int msgSeqNum;
+    size_t offset;
+    size_t size;
+  };
+  typedef std::deque < Record > Records;
+
+  size_t place( size_t );
+  bool fits( size_t, size_t ) const;
+  void evict();
+  void truncate( int );
+  void grow( size_t );
+
+  size_t m_maxMessages;
+  size_t m_maxBytes;
+  std::vector < char > m_ring;
+  Records m_records;
+  size_t m_tail;
+  size_t m_bytes;
+  size_t m_evictedMessages;
+  size_t m_evictedBytes;
+  int m_nextSenderMsgSeqNum;
+  int m_nextTargetMsgSeqNum;
+  UtcTimeStamp m_creationTime;
+};
+
 class MessageStoreFactoryExceptionWrapper
 {
 private:
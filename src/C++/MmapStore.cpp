@@ -0,0 +1,417 @@
+/****************************************************************************
+** Copyright (c) 2001-2014
+**
+** This file is part of the QuickFIX FIX Engine
+**
+** This file may be distributed under the terms of the quickfixengine.org
+** license as defined by quickfixengine.org and appearing in the file
+** LICENSE included in the packaging of this file.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** See http://www.quickfixengine.org/LICENSE for licensing information.
+**
+** Contact ask@quickfixengine.org if any conditions of this licensing are
+** not clear to you.
+**
+****************************************************************************/
+
+#ifdef _MSC_VER
+#include "stdafx.h"
+#else
+#include "config.h"
+#endif
+
+#include "MmapStore.h"
+#include "SessionID.h"
+#include "Utility.h"
+#include <algorithm>
+
+namespace FIX
+{
+namespace
+{
+const char STATE_MAGIC[ 8 ] = { 'Q', 'F', 'M', 'M', 'A', 'P', '0', '1' };
+const size_t RECORD_HEADER = 8;
+const size_t RECORD_ALIGN = 8;
+// holes the dense index may hold beyond one per stored message
+const size_t INDEX_SLACK = 1024;
+
+inline size_t recordSize( size_t length )
+{
+  return ( RECORD_HEADER + length + RECORD_ALIGN - 1 ) & ~( RECORD_ALIGN - 1 );
+}
+}
+
+MmapStore::MmapStore( std::string path, const SessionID& s, size_t segmentSize,
+                      const SyncPolicy& policy )
+: m_sessionID( s ), m_policy( policy ), m_segmentSize( segmentSize ),
+  m_pState( 0 ), m_writeOffset( 0 ), m_syncSegment( 0 ), m_syncOffset( 0 ),
+  m_indexBase( 0 ), m_indexCount( 0 )
+{
+  file_mkdir( path.c_str() );
+  if ( path.empty() )
+    path = ".";
+  std::string prefix
+    = file_appendpath( path, s.getName() + ".mmap." );
+
+  m_stateFileName = prefix + "state";
+  m_segmentPrefix = prefix;
+
+  try
+  {
+    open( false );
+  }
+  catch ( const IOException & e )
+  {
+    throw ConfigError( e.what() );
+  }
+}
+
+MmapStore::~MmapStore()
+{
+  StoreSyncer::instance().remove( this );
+  close();
+}
+
+void MmapStore::close()
+{
+  std::vector < Segment > ::iterator i;
+  for ( i = m_segments.begin(); i != m_segments.end(); ++i )
+    file_munmap( i->data, i->size );
+  m_segments.clear();
+
+  if ( m_pState ) file_munmap( m_pState, sizeof( State ) );
+  m_pState = 0;
+
+  m_index.clear();
+  m_indexBase = 0;
+  m_indexCount = 0;
+  m_sparse.clear();
+  m_writeOffset = 0;
+  m_syncSegment = 0;
+  m_syncOffset = 0;
+}
+
+void MmapStore::open( bool deleteFiles )
+{
+  StoreSyncer::instance().remove( this );
+  close();
+
+  if ( deleteFiles )
+  {
+    file_unlink( m_stateFileName.c_str() );
+    for ( size_t i = 0; file_exists( segmentFileName( i ).c_str() ); ++i )
+      file_unlink( segmentFileName( i ).c_str() );
+  }
+
+  size_t size = sizeof( State );
+  m_pState = (State*)file_mmap( m_stateFileName.c_str(), size );
+  if ( !m_pState )
+    throw ConfigError( "Could not map state file: " + m_stateFileName );
+
+  if ( memcmp( m_pState->magic, STATE_MAGIC, sizeof( STATE_MAGIC ) ) != 0 )
+  {
+    m_pState->sender = 1;
+    m_pState->target = 1;
+    setSession();
+    memcpy( m_pState->magic, STATE_MAGIC, sizeof( STATE_MAGIC ) );
+  }
+
+  while ( file_exists( segmentFileName( m_segments.size() ).c_str() ) )
+  {
+    size = m_segmentSize;
+    void* data = file_mmap( segmentFileName( m_segments.size() ).c_str(), size );
+    if ( !data )
+      throw ConfigError( "Could not map segment file: "
+                         + segmentFileName( m_segments.size() ) );
+
+    Segment segment = { (char*)data, size };
+    m_segments.push_back( segment );
+    scanSegment();
+  }
+
+  if ( m_segments.empty() )
+    addSegment();
+
+  m_syncSegment = m_segments.size() - 1;
+  m_syncOffset = m_writeOffset;
+  StoreSyncer::instance().add( this, m_sessionID, m_policy );
+}
+
+void MmapStore::addSegment()
+{
+  size_t size = m_segmentSize;
+  std::string fileName = segmentFileName( m_segments.size() );
+  void* data = file_mmap( fileName.c_str(), size );
+  if ( !data )
+    throw IOException( "Could not map segment file: " + fileName );
+
+  Segment segment = { (char*)data, size };
+  Locker l( m_mutex );
+  m_segments.push_back( segment );
+  m_writeOffset = 0;
+}
+
+void MmapStore::scanSegment()
+{
+  const Segment& segment = m_segments.back();
+  size_t number = m_segments.size() - 1;
+
+  m_writeOffset = 0;
+  while ( m_writeOffset + RECORD_HEADER <= segment.size )
+  {
+    const char* record = segment.data + m_writeOffset;
+    int msgSeqNum;
+    unsigned int length;
+    memcpy( &msgSeqNum, record, 4 );
+    memcpy( &length, record + 4, 4 );
+    if ( msgSeqNum <= 0 ) break;
+    if ( m_writeOffset + RECORD_HEADER + length > segment.size ) break;
+
+    index( msgSeqNum, Location( number, m_writeOffset + RECORD_HEADER, length ) );
+    m_writeOffset += recordSize( length );
+  }
+}
+
+void MmapStore::index( int msgSeqNum, const Location& location )
+{
+  if ( m_index.empty() )
+    m_indexBase = msgSeqNum;
+
+  if ( msgSeqNum < m_indexBase )
+  {
+    m_sparse[ msgSeqNum ] = location;
+    return;
+  }
+
+  size_t position = msgSeqNum - m_indexBase;
+  if ( position >= m_index.size() )
+  {
+    // a jump that would leave more holes than messages starts a new run,
+    // the numbers indexed so far move to the sparse map
+    if ( position >= 2 * m_indexCount + INDEX_SLACK )
+    {
+      for ( size_t i = 0; i < m_index.size(); ++i )
+      {
+        if ( m_index[ i ].size )
+          m_sparse[ m_indexBase + (int)i ] = m_index[ i ];
+      }
+      m_index.clear();
+      m_indexCount = 0;
+      m_indexBase = msgSeqNum;
+      position = 0;
+    }
+    m_index.resize( position + 1 );
+  }
+
+  if ( !m_index[ position ].size )
+    ++m_indexCount;
+  m_index[ position ] = location;
+}
+
+std::string MmapStore::segmentFileName( size_t segment ) const
+{
+  return m_segmentPrefix + IntConvertor::convert( (int)segment );
+}
+
+MessageStore* MmapStoreFactory::create( const SessionID& s )
+{
+  if ( m_path.size() )
+    return new MmapStore( m_path, s, MmapStore::DEFAULT_SEGMENT_SIZE, m_policy );
+
+  Dictionary settings = SessionSettings::instance().get( s );
+  std::string path = settings.getString( MMAP_STORE_PATH );
+  size_t segmentSize = MmapStore::DEFAULT_SEGMENT_SIZE;
+  if ( settings.has( MMAP_STORE_SEGMENT_SIZE ) )
+  {
+    int value = settings.getInt( MMAP_STORE_SEGMENT_SIZE );
+    if ( value <= 0 )
+      throw ConfigError( std::string( MMAP_STORE_SEGMENT_SIZE ) + " must be positive" );
+    segmentSize = value;
+  }
+  return new MmapStore( path, s, segmentSize, SyncPolicy( settings ) );
+}
+
+void MmapStoreFactory::destroy( MessageStore* pStore )
+{
+  delete pStore;
+}
+
+bool MmapStore::set( int msgSeqNum, const std::string& msg )
+throw ( IOException )
+{
+  if ( msgSeqNum <= 0 )
+    throw IOException( "Invalid sequence number for " + m_segmentPrefix );
+
+  size_t length = msg.size();
+  size_t record = recordSize( length );
+  if ( record > m_segmentSize )
+    throw IOException( "Message does not fit in segment of " + m_segmentPrefix );
+
+  if ( m_writeOffset + record > m_segments.back().size )
+    addSegment();
+
+  Segment& segment = m_segments.back();
+  char* p = segment.data + m_writeOffset;
+  unsigned int size = (unsigned int)length;
+
+  // the sequence number is written last so a partially written
+  // record still reads as the end of the segment
+  memcpy( p + RECORD_HEADER, msg.data(), length );
+  memcpy( p + 4, &size, 4 );
+  memcpy( p, &msgSeqNum, 4 );
+
+  index( msgSeqNum, Location( m_segments.size() - 1,
+                              m_writeOffset + RECORD_HEADER, length ) );
+  {
+    Locker l( m_mutex );
+    m_writeOffset += record;
+  }
+
+  if ( m_policy.sync() )
+    StoreSyncer::instance().written( this );
+  return true;
+}
+
+void MmapStore::get( int begin, int end,
+                     std::vector < View > & result ) const
+{
+  result.clear();
+  if ( begin > end ) return;
+
+  std::map < int, Location > ::const_iterator i;
+  for ( i = m_sparse.lower_bound( begin );
+        i != m_sparse.end() && i->first <= end; ++i )
+  {
+    result.push_back( View( m_segments[ i->second.segment ].data + i->second.offset,
+                            i->second.size ) );
+  }
+
+  if ( m_index.empty() || end < m_indexBase ) return;
+  size_t first = begin > m_indexBase ? begin - m_indexBase : 0;
+  size_t last = std::min( (size_t)( end - m_indexBase ) + 1, m_index.size() );
+
+  for ( size_t position = first; position < last; ++position )
+  {
+    const Location& location = m_index[ position ];
+    if ( location.size )
+      result.push_back( View( m_segments[ location.segment ].data + location.offset,
+                              location.size ) );
+  }
+}
+
+void MmapStore::get( int begin, int end,
+                     std::vector < std::string > & result ) const
+throw ( IOException )
+{
+  std::vector < View > views;
+  get( begin, end, views );
+
+  result.clear();
+  result.reserve( views.size() );
+  std::vector < View > ::const_iterator i;
+  for ( i = views.begin(); i != views.end(); ++i )
+    result.push_back( std::string( i->first, i->second ) );
+}
+
+int MmapStore::getNextSenderMsgSeqNum() const throw ( IOException )
+{
+  return m_pState->sender;
+}
+
+int MmapStore::getNextTargetMsgSeqNum() const throw ( IOException )
+{
+  return m_pState->target;
+}
+
+void MmapStore::setNextSenderMsgSeqNum( int value ) throw ( IOException )
+{
+  m_pState->sender = value;
+  if ( m_policy.sync() )
+    StoreSyncer::instance().written( this, false );
+}
+
+void MmapStore::setNextTargetMsgSeqNum( int value ) throw ( IOException )
+{
+  m_pState->target = value;
+  if ( m_policy.sync() )
+    StoreSyncer::instance().written( this, false );
+}
+
+void MmapStore::incrNextSenderMsgSeqNum() throw ( IOException )
+{
+  ++m_pState->sender;
+  if ( m_policy.sync() )
+    StoreSyncer::instance().written( this, false );
+}
+
+void MmapStore::incrNextTargetMsgSeqNum() throw ( IOException )
+{
+  ++m_pState->target;
+  if ( m_policy.sync() )
+    StoreSyncer::instance().written( this, false );
+}
+
+bool MmapStore::sync()
+{
+  std::vector < std::pair < char*, size_t > > ranges;
+  {
+    Locker l( m_mutex );
+    for ( size_t i = m_syncSegment; i < m_segments.size(); ++i )
+    {
+      size_t begin = i == m_syncSegment ? m_syncOffset : 0;
+      size_t end = i + 1 == m_segments.size() ? m_writeOffset : m_segments[ i ].size;
+      if ( end > begin )
+        ranges.push_back( std::make_pair( m_segments[ i ].data + begin, end - begin ) );
+    }
+    m_syncSegment = m_segments.size() - 1;
+    m_syncOffset = m_writeOffset;
+  }
+
+  bool result = file_msync( m_pState, sizeof( State ) );
+  std::vector < std::pair < char*, size_t > > ::iterator i;
+  for ( i = ranges.begin(); i != ranges.end(); ++i )
+    result = file_msync( i->first, i->second ) && result;
+  return result;
+}
+
+UtcTimeStamp MmapStore::getCreationTime() const throw ( IOException )
+{
+  return UtcTimeStampConvertor::convert( m_pState->creationTime, true );
+}
+
+void MmapStore::reset() throw ( IOException )
+{
+  try
+  {
+    open( true );
+  }
+  catch( std::exception& e )
+  {
+    throw IOException( e.what() );
+  }
+}
+
+void MmapStore::refresh() throw ( IOException )
+{
+  try
+  {
+    open( false );
+  }
+  catch( std::exception& e )
+  {
+    throw IOException( e.what() );
+  }
+}
+
+void MmapStore::setSession()
+{
+  std::string time = UtcTimeStampConvertor::convert( UtcTimeStamp() );
+  memset( m_pState->creationTime, 0, sizeof( m_pState->creationTime ) );
+  memcpy( m_pState->creationTime, time.c_str(),
+          std::min( time.size(), sizeof( m_pState->creationTime ) - 1 ) );
+}
+
+} //namespace FIX
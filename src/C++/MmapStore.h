@@ -0,0 +1,173 @@
+/* -*- C++ -*- */
+
+/****************************************************************************
+** Copyright (c) 2001-2014
+**
+** This file is part of the QuickFIX FIX Engine
+**
+** This file may be distributed under the terms of the quickfixengine.org
+** license as defined by quickfixengine.org and appearing in the file
+** LICENSE included in the packaging of this file.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** See http://www.quickfixengine.org/LICENSE for licensing information.
+**
+** Contact ask@quickfixengine.org if any conditions of this licensing are
+** not clear to you.
+**
+****************************************************************************/
+
+#ifndef FIX_MMAPSTORE_H
+#define FIX_MMAPSTORE_H
+
+#ifdef _MSC_VER
+#pragma warning( disable : 4503 4355 4786 4290 )
+#endif
+
+#include "MessageStore.h"
+#include "SessionSettings.h"
+#include "StoreSyncer.h"
+#include "Mutex.h"
+#include <map>
+#include <string>
+#include <vector>
+
+namespace FIX
+{
+class Session;
+
+/// Creates a memory mapped file based implementation of MessageStore.
+class MmapStoreFactory : public MessageStoreFactory
+{
+public:
+  MmapStoreFactory()
+ {};
+  MmapStoreFactory( const std::string& path,
+                    const SyncPolicy& policy = SyncPolicy() )
+: m_path( path ), m_policy( policy ) {};
+
+  MessageStore* create( const SessionID& );
+  void destroy( MessageStore* );
+private:
+  std::string m_path;
+  SyncPolicy m_policy;
+};
+/*! @} */
+
+/**
+ * Memory mapped file based implementation of MessageStore.
+ *
+ * Outgoing messages are appended to fixed size segment files which are
+ * preallocated and mapped into memory, so storing a message is a copy into
+ * the mapping rather than a write system call.  Sequence numbers and the
+ * session creation time live in a small mapped state file.
+ *
+ * The formats of the files are:<br>
+ * &nbsp;&nbsp;
+ *   [path]+[BeginString]-[SenderCompID]-[TargetCompID].mmap.state<br>
+ * &nbsp;&nbsp;
+ *   [path]+[BeginString]-[SenderCompID]-[TargetCompID].mmap.[segment]<br>
+ *
+ * Each segment is a sequence of records padded to eight bytes<br>
+ * &nbsp;&nbsp;
+ *   [MsgSeqNum:4][Length:4][Message]<br><br>
+ * A MsgSeqNum of zero marks the end of the data in a segment.  The
+ * record index is rebuilt by scanning the segments when the store is opened.
+ * It is a vector for the current run of sequence numbers and a map for
+ * numbers below it, so a large jump in MsgSeqNum starts a new run rather
+ * than filling the gap.
+ *
+ * Mapped writes reach the operating system immediately, so the NONE and
+ * FLUSH sync policies behave the same; COUNT and INTERVAL msync the
+ * written ranges from the StoreSyncer.
+ */
+class MmapStore : public MessageStore, public Syncable
+{
+public:
+  /// Location and length of a message inside a mapped segment.
+  typedef std::pair < const char*, size_t > View;
+
+  MmapStore( std::string, const SessionID& s,
+             size_t segmentSize = DEFAULT_SEGMENT_SIZE,
+             const SyncPolicy& policy = SyncPolicy() );
+  virtual ~MmapStore();
+
+  bool set( int, const std::string& ) throw ( IOException );
+  void get( int, int, std::vector < std::string > & ) const throw ( IOException );
+  /// Get messages without copying them out of the mapping.
+  /// Views stay valid until the store is reset, refreshed or destroyed.
+  void get( int, int, std::vector < View > & ) const;
+
+  int getNextSenderMsgSeqNum() const throw ( IOException );
+  int getNextTargetMsgSeqNum() const throw ( IOException );
+  void setNextSenderMsgSeqNum( int value ) throw ( IOException );
+  void setNextTargetMsgSeqNum( int value ) throw ( IOException );
+  void incrNextSenderMsgSeqNum() throw ( IOException );
+  void incrNextTargetMsgSeqNum() throw ( IOException );
+
+  UtcTimeStamp getCreationTime() const throw ( IOException );
+
+  void reset() throw ( IOException );
+  void refresh() throw ( IOException );
+
+  bool sync();
+
+  static const size_t DEFAULT_SEGMENT_SIZE = 64 * 1024 * 1024;
+
+private:
+  struct Segment
+  {
+    char* data;
+    size_t size;
+  };
+
+  struct Location
+  {
+    Location() : segment( 0 ), offset( 0 ), size( 0 ) {}
+    Location( size_t s, size_t o, size_t n ) : segment( s ), offset( o ), size( n ) {}
+
+    size_t segment;
+    size_t offset;
+    size_t size;
+  };
+
+  struct State
+  {
+    char magic[ 8 ];
+    int sender;
+    int target;
+    char creationTime[ 32 ];
+  };
+
+  void open( bool deleteFiles );
+  void close();
+  void addSegment();
+  void scanSegment();
+  void index( int msgSeqNum, const Location& location );
+  void setSession();
+  std::string segmentFileName( size_t segment ) const;
+
+  SessionID m_sessionID;
+  SyncPolicy m_policy;
+
+  std::string m_stateFileName;
+  std::string m_segmentPrefix;
+  size_t m_segmentSize;
+
+  State* m_pState;
+  std::vector < Segment > m_segments;
+  size_t m_writeOffset;
+  size_t m_syncSegment;
+  size_t m_syncOffset;
+  Mutex m_mutex;
+
+  std::vector < Location > m_index;
+  int m_indexBase;
+  size_t m_indexCount;
+  std::map < int, Location > m_sparse;
+};
+}
+
+#endif //FIX_MMAPSTORE_H
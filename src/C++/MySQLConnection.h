@@ -36,7 +36,10 @@
 #include <errmsg.h>
 #include "DatabaseConnectionID.h"
 #include "DatabaseConnectionPool.h"
+#include "FieldConvertors.h"
 #include "Mutex.h"
+#include <string.h>
+#include <vector>
 
 #undef MYSQL_PORT
 
@@ -114,6 +117,163 @@ private:
   std::vector<MYSQL_ROW> m_rows;
 };
 
+/**
+ * Prepared MySQL statement with string parameters.
+ *
+ * Parameters are sent as strings and converted by the server to the
+ * column types.  The statement is prepared on first use and again
+ * after the connection it was prepared on has been lost.
+ */
+class MySQLStatement
+{
+public:
+  MySQLStatement( const std::string& query, int parameters )
+  : m_pConnection( 0 ), m_pStatement( 0 ), m_status( 0 ), m_query( query ),
+    m_values( parameters ), m_nulls( parameters, 0 ),
+    m_lengths( parameters, 0 ), m_binds( parameters )
+  {}
+
+  ~MySQLStatement()
+  {
+    close();
+  }
+
+  int parameters() const
+  {
+    return (int)m_values.size();
+  }
+
+  /// Most placeholders the server accepts in a single statement.
+  static const int MAX_PARAMETERS = 65535;
+
+  /// Rows to write next as one multi-row statement.  Full batches are
+  /// written whole and the rest in power of two chunks, so a bounded
+  /// number of statements covers every remainder.
+  static int batch( size_t remaining, int batchSize )
+  {
+    if( remaining >= (size_t)batchSize )
+      return batchSize;
+    int rows = 1;
+    while( (size_t)rows * 2 <= remaining )
+      rows *= 2;
+    return rows;
+  }
+
+  void set( int index, const std::string& value )
+  {
+    m_values[ index ] = value;
+    m_nulls[ index ] = 0;
+  }
+
+  void set( int index, int value )
+  {
+    set( index, IntConvertor::convert( value ) );
+  }
+
+  void setNull( int index )
+  {
+    m_values[ index ].clear();
+    m_nulls[ index ] = 1;
+  }
+
+  bool execute( MYSQL* pConnection )
+  {
+    int retry = 0;
+
+    do
+    {
+      if( prepare( pConnection ) && bind()
+          && mysql_stmt_execute( m_pStatement ) == 0 )
+      {
+        m_status = 0;
+        return true;
+      }
+
+      m_status = m_pStatement
+        ? mysql_stmt_errno( m_pStatement ) : mysql_errno( pConnection );
+      m_reason = m_pStatement
+        ? mysql_stmt_error( m_pStatement ) : mysql_error( pConnection );
+      if( m_status != CR_SERVER_GONE_ERROR && m_status != CR_SERVER_LOST )
+        break;
+
+      // statement handles do not survive a reconnect
+      close();
+      mysql_ping( pConnection );
+      retry++;
+    } while( retry <= 1 );
+    return success();
+  }
+
+  bool success()
+  {
+    return m_status == 0;
+  }
+
+  const std::string& reason()
+  {
+    return m_reason;
+  }
+
+  void throwException() throw( IOException )
+  {
+    if( !success() )
+      throw IOException( "Statement failed [" + m_query + "] " + reason() );
+  }
+
+private:
+  bool prepare( MYSQL* pConnection )
+  {
+    if( m_pStatement && m_pConnection == pConnection )
+      return true;
+
+    close();
+    m_pStatement = mysql_stmt_init( pConnection );
+    if( !m_pStatement )
+      return false;
+    if( mysql_stmt_prepare( m_pStatement, m_query.c_str(), m_query.size() ) )
+      return false;
+    m_pConnection = pConnection;
+    return true;
+  }
+
+  bool bind()
+  {
+    if( m_binds.empty() )
+      return true;
+
+    for( size_t i = 0; i < m_binds.size(); ++i )
+    {
+      MYSQL_BIND& bind = m_binds[ i ];
+      memset( &bind, 0, sizeof( bind ) );
+      m_lengths[ i ] = m_values[ i ].size();
+      bind.buffer_type = MYSQL_TYPE_STRING;
+      bind.buffer = (void*)m_values[ i ].data();
+      bind.buffer_length = m_lengths[ i ];
+      bind.length = &m_lengths[ i ];
+      bind.is_null = &m_nulls[ i ];
+    }
+    return mysql_stmt_bind_param( m_pStatement, &m_binds[ 0 ] ) == 0;
+  }
+
+  void close()
+  {
+    if( m_pStatement )
+      mysql_stmt_close( m_pStatement );
+    m_pStatement = 0;
+    m_pConnection = 0;
+  }
+
+  MYSQL* m_pConnection;
+  MYSQL_STMT* m_pStatement;
+  unsigned int m_status;
+  std::string m_query;
+  std::string m_reason;
+  std::vector<std::string> m_values;
+  std::vector<my_bool> m_nulls;
+  std::vector<unsigned long> m_lengths;
+  std::vector<MYSQL_BIND> m_binds;
+};
+
 class MySQLConnection
 {
 public:
@@ -161,6 +321,12 @@ public:
     return pQuery.execute( m_pConnection );
   }
 
+  bool execute( MySQLStatement& statement )
+  {
+    Locker locker( m_mutex );
+    return statement.execute( m_pConnection );
+  }
+
 private:
   void connect()
   {
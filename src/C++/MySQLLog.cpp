@@ -40,10 +40,11 @@ const std::string MySQLLogFactory::DEFAULT_USER = "root";
 const std::string MySQLLogFactory::DEFAULT_PASSWORD = "";
 const std::string MySQLLogFactory::DEFAULT_HOST = "localhost";
 const short MySQLLogFactory::DEFAULT_PORT = 0;
+const long MySQLLogFactory::DEFAULT_BATCH_INTERVAL = 100000;
 
 MySQLLog::MySQLLog
 ( const SessionID& s, const DatabaseConnectionID& d, MySQLConnectionPool* p )
-: m_pConnectionPool( p )
+: m_pConnectionPool( p ), m_batchSize( 1 )
 {
   init();
   m_pSessionID = new SessionID( s );
@@ -52,7 +53,7 @@ MySQLLog::MySQLLog
 
 MySQLLog::MySQLLog
 ( const DatabaseConnectionID& d, MySQLConnectionPool* p )
-: m_pConnectionPool( p ), m_pSessionID( 0 )
+: m_pConnectionPool( p ), m_pSessionID( 0 ), m_batchSize( 1 )
 {
   init();
   m_pConnection = m_pConnectionPool->create( d );
@@ -61,7 +62,7 @@ MySQLLog::MySQLLog
 MySQLLog::MySQLLog
 ( const SessionID& s, const std::string& database, const std::string& user,
   const std::string& password, const std::string& host, short port )
-  : m_pConnectionPool( 0 )
+  : m_pConnectionPool( 0 ), m_batchSize( 1 )
 {
   init();
   m_pSessionID = new SessionID( s );
@@ -71,7 +72,7 @@ MySQLLog::MySQLLog
 MySQLLog::MySQLLog
 ( const std::string& database, const std::string& user,
   const std::string& password, const std::string& host, short port )
-  : m_pConnectionPool( 0 ), m_pSessionID( 0 )
+  : m_pConnectionPool( 0 ), m_pSessionID( 0 ), m_batchSize( 1 )
 {
   m_pConnection = new MySQLConnection( database, user, password, host, port );
 }
@@ -85,6 +86,9 @@ void MySQLLog::init()
 
 MySQLLog::~MySQLLog()
 {
+  StoreSyncer::instance().remove( this );
+  flush();
+
   if( m_pConnectionPool )
     m_pConnectionPool->destroy( m_pConnection );
   else
@@ -176,6 +180,14 @@ void MySQLLogFactory::initLog( const Dictionary& settings, MySQLLog& log )
 
   try { log.setEventTable( settings.getString( MYSQL_LOG_EVENT_TABLE ) ); }
   catch( ConfigError& ) {}
+
+  if( settings.has( MYSQL_LOG_BATCH_SIZE ) )
+  {
+    long interval = DEFAULT_BATCH_INTERVAL;
+    if( settings.has( MYSQL_LOG_BATCH_INTERVAL ) )
+      interval = settings.getInt( MYSQL_LOG_BATCH_INTERVAL );
+    log.setBatch( settings.getInt( MYSQL_LOG_BATCH_SIZE ), interval );
+  }
 }
 
 void MySQLLogFactory::destroy( Log* pLog )
@@ -215,6 +227,11 @@ void MySQLLog::clear()
   eventQuery 
     << "DELETE FROM " << m_eventTable << " " << whereClause.str();
 
+  {
+    Locker l( m_mutex );
+    m_pending.clear();
+  }
+
   MySQLQuery incoming( incomingQuery.str() );
   MySQLQuery outgoing( outgoingQuery.str() );
   MySQLQuery event( eventQuery.str() );
@@ -227,6 +244,24 @@ void MySQLLog::backup()
 {
 }
 
+void MySQLLog::setBatch( int size, long interval )
+{
+  if( size <= 0 )
+    throw ConfigError( std::string( MYSQL_LOG_BATCH_SIZE ) + " must be positive" );
+  if( interval <= 0 )
+    throw ConfigError( std::string( MYSQL_LOG_BATCH_INTERVAL ) + " must be positive" );
+
+  StoreSyncer::instance().remove( this );
+  flush();
+  m_batchSize = size;
+  if( m_batchSize > 1 )
+  {
+    SessionID sessionID = m_pSessionID ? *m_pSessionID : SessionID( "", "", "" );
+    StoreSyncer::instance().add
+      ( this, sessionID, SyncPolicy( SyncPolicy::COUNT, size, interval ) );
+  }
+}
+
 void MySQLLog::insert( const std::string& table, const std::string value )
 {
   UtcTimeStamp time;
@@ -238,36 +273,107 @@ void MySQLLog::insert( const std::string& table, const std::string value )
   STRING_SPRINTF( sqlTime, "%d-%02d-%02d %02d:%02d:%02d",
            year, month, day, hour, minute, second );
 
-  char* valueCopy = new char[ (value.size() * 2) + 1 ];
-  mysql_escape_string( valueCopy, value.c_str(), value.size() );
+  Line line;
+  line.table = table;
+  line.time = sqlTime;
+  line.millis = millis;
+  line.text = value;
+
+  if( m_batchSize > 1 )
+  {
+    {
+      Locker l( m_mutex );
+      m_pending.push_back( line );
+    }
+    StoreSyncer::instance().written( this );
+    return;
+  }
 
-  std::stringstream queryString;
-  queryString << "INSERT INTO " << table << " "
-  << "(time, time_milliseconds, beginstring, sendercompid, targetcompid, session_qualifier, text) "
-  << "VALUES ("
-  << "'" << sqlTime << "','" << millis << "',";
+  Locker l( m_dbMutex );
+  MySQLStatement& insert = statement( table, 1 );
+  bindLine( insert, 0, line );
+  m_pConnection->execute( insert );
+}
 
+void MySQLLog::flush()
+{
+  Locker dbLock( m_dbMutex );
+  Lines lines;
+  {
+    Locker l( m_mutex );
+    lines.swap( m_pending );
+  }
+
+  // write each table's lines in the order they were logged
+  while( lines.size() )
+  {
+    std::string table = lines.front().table;
+    Lines batch;
+    Lines rest;
+    Lines::const_iterator i;
+    for( i = lines.begin(); i != lines.end(); ++i )
+      ( i->table == table ? batch : rest ).push_back( *i );
+
+    size_t next = 0;
+    while( next < batch.size() )
+    {
+      int rows = MySQLStatement::batch( batch.size() - next, m_batchSize );
+      MySQLStatement& insert = statement( table, rows );
+      for( int row = 0; row < rows; ++row )
+        bindLine( insert, row, batch[ next + row ] );
+      m_pConnection->execute( insert );
+      next += rows;
+    }
+    lines.swap( rest );
+  }
+}
+
+bool MySQLLog::sync()
+{
+  flush();
+  return true;
+}
+
+void MySQLLog::bindLine( MySQLStatement& statement, int row, const Line& line )
+{
+  int first = row * 7;
+  statement.set( first, line.time );
+  statement.set( first + 1, line.millis );
   if( m_pSessionID )
   {
-    queryString
-    << "\"" << m_pSessionID->getBeginString().getValue() << "\","
-    << "\"" << m_pSessionID->getSenderCompID().getValue() << "\","
-    << "\"" << m_pSessionID->getTargetCompID().getValue() << "\",";
+    statement.set( first + 2, m_pSessionID->getBeginString().getValue() );
+    statement.set( first + 3, m_pSessionID->getSenderCompID().getValue() );
+    statement.set( first + 4, m_pSessionID->getTargetCompID().getValue() );
     if( m_pSessionID->getSessionQualifier() == "" )
-      queryString << "NULL" << ",";
+      statement.setNull( first + 5 );
     else
-      queryString << "\"" << m_pSessionID->getSessionQualifier() << "\",";
+      statement.set( first + 5, m_pSessionID->getSessionQualifier() );
   }
   else
   {
-    queryString << "NULL, NULL, NULL, NULL, ";
+    for( int column = 2; column < 6; ++column )
+      statement.setNull( first + column );
   }
+  statement.set( first + 6, line.text );
+}
 
-  queryString << "\"" << valueCopy << "\")";
-  delete [] valueCopy;
-
-  MySQLQuery query( queryString.str() );
-  m_pConnection->execute( query );
+MySQLStatement& MySQLLog::statement( const std::string& table, int rows )
+{
+  Statements::iterator i = m_statements.find( std::make_pair( table, rows ) );
+  if( i == m_statements.end() )
+  {
+    std::string query = "INSERT INTO " + table + " "
+      "(time, time_milliseconds, beginstring, sendercompid, targetcompid, session_qualifier, text) "
+      "VALUES ";
+    for( int row = 0; row < rows; ++row )
+      query += row ? ",(?,?,?,?,?,?,?)" : "(?,?,?,?,?,?,?)";
+
+    std::shared_ptr < MySQLStatement > pStatement
+      ( new MySQLStatement( query, rows * 7 ) );
+    i = m_statements.insert
+      ( std::make_pair( std::make_pair( table, rows ), pStatement ) ).first;
+  }
+  return *i->second;
 }
 
 } //namespace FIX
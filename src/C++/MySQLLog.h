@@ -35,13 +35,23 @@
 #include "Log.h"
 #include "SessionSettings.h"
 #include "MySQLConnection.h"
+#include "StoreSyncer.h"
 #include <fstream>
+#include <map>
+#include <memory>
 #include <string>
+#include <vector>
 
 namespace FIX
 {
-/// MySQL based implementation of Log.
-class MySQLLog : public Log
+/**
+ * MySQL based implementation of Log.
+ *
+ * Lines are written with prepared statements.  When batching is enabled
+ * they are queued and written by the StoreSyncer thread with multi-row
+ * inserts.
+ */
+class MySQLLog : public Log, public Syncable
 {
 public:
   MySQLLog( const SessionID& s, const DatabaseConnectionID& d, MySQLConnectionPool* p );
@@ -69,9 +79,29 @@ public:
   void onEvent( const std::string& value )
   { insert( m_eventTable, value ); }
 
+  /// Write lines in batches of up to size, at most interval
+  /// microseconds after the first queued line.
+  void setBatch( int size, long interval );
+  /// Write queued lines to the database.
+  void flush();
+  bool sync();
+
 private:
+  struct Line
+  {
+    std::string table;
+    std::string time;
+    int millis;
+    std::string text;
+  };
+  typedef std::vector < Line > Lines;
+  typedef std::map < std::pair < std::string, int >,
+                     std::shared_ptr < MySQLStatement > > Statements;
+
   void init();
   void insert( const std::string& table, const std::string value );
+  void bindLine( MySQLStatement&, int, const Line& );
+  MySQLStatement& statement( const std::string& table, int rows );
 
   std::string m_incomingTable;
   std::string m_outgoingTable;
@@ -79,6 +109,11 @@ private:
   MySQLConnection* m_pConnection;
   MySQLConnectionPool* m_pConnectionPool;
   SessionID* m_pSessionID;
+  int m_batchSize;
+  Statements m_statements;
+  Lines m_pending;
+  Mutex m_mutex;
+  Mutex m_dbMutex;
 };
 
 /// Creates a MySQL based implementation of Log.
@@ -90,6 +125,7 @@ public:
   static const std::string DEFAULT_PASSWORD;
   static const std::string DEFAULT_HOST;
   static const short DEFAULT_PORT;
+  static const long DEFAULT_BATCH_INTERVAL;
 
   MySQLLogFactory( const SessionSettings& settings )
 : m_settings( settings ), m_useSettings( true ) 
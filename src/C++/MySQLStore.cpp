@@ -43,31 +43,95 @@ const std::string MySQLStoreFactory::DEFAULT_PASSWORD = "";
 const std::string MySQLStoreFactory::DEFAULT_HOST = "localhost";
 const short MySQLStoreFactory::DEFAULT_PORT = 3306;
 
+namespace
+{
+const int MESSAGE_COLUMNS = 6;
+const char SESSION_WHERE[] =
+  " WHERE beginstring=? and sendercompid=? and targetcompid=? and session_qualifier=?";
+
+std::string insertMessages( int rows )
+{
+  std::string query = "INSERT INTO messages "
+    "(beginstring, sendercompid, targetcompid, session_qualifier, msgseqnum, message) "
+    "VALUES ";
+  for( int i = 0; i < rows; ++i )
+    query += i ? ",(?,?,?,?,?,?)" : "(?,?,?,?,?,?)";
+  return query + " ON DUPLICATE KEY UPDATE message=VALUES(message)";
+}
+}
+
 MySQLStore::MySQLStore
-( const SessionID& s, const DatabaseConnectionID& d, MySQLConnectionPool* p )
-  : m_pConnectionPool( p ), m_sessionID( s )
+( const SessionID& s, const DatabaseConnectionID& d, MySQLConnectionPool* p,
+  const SyncPolicy& policy )
+  : m_pConnectionPool( p ), m_sessionID( s ), m_policy( policy ),
+    m_updateSender( std::string( "UPDATE sessions SET outgoing_seqnum=?" ) + SESSION_WHERE, 5 ),
+    m_updateTarget( std::string( "UPDATE sessions SET incoming_seqnum=?" ) + SESSION_WHERE, 5 )
 {
   m_pConnection = m_pConnectionPool->create( d );
   populateCache();
+  init();
 }
 
 MySQLStore::MySQLStore
 ( const SessionID& s, const std::string& database, const std::string& user,
-  const std::string& password, const std::string& host, short port )
-  : m_pConnectionPool( 0 ), m_sessionID( s )
+  const std::string& password, const std::string& host, short port,
+  const SyncPolicy& policy )
+  : m_pConnectionPool( 0 ), m_sessionID( s ), m_policy( policy ),
+    m_updateSender( std::string( "UPDATE sessions SET outgoing_seqnum=?" ) + SESSION_WHERE, 5 ),
+    m_updateTarget( std::string( "UPDATE sessions SET incoming_seqnum=?" ) + SESSION_WHERE, 5 )
 {
   m_pConnection = new MySQLConnection( database, user, password, host, port );
   populateCache();
+  init();
 }
 
 MySQLStore::~MySQLStore()
 {
+  StoreSyncer::instance().remove( this );
+  try { flush(); }
+  catch( IOException& ) {}
+
   if( m_pConnectionPool )
     m_pConnectionPool->destroy( m_pConnection );
   else
     delete m_pConnection;
 }
 
+void MySQLStore::init()
+{
+  if( m_policy.sync() )
+    StoreSyncer::instance().add( this, m_sessionID, m_policy );
+}
+
+MySQLStatement& MySQLStore::insertStatement( int rows ) const
+{
+  Statements::iterator i = m_inserts.find( rows );
+  if( i == m_inserts.end() )
+  {
+    std::shared_ptr < MySQLStatement > pStatement
+      ( new MySQLStatement( insertMessages( rows ), rows * MESSAGE_COLUMNS ) );
+    i = m_inserts.insert( std::make_pair( rows, pStatement ) ).first;
+  }
+  return *i->second;
+}
+
+void MySQLStore::bindSessionID( MySQLStatement& statement, int first ) const
+{
+  statement.set( first, m_sessionID.getBeginString().getValue() );
+  statement.set( first + 1, m_sessionID.getSenderCompID().getValue() );
+  statement.set( first + 2, m_sessionID.getTargetCompID().getValue() );
+  statement.set( first + 3, m_sessionID.getSessionQualifier() );
+}
+
+void MySQLStore::bindMessage( MySQLStatement& statement, int row,
+                              int msgSeqNum, const std::string& msg ) const
+{
+  int first = row * MESSAGE_COLUMNS;
+  bindSessionID( statement, first );
+  statement.set( first + 4, msgSeqNum );
+  statement.set( first + 5, msg );
+}
+
 void MySQLStore::populateCache()
 {
   std::stringstream queryString;
@@ -158,7 +222,7 @@ MessageStore* MySQLStoreFactory::create( const SessionID& s, const Dictionary& s
   catch( ConfigError& ) {}
 
   DatabaseConnectionID id( database, user, password, host, port );
-  return new MySQLStore( s, id, m_connectionPoolPtr.get() );
+  return new MySQLStore( s, id, m_connectionPoolPtr.get(), SyncPolicy( settings ) );
 }
 
 void MySQLStoreFactory::destroy( MessageStore* pStore )
@@ -169,36 +233,27 @@ void MySQLStoreFactory::destroy( MessageStore* pStore )
 bool MySQLStore::set( int msgSeqNum, const std::string& msg )
 throw ( IOException )
 {
-  char* msgCopy = new char[ (msg.size() * 2) + 1 ];
-  mysql_escape_string( msgCopy, msg.c_str(), msg.size() );
-
-  std::stringstream queryString;
-  queryString << "INSERT INTO messages "
-  << "(beginstring, sendercompid, targetcompid, session_qualifier, msgseqnum, message) "
-  << "VALUES ("
-  << "\"" << m_sessionID.getBeginString().getValue() << "\","
-  << "\"" << m_sessionID.getSenderCompID().getValue() << "\","
-  << "\"" << m_sessionID.getTargetCompID().getValue() << "\","
-  << "\"" << m_sessionID.getSessionQualifier() << "\","
-  << msgSeqNum << ","
-  << "\"" << msgCopy << "\")";
-
-  delete [] msgCopy;
-
-  MySQLQuery query( queryString.str() );
-  if( !m_pConnection->execute(query) )
+  if( m_policy.sync() )
   {
-    std::stringstream queryString2;
-    queryString2 << "UPDATE messages SET message=\"" << msg << "\" WHERE "
-    << "beginstring=" << "\"" << m_sessionID.getBeginString().getValue() << "\" and "
-    << "sendercompid=" << "\"" << m_sessionID.getSenderCompID().getValue() << "\" and "
-    << "targetcompid=" << "\"" << m_sessionID.getTargetCompID().getValue() << "\" and "
-    << "session_qualifier=" << "\"" << m_sessionID.getSessionQualifier() << "\" and "
-    << "msgseqnum=" << msgSeqNum;
-    MySQLQuery query2( queryString2.str() );
-    if( !m_pConnection->execute(query2) )
-      query2.throwException();
+    {
+      Locker l( m_mutex );
+      if( m_error.size() )
+      {
+        std::string error;
+        error.swap( m_error );
+        throw IOException( error );
+      }
+      m_pending.push_back( std::make_pair( msgSeqNum, msg ) );
+    }
+    StoreSyncer::instance().written( this );
+    return true;
   }
+
+  Locker l( m_dbMutex );
+  MySQLStatement& insert = insertStatement( 1 );
+  bindMessage( insert, 0, msgSeqNum, msg );
+  if( !m_pConnection->execute(insert) )
+    insert.throwException();
   return true;
 }
 
@@ -206,6 +261,7 @@ void MySQLStore::get( int begin, int end,
                       std::vector < std::string > & result ) const
 throw ( IOException )
 {
+  flush();
   result.clear();
   std::stringstream queryString;
   queryString << "SELECT message FROM messages WHERE "
@@ -237,31 +293,21 @@ int MySQLStore::getNextTargetMsgSeqNum() const throw ( IOException )
 
 void MySQLStore::setNextSenderMsgSeqNum( int value ) throw ( IOException )
 {
-  std::stringstream queryString;
-  queryString << "UPDATE sessions SET outgoing_seqnum=" << value << " WHERE "
-  << "beginstring=" << "\"" << m_sessionID.getBeginString().getValue() << "\" and "
-  << "sendercompid=" << "\"" << m_sessionID.getSenderCompID().getValue() << "\" and "
-  << "targetcompid=" << "\"" << m_sessionID.getTargetCompID().getValue() << "\" and "
-  << "session_qualifier=" << "\"" << m_sessionID.getSessionQualifier() << "\"";
-  MySQLQuery query( queryString.str() );
-  if( !m_pConnection->execute(query) )
-    query.throwException();
+  Locker l( m_dbMutex );
+  m_updateSender.set( 0, value );
+  bindSessionID( m_updateSender, 1 );
+  if( !m_pConnection->execute(m_updateSender) )
+    m_updateSender.throwException();
   m_cache.setNextSenderMsgSeqNum( value );
 }
 
 void MySQLStore::setNextTargetMsgSeqNum( int value ) throw ( IOException )
 {
-  std::stringstream queryString;
-  queryString << "UPDATE sessions SET incoming_seqnum=" << value << " WHERE "
-  << "beginstring=" << "\"" << m_sessionID.getBeginString().getValue() << "\" and "
-  << "sendercompid=" << "\"" << m_sessionID.getSenderCompID().getValue() << "\" and "
-  << "targetcompid=" << "\"" << m_sessionID.getTargetCompID().getValue() << "\" and "
-  << "session_qualifier=" << "\"" << m_sessionID.getSessionQualifier() << "\"";
-
-  MySQLQuery query( queryString.str() );
-  if( !m_pConnection->execute(query) )
-    query.throwException();
-
+  Locker l( m_dbMutex );
+  m_updateTarget.set( 0, value );
+  bindSessionID( m_updateTarget, 1 );
+  if( !m_pConnection->execute(m_updateTarget) )
+    m_updateTarget.throwException();
   m_cache.setNextTargetMsgSeqNum( value );
 }
 
@@ -284,6 +330,14 @@ UtcTimeStamp MySQLStore::getCreationTime() const throw ( IOException )
 
 void MySQLStore::reset() throw ( IOException )
 {
+  // queued messages belong to the session being reset
+  Locker dbLock( m_dbMutex );
+  {
+    Locker l( m_mutex );
+    m_pending.clear();
+    m_error.clear();
+  }
+
   std::stringstream queryString;
   queryString << "DELETE FROM messages WHERE "
   << "beginstring=" << "\"" << m_sessionID.getBeginString().getValue() << "\" and "
@@ -322,10 +376,57 @@ void MySQLStore::reset() throw ( IOException )
 
 void MySQLStore::refresh() throw ( IOException )
 {
+  flush();
   m_cache.reset();
   populateCache(); 
 }
 
+void MySQLStore::flush() const throw ( IOException )
+{
+  if( !m_policy.sync() ) return;
+
+  Locker dbLock( m_dbMutex );
+  Messages messages;
+  {
+    Locker l( m_mutex );
+    messages.swap( m_pending );
+  }
+
+  size_t i = 0;
+  while( i < messages.size() )
+  {
+    int rows = MySQLStatement::batch( messages.size() - i,
+      std::min( m_policy.getCount(), MySQLStatement::MAX_PARAMETERS / MESSAGE_COLUMNS ) );
+    MySQLStatement& statement = insertStatement( rows );
+    for( int row = 0; row < rows; ++row )
+      bindMessage( statement, row, messages[ i + row ].first, messages[ i + row ].second );
+
+    if( !m_pConnection->execute(statement) )
+    {
+      // keep what was not written so the next flush retries it
+      Locker l( m_mutex );
+      m_pending.insert( m_pending.begin(), messages.begin() + i, messages.end() );
+      statement.throwException();
+    }
+    i += rows;
+  }
+}
+
+bool MySQLStore::sync()
+{
+  try
+  {
+    flush();
+    return true;
+  }
+  catch( IOException& e )
+  {
+    Locker l( m_mutex );
+    m_error = e.what();
+    return false;
+  }
+}
+
 }
 
 #endif
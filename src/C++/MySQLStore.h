@@ -35,7 +35,10 @@
 #include "MessageStore.h"
 #include "SessionSettings.h"
 #include "MySQLConnection.h"
+#include "StoreSyncer.h"
 #include <fstream>
+#include <map>
+#include <memory>
 #include <string>
 
 namespace FIX
@@ -104,13 +107,23 @@ private:
 };
 /*! @} */
 
-/// MySQL based implementation of MessageStore.
-class MySQLStore : public MessageStore
+/**
+ * MySQL based implementation of MessageStore.
+ *
+ * Writes use prepared statements.  With a COUNT or INTERVAL SyncPolicy
+ * messages are queued and written by the StoreSyncer thread with
+ * multi-row inserts, while sequence numbers are still written
+ * immediately.  Messages queued when the process dies are lost and
+ * answered with a gap fill on resend.
+ */
+class MySQLStore : public MessageStore, public Syncable
 {
 public:
-  MySQLStore( const SessionID& s, const DatabaseConnectionID& d, MySQLConnectionPool* p );
+  MySQLStore( const SessionID& s, const DatabaseConnectionID& d, MySQLConnectionPool* p,
+              const SyncPolicy& policy = SyncPolicy() );
   MySQLStore( const SessionID& s, const std::string& database, const std::string& user,
-                   const std::string& password, const std::string& host, short port );
+                   const std::string& password, const std::string& host, short port,
+                   const SyncPolicy& policy = SyncPolicy() );
   ~MySQLStore();
 
   bool set( int, const std::string& ) throw ( IOException );
@@ -128,13 +141,32 @@ public:
   void reset() throw ( IOException );
   void refresh() throw ( IOException );
 
+  /// Write queued messages to the database.
+  void flush() const throw ( IOException );
+  bool sync();
+
 private:
+  typedef std::vector < std::pair < int, std::string > > Messages;
+  typedef std::map < int, std::shared_ptr < MySQLStatement > > Statements;
+
+  void init();
   void populateCache();
+  void bindSessionID( MySQLStatement&, int ) const;
+  void bindMessage( MySQLStatement&, int, int, const std::string& ) const;
+  MySQLStatement& insertStatement( int ) const;
 
   MemoryStore m_cache;
   MySQLConnection* m_pConnection;
   MySQLConnectionPool* m_pConnectionPool;
   SessionID m_sessionID;
+  SyncPolicy m_policy;
+  mutable Statements m_inserts;
+  MySQLStatement m_updateSender;
+  MySQLStatement m_updateTarget;
+  mutable Messages m_pending;
+  mutable std::string m_error;
+  mutable Mutex m_mutex;
+  mutable Mutex m_dbMutex;
 };
 }
 
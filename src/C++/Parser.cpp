@@ -30,15 +30,39 @@
 
 namespace FIX
 {
+	namespace
+	{
+		// find that stops at size instead of the end of the buffer
+		std::string::size_type find(const std::string& buffer,
+			std::string::size_type size, const char* str,
+			std::string::size_type pos = 0)
+		{
+			if (pos >= size)
+				return std::string::npos;
+			const char* begin = buffer.data();
+			const char* end = begin + size;
+			const char* result = std::search(begin + pos, end, str, str + strlen(str));
+			return result == end ? std::string::npos : result - begin;
+		}
+	}
+
 	bool Parser::extractLength(int& length, std::string::size_type& pos,
 		const std::string& buffer)
 		throw(MessageParseError)
 	{
-		std::string::size_type startPos = buffer.find("\0019=");
+		pos = 0;
+		return extractLength(length, pos, buffer, buffer.size());
+	}
+
+	bool Parser::extractLength(int& length, std::string::size_type& pos,
+		const std::string& buffer, std::string::size_type size)
+		throw(MessageParseError)
+	{
+		std::string::size_type startPos = find(buffer, size, "\0019=", pos);
 		if (startPos == std::string::npos)
 			return false;
 		startPos += 3;
-		std::string::size_type endPos = buffer.find("\001", startPos);
+		std::string::size_type endPos = find(buffer, size, "\001", startPos);
 		if (endPos == std::string::npos)
 			return false;
 
@@ -64,45 +88,63 @@ namespace FIX
 	{
 		std::string::size_type pos = 0;
 
-		pos = m_buffer.find("8=");
+		pos = find(m_buffer, m_length, "8=", m_pos);
 		if (pos == std::string::npos)
 			return false;
-		m_buffer.erase(0, pos);
+		consume(pos - m_pos);
 
 		int length = 0;
 		try
 		{
-			if (extractLength(length, pos, m_buffer))
+			if (extractLength(length, pos, m_buffer, m_length))
 			{
 				pos += length;
-				if (m_buffer.size() < pos)
+				if (m_length < pos)
 					return false;
 
-				pos = m_buffer.find("\00110=", pos - 1);
+				pos = find(m_buffer, m_length, "\00110=", pos - 1);
 				if (pos == std::string::npos) 
 					return false;
 				pos += 4;
 
-				pos = m_buffer.find("\001", pos);
+				pos = find(m_buffer, m_length, "\001", pos);
 				if (pos == std::string::npos) 
 					return false;
 				pos += 1;
 
-				str.assign(m_buffer, 0, pos);
-				m_buffer.erase(0, pos);
+				str.assign(m_buffer, m_pos, pos - m_pos);
+				consume(pos - m_pos);
 				return true;
 			}
 		}
 		catch (MessageParseError& e)
 		{
 			if (length > 0)
-				m_buffer.erase(0, pos + length);
+				consume(std::min<std::string::size_type>(pos + length, m_length) - m_pos);
 			else
-				m_buffer.erase();
+				m_pos = m_length = 0;
 
 			throw e;
 		}
 
 		return false;
 	}
+
+	void Parser::consume(std::string::size_type count)
+	{
+		// only moves the cursor, the bytes left are moved once per read
+		m_pos += count;
+		if (m_pos == m_length)
+			m_pos = m_length = 0;
+	}
+
+	void Parser::compact()
+	{
+		if (!m_pos)
+			return;
+		std::copy(m_buffer.begin() + m_pos, m_buffer.begin() + m_length,
+			m_buffer.begin());
+		m_length -= m_pos;
+		m_pos = 0;
+	}
 }
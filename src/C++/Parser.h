@@ -29,6 +29,7 @@
 #include "Exceptions.h"
 #include <iostream>
 #include <string>
+#include <algorithm>
 
 namespace FIX
 {
@@ -36,7 +37,7 @@ namespace FIX
 class Parser
 {
 public:
-  Parser() {}
+  Parser() : m_pos( 0 ), m_length( 0 ) {}
   ~Parser() {}
 
   bool extractLength( int& length, std::string::size_type& pos,
@@ -46,12 +47,46 @@ public:
   throw ( MessageParseError );
 
   void addToStream( const char* str, size_t len )
-  { m_buffer.append( str, len ); }
+  {
+    std::copy( str, str + len, prepareStream( len ) );
+    commitStream( len );
+  }
   void addToStream( const std::string& str )
-  { m_buffer.append( str ); }
+  { addToStream( str.data(), str.size() ); }
+
+  /// Make room for len more bytes and return where to write them, so
+  /// data can be received in place instead of copied in.
+  char* prepareStream( size_t len )
+  {
+    compact();
+    // the buffer only grows, so it is not cleared again on every read
+    if( m_buffer.size() < m_length + len )
+      m_buffer.resize( std::max( m_length + len, 2 * m_buffer.size() ) );
+    return &m_buffer[ m_length ];
+  }
+  /// Keep len of the bytes handed out by prepareStream.
+  void commitStream( size_t len )
+  { m_length += len; }
+  /// Release memory the stream no longer needs.
+  void shrinkStream()
+  {
+    compact();
+    if( m_buffer.size() > 2 * m_length )
+      std::string( m_buffer, 0, m_length ).swap( m_buffer );
+  }
 
 private:
+  bool extractLength( int& length, std::string::size_type& pos,
+                      const std::string& buffer, std::string::size_type size )
+  throw ( MessageParseError );
+  void consume( std::string::size_type count );
+  void compact();
+
+  /// Received bytes not yet parsed are m_pos up to m_length of m_buffer,
+  /// the rest is space for the next read.
   std::string m_buffer;
+  std::string::size_type m_pos;
+  std::string::size_type m_length;
 };
 }
 #endif //FIX_PARSER_H
@@ -35,7 +35,10 @@
 #include <libpq-fe.h>
 #include "DatabaseConnectionID.h"
 #include "DatabaseConnectionPool.h"
+#include "FieldConvertors.h"
 #include "Mutex.h"
+#include <map>
+#include <vector>
 
 namespace FIX
 {
@@ -101,12 +104,119 @@ private:
   std::string m_query; 
 };
 
+/**
+ * PostgreSQL statement with text parameters, executed as a prepared
+ * statement on the connection.
+ */
+class PostgreSQLStatement
+{
+public:
+  PostgreSQLStatement( const std::string& query, int parameters )
+  : m_result( 0 ), m_status( PGRES_EMPTY_QUERY ), m_query( query ),
+    m_values( parameters ), m_nulls( parameters, false )
+  {}
+
+  ~PostgreSQLStatement()
+  {
+    if( m_result )
+      PQclear( m_result );
+  }
+
+  const std::string& query() const
+  {
+    return m_query;
+  }
+
+  int parameters() const
+  {
+    return (int)m_values.size();
+  }
+
+  /// Most parameters the protocol can bind to a single statement.
+  static const int MAX_PARAMETERS = 65535;
+
+  /// Rows to write next as one multi-row statement.  Full batches are
+  /// written whole and the rest in power of two chunks, so a bounded
+  /// number of statements covers every remainder.
+  static int batch( size_t remaining, int batchSize )
+  {
+    if( remaining >= (size_t)batchSize )
+      return batchSize;
+    int rows = 1;
+    while( (size_t)rows * 2 <= remaining )
+      rows *= 2;
+    return rows;
+  }
+
+  void set( int index, const std::string& value )
+  {
+    m_values[ index ] = value;
+    m_nulls[ index ] = false;
+  }
+
+  void set( int index, int value )
+  {
+    set( index, IntConvertor::convert( value ) );
+  }
+
+  void setNull( int index )
+  {
+    m_values[ index ].clear();
+    m_nulls[ index ] = true;
+  }
+
+  bool execute( PGconn* pConnection, const std::string& name )
+  {
+    std::vector<const char*> values( m_values.size() );
+    for( size_t i = 0; i < m_values.size(); ++i )
+      values[ i ] = m_nulls[ i ] ? 0 : m_values[ i ].c_str();
+
+    if( m_result ) PQclear( m_result );
+    m_result = PQexecPrepared( pConnection, name.c_str(), (int)values.size(),
+                               values.empty() ? 0 : &values[ 0 ], 0, 0, 0 );
+    m_status = PQresultStatus( m_result );
+    m_reason = success() ? "" : PQresultErrorMessage( m_result );
+    return success();
+  }
+
+  void fail( const std::string& reason )
+  {
+    m_status = PGRES_FATAL_ERROR;
+    m_reason = reason;
+  }
+
+  bool success()
+  {
+    return m_status == PGRES_TUPLES_OK
+      || m_status == PGRES_COMMAND_OK;
+  }
+
+  const std::string& reason()
+  {
+    return m_reason;
+  }
+
+  void throwException() throw( IOException )
+  {
+    if( !success() )
+      throw IOException( "Statement failed [" + m_query + "] " + m_reason );
+  }
+
+private:
+  PGresult* m_result;
+  ExecStatusType m_status;
+  std::string m_query;
+  std::string m_reason;
+  std::vector<std::string> m_values;
+  std::vector<bool> m_nulls;
+};
+
 class PostgreSQLConnection
 {
 public:
   PostgreSQLConnection
   ( const DatabaseConnectionID& id )
-  : m_connectionID( id )
+  : m_connectionID( id ), m_nextStatement( 0 )
   {
     connect();
   }
@@ -114,7 +224,7 @@ public:
   PostgreSQLConnection
   ( const std::string& database, const std::string& user,
     const std::string& password, const std::string& host, short port )
-  : m_connectionID( database, user, password, host, port )
+  : m_connectionID( database, user, password, host, port ), m_nextStatement( 0 )
   {
     connect();
   }
@@ -139,7 +249,7 @@ public:
   bool reconnect()
   {
     Locker locker( m_mutex );
-    PQreset( m_pConnection );
+    reset();
     return connected();
   }
 
@@ -149,7 +259,85 @@ public:
     return pQuery.execute( m_pConnection );
   }
 
+  bool execute( PostgreSQLStatement& statement )
+  {
+    Locker locker( m_mutex );
+    int retry = 0;
+
+    do
+    {
+      std::string name;
+      if( prepare( statement, name ) && statement.execute( m_pConnection, name ) )
+        return true;
+      if( PQstatus( m_pConnection ) == CONNECTION_OK )
+        return false;
+
+      reset();
+      retry++;
+    } while( retry <= 1 );
+    return false;
+  }
+
+  /// Load rows in COPY text format into a table.
+  bool copy( const std::string& command, const std::string& data,
+             std::string& reason )
+  {
+    Locker locker( m_mutex );
+    PGresult* result = PQexec( m_pConnection, command.c_str() );
+    bool ready = PQresultStatus( result ) == PGRES_COPY_IN;
+    PQclear( result );
+    if( !ready )
+    {
+      reason = PQerrorMessage( m_pConnection );
+      return false;
+    }
+
+    bool success = PQputCopyData( m_pConnection, data.data(), (int)data.size() ) == 1;
+    if( PQputCopyEnd( m_pConnection, success ? 0 : "copy failed" ) != 1 )
+      success = false;
+    while( (result = PQgetResult( m_pConnection )) )
+    {
+      if( PQresultStatus( result ) != PGRES_COMMAND_OK )
+        success = false;
+      PQclear( result );
+    }
+
+    if( !success )
+      reason = PQerrorMessage( m_pConnection );
+    return success;
+  }
+
 private:
+  /// Prepared statements only live as long as the server session, so
+  /// after a reset they are prepared again under the same names.
+  void reset()
+  {
+    PQreset( m_pConnection );
+    m_statements.clear();
+    m_nextStatement = 0;
+  }
+
+  bool prepare( PostgreSQLStatement& statement, std::string& name )
+  {
+    Statements::iterator i = m_statements.find( statement.query() );
+    if( i != m_statements.end() )
+    {
+      name = i->second;
+      return true;
+    }
+
+    name = "quickfix_" + IntConvertor::convert( m_nextStatement++ );
+    PGresult* result = PQprepare( m_pConnection, name.c_str(),
+      statement.query().c_str(), statement.parameters(), 0 );
+    bool success = PQresultStatus( result ) == PGRES_COMMAND_OK;
+    if( success )
+      m_statements[ statement.query() ] = name;
+    else
+      statement.fail( PQresultErrorMessage( result ) );
+    PQclear( result );
+    return success;
+  }
+
   void connect()
   {
     short port = m_connectionID.getPort();
@@ -161,8 +349,12 @@ private:
       throw ConfigError( "Unable to connect to database" );
   }
 
+  typedef std::map<std::string, std::string> Statements;
+
   PGconn* m_pConnection;
   DatabaseConnectionID m_connectionID;
+  Statements m_statements;
+  int m_nextStatement;
   Mutex m_mutex;
 };
 
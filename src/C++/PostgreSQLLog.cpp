@@ -40,10 +40,29 @@ const std::string PostgreSQLLogFactory::DEFAULT_USER = "postgres";
 const std::string PostgreSQLLogFactory::DEFAULT_PASSWORD = "";
 const std::string PostgreSQLLogFactory::DEFAULT_HOST = "localhost";
 const short PostgreSQLLogFactory::DEFAULT_PORT = 0;
+const long PostgreSQLLogFactory::DEFAULT_BATCH_INTERVAL = 100000;
+
+namespace
+{
+void copyValue( std::string& data, const std::string& value )
+{
+  for( std::string::const_iterator i = value.begin(); i != value.end(); ++i )
+  {
+    switch( *i )
+    {
+    case '\\': data += "\\\\"; break;
+    case '\t': data += "\\t"; break;
+    case '\n': data += "\\n"; break;
+    case '\r': data += "\\r"; break;
+    default: data += *i;
+    }
+  }
+}
+}
 
 PostgreSQLLog::PostgreSQLLog
 ( const SessionID& s, const DatabaseConnectionID& d, PostgreSQLConnectionPool* p )
-: m_pConnectionPool( p )
+: m_pConnectionPool( p ), m_batchSize( 1 )
 {
   init();
   m_pSessionID = new SessionID( s );
@@ -52,7 +71,7 @@ PostgreSQLLog::PostgreSQLLog
 
 PostgreSQLLog::PostgreSQLLog
 ( const DatabaseConnectionID& d, PostgreSQLConnectionPool* p )
-: m_pConnectionPool( p ), m_pSessionID( 0 )
+: m_pConnectionPool( p ), m_pSessionID( 0 ), m_batchSize( 1 )
 {
   init();
   m_pConnection = m_pConnectionPool->create( d );
@@ -61,7 +80,7 @@ PostgreSQLLog::PostgreSQLLog
 PostgreSQLLog::PostgreSQLLog
 ( const SessionID& s, const std::string& database, const std::string& user,
   const std::string& password, const std::string& host, short port )
-  : m_pConnectionPool( 0 )
+  : m_pConnectionPool( 0 ), m_batchSize( 1 )
 {
   init();
   m_pSessionID = new SessionID( s );
@@ -71,7 +90,7 @@ PostgreSQLLog::PostgreSQLLog
 PostgreSQLLog::PostgreSQLLog
 ( const std::string& database, const std::string& user,
   const std::string& password, const std::string& host, short port )
-  : m_pConnectionPool( 0 ), m_pSessionID( 0 )
+  : m_pConnectionPool( 0 ), m_pSessionID( 0 ), m_batchSize( 1 )
 {
   init();
   m_pConnection = new PostgreSQLConnection( database, user, password, host, port );
@@ -86,6 +105,9 @@ void PostgreSQLLog::init()
 
 PostgreSQLLog::~PostgreSQLLog()
 {
+  StoreSyncer::instance().remove( this );
+  flush();
+
   if( m_pConnectionPool )
     m_pConnectionPool->destroy( m_pConnection );
   else
@@ -177,6 +199,14 @@ void PostgreSQLLogFactory::initLog( const Dictionary& settings, PostgreSQLLog& l
 
   try { log.setEventTable( settings.getString( POSTGRESQL_LOG_EVENT_TABLE ) ); }
   catch( ConfigError& ) {}
+
+  if( settings.has( POSTGRESQL_LOG_BATCH_SIZE ) )
+  {
+    long interval = DEFAULT_BATCH_INTERVAL;
+    if( settings.has( POSTGRESQL_LOG_BATCH_INTERVAL ) )
+      interval = settings.getInt( POSTGRESQL_LOG_BATCH_INTERVAL );
+    log.setBatch( settings.getInt( POSTGRESQL_LOG_BATCH_SIZE ), interval );
+  }
 }
 
 void PostgreSQLLogFactory::destroy( Log* pLog )
@@ -216,6 +246,11 @@ void PostgreSQLLog::clear()
   eventQuery 
     << "DELETE FROM " << m_eventTable << " " << whereClause.str();
 
+  {
+    Locker l( m_mutex );
+    m_pending.clear();
+  }
+
   PostgreSQLQuery incoming( incomingQuery.str() );
   PostgreSQLQuery outgoing( outgoingQuery.str() );
   PostgreSQLQuery event( eventQuery.str() );
@@ -228,6 +263,24 @@ void PostgreSQLLog::backup()
 {
 }
 
+void PostgreSQLLog::setBatch( int size, long interval )
+{
+  if( size <= 0 )
+    throw ConfigError( std::string( POSTGRESQL_LOG_BATCH_SIZE ) + " must be positive" );
+  if( interval <= 0 )
+    throw ConfigError( std::string( POSTGRESQL_LOG_BATCH_INTERVAL ) + " must be positive" );
+
+  StoreSyncer::instance().remove( this );
+  flush();
+  m_batchSize = size;
+  if( m_batchSize > 1 )
+  {
+    SessionID sessionID = m_pSessionID ? *m_pSessionID : SessionID( "", "", "" );
+    StoreSyncer::instance().add
+      ( this, sessionID, SyncPolicy( SyncPolicy::COUNT, size, interval ) );
+  }
+}
+
 void PostgreSQLLog::insert( const std::string& table, const std::string value )
 {
   UtcTimeStamp time;
@@ -238,37 +291,134 @@ void PostgreSQLLog::insert( const std::string& table, const std::string value )
   char sqlTime[ 24 ];
   STRING_SPRINTF( sqlTime, "%d-%02d-%02d %02d:%02d:%02d.%003d",
            year, month, day, hour, minute, second, millis );
-  
-  char* valueCopy = new char[ (value.size() * 2) + 1 ];
-  PQescapeString( valueCopy, value.c_str(), value.size() );
 
-  std::stringstream queryString;
-  queryString << "INSERT INTO " << table << " "
-  << "(time, beginstring, sendercompid, targetcompid, session_qualifier, text) "
-  << "VALUES ("
-  << "'" << sqlTime << "',";
+  if( m_batchSize > 1 )
+  {
+    Line line;
+    line.table = table;
+    line.time = sqlTime;
+    line.text = value;
+    {
+      Locker l( m_mutex );
+      m_pending.push_back( line );
+    }
+    StoreSyncer::instance().written( this );
+    return;
+  }
+
+  Locker l( m_dbMutex );
+  write( table, sqlTime, value );
+}
+
+void PostgreSQLLog::write( const std::string& table, const std::string& time,
+                           const std::string& value )
+{
+  PostgreSQLStatement& insert = statement( table );
+  insert.set( 0, time );
+  if( m_pSessionID )
+  {
+    insert.set( 1, m_pSessionID->getBeginString().getValue() );
+    insert.set( 2, m_pSessionID->getSenderCompID().getValue() );
+    insert.set( 3, m_pSessionID->getTargetCompID().getValue() );
+    if( m_pSessionID->getSessionQualifier() == "" )
+      insert.setNull( 4 );
+    else
+      insert.set( 4, m_pSessionID->getSessionQualifier() );
+  }
+  else
+  {
+    for( int column = 1; column < 5; ++column )
+      insert.setNull( column );
+  }
+  insert.set( 5, value );
+  m_pConnection->execute( insert );
+}
+
+void PostgreSQLLog::flush()
+{
+  Locker dbLock( m_dbMutex );
+  Lines lines;
+  {
+    Locker l( m_mutex );
+    lines.swap( m_pending );
+  }
 
+  // each table is loaded with one COPY, keeping the logged order
+  while( lines.size() )
+  {
+    std::string table = lines.front().table;
+    Lines batch;
+    Lines rest;
+    Lines::const_iterator i;
+    for( i = lines.begin(); i != lines.end(); ++i )
+      ( i->table == table ? batch : rest ).push_back( *i );
+    copy( table, batch );
+    lines.swap( rest );
+  }
+}
+
+bool PostgreSQLLog::sync()
+{
+  flush();
+  return true;
+}
+
+PostgreSQLStatement& PostgreSQLLog::statement( const std::string& table )
+{
+  Statements::iterator i = m_statements.find( table );
+  if( i == m_statements.end() )
+  {
+    std::shared_ptr < PostgreSQLStatement > pStatement( new PostgreSQLStatement
+      ( "INSERT INTO " + table + " "
+        "(time, beginstring, sendercompid, targetcompid, session_qualifier, text) "
+        "VALUES ($1,$2,$3,$4,$5,$6)", 6 ) );
+    i = m_statements.insert( std::make_pair( table, pStatement ) ).first;
+  }
+  return *i->second;
+}
+
+void PostgreSQLLog::copy( const std::string& table, const Lines& lines )
+{
+  std::string session;
   if( m_pSessionID )
   {
-    queryString
-    << "'" << m_pSessionID->getBeginString().getValue() << "',"
-    << "'" << m_pSessionID->getSenderCompID().getValue() << "',"
-    << "'" << m_pSessionID->getTargetCompID().getValue() << "',";
+    copyValue( session, m_pSessionID->getBeginString().getValue() );
+    session += '\t';
+    copyValue( session, m_pSessionID->getSenderCompID().getValue() );
+    session += '\t';
+    copyValue( session, m_pSessionID->getTargetCompID().getValue() );
+    session += '\t';
     if( m_pSessionID->getSessionQualifier() == "" )
-      queryString << "NULL" << ",";
+      session += "\\N";
     else
-      queryString << "'" << m_pSessionID->getSessionQualifier() << "',";
+      copyValue( session, m_pSessionID->getSessionQualifier() );
   }
   else
   {
-    queryString << "NULL, NULL, NULL, NULL, ";
+    session = "\\N\t\\N\t\\N\t\\N";
+  }
+
+  std::string data;
+  Lines::const_iterator i;
+  for( i = lines.begin(); i != lines.end(); ++i )
+  {
+    data += i->time;
+    data += '\t';
+    data += session;
+    data += '\t';
+    copyValue( data, i->text );
+    data += '\n';
   }
 
-  queryString << "'" << valueCopy << "')";
-  delete [] valueCopy;
+  std::string reason;
+  if( m_pConnection->copy( "COPY " + table + " "
+        "(time, beginstring, sendercompid, targetcompid, session_qualifier, text) "
+        "FROM STDIN", data, reason ) )
+    return;
 
-  PostgreSQLQuery query( queryString.str() );
-  m_pConnection->execute( query );
+  // a rejected COPY loads nothing, so keep whatever rows are accepted
+  for( i = lines.begin(); i != lines.end(); ++i )
+    write( table, i->time, i->text );
 }
 
 } // namespace FIX
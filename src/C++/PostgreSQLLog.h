@@ -34,13 +34,22 @@
 #include "Log.h"
 #include "SessionSettings.h"
 #include "PostgreSQLConnection.h"
+#include "StoreSyncer.h"
 #include <fstream>
+#include <map>
+#include <memory>
 #include <string>
+#include <vector>
 
 namespace FIX
 {
-/// PostgreSQL based implementation of Log.
-class PostgreSQLLog : public Log
+/**
+ * PostgreSQL based implementation of Log.
+ *
+ * Lines are written with prepared statements.  When batching is enabled
+ * they are queued and loaded by the StoreSyncer thread with COPY.
+ */
+class PostgreSQLLog : public Log, public Syncable
 {
 public:
   PostgreSQLLog( const SessionID& s, const DatabaseConnectionID& d, PostgreSQLConnectionPool* p );
@@ -68,9 +77,29 @@ public:
   void onEvent( const std::string& value )
   { insert( m_eventTable, value ); }
 
+  /// Write lines in batches of up to size, at most interval
+  /// microseconds after the first queued line.
+  void setBatch( int size, long interval );
+  /// Write queued lines to the database.
+  void flush();
+  bool sync();
+
 private:
   void init();
+  struct Line
+  {
+    std::string table;
+    std::string time;
+    std::string text;
+  };
+  typedef std::vector < Line > Lines;
+  typedef std::map < std::string, std::shared_ptr < PostgreSQLStatement > > Statements;
+
   void insert( const std::string& table, const std::string value );
+  PostgreSQLStatement& statement( const std::string& table );
+  void write( const std::string& table, const std::string& time,
+              const std::string& value );
+  void copy( const std::string& table, const Lines& lines );
 
   std::string m_incomingTable;
   std::string m_outgoingTable;
@@ -78,6 +107,11 @@ private:
   PostgreSQLConnection* m_pConnection;
   PostgreSQLConnectionPool* m_pConnectionPool;
   SessionID* m_pSessionID;
+  int m_batchSize;
+  Statements m_statements;
+  Lines m_pending;
+  Mutex m_mutex;
+  Mutex m_dbMutex;
 };
 
 /// Creates a MySQL based implementation of Log.
@@ -89,6 +123,7 @@ public:
   static const std::string DEFAULT_PASSWORD;
   static const std::string DEFAULT_HOST;
   static const short DEFAULT_PORT;
+  static const long DEFAULT_BATCH_INTERVAL;
 
   PostgreSQLLogFactory( const SessionSettings& settings )
 : m_settings( settings ), m_useSettings( true ) 
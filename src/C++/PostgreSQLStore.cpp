@@ -43,31 +43,105 @@ const std::string PostgreSQLStoreFactory::DEFAULT_PASSWORD = "";
 const std::string PostgreSQLStoreFactory::DEFAULT_HOST = "localhost";
 const short PostgreSQLStoreFactory::DEFAULT_PORT = 0;
 
+namespace
+{
+const int MESSAGE_COLUMNS = 6;
+const char SESSION_WHERE[] =
+  " WHERE beginstring=$2 and sendercompid=$3 and targetcompid=$4 and session_qualifier=$5";
+
+std::string insertMessages( int rows )
+{
+  std::string query = "INSERT INTO messages "
+    "(beginstring, sendercompid, targetcompid, session_qualifier, msgseqnum, message) "
+    "VALUES ";
+  for( int row = 0; row < rows; ++row )
+  {
+    query += row ? ",(" : "(";
+    for( int column = 1; column <= MESSAGE_COLUMNS; ++column )
+    {
+      if( column > 1 ) query += ",";
+      query += "$" + IntConvertor::convert( row * MESSAGE_COLUMNS + column );
+    }
+    query += ")";
+  }
+  return query;
+}
+}
+
 PostgreSQLStore::PostgreSQLStore
-( const SessionID& s, const DatabaseConnectionID& d, PostgreSQLConnectionPool* p )
-: m_pConnectionPool( p ), m_sessionID( s )
+( const SessionID& s, const DatabaseConnectionID& d, PostgreSQLConnectionPool* p,
+  const SyncPolicy& policy )
+: m_pConnectionPool( p ), m_sessionID( s ), m_policy( policy ),
+  m_update( std::string( "UPDATE messages SET message=$6" ) + SESSION_WHERE + " and msgseqnum=$1", 6 ),
+  m_updateSender( std::string( "UPDATE sessions SET outgoing_seqnum=$1" ) + SESSION_WHERE, 5 ),
+  m_updateTarget( std::string( "UPDATE sessions SET incoming_seqnum=$1" ) + SESSION_WHERE, 5 )
 {
   m_pConnection = m_pConnectionPool->create( d );
   populateCache();
+  init();
 }
 
 PostgreSQLStore::PostgreSQLStore
 ( const SessionID& s, const std::string& database, const std::string& user,
-  const std::string& password, const std::string& host, short port )
-  : m_pConnectionPool( 0 ), m_sessionID( s )
+  const std::string& password, const std::string& host, short port,
+  const SyncPolicy& policy )
+  : m_pConnectionPool( 0 ), m_sessionID( s ), m_policy( policy ),
+  m_update( std::string( "UPDATE messages SET message=$6" ) + SESSION_WHERE + " and msgseqnum=$1", 6 ),
+  m_updateSender( std::string( "UPDATE sessions SET outgoing_seqnum=$1" ) + SESSION_WHERE, 5 ),
+  m_updateTarget( std::string( "UPDATE sessions SET incoming_seqnum=$1" ) + SESSION_WHERE, 5 )
 {
   m_pConnection = new PostgreSQLConnection( database, user, password, host, port );
   populateCache();
+  init();
 }
 
 PostgreSQLStore::~PostgreSQLStore()
 {
+  StoreSyncer::instance().remove( this );
+  try { flush(); }
+  catch( IOException& ) {}
+
   if( m_pConnectionPool )
     m_pConnectionPool->destroy( m_pConnection );
   else
     delete m_pConnection;
 }
 
+void PostgreSQLStore::init()
+{
+  if( m_policy.sync() )
+    StoreSyncer::instance().add( this, m_sessionID, m_policy );
+}
+
+PostgreSQLStatement& PostgreSQLStore::insertStatement( int rows ) const
+{
+  Statements::iterator i = m_inserts.find( rows );
+  if( i == m_inserts.end() )
+  {
+    std::shared_ptr < PostgreSQLStatement > pStatement
+      ( new PostgreSQLStatement( insertMessages( rows ), rows * MESSAGE_COLUMNS ) );
+    i = m_inserts.insert( std::make_pair( rows, pStatement ) ).first;
+  }
+  return *i->second;
+}
+
+void PostgreSQLStore::bindSessionID( PostgreSQLStatement& statement, int first ) const
+{
+  statement.set( first, m_sessionID.getBeginString().getValue() );
+  statement.set( first + 1, m_sessionID.getSenderCompID().getValue() );
+  statement.set( first + 2, m_sessionID.getTargetCompID().getValue() );
+  statement.set( first + 3, m_sessionID.getSessionQualifier() );
+}
+
+void PostgreSQLStore::bindMessage( PostgreSQLStatement& statement, int row,
+                                   int msgSeqNum, const std::string& msg ) const
+{
+  int first = row * MESSAGE_COLUMNS;
+  bindSessionID( statement, first );
+  statement.set( first + 4, msgSeqNum );
+  statement.set( first + 5, msg );
+}
+
 void PostgreSQLStore::populateCache()
 {
   std::stringstream queryString;
@@ -158,7 +232,7 @@ MessageStore* PostgreSQLStoreFactory::create( const SessionID& s, const Dictiona
   catch( ConfigError& ) {}
 
   DatabaseConnectionID id( database, user, password, host, port );
-  return new PostgreSQLStore( s, id, m_connectionPoolPtr.get() );
+  return new PostgreSQLStore( s, id, m_connectionPoolPtr.get(), SyncPolicy( settings ) );
 }
 
 void PostgreSQLStoreFactory::destroy( MessageStore* pStore )
@@ -169,44 +243,47 @@ void PostgreSQLStoreFactory::destroy( MessageStore* pStore )
 bool PostgreSQLStore::set( int msgSeqNum, const std::string& msg )
 throw ( IOException )
 {
-  char* msgCopy = new char[ (msg.size() * 2) + 1 ];
-  PQescapeString( msgCopy, msg.c_str(), msg.size() );
-
-  std::stringstream queryString;
-  queryString << "INSERT INTO messages "
-  << "(beginstring, sendercompid, targetcompid, session_qualifier, msgseqnum, message) "
-  << "VALUES ("
-  << "'" << m_sessionID.getBeginString().getValue() << "',"
-  << "'" << m_sessionID.getSenderCompID().getValue() << "',"
-  << "'" << m_sessionID.getTargetCompID().getValue() << "',"
-  << "'" << m_sessionID.getSessionQualifier() << "',"
-  << msgSeqNum << ","
-  << "'" << msgCopy << "')";
-
-  delete [] msgCopy;
-
-  PostgreSQLQuery query( queryString.str() );
-  if( !m_pConnection->execute(query) )
+  if( m_policy.sync() )
   {
-    std::stringstream queryString2;
-    queryString2 << "UPDATE messages SET message='" << msg << "' WHERE "
-    << "beginstring=" << "'" << m_sessionID.getBeginString().getValue() << "' and "
-    << "sendercompid=" << "'" << m_sessionID.getSenderCompID().getValue() << "' and "
-    << "targetcompid=" << "'" << m_sessionID.getTargetCompID().getValue() << "' and "
-    << "session_qualifier=" << "'" << m_sessionID.getSessionQualifier() << "' and "
-    << "msgseqnum=" << msgSeqNum;
-    PostgreSQLQuery query2( queryString2.str() );
-    if( !m_pConnection->execute(query2) )
-      query2.throwException();
+    {
+      Locker l( m_mutex );
+      if( m_error.size() )
+      {
+        std::string error;
+        error.swap( m_error );
+        throw IOException( error );
+      }
+      m_pending.push_back( std::make_pair( msgSeqNum, msg ) );
+    }
+    StoreSyncer::instance().written( this );
+    return true;
   }
 
+  Locker l( m_dbMutex );
+  write( msgSeqNum, msg );
   return true;
 }
 
+void PostgreSQLStore::write( int msgSeqNum, const std::string& msg ) const
+throw ( IOException )
+{
+  PostgreSQLStatement& insert = insertStatement( 1 );
+  bindMessage( insert, 0, msgSeqNum, msg );
+  if( m_pConnection->execute(insert) )
+    return;
+
+  m_update.set( 0, msgSeqNum );
+  bindSessionID( m_update, 1 );
+  m_update.set( 5, msg );
+  if( !m_pConnection->execute(m_update) )
+    m_update.throwException();
+}
+
 void PostgreSQLStore::get( int begin, int end,
                       std::vector < std::string > & result ) const
 throw ( IOException )
 {
+  flush();
   result.clear();
   std::stringstream queryString;
   queryString << "SELECT message FROM messages WHERE "
@@ -238,33 +315,21 @@ int PostgreSQLStore::getNextTargetMsgSeqNum() const throw ( IOException )
 
 void PostgreSQLStore::setNextSenderMsgSeqNum( int value ) throw ( IOException )
 {
-  std::stringstream queryString;
-  queryString << "UPDATE sessions SET outgoing_seqnum=" << value << " WHERE "
-  << "beginstring=" << "'" << m_sessionID.getBeginString().getValue() << "' and "
-  << "sendercompid=" << "'" << m_sessionID.getSenderCompID().getValue() << "' and "
-  << "targetcompid=" << "'" << m_sessionID.getTargetCompID().getValue() << "' and "
-  << "session_qualifier=" << "'" << m_sessionID.getSessionQualifier() << "'";
-
-  PostgreSQLQuery query( queryString.str() );
-  if( !m_pConnection->execute(query) )
-    query.throwException();
-
+  Locker l( m_dbMutex );
+  m_updateSender.set( 0, value );
+  bindSessionID( m_updateSender, 1 );
+  if( !m_pConnection->execute(m_updateSender) )
+    m_updateSender.throwException();
   m_cache.setNextSenderMsgSeqNum( value );
 }
 
 void PostgreSQLStore::setNextTargetMsgSeqNum( int value ) throw ( IOException )
 {
-  std::stringstream queryString;
-  queryString << "UPDATE sessions SET incoming_seqnum=" << value << " WHERE "
-  << "beginstring=" << "'" << m_sessionID.getBeginString().getValue() << "' and "
-  << "sendercompid=" << "'" << m_sessionID.getSenderCompID().getValue() << "' and "
-  << "targetcompid=" << "'" << m_sessionID.getTargetCompID().getValue() << "' and "
-  << "session_qualifier=" << "'" << m_sessionID.getSessionQualifier() << "'";
-
-  PostgreSQLQuery query( queryString.str() );
-  if( !m_pConnection->execute(query) )
-    query.throwException();
-
+  Locker l( m_dbMutex );
+  m_updateTarget.set( 0, value );
+  bindSessionID( m_updateTarget, 1 );
+  if( !m_pConnection->execute(m_updateTarget) )
+    m_updateTarget.throwException();
   m_cache.setNextTargetMsgSeqNum( value );
 }
 
@@ -287,6 +352,14 @@ UtcTimeStamp PostgreSQLStore::getCreationTime() const throw ( IOException )
 
 void PostgreSQLStore::reset() throw ( IOException )
 {
+  // queued messages belong to the session being reset
+  Locker dbLock( m_dbMutex );
+  {
+    Locker l( m_mutex );
+    m_pending.clear();
+    m_error.clear();
+  }
+
   std::stringstream queryString;
   queryString << "DELETE FROM messages WHERE "
   << "beginstring=" << "'" << m_sessionID.getBeginString().getValue() << "' and "
@@ -325,10 +398,67 @@ void PostgreSQLStore::reset() throw ( IOException )
 
 void PostgreSQLStore::refresh() throw ( IOException )
 {
+  flush();
   m_cache.reset();
   populateCache(); 
 }
 
+void PostgreSQLStore::flush() const throw ( IOException )
+{
+  if( !m_policy.sync() ) return;
+
+  Locker dbLock( m_dbMutex );
+  Messages messages;
+  {
+    Locker l( m_mutex );
+    messages.swap( m_pending );
+  }
+
+  size_t i = 0;
+  try
+  {
+    while( i < messages.size() )
+    {
+      int rows = PostgreSQLStatement::batch( messages.size() - i,
+        std::min( m_policy.getCount(), PostgreSQLStatement::MAX_PARAMETERS / MESSAGE_COLUMNS ) );
+      PostgreSQLStatement& insert = insertStatement( rows );
+      for( int row = 0; row < rows; ++row )
+        bindMessage( insert, row, messages[ i + row ].first, messages[ i + row ].second );
+
+      // a batch holding a sequence number already stored is written a
+      // row at a time so the duplicates are updated
+      if( !m_pConnection->execute(insert) )
+      {
+        for( int row = 0; row < rows; ++row )
+          write( messages[ i + row ].first, messages[ i + row ].second );
+      }
+      i += rows;
+    }
+  }
+  catch( IOException& )
+  {
+    // keep what was not written so the next flush retries it
+    Locker l( m_mutex );
+    m_pending.insert( m_pending.begin(), messages.begin() + i, messages.end() );
+    throw;
+  }
+}
+
+bool PostgreSQLStore::sync()
+{
+  try
+  {
+    flush();
+    return true;
+  }
+  catch( IOException& e )
+  {
+    Locker l( m_mutex );
+    m_error = e.what();
+    return false;
+  }
+}
+
 }
 
 #endif
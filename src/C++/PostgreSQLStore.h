@@ -34,7 +34,10 @@
 #include "MessageStore.h"
 #include "SessionSettings.h"
 #include "PostgreSQLConnection.h"
+#include "StoreSyncer.h"
 #include <fstream>
+#include <map>
+#include <memory>
 #include <string>
 
 namespace FIX
@@ -103,13 +106,23 @@ private:
 };
 /*! @} */
 
-/// PostgreSQL based implementation of MessageStore.
-class PostgreSQLStore : public MessageStore
+/**
+ * PostgreSQL based implementation of MessageStore.
+ *
+ * Writes use prepared statements.  With a COUNT or INTERVAL SyncPolicy
+ * messages are queued and written by the StoreSyncer thread with
+ * multi-row inserts, while sequence numbers are still written
+ * immediately.  Messages queued when the process dies are lost and
+ * answered with a gap fill on resend.
+ */
+class PostgreSQLStore : public MessageStore, public Syncable
 {
 public:
-  PostgreSQLStore( const SessionID& s, const DatabaseConnectionID& d, PostgreSQLConnectionPool* p );
+  PostgreSQLStore( const SessionID& s, const DatabaseConnectionID& d, PostgreSQLConnectionPool* p,
+                   const SyncPolicy& policy = SyncPolicy() );
   PostgreSQLStore( const SessionID& s, const std::string& database, const std::string& user,
-                   const std::string& password, const std::string& host, short port );
+                   const std::string& password, const std::string& host, short port,
+                   const SyncPolicy& policy = SyncPolicy() );
   ~PostgreSQLStore();
 
   bool set( int, const std::string& ) throw ( IOException );
@@ -127,13 +140,34 @@ public:
   void reset() throw ( IOException );
   void refresh() throw ( IOException );
 
+  /// Write queued messages to the database.
+  void flush() const throw ( IOException );
+  bool sync();
+
 private:
+  typedef std::vector < std::pair < int, std::string > > Messages;
+  typedef std::map < int, std::shared_ptr < PostgreSQLStatement > > Statements;
+
+  void init();
   void populateCache();
+  void write( int, const std::string& ) const throw ( IOException );
+  void bindSessionID( PostgreSQLStatement&, int ) const;
+  void bindMessage( PostgreSQLStatement&, int, int, const std::string& ) const;
+  PostgreSQLStatement& insertStatement( int ) const;
 
   MemoryStore m_cache;
   PostgreSQLConnection* m_pConnection;
   PostgreSQLConnectionPool* m_pConnectionPool;
   SessionID m_sessionID;
+  SyncPolicy m_policy;
+  mutable Statements m_inserts;
+  mutable PostgreSQLStatement m_update;
+  PostgreSQLStatement m_updateSender;
+  PostgreSQLStatement m_updateTarget;
+  mutable Messages m_pending;
+  mutable std::string m_error;
+  mutable Mutex m_mutex;
+  mutable Mutex m_dbMutex;
 };
 }
 
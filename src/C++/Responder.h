@@ -27,6 +27,7 @@
 #endif
 
 #include <string>
+#include <cstddef>
 
 namespace FIX
 {
@@ -37,6 +38,11 @@ namespace FIX
     virtual ~Responder() {}
     virtual bool send( const std::string& ) = 0;
     virtual void disconnect() = 0;
+    /// Number of bytes accepted by send but not yet written to the transport.
+    virtual size_t getQueueDepth() { return 0; }
+    /// Asks the transport to call Session::next() from its own thread.
+    /// Transports that poll their sessions can ignore it.
+    virtual void wakeup() {}
   };
 }
 
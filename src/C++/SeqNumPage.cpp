@@ -0,0 +1,122 @@
+/****************************************************************************
+** Copyright (c) 2001-2014
+**
+** This file is part of the QuickFIX FIX Engine
+**
+** This file may be distributed under the terms of the quickfixengine.org
+** license as defined by quickfixengine.org and appearing in the file
+** LICENSE included in the packaging of this file.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** See http://www.quickfixengine.org/LICENSE for licensing information.
+**
+** Contact ask@quickfixengine.org if any conditions of this licensing are
+** not clear to you.
+**
+****************************************************************************/
+
+#ifdef _MSC_VER
+#include "stdafx.h"
+#else
+#include "config.h"
+#endif
+
+#include "SeqNumPage.h"
+#include "Utility.h"
+
+namespace FIX
+{
+namespace
+{
+const char PAGE_MAGIC[ 8 ] = { 'Q', 'F', 'S', 'E', 'Q', 'N', '0', '1' };
+}
+
+void SeqNumPage::open( const std::string& fileName, int sender, int target )
+throw ( IOException )
+{
+  close();
+
+  size_t size = sizeof( Page );
+  m_pPage = (Page*)file_mmap( fileName.c_str(), size );
+  if ( !m_pPage )
+    throw IOException( "Could not map seqnums file: " + fileName );
+  m_size = size;
+
+  m_current = -1;
+  if ( memcmp( m_pPage->magic, PAGE_MAGIC, sizeof( PAGE_MAGIC ) ) == 0 )
+  {
+    for ( int i = 0; i < 2; ++i )
+    {
+      const Slot& slot = m_pPage->slots[ i ];
+      if ( slot.checksum != checksum( slot ) ) continue;
+      if ( m_current < 0 || slot.generation > m_pPage->slots[ m_current ].generation )
+        m_current = i;
+    }
+  }
+
+  m_loaded = m_current >= 0;
+  if ( m_loaded )
+  {
+    m_sender = m_pPage->slots[ m_current ].sender;
+    m_target = m_pPage->slots[ m_current ].target;
+  }
+  else
+  {
+    memset( m_pPage, 0, sizeof( Page ) );
+    memcpy( m_pPage->magic, PAGE_MAGIC, sizeof( PAGE_MAGIC ) );
+    m_current = 1;
+    set( sender, target );
+  }
+}
+
+void SeqNumPage::close()
+{
+  if ( m_pPage ) file_munmap( m_pPage, m_size );
+  m_pPage = 0;
+  m_size = 0;
+  m_sender = 1;
+  m_target = 1;
+  m_loaded = false;
+}
+
+void SeqNumPage::set( int sender, int target )
+{
+  m_sender = sender;
+  m_target = target;
+
+  const Slot& current = m_pPage->slots[ m_current ];
+  int next = 1 - m_current;
+  Slot& slot = m_pPage->slots[ next ];
+
+  // invalidate first so the slot never holds new numbers under an old
+  // checksum, then publish the checksum once the numbers are in place
+  slot.checksum = 0;
+  slot.generation = current.generation + 1;
+  slot.sender = sender;
+  slot.target = target;
+  slot.checksum = checksum( slot );
+  m_current = next;
+}
+
+bool SeqNumPage::sync()
+{
+  return m_pPage && file_msync( m_pPage, sizeof( Page ) );
+}
+
+unsigned int SeqNumPage::checksum( const Slot& slot )
+{
+  // FNV-1a over the slot contents, never zero so a cleared slot is invalid
+  const unsigned char* data = (const unsigned char*)&slot;
+  size_t length = (const char*)&slot.checksum - (const char*)&slot;
+  unsigned int hash = 2166136261U;
+  for ( size_t i = 0; i < length; ++i )
+  {
+    hash ^= data[ i ];
+    hash *= 16777619U;
+  }
+  return hash ? hash : 1;
+}
+
+} //namespace FIX
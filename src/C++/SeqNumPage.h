@@ -0,0 +1,91 @@
+/* -*- C++ -*- */
+
+/****************************************************************************
+** Copyright (c) 2001-2014
+**
+** This file is part of the QuickFIX FIX Engine
+**
+** This file may be distributed under the terms of the quickfixengine.org
+** license as defined by quickfixengine.org and appearing in the file
+** LICENSE included in the packaging of this file.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** See http://www.quickfixengine.org/LICENSE for licensing information.
+**
+** Contact ask@quickfixengine.org if any conditions of this licensing are
+** not clear to you.
+**
+****************************************************************************/
+
+#ifndef FIX_SEQNUMPAGE_H
+#define FIX_SEQNUMPAGE_H
+
+#ifdef _MSC_VER
+#pragma warning( disable : 4503 4355 4786 4290 )
+#endif
+
+#include "Exceptions.h"
+#include <string>
+
+namespace FIX
+{
+/**
+ * Sender and target sequence numbers kept in a small memory mapped file.
+ *
+ * Updates are plain stores into one of two checksummed slots, alternating
+ * between them, so a write torn by a crash leaves the previous value
+ * readable in the other slot.
+ */
+class SeqNumPage
+{
+public:
+  SeqNumPage()
+  : m_pPage( 0 ), m_size( 0 ), m_current( 0 ),
+    m_sender( 1 ), m_target( 1 ), m_loaded( false ) {}
+  ~SeqNumPage() { close(); }
+
+  /// Map the file, seeding a page that holds no valid slot with these numbers.
+  void open( const std::string& fileName, int sender = 1, int target = 1 )
+  throw ( IOException );
+  void close();
+
+  /// True if open found sequence numbers written by an earlier session.
+  bool loaded() const { return m_loaded; }
+
+  int getSender() const { return m_sender; }
+  int getTarget() const { return m_target; }
+  void set( int sender, int target );
+
+  bool sync();
+
+private:
+  struct Slot
+  {
+    long long generation;
+    int sender;
+    int target;
+    unsigned int checksum;
+    char padding[ 12 ];
+  };
+
+  struct Page
+  {
+    char magic[ 8 ];
+    char padding[ 24 ];
+    Slot slots[ 2 ];
+  };
+
+  static unsigned int checksum( const Slot& );
+
+  Page* m_pPage;
+  size_t m_size;
+  int m_current;
+  int m_sender;
+  int m_target;
+  bool m_loaded;
+};
+}
+
+#endif //FIX_SEQNUMPAGE_H
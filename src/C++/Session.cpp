@@ -24,17 +24,15 @@
 #endif
 
 #include "Session.h"
+#include "InboundPipeline.h"
 #include "Values.h"
 #include "DataDictionaryPool.h"
 #include <algorithm>
+#include <cmath>
 #include <iostream>
 
 namespace FIX
 {
-	static Session::Sessions s_sessions;
-	static Session::SessionIDs s_sessionIDs;
-	static Mutex s_mutex;
-
 #define LOGEX( method ) try { method; } catch( std::exception& e ) \
   { m_state.onEvent( e.what() ); }
 
@@ -46,6 +44,10 @@ namespace FIX
 		m_sessionID(sessionID),
 		m_sessionTime(sessionTime),
 		m_logonTime(sessionTime),
+		m_windowStart(0, 0, 0, 1, 1, 1970),
+		m_windowEnd(m_windowStart),
+		m_windowCreationTime(m_windowStart),
+		m_inSessionWindow(false),
 		m_senderDefaultApplVerID(ApplVerID_FIX50),
 		m_targetDefaultApplVerID(ApplVerID_FIX50),
 		m_sendRedundantResendRequests(false),
@@ -59,9 +61,24 @@ namespace FIX
 		m_millisecondsInTimeStamp(true),
 		m_persistMessages(true),
 		m_validateLengthAndChecksum(true),
+		m_sendQueueHighWatermark(0),
+		m_aboveHighWatermark(false),
+		m_resendPageSize(0),
+		m_deferredQueueSize(DEFAULT_DEFERRED_QUEUE_SIZE),
+		m_deferredBytes(0),
+		m_deferredFull(false),
+		m_rawResend(false),
+		m_gapQueueOverflow(GapQueue::DISCONNECT),
+		m_resendRequestChunkSize(0),
+		m_pIncoming(0),
+		m_pReceived(0),
+		m_handle(-1),
+		m_owned(false),
+		m_ticker(*this),
 		m_messageStoreFactory(messageStoreFactory),
 		m_pLogFactory(pLogFactory),
 		m_pResponder(nullptr),
+		m_pInboundLane(0),
 		m_sessionDataDictionary(sessionDataDictionary),
 		m_appDataDictionary(appDataDictionary)
 	{
@@ -76,6 +93,7 @@ namespace FIX
 
 	Session::~Session()
 	{
+		SessionTimer::instance().cancel(&m_ticker);
 		removeSession(*this);
 		m_messageStoreFactory.destroy(m_state.store());
 		if (m_pLogFactory && m_state.log())
@@ -119,6 +137,61 @@ namespace FIX
 	void Session::next()
 	{
 		next(UtcTimeStamp());
+
+		// Rather than being polled, the transport is woken up again
+		// when the next deadline is due
+		if (m_pResponder)
+			SessionTimer::instance().schedule(&m_ticker, getTimeout(UtcTimeStamp()) * 1000);
+	}
+
+	void Session::onTimer()
+	{
+		Locker l(m_responderMutex);
+		if (m_pResponder)
+			m_pResponder->wakeup();
+	}
+
+	bool Session::updateSessionWindow(const UtcTimeStamp& timeStamp)
+	{
+		m_windowCreationTime = m_state.getCreationTime();
+		m_inSessionWindow = m_sessionTime.isInSameRange(timeStamp, m_windowCreationTime);
+		m_windowStart = timeStamp;
+		m_windowEnd = m_sessionTime.getNextBoundary(timeStamp);
+		return m_inSessionWindow;
+	}
+
+	static void earliest(int& timeout, int seconds)
+	{
+		if (seconds > 0 && seconds < timeout)
+			timeout = seconds;
+	}
+
+	int Session::getTimeout(const UtcTimeStamp& now)
+	{
+		int timeout = std::min(m_sessionTime.getNextBoundary(now) - now,
+			m_logonTime.getNextBoundary(now) - now);
+
+		int sinceSent = now - m_state.lastSentTime();
+		int sinceReceived = now - m_state.lastReceivedTime();
+
+		if (!m_state.receivedLogon())
+		{
+			if (m_state.alreadySentLogon())
+				earliest(timeout, m_state.logonTimeout() - sinceReceived);
+		}
+		else if (m_state.heartBtInt())
+		{
+			// the same thresholds next() checks, whichever is passed first
+			int heartBtInt = m_state.heartBtInt();
+			earliest(timeout, heartBtInt - sinceSent);
+			earliest(timeout, heartBtInt - sinceReceived);
+			earliest(timeout, (int)ceil(1.2 * (m_state.testRequest() + 1) * heartBtInt) - sinceReceived);
+			earliest(timeout, (int)ceil(2.4 * heartBtInt) - sinceReceived);
+			if (m_state.sentLogout())
+				earliest(timeout, m_state.logoutTimeout() - sinceSent);
+		}
+
+		return std::max(timeout, 1);
 	}
 
 	void Session::next(const UtcTimeStamp& timeStamp)
@@ -160,6 +233,9 @@ namespace FIX
 				return;
 			}
 
+			if (isResending())
+				nextResend();
+
 			if (m_state.heartBtInt() == 0) 
 				return;
 
@@ -273,7 +349,10 @@ namespace FIX
 		}
 
 		if (isLoggedOn())
+		{
 			m_application.onLogon(m_sessionID);
+			wake();
+		}
 	}
 
 	void Session::nextHeartbeat(const Message& heartbeat, const UtcTimeStamp& timeStamp)
@@ -337,6 +416,15 @@ namespace FIX
 				m_state.setNextTargetMsgSeqNum(MsgSeqNum(newSeqNo));
 			else if (newSeqNo < getExpectedTargetNum())
 				generateReject(sequenceReset, SessionRejectReason_VALUE_IS_INCORRECT);
+
+			// A gap fill to the end of a chunk completes it without any
+			// message at or beyond its last sequence number arriving
+			if (m_state.resendTarget() && m_state.resendRequested()
+				&& newSeqNo > m_state.resendRange().second)
+			{
+				m_state.resendRange(0, 0);
+				nextResendChunk(newSeqNo);
+			}
 		}
 	}
 
@@ -373,78 +461,137 @@ namespace FIX
 			return;
 		}
 
-		std::vector < std::string > messages;
-		m_state.get(beginSeqNo, endSeqNo, messages);
+		if (m_pResend.get())
+		{
+			m_state.onEvent("Abandoning resend at "
+				+ IntConvertor::convert(m_pResend->current));
+		}
+
+		// messages held back by the previous resend are resent with this one
+		while (m_deferred.size() && m_deferred.front().first <= endSeqNo)
+		{
+			m_deferredBytes -= m_deferred.front().second.size();
+			m_deferred.pop_front();
+		}
 
-		MsgSeqNum msgSeqNum(0);
-		MsgType msgType;
-		int begin = 0;
-		int current = beginSeqNo;
-		std::string messageString;
-		Message msg;
+		m_pResend.reset(new Resend(m_state, beginSeqNo, endSeqNo, m_resendPageSize));
+		nextResend();
 
-		for (std::vector < std::string > ::iterator i = messages.begin(); i != messages.end(); ++i)
+		MsgSeqNum msgSeqNum;
+		resendRequest.getHeader().getField(msgSeqNum);
+		if (!isTargetTooHigh(msgSeqNum) && !isTargetTooLow(msgSeqNum))
+			m_state.incrNextTargetMsgSeqNum();
+	}
+
+	void Session::nextResend()
+	{
+		Locker l(m_mutex);
+
+		if (!m_pResend.get())
+			return;
+		if (m_sendQueueHighWatermark && m_pResponder
+			&& m_pResponder->getQueueDepth() >= m_sendQueueHighWatermark)
+			return;
+
+		resendPage(m_resendPageSize);
+	}
+
+	void Session::resendPage(int pageSize)
+	{
+		try
 		{
-			if (m_sessionID.isFIXT())
-			{
-				msg.setStringHeader(*i);
-				ApplVerID applVerID;
-				if (!msg.getHeader().getFieldIfSet(applVerID))
-					applVerID = m_senderDefaultApplVerID;
-				msg = Message(*i, m_sessionDataDictionary, m_appDataDictionary, m_validateLengthAndChecksum);
-			}
-			else
+			Resend& pending = *m_pResend;
+			MsgSeqNum msgSeqNum;
+			MsgType msgType;
+			std::string messageString;
+			Message msg;
+			int count = 0;
+
+			while (pending.cursor.next(messageString))
 			{
-				msg = Message(*i, m_sessionDataDictionary, m_validateLengthAndChecksum);
-			}
+				int seqNum = 0;
+				bool admin = false;
+				bool sent = false;
 
+				if (m_rawResend && resendRaw(messageString, seqNum, admin))
+				{
+					sent = !admin;
+				}
+				else
+				{
+					if (m_sessionID.isFIXT())
+					{
+						msg.setStringHeader(messageString);
+						ApplVerID applVerID;
+						if (!msg.getHeader().getFieldIfSet(applVerID))
+							applVerID = m_senderDefaultApplVerID;
+						msg = Message(messageString, m_sessionDataDictionary, m_appDataDictionary, m_validateLengthAndChecksum);
+					}
+					else
+					{
+						msg = Message(messageString, m_sessionDataDictionary, m_validateLengthAndChecksum);
+					}
 
-			msg.getHeader().getField(msgSeqNum);
-			msg.getHeader().getField(msgType);
+					msg.getHeader().getField(msgSeqNum);
+					msg.getHeader().getField(msgType);
+					seqNum = msgSeqNum;
+					admin = Message::isAdminMsgType(msgType);
+					sent = !admin && resend(msg);
+					if (sent)
+						msg.toString(messageString);
+				}
 
-			if ((current != msgSeqNum) && !begin)
-				begin = current;
+				if ((pending.current != seqNum) && !pending.gapBegin)
+					pending.gapBegin = pending.current;
 
-			if (Message::isAdminMsgType(msgType))
-			{
-				if (!begin)
-					begin = msgSeqNum;
-			}
-			else
-			{
-				if (resend(msg))
+				if (sent)
 				{
-					if (begin)
-						generateSequenceReset(begin, msgSeqNum);
-					send(msg.toString(messageString));
-					m_state.onEvent("Resending Message: " + IntConvertor::convert(msgSeqNum));
-					begin = 0;
+					if (pending.gapBegin)
+						generateSequenceReset(pending.gapBegin, seqNum);
+					send(messageString);
+					m_state.onEvent("Resending Message: " + IntConvertor::convert(seqNum));
+					pending.gapBegin = 0;
 				}
-				else if (!begin)
+				else if (!pending.gapBegin)
 				{
-					begin = msgSeqNum;
+					pending.gapBegin = seqNum;
 				}
+				pending.current = seqNum + 1;
+				pending.last = seqNum;
+
+				if (pageSize && ++count >= pageSize)
+					return;
 			}
-			current = msgSeqNum + 1;
-		}
 
-		if (begin)
+			finishResend();
+		}
+		catch (IOException& e)
 		{
-			generateSequenceReset(begin, msgSeqNum + 1);
+			m_state.onEvent(e.what());
+			disconnect();
 		}
+	}
 
-		if (endSeqNo > msgSeqNum)
+	void Session::finishResend()
+	{
+		Resend& pending = *m_pResend;
+		int beginSeqNo = pending.cursor.getBegin();
+		int endSeqNo = pending.cursor.getEnd();
+
+		if (pending.gapBegin)
+			generateSequenceReset(pending.gapBegin, pending.last + 1);
+
+		if (endSeqNo > pending.last)
 		{
-			endSeqNo = EndSeqNo(endSeqNo + 1);
+			endSeqNo = endSeqNo + 1;
 			int next = m_state.getNextSenderMsgSeqNum();
 			if (endSeqNo > next)
-				endSeqNo = EndSeqNo(next);
-			generateSequenceReset(beginSeqNo, endSeqNo);
+				endSeqNo = next;
+			generateSequenceReset(pending.last ? pending.last + 1 : beginSeqNo, endSeqNo);
 		}
 
-		resendRequest.getHeader().getField(msgSeqNum);
-		if (!isTargetTooHigh(msgSeqNum) && !isTargetTooLow(msgSeqNum))
-			m_state.incrNextTargetMsgSeqNum();
+		m_pResend.reset();
+		sendDeferred();
 	}
 
 	bool Session::send(Message& message)
@@ -492,7 +639,18 @@ namespace FIX
 					|| msgType == "2" || msgType == "4"
 					|| isLoggedOn())
 				{
-					send(messageString);
+					// logouts and rejects cannot wait for a resend in progress,
+					// so the rest of its range and what it held back go out
+					// first, the counterparty would otherwise see a gap
+					if (msgType == "5" || msgType == "3")
+					{
+						if (m_pResend.get())
+							resendPage(0);
+						sendDeferred();
+						send(messageString);
+					}
+					else if (!sendOrDefer(messageString, num))
+						return false;
 				}
 			}
 			else
@@ -506,8 +664,8 @@ namespace FIX
 					m_application.toApp(message, m_sessionID);
 					message.toString(messageString);
 
-					if (isLoggedOn())
-						send(messageString);
+					if (isLoggedOn() && !sendOrDefer(messageString, num))
+						return false;
 				}
 				catch (DoNotSend&) 
 				{ 
@@ -531,7 +689,63 @@ namespace FIX
 		if (!m_pResponder) 
 			return false;
 		m_state.onOutgoing(string);
-		return m_pResponder->send(string);
+		bool result = m_pResponder->send(string);
+
+		if (m_sendQueueHighWatermark)
+		{
+			size_t depth = m_pResponder->getQueueDepth();
+			if (depth < m_sendQueueHighWatermark)
+			{
+				m_aboveHighWatermark = false;
+			}
+			else if (!m_aboveHighWatermark)
+			{
+				m_aboveHighWatermark = true;
+				m_state.onEvent("Send queue reached " + IntConvertor::convert((int)depth) + " bytes");
+				m_application.onHighWatermark(m_sessionID, depth);
+			}
+		}
+		return result;
+	}
+
+	bool Session::sendOrDefer(const std::string& string, int msgSeqNum)
+	{
+		// new messages wait for a resend in progress so the counterparty
+		// still receives them in sequence
+		if (msgSeqNum || !m_pResend.get())
+		{
+			send(string);
+			return true;
+		}
+
+		// they are refused once too much is held back, without taking
+		// a sequence number
+		if (m_deferredQueueSize
+			&& m_deferredBytes + string.size() > m_deferredQueueSize)
+		{
+			if (!m_deferredFull)
+			{
+				m_deferredFull = true;
+				m_state.onEvent("Deferred queue limit of "
+					+ IntConvertor::convert((int)m_deferredQueueSize)
+					+ " bytes reached during resend");
+			}
+			return false;
+		}
+		m_deferred.push_back(std::make_pair(getExpectedSenderNum(), string));
+		m_deferredBytes += string.size();
+		return true;
+	}
+
+	void Session::sendDeferred()
+	{
+		while (m_deferred.size())
+		{
+			send(m_deferred.front().second);
+			m_deferred.pop_front();
+		}
+		m_deferredBytes = 0;
+		m_deferredFull = false;
 	}
 
 	void Session::disconnect()
@@ -543,6 +757,7 @@ namespace FIX
 			m_state.onEvent("Disconnecting");
 
 			m_pResponder->disconnect();
+			Locker r(m_responderMutex);
 			m_pResponder = 0;
 		}
 
@@ -562,6 +777,11 @@ namespace FIX
 			m_state.reset();
 
 		m_state.resendRange(0, 0);
+		m_state.resendTarget(0);
+		m_pResend.reset();
+		m_deferred.clear();
+		m_deferredBytes = 0;
+		m_deferredFull = false;
 	}
 
 	bool Session::resend(Message& message)
@@ -586,6 +806,103 @@ namespace FIX
 		}
 	}
 
+	bool Session::resendRaw(std::string& messageString, int& msgSeqNum, bool& admin)
+	{
+		// Rewrites the header of a stored message for resending without
+		// building a Message.  Returns false when the bytes can not be
+		// patched in place, leaving the caller to take the parsing path.
+		const std::string& in = messageString;
+		std::string::size_type beginString = in.find('\001');
+		if (in.compare(0, 2, "8=") != 0 || beginString == std::string::npos
+			|| in.compare(beginString + 1, 2, "9=") != 0)
+			return false;
+		std::string::size_type pos = in.find('\001', beginString + 1);
+		std::string::size_type trailer = in.rfind("\00110=");
+		if (pos == std::string::npos || trailer == std::string::npos || trailer < pos)
+			return false;
+		++pos;
+		++trailer;
+
+		std::string header;
+		std::string sendingTime;
+		bool haveMsgType = false;
+		bool haveMsgSeqNum = false;
+		header.reserve(trailer - pos + 64);
+
+		while (pos < trailer)
+		{
+			std::string::size_type equals = in.find('=', pos);
+			if (equals == std::string::npos || equals >= trailer)
+				return false;
+			std::string::size_type end = in.find('\001', equals);
+			if (end == std::string::npos || end >= trailer)
+				return false;
+
+			int field = 0;
+			if (!IntConvertor::convert(in.begin() + pos, in.begin() + equals, field))
+				return false;
+			if (!Message::isHeaderField(field))
+				break;
+
+			switch (field)
+			{
+			case FIELD::MsgType:
+				admin = Message::isAdminMsgType(MsgType(in.substr(equals + 1, end - equals - 1)));
+				haveMsgType = true;
+				break;
+			case FIELD::MsgSeqNum:
+				if (!IntConvertor::convert(in.begin() + equals + 1, in.begin() + end, msgSeqNum))
+					return false;
+				haveMsgSeqNum = true;
+				break;
+			case FIELD::SendingTime:
+				sendingTime = in.substr(equals + 1, end - equals - 1);
+				break;
+			case FIELD::SecureDataLen:
+			case FIELD::XmlDataLen:
+				// data fields may contain SOH, leave them to the parser
+				return false;
+			}
+
+			if (field != FIELD::SendingTime && field != FIELD::OrigSendingTime
+				&& field != FIELD::PossDupFlag)
+				header.append(in, pos, end + 1 - pos);
+			pos = end + 1;
+		}
+
+		if (!haveMsgType || !haveMsgSeqNum || sendingTime.empty())
+			return false;
+		if (admin)
+			return true;
+
+		Header now;
+		insertSendingTime(now);
+		header += "43=Y\001122=";
+		header += sendingTime;
+		header += "\00152=";
+		header += now.getField(FIELD::SendingTime);
+		header += '\001';
+		header.append(in, pos, trailer - pos);
+
+		std::string result;
+		result.reserve(in.size() + 64);
+		result.append(in, 0, beginString + 1);
+		result += "9=";
+		result += IntConvertor::convert(header.size());
+		result += '\001';
+		result += header;
+
+		int checkSum = 0;
+		for (std::string::size_type i = 0; i < result.size(); ++i)
+			checkSum += (unsigned char)result[i];
+		result += "10=";
+		result += CheckSumConvertor::convert(checkSum % 256);
+		result += '\001';
+
+		messageString.swap(result);
+		return true;
+	}
+
 	void Session::persist(const Message& message, const std::string& messageString)
 		throw (IOException)
 	{
@@ -639,14 +956,35 @@ namespace FIX
 	}
 
 	void Session::generateResendRequest(const BeginString& beginString, const MsgSeqNum& msgSeqNum)
+	{
+		int begin = getExpectedTargetNum();
+		int end = msgSeqNum - 1;
+
+		if (m_resendRequestChunkSize > 0 && end - begin >= m_resendRequestChunkSize)
+		{
+			m_state.resendTarget(end);
+			m_state.onEvent("Recovering messages FROM: " + IntConvertor::convert(begin)
+				+ " TO: " + IntConvertor::convert(end) + " in chunks of "
+				+ IntConvertor::convert(m_resendRequestChunkSize));
+			generateResendRequest(beginString, begin, begin + m_resendRequestChunkSize - 1);
+		}
+		else
+			generateResendRequest(beginString, begin, end);
+	}
+
+	void Session::generateResendRequest(const BeginString& beginString, int begin, int end)
 	{
 		Message resendRequest;
-		BeginSeqNo beginSeqNo((int)getExpectedTargetNum());
-		EndSeqNo endSeqNo(msgSeqNum - 1);
-		if (beginString >= FIX::BeginString_FIX42)
-			endSeqNo = 0;
-		else if (beginString <= FIX::BeginString_FIX41)
-			endSeqNo = 999999;
+		BeginSeqNo beginSeqNo(begin);
+		EndSeqNo endSeqNo(end);
+		// Only a chunk short of the whole gap asks for a closed range
+		if (end >= m_state.resendTarget())
+		{
+			if (beginString >= FIX::BeginString_FIX42)
+				endSeqNo = 0;
+			else if (beginString <= FIX::BeginString_FIX41)
+				endSeqNo = 999999;
+		}
 		resendRequest.getHeader().setField(MsgType("2"));
 		resendRequest.setField(beginSeqNo);
 		resendRequest.setField(endSeqNo);
@@ -657,7 +995,26 @@ namespace FIX
 			+ IntConvertor::convert(beginSeqNo) +
 			" TO: " + IntConvertor::convert(endSeqNo));
 
-		m_state.resendRange(beginSeqNo, msgSeqNum - 1);
+		m_state.resendRange(beginSeqNo, end);
+	}
+
+	void Session::nextResendChunk(int next)
+	{
+		int target = m_state.resendTarget();
+		if (!target)
+			return;
+
+		if (next > target)
+		{
+			m_state.resendTarget(0);
+			m_state.onEvent("Recovered messages TO: " + IntConvertor::convert(target));
+			return;
+		}
+
+		m_state.onEvent(IntConvertor::convert(target - next + 1)
+			+ " messages left to recover TO: " + IntConvertor::convert(target));
+		generateResendRequest(m_sessionID.getBeginString(), next,
+			std::min(next + m_resendRequestChunkSize - 1, target));
 	}
 
 	void Session::generateSequenceReset
@@ -812,7 +1169,7 @@ namespace FIX
 		sendRaw(reject);
 	}
 
-	void Session::generateReject(const Message& message, const std::string& str)
+	void Session::generateReject(const Message& message, const std::string& str, bool counted)
 	{
 		std::string beginString = m_sessionID.getBeginString();
 
@@ -830,7 +1187,8 @@ namespace FIX
 			reject.setField(RefMsgType(msgType));
 		reject.setField(RefSeqNum(msgSeqNum));
 
-		if (msgType != MsgType_Logon && msgType != MsgType_SequenceReset)
+		if (msgType != MsgType_Logon && msgType != MsgType_SequenceReset
+			&& !counted)
 			m_state.incrNextTargetMsgSeqNum();
 
 		reject.setField(Text(str));
@@ -839,7 +1197,7 @@ namespace FIX
 			+ " Rejected: " + str);
 	}
 
-	void Session::generateBusinessReject(const Message& message, int err, int field)
+	void Session::generateBusinessReject(const Message& message, int err, int field, bool counted)
 	{
 		Message reject;
 		reject.getHeader().setField(MsgType(MsgType_BusinessMessageReject));
@@ -853,7 +1211,8 @@ namespace FIX
 		reject.setField(RefMsgType(msgType));
 		reject.setField(RefSeqNum(msgSeqNum));
 		reject.setField(BusinessRejectReason(err));
-		m_state.incrNextTargetMsgSeqNum();
+		if (!counted)
+			m_state.incrNextTargetMsgSeqNum();
 
 		const char* reason = 0;
 		switch (err)
@@ -911,6 +1270,9 @@ namespace FIX
 			logout.setField(Text(text));
 		sendRaw(logout);
 		m_state.sentLogout(true);
+
+		// the logout timeout is a new deadline, whichever path sent it
+		wake();
 	}
 
 	void Session::populateRejectReason(Message& reject, int field,
@@ -992,6 +1354,7 @@ namespace FIX
 						IntConvertor::convert(range.second) +
 						" has been satisfied.");
 					m_state.resendRange(0, 0);
+					nextResendChunk(*pMsgSeqNum + 1);
 				}
 			}
 		}
@@ -1046,7 +1409,7 @@ namespace FIX
 	{
 		if (Message::isAdminMsgType(msgType))
 			m_application.fromAdmin(msg, m_sessionID);
-		else
+		else if (!m_pInboundLane)
 			m_application.fromApp(msg, m_sessionID);
 	}
 
@@ -1123,7 +1486,28 @@ namespace FIX
 			+ " but received "
 			+ IntConvertor::convert(msgSeqNum));
 
-		m_state.queue(msgSeqNum, msg);
+		std::string string;
+		if (!m_pIncoming)
+			msg.toString(string);
+		if (!m_state.queue(msgSeqNum, m_pIncoming ? *m_pIncoming : string))
+		{
+			std::string limit = "Gap queue limit of "
+				+ IntConvertor::convert((int)m_state.getMaxQueueSize()) + " bytes exceeded";
+			if (m_gapQueueOverflow == GapQueue::DISCONNECT)
+			{
+				m_state.onEvent(limit);
+				disconnect();
+				return;
+			}
+
+			// Requested again once the messages before it are processed
+			m_state.onEvent(limit + ", dropped message "
+				+ IntConvertor::convert(msgSeqNum));
+		}
+
+		// Later chunks of a recovery in progress cover this gap too
+		if (m_state.resendTarget() && msgSeqNum - 1 > m_state.resendTarget())
+			m_state.resendTarget(msgSeqNum - 1);
 
 		if (m_state.resendRequested())
 		{
@@ -1149,13 +1533,18 @@ namespace FIX
 
 	bool Session::nextQueued(int num, const UtcTimeStamp& timeStamp)
 	{
-		Message msg;
+		std::string string;
 		MsgType msgType;
 
-		if (m_state.retrieve(num, msg))
+		if (m_state.retrieve(num, string))
 		{
 			m_state.onEvent("Processing QUEUED message: "
 				+ IntConvertor::convert(num));
+
+			// Queued messages were only framed, they are parsed again now
+			Message msg = m_sessionID.isFIXT()
+				? Message(string, m_sessionDataDictionary, m_appDataDictionary, m_validateLengthAndChecksum)
+				: Message(string, m_sessionDataDictionary, m_validateLengthAndChecksum);
 			msg.getHeader().getField(msgType);
 			if (msgType == MsgType_Logon
 				|| msgType == MsgType_ResendRequest)
@@ -1164,7 +1553,10 @@ namespace FIX
 			}
 			else
 			{
+				const std::string* pIncoming = m_pIncoming;
+				m_pIncoming = &string;
 				next(msg, timeStamp, true);
+				m_pIncoming = pIncoming;
 			}
 			return true;
 		}
@@ -1173,6 +1565,10 @@ namespace FIX
 
 	void Session::next(const std::string& msg, const UtcTimeStamp& timeStamp, bool queued)
 	{
+		// A message ahead of a gap is queued as these bytes
+		const std::string* pIncoming = m_pIncoming;
+		m_pIncoming = &msg;
+
 		try
 		{
 			m_state.onIncoming(msg);
@@ -1184,9 +1580,11 @@ namespace FIX
 			{
 				next(Message(msg, m_sessionDataDictionary, m_validateLengthAndChecksum), timeStamp, queued);
 			}
+			m_pIncoming = pIncoming;
 		}
 		catch (InvalidMessage& e)
 		{
+			m_pIncoming = pIncoming;
 			m_state.onEvent(e.what());
 			try
 			{
@@ -1199,9 +1597,123 @@ namespace FIX
 			catch (MessageParseError&) {}
 			throw e;
 		}
+		catch (...)
+		{
+			m_pIncoming = pIncoming;
+			throw;
+		}
+	}
+
+	void Session::next(const std::string& msg, Message& message, const UtcTimeStamp& timeStamp)
+	{
+		const std::string* pIncoming = m_pIncoming;
+		m_pIncoming = &msg;
+		// the lane may take this one rather than a copy
+		m_pReceived = &message;
+
+		try
+		{
+			m_state.onIncoming(msg);
+			nextMessage(message, timeStamp, false, true);
+			m_pIncoming = pIncoming;
+			m_pReceived = 0;
+		}
+		catch (...)
+		{
+			m_pIncoming = pIncoming;
+			m_pReceived = 0;
+			throw;
+		}
+	}
+
+	bool Session::decode(const std::string& msg, Message& message)
+	{
+		try
+		{
+			// chooses dictionaries the way the Message constructors do
+			const DataDictionary* pAppDataDictionary = &m_sessionDataDictionary;
+			if (m_sessionID.isFIXT())
+			{
+				message.setStringHeader(msg);
+				if (!message.isAdmin())
+					pAppDataDictionary = &m_appDataDictionary;
+			}
+			message.setString(msg, m_validateLengthAndChecksum,
+				&m_sessionDataDictionary, pAppDataDictionary);
+			validate(message);
+			return true;
+		}
+		catch (std::exception&)
+		{
+			return false;
+		}
+	}
+
+	void Session::validate(const Message& message)
+	{
+		if (m_sessionID.isFIXT() && message.isApp())
+			DataDictionary::validateMessage(message, &m_sessionDataDictionary, &m_appDataDictionary);
+		else
+			m_sessionDataDictionary.validate(message);
+	}
+
+	void Session::nextApplication(const Message& message)
+	{
+		m_application.fromApp(message, m_sessionID);
+	}
+
+	void Session::rejectApplication(const Message& message, std::exception_ptr error)
+	{
+		const Header& header = message.getHeader();
+
+		// rejects the same way next() does for an exception from fromApp
+		try
+		{
+			std::rethrow_exception(error);
+		}
+		catch (FieldNotFound & e)
+		{
+			if (header.getField(FIELD::BeginString) >= FIX::BeginString_FIX42)
+			{
+				LOGEX(generateBusinessReject(message, BusinessRejectReason_CONDITIONALLY_REQUIRED_FIELD_MISSING, e.field, true));
+			}
+			else
+			{
+				LOGEX(generateReject(message, SessionRejectReason_REQUIRED_TAG_MISSING, e.field));
+			}
+		}
+		catch (IncorrectDataFormat & e)
+		{
+			LOGEX(generateReject(message, SessionRejectReason_INCORRECT_DATA_FORMAT_FOR_VALUE, e.field));
+		}
+		catch (IncorrectTagValue & e)
+		{
+			LOGEX(generateReject(message, SessionRejectReason_VALUE_IS_INCORRECT, e.field));
+		}
+		catch (UnsupportedMessageType&)
+		{
+			if (header.getField(FIELD::BeginString) >= FIX::BeginString_FIX42)
+			{
+				LOGEX(generateBusinessReject(message, BusinessRejectReason_UNKNOWN_MESSAGE_TYPE, 0, true));
+			}
+			else
+			{
+				LOGEX(generateReject(message, "Unsupported message type", true));
+			}
+		}
+		catch (std::exception& e)
+		{
+			m_state.onEvent(e.what());
+		}
 	}
 
 	void Session::next(const Message& message, const UtcTimeStamp& timeStamp, bool queued)
+	{
+		nextMessage(message, timeStamp, queued, false);
+	}
+
+	void Session::nextMessage(const Message& message, const UtcTimeStamp& timeStamp,
+		bool queued, bool validated)
 	{
 		const Header& header = message.getHeader();
 
@@ -1234,10 +1746,8 @@ namespace FIX
 				}
 			}
 
-			if (m_sessionID.isFIXT() && message.isApp())
-				DataDictionary::validateMessage(message, &m_sessionDataDictionary, &m_appDataDictionary);
-			else
-				m_sessionDataDictionary.validate(message);
+			if (!validated)
+				validate(message);
 
 			if (msgType == MsgType_Logon)
 				nextLogon(message, timeStamp);
@@ -1258,6 +1768,18 @@ namespace FIX
 				if (!verify(message)) 
 					return;
 				m_state.incrNextTargetMsgSeqNum();
+				// counted first, a reject from the application stage then
+				// comes back through rejectApplication
+				if (m_pInboundLane)
+				{
+					if (m_pReceived == &message)
+						m_pInboundLane->deliver(*m_pReceived);
+					else
+					{
+						Message copy(message);
+						m_pInboundLane->deliver(copy);
+					}
+				}
 			}
 		}
 		catch (MessageParseError& e)
@@ -1360,8 +1882,10 @@ namespace FIX
 		if (!queued)
 			nextQueued(timeStamp);
 
+		// Traffic only moves deadlines later, so the session timer is
+		// left as it is rather than rescheduled for every message
 		if (isLoggedOn())
-			next();
+			next(UtcTimeStamp());
 	}
 
 	bool Session::sendToTarget(Message& message, const std::string& qualifier)
@@ -1379,7 +1903,13 @@ namespace FIX
 		throw(SessionNotFound)
 	{
 		message.setSessionID(sessionID);
-		std::shared_ptr<Session> pSession = lookupSession(sessionID);
+		return send(lookupHandle(sessionID), message);
+	}
+
+	bool Session::send(int handle, Message& message)
+		throw(SessionNotFound)
+	{
+		SessionRegistry::Reference pSession(handle);
 		if (!pSession) throw SessionNotFound();
 		return pSession->send(message);
 	}
@@ -1407,19 +1937,36 @@ namespace FIX
 
 	std::set<SessionID> Session::getSessions()
 	{
-		return s_sessionIDs;
+		return SessionRegistry::instance().getSessionIDs();
 	}
 
 	bool Session::doesSessionExist(const SessionID& sessionID)
 	{
-		Locker locker(s_mutex);
-		return s_sessions.end() != s_sessions.find(sessionID);
+		SessionRegistry::Reference pSession(lookupHandle(sessionID));
+		return pSession;
 	}
 
 	std::shared_ptr<Session> Session::lookupSession(const SessionID& sessionID)
 	{
-		Locker locker(s_mutex);
-		return  s_sessions[sessionID];
+		return lookupSession(lookupHandle(sessionID));
+	}
+
+	std::shared_ptr<Session> Session::lookupSession(int handle)
+	{
+		std::shared_ptr<SessionRegistry::Reference> pReference(
+			new SessionRegistry::Reference(handle));
+		if (!*pReference)
+			return nullptr;
+
+		// an owned session is shared with the caller, which then does not
+		// hold up its removal, one going away is no longer handed out
+		Session* pSession = pReference->get();
+		if (pSession->m_owned)
+			return pSession->m_owner.lock();
+
+		// the registry does not own other sessions, so the pointer owns a
+		// pin on the session instead of the session itself
+		return std::shared_ptr<Session>(pReference, pSession);
 	}
 
 	std::shared_ptr<Session> Session::lookupSession(const std::string& str, bool reverse)
@@ -1431,13 +1978,17 @@ namespace FIX
 		try
 		{
 			const Header& header = message.getHeader();
-			const BeginString& beginString = FIELD_GET_REF(header, BeginString);
-			const SenderCompID& senderCompID = FIELD_GET_REF(header, SenderCompID);
-			const TargetCompID& targetCompID = FIELD_GET_REF(header, TargetCompID);
+			const std::string& beginString = FIELD_GET_REF(header, BeginString).getString();
+			const std::string& senderCompID = FIELD_GET_REF(header, SenderCompID).getString();
+			const std::string& targetCompID = FIELD_GET_REF(header, TargetCompID).getString();
+
+			// the key is the string form of the SessionID, built directly
+			std::string key = beginString + ":";
+			key += reverse ? targetCompID : senderCompID;
+			key += "->";
+			key += reverse ? senderCompID : targetCompID;
 
-			if (reverse)
-				return lookupSession(SessionID(beginString, SenderCompID(targetCompID), TargetCompID(senderCompID)));
-			return lookupSession(SessionID(beginString, senderCompID, targetCompID));
+			return lookupSession(SessionRegistry::instance().find(key));
 		}
 		catch (FieldNotFound&)
 		{
@@ -1447,28 +1998,22 @@ namespace FIX
 
 	size_t Session::numSessions()
 	{
-		Locker locker(s_mutex);
-		return s_sessions.size();
+		return SessionRegistry::instance().size();
+	}
+
+	int Session::lookupHandle(const SessionID& sessionID)
+	{
+		return SessionRegistry::instance().find(sessionID);
 	}
 
 	bool Session::addSession(Session& s)
 	{
-		Locker locker(s_mutex);
-		Sessions::iterator it = s_sessions.find(s.m_sessionID);
-		if (it == s_sessions.end())
-		{
-			s_sessions[s.m_sessionID] = std::shared_ptr<Session>(&s);
-			s_sessionIDs.insert(s.m_sessionID);
-			return true;
-		}
-		else
-			return false;
+		s.m_handle = SessionRegistry::instance().add(s.m_sessionID, &s);
+		return s.m_handle >= 0;
 	}
 
 	void Session::removeSession(Session& s)
 	{
-		Locker locker(s_mutex);
-		s_sessions.erase(s.m_sessionID);
-		s_sessionIDs.erase(s.m_sessionID);
+		SessionRegistry::instance().remove(s.m_sessionID, &s, s.m_state.log());
 	}
 }
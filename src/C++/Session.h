@@ -29,18 +29,25 @@
 #include "SessionState.h"
 #include "TimeRange.h"
 #include "SessionID.h"
+#include "SessionRegistry.h"
+#include "TimerWheel.h"
 #include "Responder.h"
 #include "Fields.h"
 #include "DataDictionaryProvider.h"
 #include "Application.h"
 #include "Mutex.h"
 #include "Log.h"
+#include <exception>
 #include <utility>
 #include <map>
 #include <queue>
+#include <memory>
+#include <atomic>
 
 namespace FIX
 {
+	class InboundLane;
+
 	/// Maintains the state and implements the logic of a %FIX %session.
 	class Session
 	{
@@ -52,13 +59,17 @@ namespace FIX
 		);
 		~Session();
 
+		static const size_t DEFAULT_DEFERRED_QUEUE_SIZE = 16 * 1024 * 1024;
+
 		void logon()
 		{
 			m_state.enabled(true); m_state.logoutReason("");
+			wake();
 		}
 		void logout(const std::string& reason = "")
 		{
 			m_state.enabled(false); m_state.logoutReason(reason);
+			wake();
 		}
 		bool isEnabled()
 		{
@@ -107,11 +118,30 @@ namespace FIX
 			const std::string& qualifier = "")
 			throw(SessionNotFound);
 
+		/// Send to the session of a handle, without building a SessionID.
+		static bool send(int handle, Message& message)
+			throw(SessionNotFound);
+
 		static std::set<SessionID> getSessions();
 		static bool doesSessionExist(const SessionID&);
+		/// The session stays alive while the returned pointer is held. A
+		/// session created by SessionFactory is shared with its owner.
+		/// Any other session is pinned in the registry, and destroying it
+		/// waits for the pointer to be released, so that pointer must be
+		/// kept for the call at hand only.
 		static std::shared_ptr<Session> lookupSession(const SessionID&);
 		static std::shared_ptr<Session> lookupSession(const std::string&, bool reverse = false);
+		/// Session of a handle, held on the same terms.
+		static std::shared_ptr<Session> lookupSession(int handle);
 		static size_t numSessions();
+		/// Handle of a SessionID, -1 if no such session was ever created.
+		static int lookupHandle(const SessionID&);
+
+		/// Small integer naming this session for as long as the process runs.
+		int getHandle() const
+		{
+			return m_handle;
+		}
 
 		bool isSessionTime(const UtcTimeStamp& time)
 		{
@@ -274,20 +304,152 @@ namespace FIX
 			m_validateLengthAndChecksum = value;
 		}
 
+		size_t getSendQueueHighWatermark()
+		{
+			return m_sendQueueHighWatermark;
+		}
+		void setSendQueueHighWatermark(size_t value)
+		{
+			m_sendQueueHighWatermark = value;
+		}
+
+		/// Bytes sent by the session but still queued on its connection.
+		size_t getSendQueueDepth()
+		{
+			Locker l(m_mutex);
+			return m_pResponder ? m_pResponder->getQueueDepth() : 0;
+		}
+
+		int getResendPageSize()
+		{
+			return m_resendPageSize;
+		}
+		void setResendPageSize(int value)
+		{
+			m_resendPageSize = value;
+		}
+
+		/// Limit in bytes on new messages held back by a resend in
+		/// progress, beyond it send fails until the resend completes.
+		size_t getDeferredQueueSize()
+		{
+			return m_deferredQueueSize;
+		}
+		void setDeferredQueueSize(size_t value)
+		{
+			m_deferredQueueSize = value;
+		}
+
+		/// When set, resent messages are patched in their stored form
+		/// and are not passed to Application::toApp.
+		bool getRawResend()
+		{
+			return m_rawResend;
+		}
+		void setRawResend(bool value)
+		{
+			m_rawResend = value;
+		}
+
+		/// Limit on bytes of messages queued behind a sequence gap, 0 for none.
+		size_t getGapQueueSize()
+		{
+			return m_state.getMaxQueueSize();
+		}
+		void setGapQueueSize(size_t value)
+		{
+			m_state.setMaxQueueSize(value);
+		}
+		GapQueue::Overflow getGapQueueOverflow()
+		{
+			return m_gapQueueOverflow;
+		}
+		void setGapQueueOverflow(GapQueue::Overflow value)
+		{
+			m_gapQueueOverflow = value;
+		}
+
+		/// Most messages asked for by one ResendRequest, 0 for no limit.
+		/// Larger gaps are requested a chunk at a time.
+		int getResendRequestChunkSize()
+		{
+			return m_resendRequestChunkSize;
+		}
+		void setResendRequestChunkSize(int value)
+		{
+			m_resendRequestChunkSize = value;
+		}
+		/// Last message of the gap being recovered in chunks, 0 if none.
+		int getResendTarget()
+		{
+			return m_state.resendTarget();
+		}
+
+		/// Decides which incoming and outgoing messages reach the log.
+		const LogFilter& getLogFilter()
+		{
+			return m_state.logFilter();
+		}
+		void setLogFilter(const LogFilter& value)
+		{
+			m_state.logFilter(value);
+		}
+
+		/// True while a resend is being streamed out a page at a time.
+		bool isResending()
+		{
+			Locker l(m_mutex);
+			return m_pResend.get() != 0;
+		}
+		/// Send the next page of a resend in progress.
+		void nextResend();
+
 		void setResponder(Responder* pR)
 		{
 			if (!checkSessionTime(UtcTimeStamp()))
 				reset();
-			m_pResponder = pR;
+			{
+				Locker l(m_responderMutex);
+				m_pResponder = pR;
+			}
+			if (pR)
+				wake();
 		}
 
 		bool send(Message&);
 		void next();
+		/// Seconds until the next deadline next() acts on.
+		int getTimeout() { return getTimeout(UtcTimeStamp()); }
 		void next(const UtcTimeStamp& timeStamp);
 		void next(const std::string&, const UtcTimeStamp& timeStamp, bool queued = false);
 		void next(const Message&, const UtcTimeStamp& timeStamp, bool queued = false);
+		/// Process a message already parsed and validated by an InboundPipeline,
+		/// which may be swapped out for the application stage.
+		void next(const std::string&, Message&, const UtcTimeStamp& timeStamp);
 		void disconnect();
 
+		/// Parse and validate a message, false if it fails either. Only
+		/// reads configuration, so any thread may call it.
+		bool decode(const std::string&, Message&);
+		/// Call fromApp for a message the session has accepted, on the
+		/// application stage of an InboundPipeline.  Exceptions are left
+		/// to the lane, which hands them to rejectApplication.
+		void nextApplication(const Message&);
+		/// Send the reject for an exception nextApplication threw, on the
+		/// thread processing messages.  The message is already counted.
+		void rejectApplication(const Message&, std::exception_ptr);
+
+		/// Lane taking accepted application messages to fromApp, 0 to
+		/// call it on the thread processing the message.
+		InboundLane* getInboundLane()
+		{
+			return m_pInboundLane;
+		}
+		void setInboundLane(InboundLane* pLane)
+		{
+			m_pInboundLane = pLane;
+		}
+
 		int getExpectedSenderNum() { return m_state.getNextSenderMsgSeqNum(); }
 		int getExpectedTargetNum() { return m_state.getNextTargetMsgSeqNum(); }
 
@@ -297,12 +459,53 @@ namespace FIX
 		typedef std::map < SessionID, std::shared_ptr<Session> > Sessions;
 		typedef std::set < SessionID > SessionIDs;
 	private:
+		friend class SessionFactory;
+
 		static bool addSession(Session&);
 		static void removeSession(Session&);
 
+		/// Lets lookups share ownership of a session instead of pinning it.
+		void setOwner(const std::shared_ptr<Session>& pOwner)
+		{
+			m_owner = pOwner;
+			m_owned = true;
+		}
+
+		/// Wakes the session through its responder when a deadline is due.
+		struct Ticker : public TimerWheel::Timer
+		{
+			Ticker(Session& s) : session(s) {}
+			void onTimer() { session.onTimer(); }
+			Session& session;
+		};
+
+		void wake()
+		{
+			SessionTimer::instance().schedule(&m_ticker, 0);
+		}
+		void onTimer();
+		int getTimeout(const UtcTimeStamp& now);
+
+		struct Resend
+		{
+			Resend(const MessageStore& store, int begin, int end, int pageSize)
+				: cursor(store, begin, end, pageSize), gapBegin(0), current(begin), last(0) {}
+
+			MessageStoreCursor cursor;
+			int gapBegin;
+			int current;
+			int last;
+		};
+		typedef std::deque < std::pair < int, std::string > > Deferred;
+
 		bool send(const std::string&);
+		bool sendOrDefer(const std::string&, int msgSeqNum);
+		void sendDeferred();
 		bool sendRaw(Message&, int msgSeqNum = 0);
+		void resendPage(int pageSize);
+		void finishResend();
 		bool resend(Message& message);
+		bool resendRaw(std::string& messageString, int& msgSeqNum, bool& admin);
 		void persist(const Message&, const std::string&) throw (IOException);
 
 		void insertSendingTime(Header&);
@@ -318,9 +521,14 @@ namespace FIX
 		}
 		bool checkSessionTime(const UtcTimeStamp& timeStamp)
 		{
-			UtcTimeStamp creationTime = m_state.getCreationTime();
-			return m_sessionTime.isInSameRange(timeStamp, creationTime);
+			// The answer only changes at a session time boundary or when
+			// the store is reset, between them a comparison is enough
+			if (m_windowStart <= timeStamp && timeStamp < m_windowEnd
+				&& m_windowCreationTime == m_state.creationTime())
+				return m_inSessionWindow;
+			return updateSessionWindow(timeStamp);
 		}
+		bool updateSessionWindow(const UtcTimeStamp& timeStamp);
 		bool isTargetTooHigh(const MsgSeqNum& msgSeqNum)
 		{
 			return msgSeqNum > (m_state.getNextTargetMsgSeqNum());
@@ -351,6 +559,9 @@ namespace FIX
 		void doTargetTooHigh(const Message& msg);
 		void nextQueued(const UtcTimeStamp& timeStamp);
 		bool nextQueued(int num, const UtcTimeStamp& timeStamp);
+		void nextMessage(const Message&, const UtcTimeStamp& timeStamp,
+			bool queued, bool validated);
+		void validate(const Message&);
 
 		void nextLogon(const Message&, const UtcTimeStamp& timeStamp);
 		void nextHeartbeat(const Message&, const UtcTimeStamp& timeStamp);
@@ -359,17 +570,20 @@ namespace FIX
 		void nextReject(const Message&, const UtcTimeStamp& timeStamp);
 		void nextSequenceReset(const Message&);
 		void nextResendRequest(const Message&);
+		void nextResendChunk(int next);
 
 		void generateLogon();
 		void generateLogon(const Message&);
 		void generateResendRequest(const BeginString&, const MsgSeqNum&);
+		void generateResendRequest(const BeginString&, int begin, int end);
 		void generateSequenceReset(int, int);
 		void generateHeartbeat();
 		void generateHeartbeat(const Message&);
 		void generateTestRequest(const std::string&);
 		void generateReject(const Message&, int err, int field = 0);
-		void generateReject(const Message&, const std::string&);
-		void generateBusinessReject(const Message&, int err, int field = 0);
+		void generateReject(const Message&, const std::string&, bool counted = false);
+		void generateBusinessReject(const Message&, int err, int field = 0,
+			bool counted = false);
 		void generateLogout(const std::string& text = "");
 
 		void populateRejectReason(Message&, int field, const std::string&);
@@ -385,6 +599,10 @@ namespace FIX
 		SessionID m_sessionID;
 		TimeRange m_sessionTime;
 		TimeRange m_logonTime;
+		UtcTimeStamp m_windowStart;
+		UtcTimeStamp m_windowEnd;
+		UtcTimeStamp m_windowCreationTime;
+		bool m_inSessionWindow;
 
 		std::string m_senderDefaultApplVerID;
 		std::string m_targetDefaultApplVerID;
@@ -399,12 +617,33 @@ namespace FIX
 		bool m_millisecondsInTimeStamp;
 		bool m_persistMessages;
 		bool m_validateLengthAndChecksum;
+		size_t m_sendQueueHighWatermark;
+		bool m_aboveHighWatermark;
+		int m_resendPageSize;
+		size_t m_deferredQueueSize;
+		size_t m_deferredBytes;
+		bool m_deferredFull;
+		bool m_rawResend;
+		GapQueue::Overflow m_gapQueueOverflow;
+		int m_resendRequestChunkSize;
+		const std::string* m_pIncoming;
+		Message* m_pReceived;
+		int m_handle;
+		std::weak_ptr<Session> m_owner;
+		std::atomic<bool> m_owned;
+		Ticker m_ticker;
+		std::unique_ptr<Resend> m_pResend;
+		Deferred m_deferred;
 
 		SessionState m_state;
 		MessageStoreFactory& m_messageStoreFactory;
 		LogFactory* m_pLogFactory;
 		Responder* m_pResponder;
+		InboundLane* m_pInboundLane;
 		Mutex m_mutex;
+		// guards only the responder pointer, so the timer thread can
+		// wake a session without waiting on its store
+		Mutex m_responderMutex;
 
 		const DataDictionary& m_sessionDataDictionary;
 		const DataDictionary& m_appDataDictionary;
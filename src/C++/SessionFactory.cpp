@@ -73,6 +73,7 @@ namespace FIX
 			sessionID, sessionTimeRange, heartBtInt, m_pLogFactory,
 			getDataDictionary(settings.getString(dataDicPath)),
 			getDataDictionary(settings.getString(APP_DATA_DICTIONARY)));
+		pSession->setOwner(pSession);
 
 		if (sessionID.isFIXT())
 		{
@@ -136,6 +137,29 @@ namespace FIX
 			pSession->setPersistMessages(settings.getBool(PERSIST_MESSAGES));
 		if (settings.has(VALIDATE_LENGTH_AND_CHECKSUM))
 			pSession->setValidateLengthAndChecksum(settings.getBool(VALIDATE_LENGTH_AND_CHECKSUM));
+		if (settings.has(SEND_QUEUE_HIGH_WATERMARK))
+			pSession->setSendQueueHighWatermark(settings.getInt(SEND_QUEUE_HIGH_WATERMARK));
+		if (settings.has(RESEND_PAGE_SIZE))
+			pSession->setResendPageSize(settings.getInt(RESEND_PAGE_SIZE));
+		if (settings.has(DEFERRED_QUEUE_SIZE))
+			pSession->setDeferredQueueSize(settings.getInt(DEFERRED_QUEUE_SIZE));
+		if (settings.has(RAW_RESEND))
+			pSession->setRawResend(settings.getBool(RAW_RESEND));
+		if (settings.has(GAP_QUEUE_SIZE))
+			pSession->setGapQueueSize(settings.getInt(GAP_QUEUE_SIZE));
+		if (settings.has(GAP_QUEUE_OVERFLOW))
+		{
+			std::string overflow = string_toUpper(settings.getString(GAP_QUEUE_OVERFLOW));
+			if (overflow == "DISCONNECT")
+				pSession->setGapQueueOverflow(GapQueue::DISCONNECT);
+			else if (overflow == "RESEND")
+				pSession->setGapQueueOverflow(GapQueue::RESEND);
+			else
+				throw ConfigError("GapQueueOverflow must be DISCONNECT or RESEND");
+		}
+		if (settings.has(RESEND_REQUEST_CHUNK_SIZE))
+			pSession->setResendRequestChunkSize(settings.getInt(RESEND_REQUEST_CHUNK_SIZE));
+		pSession->setLogFilter(LogFilter(settings));
 		return pSession;
 	}
 }
@@ -0,0 +1,192 @@
+/****************************************************************************
+** Copyright (c) 2001-2014
+**
+** This file is part of the QuickFIX FIX Engine
+**
+** This file may be distributed under the terms of the quickfixengine.org
+** license as defined by quickfixengine.org and appearing in the file
+** LICENSE included in the packaging of this file.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** See http://www.quickfixengine.org/LICENSE for licensing information.
+**
+** Contact ask@quickfixengine.org if any conditions of this licensing are
+** not clear to you.
+**
+****************************************************************************/
+
+#ifdef _MSC_VER
+#include "stdafx.h"
+#else
+#include "config.h"
+#endif
+
+#include "SessionRegistry.h"
+#include "FieldConvertors.h"
+#include "Log.h"
+#include "Utility.h"
+
+namespace FIX
+{
+SessionRegistry& SessionRegistry::instance()
+{
+  // never destroyed, sessions owned by other statics may outlive it
+  static SessionRegistry* registry = new SessionRegistry;
+  return *registry;
+}
+
+SessionRegistry::SessionRegistry()
+: m_size( 0 ), m_handles( 0 )
+{
+  for ( int i = 0; i < MAX_CHUNKS; ++i )
+    m_chunks[ i ].store( 0, std::memory_order_relaxed );
+  for ( int i = 0; i < BUCKETS; ++i )
+    m_buckets[ i ].store( 0, std::memory_order_relaxed );
+}
+
+SessionRegistry::~SessionRegistry()
+{
+  for ( int i = 0; i < MAX_CHUNKS; ++i )
+    delete [] m_chunks[ i ].load();
+  for ( int i = 0; i < BUCKETS; ++i )
+  {
+    Node* pNode = m_buckets[ i ].load();
+    while ( pNode )
+    {
+      Node* pNext = pNode->next;
+      delete pNode;
+      pNode = pNext;
+    }
+  }
+}
+
+size_t SessionRegistry::hash( const std::string& key )
+{
+  size_t hash = 2166136261UL;
+  for ( std::string::const_iterator i = key.begin(); i != key.end(); ++i )
+    hash = ( hash ^ (unsigned char)*i ) * 16777619UL;
+  return hash;
+}
+
+SessionRegistry::Slot* SessionRegistry::slot( int handle ) const
+{
+  if ( handle < 0 || handle >= CHUNK_SIZE * MAX_CHUNKS ) return 0;
+  Slot* pChunk = m_chunks[ handle / CHUNK_SIZE ].load( std::memory_order_acquire );
+  return pChunk ? pChunk + handle % CHUNK_SIZE : 0;
+}
+
+int SessionRegistry::find( const std::string& key ) const
+{
+  const Node* pNode
+    = m_buckets[ hash( key ) % BUCKETS ].load( std::memory_order_acquire );
+  for ( ; pNode; pNode = pNode->next )
+  {
+    if ( pNode->sessionID.toStringFrozen() == key )
+      return pNode->handle;
+  }
+  return -1;
+}
+
+int SessionRegistry::add( const SessionID& sessionID, Session* pSession )
+throw( RuntimeError )
+{
+  Locker l( m_mutex );
+
+  int handle = find( sessionID );
+  if ( handle < 0 )
+  {
+    if ( m_handles == CHUNK_SIZE * MAX_CHUNKS )
+      throw RuntimeError( "Too many sessions" );
+    handle = m_handles++;
+    if ( handle % CHUNK_SIZE == 0 )
+      m_chunks[ handle / CHUNK_SIZE ].store( new Slot[ CHUNK_SIZE ], std::memory_order_release );
+
+    // readers walk the chain without locking, so a node is complete
+    // before it is linked
+    std::atomic < Node* >& bucket = m_buckets[ hash( sessionID.toStringFrozen() ) % BUCKETS ];
+    bucket.store( new Node( sessionID, handle, bucket.load() ), std::memory_order_release );
+  }
+
+  Slot* pSlot = slot( handle );
+  if ( pSlot->session.load() ) return -1;
+  pSlot->session.store( pSession );
+  m_sessionIDs.insert( sessionID );
+  ++m_size;
+  return handle;
+}
+
+void SessionRegistry::remove( const SessionID& sessionID, Session* pSession,
+                              Log* pLog )
+{
+  Slot* pSlot = slot( find( sessionID ) );
+  if ( !pSlot ) return;
+
+  {
+    Locker l( m_mutex );
+    if ( pSlot->session.load() != pSession ) return;
+    pSlot->session.store( 0 );
+    m_sessionIDs.erase( sessionID );
+    --m_size;
+  }
+
+  // readers that loaded the session before it was cleared are let finish,
+  // the last of them signals once it sees the slot cleared
+  int readers;
+  while ( ( readers = pSlot->readers.load() ) != 0 )
+  {
+    m_released.wait( 1 );
+    if ( pLog && pSlot->readers.load() )
+      pLog->onEvent( "Waiting for " + IntConvertor::convert( readers )
+                     + " references to the session before removing it" );
+  }
+}
+
+std::set < SessionID > SessionRegistry::getSessionIDs() const
+{
+  Locker l( m_mutex );
+  return m_sessionIDs;
+}
+
+SessionRegistry::Reference::Reference( int handle )
+: m_pSlot( 0 ), m_pSession( 0 )
+{
+  acquire( handle );
+}
+
+SessionRegistry::Reference::~Reference()
+{
+  release();
+}
+
+void SessionRegistry::Reference::reset( int handle )
+{
+  release();
+  acquire( handle );
+}
+
+void SessionRegistry::Reference::acquire( int handle )
+{
+  m_pSlot = SessionRegistry::instance().slot( handle );
+  m_pSession = 0;
+  if ( !m_pSlot ) return;
+
+  // announcing the reader before loading pairs with remove clearing the
+  // slot before it counts readers, so one of them sees the other
+  m_pSlot->readers.fetch_add( 1 );
+  m_pSession = m_pSlot->session.load();
+}
+
+void SessionRegistry::Reference::release()
+{
+  if ( !m_pSlot ) return;
+
+  // the same pairing in reverse, a remove waiting on this reader either
+  // sees the count drop or gets the signal
+  if ( m_pSlot->readers.fetch_sub( 1 ) == 1 && !m_pSlot->session.load() )
+    SessionRegistry::instance().m_released.signal();
+  m_pSlot = 0;
+  m_pSession = 0;
+}
+} //namespace FIX
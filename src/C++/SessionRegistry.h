@@ -0,0 +1,146 @@
+/* -*- C++ -*- */
+
+/****************************************************************************
+** Copyright (c) 2001-2014
+**
+** This file is part of the QuickFIX FIX Engine
+**
+** This file may be distributed under the terms of the quickfixengine.org
+** license as defined by quickfixengine.org and appearing in the file
+** LICENSE included in the packaging of this file.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** See http://www.quickfixengine.org/LICENSE for licensing information.
+**
+** Contact ask@quickfixengine.org if any conditions of this licensing are
+** not clear to you.
+**
+****************************************************************************/
+
+#ifndef FIX_SESSIONREGISTRY_H
+#define FIX_SESSIONREGISTRY_H
+
+#ifdef _MSC_VER
+#pragma warning( disable : 4503 4355 4786 4290 )
+#endif
+
+#include "Event.h"
+#include "Exceptions.h"
+#include "Mutex.h"
+#include "SessionID.h"
+#include <atomic>
+#include <set>
+#include <string>
+
+namespace FIX
+{
+class Session;
+class Log;
+
+/**
+ * Read-mostly registry of the sessions of the process.
+ *
+ * Each SessionID gets a small integer handle the first time it is
+ * registered and keeps it for the life of the process, so a session
+ * that is destroyed and created again is found under the same handle.
+ *
+ * Lookups take no lock.  The name index only ever grows, and removing a
+ * session waits for the readers still holding a Reference to it.
+ * Registering and removing sessions are serialized by a mutex.
+ */
+class SessionRegistry
+{
+  struct Slot;
+
+public:
+  enum { CHUNK_SIZE = 256, MAX_CHUNKS = 256, BUCKETS = 1024 };
+
+  static SessionRegistry& instance();
+
+  /// Register a session, -1 when its SessionID is already live.
+  int add( const SessionID&, Session* ) throw( RuntimeError );
+  /// Unregister the session, once no reader is using it.  While readers
+  /// hold on to it, the wait is reported to the log every second.
+  void remove( const SessionID&, Session*, Log* pLog = 0 );
+
+  /// Handle of a SessionID, -1 if it was never registered.
+  int find( const SessionID& sessionID ) const
+  { return find( sessionID.toStringFrozen() ); }
+  /// Handle of a SessionID in its string form.
+  int find( const std::string& key ) const;
+
+  size_t size() const { return m_size.load(); }
+  std::set < SessionID > getSessionIDs() const;
+
+  /**
+   * Pins the live session of a handle.
+   *
+   * The session is not destroyed while the reference exists, so it must
+   * not be held while destroying that session on the same thread, nor
+   * for longer than the call it is taken for.
+   */
+  class Reference
+  {
+  public:
+    Reference( int handle );
+    ~Reference();
+
+    /// Release the session pinned so far and pin the one of a handle.
+    void reset( int handle );
+
+    Session* get() const { return m_pSession; }
+    Session* operator->() const { return m_pSession; }
+    operator bool() const { return m_pSession != 0; }
+
+  private:
+    Reference( const Reference& );
+    Reference& operator=( const Reference& );
+
+    void acquire( int handle );
+    void release();
+
+    Slot* m_pSlot;
+    Session* m_pSession;
+  };
+
+private:
+  struct Slot
+  {
+    Slot() : session( 0 ), readers( 0 ) {}
+
+    std::atomic < Session* > session;
+    std::atomic < int > readers;
+    // keeps the reader counts of neighbouring sessions on their own lines
+    char pad[ 64 - sizeof( std::atomic < Session* > ) - sizeof( std::atomic < int > ) ];
+  };
+
+  struct Node
+  {
+    Node( const SessionID& s, int h, Node* n )
+    : sessionID( s ), handle( h ), next( n ) {}
+
+    SessionID sessionID;
+    int handle;
+    Node* next;
+  };
+
+  SessionRegistry();
+  ~SessionRegistry();
+
+  Slot* slot( int handle ) const;
+  static size_t hash( const std::string& key );
+
+  std::atomic < Slot* > m_chunks[ MAX_CHUNKS ];
+  std::atomic < Node* > m_buckets[ BUCKETS ];
+  std::atomic < size_t > m_size;
+  int m_handles;
+  std::set < SessionID > m_sessionIDs;
+  mutable Mutex m_mutex;
+  // signalled by the last reader of a session being removed
+  Event m_released;
+};
+}
+
+#endif //FIX_SESSIONREGISTRY_H
@@ -29,6 +29,8 @@
 #include "FieldTypes.h"
 #include "MessageStore.h"
 #include "Log.h"
+#include "LogFilter.h"
+#include "GapQueue.h"
 #include "Mutex.h"
 
 namespace FIX
@@ -36,7 +38,6 @@ namespace FIX
 /// Maintains all of state for the Session class.
 class SessionState : public MessageStore, public Log
 {
-  typedef std::map < int, Message > Messages;
 
 public:
   SessionState()
@@ -44,7 +45,7 @@ public:
   m_sentLogout( false ), m_sentLogon( false ),
   m_sentReset( false ), m_receivedReset( false ),
   m_initiate( false ), m_logonTimeout( 10 ), 
-  m_logoutTimeout( 2 ), m_testRequest( 0 ),
+  m_logoutTimeout( 2 ), m_testRequest( 0 ), m_resendTarget( 0 ),
   m_pStore( 0 ), m_pLog( 0 ) {}
 
   bool enabled() const { return m_enabled; }
@@ -87,11 +88,19 @@ public:
   ResendRange resendRange () const { return m_resendRange; }
   void resendRange (int begin, int end)
   { m_resendRange = std::make_pair( begin, end ); }
+  int resendTarget() const { return m_resendTarget; }
+  void resendTarget( int value ) { m_resendTarget = value; }
 
   MessageStore* store() { return m_pStore; }
-  void store( MessageStore* pValue ) { m_pStore = pValue; }
+  void store( MessageStore* pValue )
+  {
+    m_pStore = pValue;
+    if( m_pStore ) m_creationTime = m_pStore->getCreationTime();
+  }
   Log* log() { return m_pLog ? m_pLog : &m_nullLog; }
   void log( Log* pValue ) { m_pLog = pValue; }
+  LogFilter& logFilter() { return m_logFilter; }
+  void logFilter( const LogFilter& value ) { m_logFilter = value; }
 
   void heartBtInt( const HeartBtInt& value )
   { m_heartBtInt = value; }
@@ -154,22 +163,16 @@ public:
   void logoutReason( const std::string& value ) 
   { Locker l( m_mutex ); m_logoutReason = value; }
 
-  void queue( int msgSeqNum, const Message& message )
-  { Locker l( m_mutex ); m_queue[ msgSeqNum ] = message; }
-  bool retrieve( int msgSeqNum, Message& message )
-  {
-    Locker l( m_mutex );
-    Messages::iterator i = m_queue.find( msgSeqNum );
-    if ( i != m_queue.end() )
-    {
-      message = i->second;
-      m_queue.erase( i );
-      return true;
-    }
-    return false;
-  }
+  bool queue( int msgSeqNum, const std::string& message )
+  { Locker l( m_mutex ); return m_queue.push( msgSeqNum, message ); }
+  bool retrieve( int msgSeqNum, std::string& message )
+  { Locker l( m_mutex ); return m_queue.pop( msgSeqNum, message ); }
   void clearQueue()
   { Locker l( m_mutex ); m_queue.clear(); }
+  size_t getMaxQueueSize() const
+  { Locker l( m_mutex ); return m_queue.getMaxSize(); }
+  void setMaxQueueSize( size_t value )
+  { Locker l( m_mutex ); m_queue.setMaxSize( value ); }
 
   bool set( int s, const std::string& m ) throw ( IOException )
   { Locker l( m_mutex ); return m_pStore->set( s, m ); }
@@ -189,22 +192,43 @@ public:
   void incrNextTargetMsgSeqNum() throw ( IOException )
   { Locker l( m_mutex ); m_pStore->incrNextTargetMsgSeqNum(); }
   UtcTimeStamp getCreationTime() const throw ( IOException )
-  { Locker l( m_mutex ); return m_pStore->getCreationTime(); }
+  { Locker l( m_mutex ); return m_creationTime; }
+  /// Creation time of the store, read without locking.
+  const UtcTimeStamp& creationTime() const { return m_creationTime; }
   void reset() throw ( IOException )
-  { Locker l( m_mutex ); m_pStore->reset(); }
+  {
+    Locker l( m_mutex );
+    m_pStore->reset();
+    m_creationTime = m_pStore->getCreationTime();
+  }
   void refresh() throw ( IOException )
-  { Locker l( m_mutex ); m_pStore->refresh(); }
+  {
+    Locker l( m_mutex );
+    m_pStore->refresh();
+    m_creationTime = m_pStore->getCreationTime();
+  }
 
   void clear()
   {  Locker l( m_mutex ); m_pLog->clear(); }
   void backup()
   {  Locker l( m_mutex ); m_pLog->backup(); }
   void onIncoming( const std::string& string )
-  {  Locker l( m_mutex ); m_pLog->onIncoming( string ); }
+  {
+    if( !m_logFilter.accept( string ) ) return;
+    if( m_pLog->isThreadSafe() ) { m_pLog->onIncoming( string ); return; }
+    Locker l( m_mutex ); m_pLog->onIncoming( string );
+  }
   void onOutgoing( const std::string& string )
-  {  Locker l( m_mutex ); m_pLog->onOutgoing( string ); }
+  {
+    if( !m_logFilter.accept( string ) ) return;
+    if( m_pLog->isThreadSafe() ) { m_pLog->onOutgoing( string ); return; }
+    Locker l( m_mutex ); m_pLog->onOutgoing( string );
+  }
   void onEvent( const std::string& string )
-  {  Locker l( m_mutex ); m_pLog->onEvent( string ); }
+  {
+    if( m_pLog->isThreadSafe() ) { m_pLog->onEvent( string ); return; }
+    Locker l( m_mutex ); m_pLog->onEvent( string );
+  }
 
 private:
   bool m_enabled;
@@ -218,14 +242,17 @@ private:
   int m_logoutTimeout;
   int m_testRequest;
   ResendRange m_resendRange;
+  int m_resendTarget;
   HeartBtInt m_heartBtInt;
   UtcTimeStamp m_lastSentTime;
   UtcTimeStamp m_lastReceivedTime;
+  UtcTimeStamp m_creationTime;
   std::string m_logoutReason;
-  Messages m_queue;
+  GapQueue m_queue;
   MessageStore* m_pStore;
   Log* m_pLog;
   NullLog m_nullLog;
+  LogFilter m_logFilter;
   mutable Mutex m_mutex;
 };
 }
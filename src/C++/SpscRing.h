@@ -0,0 +1,123 @@
+/* -*- C++ -*- */
+
+/****************************************************************************
+** Copyright (c) 2001-2014
+**
+** This file is part of the QuickFIX FIX Engine
+**
+** This file may be distributed under the terms of the quickfixengine.org
+** license as defined by quickfixengine.org and appearing in the file
+** LICENSE included in the packaging of this file.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** See http://www.quickfixengine.org/LICENSE for licensing information.
+**
+** Contact ask@quickfixengine.org if any conditions of this licensing are
+** not clear to you.
+**
+****************************************************************************/
+
+#ifndef FIX_SPSCRING_H
+#define FIX_SPSCRING_H
+
+#ifdef _MSC_VER
+#pragma warning( disable : 4503 4355 4786 4290 )
+#endif
+
+#include <atomic>
+#include <cstddef>
+
+namespace FIX
+{
+/**
+ * Bounded queue between exactly one producing and one consuming thread.
+ *
+ * Slots are filled and read in place, so objects are reused rather than
+ * copied in and out, and strings or messages keep their capacity once
+ * warmed up.  Each side caches the other side's position and only reads
+ * the shared one when the cached value says the ring is full or empty.
+ */
+template < typename T > class SpscRing
+{
+public:
+  /// Capacity is rounded up to a power of two.
+  SpscRing( size_t capacity )
+  : m_slots( 0 ), m_mask( 0 ), m_tail( 0 ), m_headCache( 0 ),
+    m_head( 0 ), m_tailCache( 0 )
+  {
+    size_t size = 1;
+    while ( size < capacity ) size <<= 1;
+    m_slots = new T[ size ];
+    m_mask = size - 1;
+  }
+
+  ~SpscRing() { delete [] m_slots; }
+
+  /// Producer: the slot to fill next, 0 while the ring is full.
+  T* claim()
+  {
+    size_t tail = m_tail.load( std::memory_order_relaxed );
+    if ( tail - m_headCache > m_mask )
+    {
+      m_headCache = m_head.load( std::memory_order_acquire );
+      if ( tail - m_headCache > m_mask )
+        return 0;
+    }
+    return &m_slots[ tail & m_mask ];
+  }
+
+  /// Producer: hand the claimed slot to the consumer.
+  void publish()
+  {
+    m_tail.store( m_tail.load( std::memory_order_relaxed ) + 1,
+                  std::memory_order_release );
+  }
+
+  /// Consumer: the oldest slot, 0 while the ring is empty.
+  T* front()
+  {
+    size_t head = m_head.load( std::memory_order_relaxed );
+    if ( head == m_tailCache )
+    {
+      m_tailCache = m_tail.load( std::memory_order_acquire );
+      if ( head == m_tailCache )
+        return 0;
+    }
+    return &m_slots[ head & m_mask ];
+  }
+
+  /// Consumer: give the front slot back to the producer.
+  void pop()
+  {
+    m_head.store( m_head.load( std::memory_order_relaxed ) + 1,
+                  std::memory_order_release );
+  }
+
+  size_t capacity() const { return m_mask + 1; }
+  size_t size() const
+  { return m_tail.load( std::memory_order_acquire )
+           - m_head.load( std::memory_order_acquire ); }
+  bool empty() const { return size() == 0; }
+  bool full() const { return size() > m_mask; }
+
+private:
+  SpscRing( const SpscRing& );
+  SpscRing& operator=( const SpscRing& );
+
+  T* m_slots;
+  size_t m_mask;
+  char m_pad1[ 64 ];
+  // written by the producer
+  std::atomic < size_t > m_tail;
+  size_t m_headCache;
+  char m_pad2[ 64 ];
+  // written by the consumer
+  std::atomic < size_t > m_head;
+  size_t m_tailCache;
+  char m_pad3[ 64 ];
+};
+}
+
+#endif //FIX_SPSCRING_H
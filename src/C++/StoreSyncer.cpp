@@ -0,0 +1,304 @@
+/****************************************************************************
+** Copyright (c) 2001-2014
+**
+** This file is part of the QuickFIX FIX Engine
+**
+** This file may be distributed under the terms of the quickfixengine.org
+** license as defined by quickfixengine.org and appearing in the file
+** LICENSE included in the packaging of this file.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** See http://www.quickfixengine.org/LICENSE for licensing information.
+**
+** Contact ask@quickfixengine.org if any conditions of this licensing are
+** not clear to you.
+**
+****************************************************************************/
+
+#ifdef _MSC_VER
+#include "stdafx.h"
+#else
+#include "config.h"
+#endif
+
+#include "StoreSyncer.h"
+#include "Session.h"
+#include <sstream>
+
+namespace FIX
+{
+namespace
+{
+const long DEFAULT_SYNC_INTERVAL = 1000;
+const long DEFAULT_COUNT_SYNC_INTERVAL = 1000000;
+const int DEFAULT_SYNC_COUNT = 100;
+const int DEFAULT_REPORT_INTERVAL = 60;
+const long long NO_DEADLINE = -1;
+
+void record( StoreSyncer::Statistics& statistics,
+             int batch, long latency, bool success )
+{
+  ++statistics.commits;
+  statistics.messages += batch;
+  if ( !success ) ++statistics.failures;
+  if ( batch > statistics.maxBatch ) statistics.maxBatch = batch;
+  statistics.lastLatency = latency;
+  if ( latency > statistics.maxLatency ) statistics.maxLatency = latency;
+  statistics.totalLatency += latency;
+}
+}
+
+SyncPolicy::SyncPolicy( const Dictionary& dict ) throw( ConfigError )
+: m_mode( FLUSH ), m_count( 0 ), m_interval( 0 ),
+  m_reportInterval( DEFAULT_REPORT_INTERVAL )
+{
+  if ( dict.has( STORE_SYNC_POLICY ) )
+  {
+    std::string mode = string_toUpper( dict.getString( STORE_SYNC_POLICY ) );
+    if ( mode == "NONE" ) m_mode = NONE;
+    else if ( mode == "FLUSH" ) m_mode = FLUSH;
+    else if ( mode == "COUNT" ) m_mode = COUNT;
+    else if ( mode == "INTERVAL" ) m_mode = INTERVAL;
+    else throw ConfigError( std::string( STORE_SYNC_POLICY )
+                            + " must be NONE, FLUSH, COUNT or INTERVAL" );
+  }
+
+  m_count = DEFAULT_SYNC_COUNT;
+  if ( dict.has( STORE_SYNC_COUNT ) )
+    m_count = dict.getInt( STORE_SYNC_COUNT );
+  if ( m_count <= 0 )
+    throw ConfigError( std::string( STORE_SYNC_COUNT ) + " must be positive" );
+
+  // in COUNT mode the interval bounds how long a quiet session
+  // can leave messages unsynced
+  m_interval = m_mode == COUNT
+    ? DEFAULT_COUNT_SYNC_INTERVAL : DEFAULT_SYNC_INTERVAL;
+  if ( dict.has( STORE_SYNC_INTERVAL ) )
+    m_interval = dict.getInt( STORE_SYNC_INTERVAL );
+  if ( m_interval <= 0 )
+    throw ConfigError( std::string( STORE_SYNC_INTERVAL ) + " must be positive" );
+
+  if ( dict.has( STORE_SYNC_REPORT_INTERVAL ) )
+    m_reportInterval = dict.getInt( STORE_SYNC_REPORT_INTERVAL );
+  if ( m_reportInterval < 0 )
+    throw ConfigError( std::string( STORE_SYNC_REPORT_INTERVAL ) + " must not be negative" );
+}
+
+StoreSyncer::StoreSyncer()
+: m_thread( 0 ), m_running( false ), m_stop( false )
+{
+}
+
+StoreSyncer::~StoreSyncer()
+{
+  if ( !m_running ) return;
+  m_stop = true;
+  m_event.signal();
+  thread_join( m_thread );
+}
+
+void StoreSyncer::add( Syncable* pSyncable, const SessionID& sessionID,
+                       const SyncPolicy& policy )
+{
+  if ( !policy.sync() ) return;
+
+  Locker l( m_mutex );
+  m_entries.erase( pSyncable );
+  m_entries.insert( std::make_pair( pSyncable, Entry( sessionID, policy ) ) );
+  start();
+}
+
+void StoreSyncer::remove( Syncable* pSyncable )
+{
+  Locker syncLock( m_syncMutex );
+
+  bool dirty = false;
+  {
+    Locker l( m_mutex );
+    Entries::iterator i = m_entries.find( pSyncable );
+    if ( i == m_entries.end() ) return;
+    dirty = i->second.dirty;
+    m_entries.erase( i );
+  }
+
+  if ( dirty ) pSyncable->sync();
+}
+
+void StoreSyncer::written( Syncable* pSyncable, bool message )
+{
+  bool wake = false;
+  {
+    Locker l( m_mutex );
+    Entries::iterator i = m_entries.find( pSyncable );
+    if ( i == m_entries.end() ) return;
+
+    Entry& entry = i->second;
+    if ( !entry.dirty )
+    {
+      entry.dirty = true;
+      entry.deadline = process_microseconds() + entry.policy.getInterval();
+      wake = true;
+    }
+    if ( message && ++entry.pending == entry.policy.getCount()
+         && entry.policy.getMode() == SyncPolicy::COUNT )
+      wake = true;
+  }
+
+  if ( wake ) m_event.signal();
+}
+
+bool StoreSyncer::getStatistics( const SessionID& sessionID,
+                                 Statistics& statistics ) const
+{
+  Locker l( m_mutex );
+  Entries::const_iterator i;
+  for ( i = m_entries.begin(); i != m_entries.end(); ++i )
+  {
+    if ( i->second.sessionID == sessionID )
+    {
+      statistics = i->second.statistics;
+      return true;
+    }
+  }
+  return false;
+}
+
+std::string StoreSyncer::describe( const Statistics& statistics )
+{
+  std::stringstream stream;
+  stream << statistics.commits << " commits of "
+         << statistics.messages << " messages";
+  if ( statistics.commits )
+  {
+    stream << ", batch avg " << statistics.messages / statistics.commits
+           << " max " << statistics.maxBatch
+           << ", latency avg " << statistics.totalLatency / statistics.commits
+           << " max " << statistics.maxLatency << " us";
+  }
+  if ( statistics.failures )
+    stream << ", " << statistics.failures << " failed";
+  return stream.str();
+}
+
+void StoreSyncer::start()
+{
+  if ( m_running ) return;
+  m_running = thread_spawn( &startThread, this, m_thread );
+}
+
+long long StoreSyncer::nextDeadline() const
+{
+  Locker l( m_mutex );
+  long long deadline = NO_DEADLINE;
+  Entries::const_iterator i;
+  for ( i = m_entries.begin(); i != m_entries.end(); ++i )
+  {
+    const Entry& entry = i->second;
+    if ( !entry.dirty ) continue;
+    if ( entry.policy.getMode() == SyncPolicy::COUNT
+         && entry.pending >= entry.policy.getCount() )
+      return 0;
+    if ( deadline == NO_DEADLINE || entry.deadline < deadline )
+      deadline = entry.deadline;
+  }
+  return deadline;
+}
+
+void StoreSyncer::commit( std::vector < Report > & reports )
+{
+  Locker syncLock( m_syncMutex );
+
+  std::vector < std::pair < Syncable*, int > > batch;
+  {
+    Locker l( m_mutex );
+    Entries::iterator i;
+    for ( i = m_entries.begin(); i != m_entries.end(); ++i )
+    {
+      if ( !i->second.dirty ) continue;
+      batch.push_back( std::make_pair( i->first, i->second.pending ) );
+      i->second.dirty = false;
+      i->second.pending = 0;
+    }
+  }
+  if ( batch.empty() ) return;
+
+  // every store with pending data is synced in the same round, latency
+  // is measured from the start of the round to the store's own sync
+  long long start = process_microseconds();
+  std::vector < std::pair < bool, long > > results;
+  std::vector < std::pair < Syncable*, int > > ::iterator j;
+  for ( j = batch.begin(); j != batch.end(); ++j )
+  {
+    bool success = j->first->sync();
+    results.push_back
+      ( std::make_pair( success, (long)( process_microseconds() - start ) ) );
+  }
+
+  Locker l( m_mutex );
+  long long now = process_microseconds();
+  for ( size_t k = 0; k < batch.size(); ++k )
+  {
+    Entries::iterator i = m_entries.find( batch[ k ].first );
+    if ( i == m_entries.end() ) continue;
+
+    Entry& entry = i->second;
+    bool success = results[ k ].first;
+    record( entry.statistics, batch[ k ].second, results[ k ].second, success );
+    record( entry.window, batch[ k ].second, results[ k ].second, success );
+
+    if ( !success )
+    {
+      reports.push_back( Report( entry.sessionID, "Store sync failed" ) );
+    }
+
+    int interval = entry.policy.getReportInterval();
+    if ( interval && now - entry.lastReport >= (long long)interval * 1000000 )
+    {
+      reports.push_back( Report( entry.sessionID,
+        "Store sync: " + describe( entry.window ) ) );
+      entry.window = Statistics();
+      entry.lastReport = now;
+    }
+  }
+}
+
+void StoreSyncer::report( const std::vector < Report > & reports )
+{
+  std::vector < Report > ::const_iterator i;
+  for ( i = reports.begin(); i != reports.end(); ++i )
+  {
+    std::shared_ptr<Session> pSession = Session::lookupSession( i->first );
+    if ( pSession ) pSession->getLog()->onEvent( i->second );
+  }
+}
+
+THREAD_PROC StoreSyncer::startThread( void* p )
+{
+  StoreSyncer* pSyncer = static_cast < StoreSyncer* > ( p );
+
+  while ( !pSyncer->m_stop )
+  {
+    long long deadline = pSyncer->nextDeadline();
+    long long now = process_microseconds();
+    if ( deadline == NO_DEADLINE )
+    {
+      pSyncer->m_event.wait( 1 );
+      continue;
+    }
+    if ( deadline > now )
+    {
+      pSyncer->m_event.wait( ( deadline - now ) / 1000000.0 );
+      continue;
+    }
+
+    std::vector < Report > reports;
+    pSyncer->commit( reports );
+    pSyncer->report( reports );
+  }
+
+  return 0;
+}
+
+} //namespace FIX
@@ -0,0 +1,163 @@
+/* -*- C++ -*- */
+
+/****************************************************************************
+** Copyright (c) 2001-2014
+**
+** This file is part of the QuickFIX FIX Engine
+**
+** This file may be distributed under the terms of the quickfixengine.org
+** license as defined by quickfixengine.org and appearing in the file
+** LICENSE included in the packaging of this file.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** See http://www.quickfixengine.org/LICENSE for licensing information.
+**
+** Contact ask@quickfixengine.org if any conditions of this licensing are
+** not clear to you.
+**
+****************************************************************************/
+
+#ifndef FIX_STORESYNCER_H
+#define FIX_STORESYNCER_H
+
+#ifdef _MSC_VER
+#pragma warning( disable : 4503 4355 4786 4290 )
+#endif
+
+#include "Dictionary.h"
+#include "Event.h"
+#include "Exceptions.h"
+#include "Mutex.h"
+#include "SessionID.h"
+#include "Utility.h"
+#include <map>
+#include <string>
+#include <vector>
+
+namespace FIX
+{
+/**
+ * How much durability a message store gives each stored message.
+ *
+ * NONE leaves data in process buffers, FLUSH hands every message to the
+ * operating system, COUNT and INTERVAL additionally have the StoreSyncer
+ * force data to disk every N messages or every T microseconds.
+ */
+class SyncPolicy
+{
+public:
+  enum Mode { NONE, FLUSH, COUNT, INTERVAL };
+
+  SyncPolicy( Mode mode = FLUSH, int count = 0, long interval = 0 )
+  : m_mode( mode ), m_count( count ), m_interval( interval ),
+    m_reportInterval( 0 ) {}
+
+  /// Read the StoreSync settings from a dictionary.
+  SyncPolicy( const Dictionary& dict ) throw( ConfigError );
+
+  Mode getMode() const { return m_mode; }
+  int getCount() const { return m_count; }
+  long getInterval() const { return m_interval; }
+  int getReportInterval() const { return m_reportInterval; }
+
+  bool flush() const { return m_mode != NONE; }
+  bool sync() const { return m_mode == COUNT || m_mode == INTERVAL; }
+
+private:
+  Mode m_mode;
+  int m_count;
+  long m_interval;
+  int m_reportInterval;
+};
+
+/// Storage the StoreSyncer can force to disk.
+class Syncable
+{
+public:
+  virtual ~Syncable() {}
+  /// Make everything written so far durable.
+  virtual bool sync() = 0;
+};
+
+/**
+ * Background group commit for message stores.
+ *
+ * Stores register with their SyncPolicy and report each message they
+ * write.  A single thread wakes when any store has reached its message
+ * count or interval and syncs every store with pending data at once, so
+ * sessions share the cost of each round of disk flushes.
+ */
+class StoreSyncer
+{
+public:
+  struct Statistics
+  {
+    Statistics()
+    : commits( 0 ), messages( 0 ), failures( 0 ), maxBatch( 0 ),
+      lastLatency( 0 ), maxLatency( 0 ), totalLatency( 0 ) {}
+
+    long commits;
+    long messages;
+    long failures;
+    int maxBatch;
+    long lastLatency;
+    long maxLatency;
+    long totalLatency;
+  };
+
+  static StoreSyncer& instance()
+  {
+    static StoreSyncer syncer;
+    return syncer;
+  }
+
+  void add( Syncable*, const SessionID&, const SyncPolicy& );
+  /// Sync anything pending for the store and stop tracking it.
+  void remove( Syncable* );
+  /// Record a write by the store, counting it if it stored a message.
+  void written( Syncable*, bool message = true );
+
+  bool getStatistics( const SessionID&, Statistics& ) const;
+  static std::string describe( const Statistics& );
+
+private:
+  struct Entry
+  {
+    Entry( const SessionID& s, const SyncPolicy& p )
+    : sessionID( s ), policy( p ), dirty( false ), pending( 0 ),
+      deadline( 0 ), lastReport( process_microseconds() ) {}
+
+    SessionID sessionID;
+    SyncPolicy policy;
+    bool dirty;
+    int pending;
+    long long deadline;
+    long long lastReport;
+    Statistics statistics;
+    Statistics window;
+  };
+  typedef std::map < Syncable*, Entry > Entries;
+  typedef std::pair < SessionID, std::string > Report;
+
+  StoreSyncer();
+  ~StoreSyncer();
+
+  void start();
+  void commit( std::vector < Report > & reports );
+  void report( const std::vector < Report > & reports );
+  long long nextDeadline() const;
+  static THREAD_PROC startThread( void* p );
+
+  Entries m_entries;
+  mutable Mutex m_mutex;
+  Mutex m_syncMutex;
+  Event m_event;
+  thread_id m_thread;
+  bool m_running;
+  bool m_stop;
+};
+}
+
+#endif //FIX_STORESYNCER_H
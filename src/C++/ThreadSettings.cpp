@@ -0,0 +1,136 @@
+/****************************************************************************
+** Copyright (c) 2001-2014
+**
+** This file is part of the QuickFIX FIX Engine
+**
+** This file may be distributed under the terms of the quickfixengine.org
+** license as defined by quickfixengine.org and appearing in the file
+** LICENSE included in the packaging of this file.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** See http://www.quickfixengine.org/LICENSE for licensing information.
+**
+** Contact ask@quickfixengine.org if any conditions of this licensing are
+** not clear to you.
+**
+****************************************************************************/
+
+#ifdef _MSC_VER
+#include "stdafx.h"
+#else
+#include "config.h"
+#endif
+
+#include "ThreadSettings.h"
+#include "FieldConvertors.h"
+#include "SessionSettings.h"
+#include <sstream>
+
+namespace FIX
+{
+ThreadSettings::ThreadSettings( const Dictionary& dict,
+                                const std::string& affinityKey,
+                                const std::string& nameKey,
+                                const std::string& priorityKey,
+                                const std::string& name )
+throw( ConfigError )
+: m_name( name ), m_priority( 0 )
+{
+  if( dict.has( affinityKey ) )
+    m_cpus = parseCpus( dict.getString( affinityKey ) );
+  if( dict.has( nameKey ) )
+    m_name = dict.getString( nameKey );
+  if( dict.has( priorityKey ) )
+    m_priority = dict.getInt( priorityKey );
+  if( m_priority < 0 || m_priority > 99 )
+    throw ConfigError( priorityKey + " must be between 0 and 99" );
+}
+
+void ThreadSettings::checkConnection( const Dictionary& dict, bool busyPoll )
+throw( ConfigError )
+{
+  if( busyPoll && dict.has( SOCKET_BUSY_POLL_CPU ) && dict.has( THREAD_AFFINITY ) )
+    throw ConfigError( std::string( SOCKET_BUSY_POLL_CPU ) + " and "
+                       + THREAD_AFFINITY + " can not both place a connection thread" );
+}
+
+std::set<int> ThreadSettings::parseCpus( const std::string& value )
+throw( ConfigError )
+{
+  std::set<int> cpus;
+  std::string::size_type start = 0;
+
+  while( start <= value.size() )
+  {
+    std::string::size_type end = value.find( ',', start );
+    if( end == std::string::npos ) end = value.size();
+    std::string range = string_strip( value.substr( start, end - start ) );
+    start = end + 1;
+    if( range.empty() ) continue;
+
+    int first = 0;
+    int last = 0;
+    std::string::size_type dash = range.find( '-' );
+    if( dash == std::string::npos )
+    {
+      if( !IntConvertor::convert( range, first ) )
+        throw ConfigError( "Invalid cpu list: " + value );
+      last = first;
+    }
+    else if( !IntConvertor::convert( string_strip( range.substr( 0, dash ) ), first )
+             || !IntConvertor::convert( string_strip( range.substr( dash + 1 ) ), last ) )
+    {
+      throw ConfigError( "Invalid cpu list: " + value );
+    }
+
+    if( first < 0 || last < first )
+      throw ConfigError( "Invalid cpu list: " + value );
+    for( int cpu = first; cpu <= last; ++cpu )
+      cpus.insert( cpu );
+  }
+
+  return cpus;
+}
+
+std::string ThreadSettings::apply( thread_id thread ) const
+{
+  std::stringstream stream;
+
+  if( !m_name.empty() )
+  {
+    if( thread_setname( thread, m_name ) )
+      stream << "named " << m_name;
+    else
+      stream << "not named " << m_name;
+  }
+  else
+    stream << "unnamed";
+
+  if( !m_cpus.empty() )
+  {
+    std::set<int>::const_iterator i;
+    std::stringstream cpus;
+    for( i = m_cpus.begin(); i != m_cpus.end(); ++i )
+      cpus << (i == m_cpus.begin() ? "" : ",") << *i;
+
+    if( thread_setaffinity( thread, m_cpus ) )
+      stream << ", pinned to cpus " << cpus.str();
+    else
+      stream << ", failed to pin to cpus " << cpus.str();
+  }
+  else
+    stream << ", affinity unchanged";
+
+  if( m_priority > 0 )
+  {
+    if( thread_setpriority( thread, m_priority ) )
+      stream << ", SCHED_FIFO priority " << m_priority;
+    else
+      stream << ", failed to set SCHED_FIFO priority " << m_priority;
+  }
+
+  return stream.str();
+}
+}
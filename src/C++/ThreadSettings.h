@@ -0,0 +1,81 @@
+/* -*- C++ -*- */
+
+/****************************************************************************
+** Copyright (c) 2001-2014
+**
+** This file is part of the QuickFIX FIX Engine
+**
+** This file may be distributed under the terms of the quickfixengine.org
+** license as defined by quickfixengine.org and appearing in the file
+** LICENSE included in the packaging of this file.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** See http://www.quickfixengine.org/LICENSE for licensing information.
+**
+** Contact ask@quickfixengine.org if any conditions of this licensing are
+** not clear to you.
+**
+****************************************************************************/
+
+#ifndef FIX_THREADSETTINGS_H
+#define FIX_THREADSETTINGS_H
+
+#ifdef _MSC_VER
+#pragma warning( disable : 4503 4355 4786 4290 )
+#endif
+
+#include "Dictionary.h"
+#include "Exceptions.h"
+#include "Utility.h"
+#include <set>
+#include <string>
+
+namespace FIX
+{
+/**
+ * Placement of an engine thread.
+ *
+ * Holds the cpus a thread may run on, the name it shows up under in
+ * tools such as top or perf, and an optional SCHED_FIFO priority.
+ */
+class ThreadSettings
+{
+public:
+  ThreadSettings( const std::string& name = "" )
+  : m_name( name ), m_priority( 0 ) {}
+
+  /// Read placement from a dictionary using the given keys.
+  ThreadSettings( const Dictionary& dict,
+                  const std::string& affinityKey,
+                  const std::string& nameKey,
+                  const std::string& priorityKey,
+                  const std::string& name = "" )
+  throw( ConfigError );
+
+  /// A busy polling connection pins itself to SocketBusyPollCpu, which
+  /// can not be combined with a ThreadAffinity for the same thread.
+  static void checkConnection( const Dictionary& dict, bool busyPoll )
+  throw( ConfigError );
+
+  /// Parse a cpu list such as "0,2,4-7".
+  static std::set<int> parseCpus( const std::string& value )
+  throw( ConfigError );
+
+  const std::set<int>& getCpus() const { return m_cpus; }
+  const std::string& getName() const { return m_name; }
+  int getPriority() const { return m_priority; }
+
+  /// Apply to a thread and describe the placement that took effect,
+  /// e.g. "named fix-http, pinned to cpus 2,3, SCHED_FIFO priority 10".
+  std::string apply( thread_id thread ) const;
+
+private:
+  std::set<int> m_cpus;
+  std::string m_name;
+  int m_priority;
+};
+}
+
+#endif //FIX_THREADSETTINGS_H
@@ -57,10 +57,15 @@ namespace FIX
 	void ThreadedSocketAcceptor::initialize() throw (ConfigError)
 	{
 		SessionFactory factory(m_application, m_messageStoreFactory, m_pLogFactory);
+		const Dictionary& defaults = SessionSettings::instance().get();
+		bool busyPoll = defaults.has(SOCKET_BUSY_POLL) && defaults.getBool(SOCKET_BUSY_POLL);
 		for (const auto& kv : SessionSettings::instance().getDictionaries())
 		{
 			if (kv.second.getString(CONNECTION_TYPE) == "acceptor")
 			{
+				// validate connection thread placement before any thread is spawned
+				ThreadSettings(kv.second, THREAD_AFFINITY, THREAD_NAME, THREAD_PRIORITY);
+				ThreadSettings::checkConnection(kv.second, busyPoll);
 				m_sessionIDs.insert(kv.first);
 				m_sessions[kv.first] = factory.create(kv.first, kv.second);
 			}
@@ -79,6 +84,32 @@ namespace FIX
 
 		if (settings.has(SOCKET_RECEIVE_BUFFER_SIZE))
 			m_SOCKET_RECEIVE_BUFFER_SIZE = settings.getInt(SOCKET_RECEIVE_BUFFER_SIZE);
+
+		if (settings.has(READ_BUFFER_MAX_SIZE))
+			m_READ_BUFFER_MAX_SIZE = settings.getInt(READ_BUFFER_MAX_SIZE);
+
+		if (settings.has(SOCKET_BUSY_POLL))
+			m_SOCKET_BUSY_POLL = settings.getBool(SOCKET_BUSY_POLL);
+
+		if (settings.has(SOCKET_BUSY_POLL_CPU))
+			m_SOCKET_BUSY_POLL_CPU = settings.getInt(SOCKET_BUSY_POLL_CPU);
+
+		if (settings.has(SOCKET_BUSY_POLL_USEC))
+			m_SOCKET_BUSY_POLL_USEC = settings.getInt(SOCKET_BUSY_POLL_USEC);
+
+		if (settings.has(SOCKET_IO_URING))
+			m_SOCKET_IO_URING = settings.getBool(SOCKET_IO_URING);
+
+		if (settings.has(SEND_QUEUE_SIZE))
+			m_SEND_QUEUE_SIZE = settings.getInt(SEND_QUEUE_SIZE);
+
+		if (settings.has(INBOUND_PIPELINE) && settings.getBool(INBOUND_PIPELINE))
+			m_pInboundPipeline.reset(new InboundPipeline(settings));
+
+		m_acceptorThread = ThreadSettings(settings, ENGINE_THREAD_AFFINITY,
+			ENGINE_THREAD_NAME, ENGINE_THREAD_PRIORITY, "fix-acceptor");
+		m_connectionThread = ThreadSettings(settings, THREAD_AFFINITY,
+			THREAD_NAME, THREAD_PRIORITY, "fix-connection");
 	}
 
 	void ThreadedSocketAcceptor::start() throw (ConfigError, RuntimeError)
@@ -94,7 +125,9 @@ namespace FIX
 			throw RuntimeError("Unable to create, bind, or listen to port ");
 		}
 
-		HttpServer::startGlobal();
+		HttpServer::startGlobal(m_pLog);
+		if (m_pInboundPipeline)
+			m_pInboundPipeline->start();
 		if (!thread_spawn(&startThread, this, m_threadid))
 			throw RuntimeError("Unable to spawn thread");
 	}
@@ -128,6 +161,8 @@ namespace FIX
 		if (m_threadid)
 			thread_join(m_threadid);
 		m_threadid = 0;
+		if (m_pInboundPipeline)
+			m_pInboundPipeline->stop();
 
 		std::vector<std::shared_ptr<Session>>::iterator session = enabledSessions.begin();
 		for (; session != enabledSessions.end(); ++session)
@@ -173,10 +208,14 @@ namespace FIX
 
 			threads = m_threads;
 			m_threads.clear();
+
+			// under the mutex, so no connection is deleted meanwhile
+			for (auto i = m_connections.begin(); i != m_connections.end(); ++i)
+				i->second->disconnect();
+			// and the acceptor thread waiting in accept
+			socket_close(m_socket);
 		}
 
-		for (auto i = threads.begin(); i != threads.end(); ++i)
-			socket_close(i->first);
 		for (auto i = threads.begin(); i != threads.end(); ++i)
 			thread_join(i->second);
 	}
@@ -187,6 +226,15 @@ namespace FIX
 		m_threads[s] = t;
 	}
 
+	void ThreadedSocketAcceptor::removeConnection(ThreadedSocketConnection* pConnection)
+	{
+		// the socket may already be reused by a newer connection
+		Locker l(m_mutex);
+		auto i = m_connections.find(pConnection->getSocket());
+		if (i != m_connections.end() && i->second == pConnection)
+			m_connections.erase(i);
+	}
+
 	void ThreadedSocketAcceptor::removeThread(int s)
 	{
 		Locker l(m_mutex);
@@ -200,6 +248,8 @@ namespace FIX
 
 	void ThreadedSocketAcceptor::socketAccept()
 	{
+		m_pLog->onEvent("Acceptor thread " + m_acceptorThread.apply(thread_self()));
+
 		int socket = 0;
 		while ((!isStopped() && (socket = socket_accept(m_socket)) >= 0))
 		{
@@ -212,6 +262,16 @@ namespace FIX
 
 			ThreadedSocketConnection * pConnection =
 				new ThreadedSocketConnection(socket, m_pLog);
+			if (m_SOCKET_BUSY_POLL)
+				pConnection->setBusyPoll(true, m_SOCKET_BUSY_POLL_CPU, m_SOCKET_BUSY_POLL_USEC);
+			if (m_SEND_QUEUE_SIZE)
+				pConnection->setSendQueueSize(m_SEND_QUEUE_SIZE);
+			if (m_READ_BUFFER_MAX_SIZE)
+				pConnection->setMaxReadSize(m_READ_BUFFER_MAX_SIZE);
+			if (m_SOCKET_IO_URING)
+				pConnection->setIoUring(true);
+			if (m_pInboundPipeline)
+				pConnection->setInboundPipeline(m_pInboundPipeline.get());
 
 			ConnectionThreadInfo* info = new ConnectionThreadInfo(this, pConnection);
 
@@ -222,7 +282,14 @@ namespace FIX
 
 				thread_id thread;
 				if (!thread_spawn(&socketConnectionThread, info, thread))
+				{
 					delete info;
+					pConnection->disconnect();
+					delete pConnection;
+					continue;
+				}
+				m_pLog->onEvent("Connection thread " + m_connectionThread.apply(thread));
+				m_connections[socket] = pConnection;
 				addThread(socket, thread);
 			}
 		}
@@ -240,9 +307,11 @@ namespace FIX
 		delete info;
 
 		while (pConnection->read()) {}
+		int socket = pConnection->getSocket();
+		pAcceptor->removeConnection(pConnection);
 		delete pConnection;
 		if (!pAcceptor->isStopped())
-			pAcceptor->removeThread(pConnection->getSocket());
+			pAcceptor->removeThread(socket);
 		return 0;
 	}
 }
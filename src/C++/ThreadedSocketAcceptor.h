@@ -34,6 +34,8 @@
 #include "Responder.h"
 #include "SessionSettings.h"
 #include "Exceptions.h"
+#include "ThreadSettings.h"
+#include "InboundPipeline.h"
 #include <map>
 #include <string>
 namespace FIX
@@ -90,6 +92,7 @@ namespace FIX
 
 		void addThread(int s, thread_id t);
 		void removeThread(int s);
+		void removeConnection(ThreadedSocketConnection* pConnection);
 
 		static THREAD_PROC startThread(void* p);
 		static THREAD_PROC socketConnectionThread(void* p);
@@ -100,6 +103,7 @@ namespace FIX
 
 		thread_id m_threadid{ 0 };
 		std::map < int, thread_id > m_threads;
+		std::map < int, ThreadedSocketConnection* > m_connections;
 		Sessions m_sessions;
 		SessionIDs m_sessionIDs;
 		Application& m_application;
@@ -112,6 +116,15 @@ namespace FIX
 		bool m_SOCKET_NODELAY{ false };
 		int m_SOCKET_SEND_BUFFER_SIZE{ 0 };
 		int m_SOCKET_RECEIVE_BUFFER_SIZE{ 0 };
+		int m_READ_BUFFER_MAX_SIZE{ 0 };
+		bool m_SOCKET_BUSY_POLL{ false };
+		int m_SOCKET_BUSY_POLL_CPU{ -1 };
+		int m_SOCKET_BUSY_POLL_USEC{ 0 };
+		bool m_SOCKET_IO_URING{ false };
+		int m_SEND_QUEUE_SIZE{ 0 };
+		ThreadSettings m_acceptorThread{ "fix-acceptor" };
+		ThreadSettings m_connectionThread{ "fix-connection" };
+		std::unique_ptr<InboundPipeline> m_pInboundPipeline;
 	};
 }
 
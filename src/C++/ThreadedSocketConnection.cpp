@@ -27,96 +27,487 @@
 #include "ThreadedSocketAcceptor.h"
 #include "ThreadedSocketInitiator.h"
 #include "Session.h"
+#include "ThreadSettings.h"
 #include "Utility.h"
+#ifdef HAVE_LIBURING
+#include "IoUring.h"
+#endif
+#include <algorithm>
 
 namespace FIX
 {
 	ThreadedSocketConnection::ThreadedSocketConnection
 	(int s, Log* pLog)
-		: m_socket(s), m_pLog(pLog),m_pSession(0),
-		m_disconnect(false)
+		: m_socket(s), m_readSize(DEFAULT_READ_SIZE),
+		m_maxReadSize(DEFAULT_MAX_READ_SIZE), m_lastReceived(0),
+		m_pLog(pLog), m_pSession(0), m_handle(-1), m_disconnect(false),
+		m_sendOffset(0), m_sendQueueSize(DEFAULT_SEND_QUEUE_SIZE),
+		m_wakeup(socket_createpair()),
+		m_ioUring(false), m_pIoUring(0), m_sendInFlight(0),
+		m_busyPoll(false), m_busyPollCpu(-1),
+		m_pinned(false), m_timerDue(false), m_timerDeadline(0),
+		m_pPipeline(0), m_pLane(0), m_backlog(false), m_decodedDue(false)
 	{
-		FD_ZERO(&m_fds);
-		FD_SET(m_socket, &m_fds);
+		socket_setnonblock(m_socket);
+		if (m_wakeup.first >= 0)
+		{
+			socket_setnonblock(m_wakeup.first);
+			socket_setnonblock(m_wakeup.second);
+		}
+		else
+			m_pLog->onEvent("Unable to create wakeup socket pair, polling instead");
 	}
 
 	ThreadedSocketConnection::ThreadedSocketConnection
 	(const SessionID& sessionID, int s,
 		const std::string& address, short port,
 		Log* pLog)
-		: m_socket(s), m_address(address), m_port(port),
+		: m_socket(s), m_readSize(DEFAULT_READ_SIZE),
+		m_maxReadSize(DEFAULT_MAX_READ_SIZE), m_lastReceived(0),
+		m_address(address), m_port(port),
 		m_pLog(pLog),
-		m_pSession(Session::lookupSession(sessionID)),
-		m_disconnect(false)
+		m_pSession(0), m_handle(-1),
+		m_disconnect(false),
+		m_sendOffset(0), m_sendQueueSize(DEFAULT_SEND_QUEUE_SIZE),
+		m_wakeup(socket_createpair()),
+		m_ioUring(false), m_pIoUring(0), m_sendInFlight(0),
+		m_busyPoll(false), m_busyPollCpu(-1),
+		m_pinned(false), m_timerDue(false), m_timerDeadline(0),
+		m_pPipeline(0), m_pLane(0), m_backlog(false), m_decodedDue(false)
 	{
-		FD_ZERO(&m_fds);
-		FD_SET(m_socket, &m_fds);
-		if (m_pSession) m_pSession->setResponder(this);
+		if (m_wakeup.first >= 0)
+		{
+			socket_setnonblock(m_wakeup.first);
+			socket_setnonblock(m_wakeup.second);
+		}
+		else
+			m_pLog->onEvent("Unable to create wakeup socket pair, polling instead");
+		std::shared_ptr<Session> pSession = Session::lookupSession(sessionID);
+		if (pSession)
+		{
+			m_pSession = pSession.get();
+			m_handle = pSession->getHandle();
+			m_pSession->setResponder(this);
+		}
 	}
 
 	ThreadedSocketConnection::~ThreadedSocketConnection()
 	{
+		// before the responder goes, rejects from fromApp are still sent,
+		// unless the session is already gone
+		SessionRegistry::Reference pSession(m_handle);
+		if (pSession.get() != m_pSession)
+			m_pSession = 0;
+		if (m_pLane)
+			m_pPipeline->remove(m_pLane);
 		if (m_pSession)
 		{
 			m_pSession->setResponder(0);
 		}
+#ifdef HAVE_LIBURING
+		delete m_pIoUring;
+#endif
+		if (m_wakeup.first >= 0)
+		{
+			socket_close(m_wakeup.first);
+			socket_close(m_wakeup.second);
+		}
+	}
+
+	std::shared_ptr<Session> ThreadedSocketConnection::getSession() const
+	{
+		// the connection itself only pins its session for a read at a
+		// time, callers get a pointer that keeps it alive
+		return m_pSession ? Session::lookupSession(m_handle) : nullptr;
 	}
 
 	bool ThreadedSocketConnection::send(const std::string& msg)
 	{
-		int totalSent = 0;
-		while (totalSent < (int)msg.length())
+		Locker l(m_sendMutex);
+
+		// Write straight to the socket unless earlier data is still
+		// waiting, in which case the message must queue up behind it.
+		size_t totalSent = 0;
+		size_t queued = m_sendQueue.size() - m_sendOffset;
+		if (!queued && !m_pIoUring)
 		{
-			ssize_t sent = socket_send(m_socket, msg.c_str() + totalSent, msg.length());
-			if (sent < 0) return false;
-			totalSent += sent;
+			while (totalSent < msg.length())
+			{
+				ssize_t sent = socket_send(m_socket, msg.c_str() + totalSent, msg.length() - totalSent);
+				if (sent < 0)
+				{
+					if (socket_wouldblock()) break;
+					return false;
+				}
+				totalSent += sent;
+			}
+			if (totalSent == msg.length())
+				return true;
+		}
+
+		size_t remaining = msg.length() - totalSent;
+		if (queued + m_sendInFlight + remaining > m_sendQueueSize)
+		{
+			Log* pLog = m_pSession ? m_pSession->getLog() : m_pLog;
+			pLog->onEvent("Send queue limit of " + IntConvertor::convert((int)m_sendQueueSize)
+				+ " bytes exceeded");
+			// Let the reading thread see the connection drop and disconnect
+			// the session, queued messages are resent after the next logon.
+			shutdown(m_socket, 2);
+			return false;
+		}
+
+		if (!queued)
+		{
+			m_sendQueue.clear();
+			m_sendOffset = 0;
+		}
+		m_sendQueue.append(msg, totalSent, remaining);
+		if (!queued)
+			signalWakeup();
+		return true;
+	}
+
+	bool ThreadedSocketConnection::flushSendQueue()
+	{
+		Locker l(m_sendMutex);
+
+		while (m_sendOffset < m_sendQueue.length())
+		{
+			ssize_t sent = socket_send(m_socket, m_sendQueue.c_str() + m_sendOffset,
+				m_sendQueue.length() - m_sendOffset);
+			if (sent < 0)
+			{
+				if (socket_wouldblock()) break;
+				return false;
+			}
+			m_sendOffset += sent;
+		}
+
+		// Sent bytes are only dropped once they outweigh the rest, so a
+		// partial write does not move the whole queue each time
+		if (m_sendOffset == m_sendQueue.length())
+		{
+			m_sendQueue.clear();
+			m_sendOffset = 0;
+		}
+		else if (m_sendOffset > m_sendQueue.length() - m_sendOffset)
+		{
+			m_sendQueue.erase(0, m_sendOffset);
+			m_sendOffset = 0;
 		}
 		return true;
 	}
 
+	size_t ThreadedSocketConnection::getQueueDepth()
+	{
+		Locker l(m_sendMutex);
+		return m_sendQueue.size() - m_sendOffset + m_sendInFlight;
+	}
+
 	bool ThreadedSocketConnection::connect()
 	{
-		return socket_connect(getSocket(), m_address.c_str(), m_port) >= 0;
+		if (socket_connect(getSocket(), m_address.c_str(), m_port) < 0)
+			return false;
+		socket_setnonblock(m_socket);
+		return true;
 	}
 
 	void ThreadedSocketConnection::disconnect()
 	{
-		m_disconnect = true;
+		// closing the socket does not wake a select on it, so the
+		// connection thread is told through the wakeup socket as well
+		if (m_disconnect.exchange(true))
+			return;
 		socket_close(m_socket);
+		signalWakeup();
+	}
+
+	void ThreadedSocketConnection::setBusyPoll(bool value, int cpu, int usec)
+	{
+		m_busyPoll = value;
+		m_busyPollCpu = cpu;
+		if (m_busyPoll && usec > 0)
+			socket_setbusypoll(m_socket, usec);
+	}
+
+	void ThreadedSocketConnection::pinThread()
+	{
+		m_pinned = true;
+		if (m_busyPollCpu < 0)
+			return;
+
+		Log* pLog = m_pSession ? m_pSession->getLog() : m_pLog;
+		if (thread_setaffinity(m_busyPollCpu))
+			pLog->onEvent("Busy polling connection pinned to cpu "
+				+ IntConvertor::convert(m_busyPollCpu));
+		else
+			pLog->onEvent("Unable to pin busy polling connection to cpu "
+				+ IntConvertor::convert(m_busyPollCpu));
+	}
+
+	void ThreadedSocketConnection::busyPollRead()
+		throw(SocketRecvFailed)
+	{
+		if (!m_pinned)
+			pinThread();
+
+		ssize_t size = receive(MSG_DONTWAIT);
+		if (size == 0 || (size < 0 && !socket_wouldblock()))
+		{
+			throw SocketRecvFailed(size);
+		}
+		if (size < 0 && m_readSize > DEFAULT_READ_SIZE
+			&& ::time(0) - m_lastReceived >= 1)
+		{
+			shrinkReadSize();
+		}
+	}
+
+	ssize_t ThreadedSocketConnection::receive(int flags)
+	{
+		ssize_t size = recv(m_socket, m_parser.prepareStream(m_readSize), m_readSize, flags);
+		m_parser.commitStream(size > 0 ? size : 0);
+		if (size <= 0)
+			return size;
+
+		m_lastReceived = ::time(0);
+		if ((size_t)size == m_readSize && m_readSize < m_maxReadSize)
+		{
+			// The read was filled, so more is likely waiting. Size the
+			// next one from what the socket reports, at least doubling.
+			size_t next = m_readSize * 2;
+			int available = 0;
+			if (socket_fionread(m_socket, available) && (size_t)available > next)
+				next = available;
+			m_readSize = std::min(next, m_maxReadSize);
+		}
+		return size;
+	}
+
+	void ThreadedSocketConnection::shrinkReadSize()
+	{
+		m_readSize = DEFAULT_READ_SIZE;
+		m_parser.shrinkStream();
+	}
+
+	void ThreadedSocketConnection::wakeup()
+	{
+		// Called from the session timer thread when a session deadline
+		// is due, the session itself is only called from this thread
+		m_timerDue = true;
+		if (!m_busyPoll)
+			signalWakeup();
+	}
+
+	void ThreadedSocketConnection::setInboundPipeline(InboundPipeline* pPipeline)
+	{
+		m_pPipeline = pPipeline;
+		if (m_pPipeline && m_pSession)
+			m_pLane = m_pPipeline->add(m_pSession, this);
+	}
+
+	void ThreadedSocketConnection::onDecoded()
+	{
+		// Called from the pipeline threads, one wakeup covers everything
+		// decoded until this thread next looks
+		if (!m_decodedDue.exchange(true) && !m_busyPoll)
+			signalWakeup();
+	}
+
+	void ThreadedSocketConnection::signalWakeup()
+	{
+		if (m_wakeup.second >= 0)
+			socket_send(m_wakeup.second, "w", 1);
+	}
+
+	void ThreadedSocketConnection::nextTimer()
+	{
+		bool due = m_timerDue.exchange(false);
+
+		// A pinned busy polling thread checks the deadline itself, the
+		// timer thread may not be scheduled while it spins and only
+		// backs it up
+		time_t now = 0;
+		if (m_busyPoll)
+		{
+			now = ::time(0);
+			due = due || now >= m_timerDeadline;
+		}
+
+		if (due && m_pSession)
+		{
+			m_pSession->next();
+			if (m_busyPoll)
+				m_timerDeadline = now + m_pSession->getTimeout();
+		}
+	}
+
+	void ThreadedSocketConnection::openIoUring()
+	{
+		Log* pLog = m_pSession ? m_pSession->getLog() : m_pLog;
+#ifdef HAVE_LIBURING
+		IoUring* pIoUring = new IoUring;
+		std::string error;
+		if (pIoUring->open(m_socket, m_wakeup.first, error))
+		{
+			Locker l(m_sendMutex);
+			m_pIoUring = pIoUring;
+			pLog->onEvent("Using io_uring for connection");
+			return;
+		}
+		delete pIoUring;
+		pLog->onEvent("Unable to use io_uring (" + error + "), falling back to select");
+#else
+		pLog->onEvent("Built without io_uring support, falling back to select");
+#endif
+		m_ioUring = false;
+	}
+
+	void ThreadedSocketConnection::ioUringRead()
+		throw(SocketRecvFailed, SocketSendFailed)
+	{
+#ifdef HAVE_LIBURING
+		{
+			Locker l(m_sendMutex);
+			if (!m_pIoUring->isSending() && m_sendQueue.size() > m_sendOffset)
+			{
+				m_sendQueue.erase(0, m_sendOffset);
+				m_sendOffset = 0;
+				m_pIoUring->send(m_sendQueue);
+				m_sendInFlight = m_pIoUring->getSendPending();
+			}
+		}
+
+		m_pIoUring->wait(m_parser, 1000000);
+
+		{
+			Locker l(m_sendMutex);
+			m_sendInFlight = m_pIoUring->getSendPending();
+
+			// the ring still owns the bytes of any send in flight, so it
+			// is only given up once those have completed
+			if (m_pIoUring->isRecvUnsupported() && !m_pIoUring->isSending())
+			{
+				delete m_pIoUring;
+				m_pIoUring = 0;
+				m_ioUring = false;
+				(m_pSession ? m_pSession->getLog() : m_pLog)->onEvent(
+					"io_uring multishot receive rejected, falling back to select");
+			}
+		}
+#endif
 	}
 
 	bool ThreadedSocketConnection::read()
 	{
-		struct timeval timeout = { 1, 0 };
-		fd_set readset = m_fds;
+		if (m_disconnect)
+			return false;
+
+		SessionRegistry::Reference pSession(m_handle);
+		if (pSession.get() != m_pSession)
+		{
+			m_pLog->onEvent("Session destroyed, closing its connection");
+			m_pSession = 0;
+			disconnect();
+			return false;
+		}
 
 		try
 		{
-			// Wait for input (1 second timeout)
-			int result = select(1 + m_socket, &readset, 0, 0, &timeout);
+			bool writable = true;
+
+			// io_uring watches the wakeup socket as well
+			if (m_ioUring && !m_pIoUring && m_wakeup.first >= 0)
+				openIoUring();
 
-			if (result > 0) // Something to read
+			if (m_pIoUring)
 			{
-				ssize_t size = recv(m_socket, m_buffer, sizeof(m_buffer), 0);
-				if (size <= 0)
-				{
-					throw SocketRecvFailed(size);
-				}
-				m_parser.addToStream(m_buffer, size);
+				ioUringRead();
 			}
-			else if (result == 0 && m_pSession) // Timeout
+			else if (m_busyPoll)
 			{
-				m_pSession->next();
+				if (getQueueDepth() && !flushSendQueue())
+					throw SocketSendFailed();
+				if (!m_backlog)
+					busyPollRead();
 			}
-			else if (result < 0) // Error
+			else
 			{
-				throw SocketRecvFailed(result);
+				writable = false;
+
+				// Session deadlines arrive as wakeups, so only wait with a
+				// timeout to shrink an enlarged read buffer
+				struct timeval timeout = { 1, 0 };
+				struct timeval* pTimeout = m_readSize > DEFAULT_READ_SIZE ? &timeout : 0;
+				if (m_wakeup.first < 0)
+				{
+					// nothing can wake the select up, so poll for queued
+					// output and session deadlines instead
+					timeout.tv_sec = 0;
+					timeout.tv_usec = 100000;
+					pTimeout = &timeout;
+				}
+				// a resend with pages left waits for the socket to take more
+				bool resending = m_pSession && m_pSession->isResending();
+				fd_set readset;
+				fd_set writeset;
+				FD_ZERO(&readset);
+				FD_ZERO(&writeset);
+				// Stop reading while the pipeline is full, so the peer is
+				// held back by TCP rather than by our memory
+				if (!m_backlog)
+					FD_SET(m_socket, &readset);
+				if (m_wakeup.first >= 0)
+					FD_SET(m_wakeup.first, &readset);
+				if (getQueueDepth() || resending)
+					FD_SET(m_socket, &writeset);
+
+				// Wait for input, queued output or a wakeup from send or the session timer
+				int result = select(1 + std::max(m_socket, m_wakeup.first), &readset, &writeset, 0, pTimeout);
+
+				if (result > 0)
+				{
+					if (m_wakeup.first >= 0 && FD_ISSET(m_wakeup.first, &readset))
+					{
+						char wakeup[64];
+						recv(m_wakeup.first, wakeup, sizeof(wakeup), 0);
+					}
+					writable = FD_ISSET(m_socket, &writeset) != 0;
+					if (writable && !flushSendQueue())
+					{
+						throw SocketSendFailed();
+					}
+					if (FD_ISSET(m_socket, &readset)) // Something to read
+					{
+						ssize_t size = receive(0);
+						if (size == 0 || (size < 0 && !socket_wouldblock()))
+						{
+							throw SocketRecvFailed(size);
+						}
+					}
+				}
+				else if (result == 0) // Timeout
+				{
+					if (m_readSize > DEFAULT_READ_SIZE)
+						shrinkReadSize();
+				}
+				else if (result < 0) // Error
+				{
+					throw SocketRecvFailed(result);
+				}
 			}
 
-			processStream();
+			processStream(pSession);
+			nextTimer();
+
+			// Resend a page at a time once earlier output has drained, so
+			// inbound messages are handled between pages
+			if (m_pSession && writable && !getQueueDepth() && m_pSession->isResending())
+				m_pSession->nextResend();
 			return true;
 		}
-		catch (SocketRecvFailed& e)
+		catch (SocketException& e)
 		{
 			if (m_disconnect)
 				return false;
@@ -146,14 +537,20 @@ namespace FIX
 		return true;
 	}
 
-	void ThreadedSocketConnection::processStream()
+	void ThreadedSocketConnection::processStream(SessionRegistry::Reference& pin)
 	{
+		if (m_pLane)
+		{
+			processPipeline();
+			return;
+		}
+
 		std::string msg;
 		while (readMessage(msg))
 		{
 			if (!m_pSession)
 			{
-				if (!setSession(msg))
+				if (!setSession(msg, pin))
 				{
 					disconnect();
 					continue;
@@ -171,19 +568,91 @@ namespace FIX
 					return;
 				}
 			}
+
+			// an acceptor only has its session from the first message on
+			if (m_pLane)
+			{
+				processPipeline();
+				return;
+			}
+		}
+	}
+
+	void ThreadedSocketConnection::processPipeline()
+	{
+		m_decodedDue = false;
+
+		// Rejects for what fromApp threw, sent from here like the rest
+		m_pLane->reject();
+
+		// Frame what fits, bytes left over stay in the parser until the
+		// decode thread has made room
+		std::string* pFrame;
+		while ((pFrame = m_pLane->nextFrame()) && readMessage(*pFrame))
+			m_pLane->pushFrame();
+		m_backlog = !pFrame;
+
+		// Session logic stays on this thread, in the order framed
+		InboundLane::Decoded* pDecoded;
+		while (!m_pLane->hold() && (pDecoded = m_pLane->nextDecoded()))
+		{
+			try
+			{
+				if (pDecoded->valid)
+					m_pSession->next(pDecoded->string, pDecoded->message, UtcTimeStamp());
+				else
+					m_pSession->next(pDecoded->string, UtcTimeStamp());
+			}
+			catch (InvalidMessage&)
+			{
+				if (!m_pSession->isLoggedOn())
+				{
+					m_pLane->popDecoded();
+					disconnect();
+					return;
+				}
+			}
+			m_pLane->popDecoded();
 		}
 	}
 
-	bool ThreadedSocketConnection::setSession(const std::string& msg)
+	bool ThreadedSocketConnection::setSession(const std::string& msg,
+		SessionRegistry::Reference& pin)
 	{
-		m_pSession = Session::lookupSession(msg, true);
+		std::shared_ptr<Session> pSession = Session::lookupSession(msg, true);
+		m_pSession = pSession.get();
 		if (!m_pSession)
 		{
 			m_pLog->onEvent("Session not found for incoming message: " + msg);
 			m_pLog->onIncoming(msg);
 			return false;
 		}
+		// the read found no session to pin, the rest of it runs with
+		// this one pinned
+		m_handle = pSession->getHandle();
+		pin.reset(m_handle);
 		m_pSession->setResponder(this);
+		if (m_pPipeline)
+			m_pLane = m_pPipeline->add(m_pSession, this);
+
+		// the session is only known once its logon arrives, so session
+		// specific settings replace the acceptor wide ones here
+		const Dictionary& settings =
+			SessionSettings::instance().get(m_pSession->getSessionID());
+		if (settings.has(SEND_QUEUE_SIZE))
+		{
+			Locker l(m_sendMutex);
+			m_sendQueueSize = settings.getInt(SEND_QUEUE_SIZE);
+		}
+		ThreadSettings threadSettings(settings,
+			THREAD_AFFINITY, THREAD_NAME, THREAD_PRIORITY,
+			"fix-" + m_pSession->getSessionID().getTargetCompID().getValue());
+		// busy polling has already pinned the thread, which the session's
+		// settings are checked not to undo
+		std::string placement = threadSettings.apply(thread_self());
+		if (m_busyPoll && m_busyPollCpu >= 0)
+			placement += ", busy polling on cpu " + IntConvertor::convert(m_busyPollCpu);
+		m_pSession->getLog()->onEvent("Connection thread " + placement);
 		return true;
 	}
 } // namespace FIX
@@ -28,9 +28,14 @@
 
 #include "Parser.h"
 #include "Responder.h"
+#include "InboundPipeline.h"
 #include "SessionID.h"
+#include "SessionRegistry.h"
+#include "Mutex.h"
 #include <set>
 #include <map>
+#include <atomic>
+#include <memory>
 
 namespace FIX
 {
@@ -39,33 +44,75 @@ class ThreadedSocketInitiator;
 class Session;
 class Application;
 class Log;
+class IoUring;
 
 /// Encapsulates a socket file descriptor (multi-threaded).
-class ThreadedSocketConnection : Responder
+class ThreadedSocketConnection : Responder, InboundSource
 {
 public:
   typedef std::set<SessionID> Sessions;
 
+  static const size_t DEFAULT_SEND_QUEUE_SIZE = 16 * 1024 * 1024;
+  static const size_t DEFAULT_READ_SIZE = BUFSIZ;
+  static const size_t DEFAULT_MAX_READ_SIZE = 1024 * 1024;
+
   ThreadedSocketConnection( int s, Log* pLog );
   ThreadedSocketConnection( const SessionID&, int s, 
                             const std::string& address, short port, 
                             Log* pLog );
   virtual ~ThreadedSocketConnection() ;
 
-  std::shared_ptr<Session> getSession() const { return m_pSession; }
+  std::shared_ptr<Session> getSession() const;
   int getSocket() const { return m_socket; }
   bool connect();
   void disconnect();
   bool read();
 
+  /// Spin on non-blocking reads instead of waiting in select.
+  void setBusyPoll( bool value, int cpu = -1, int usec = 0 );
+  bool getBusyPoll() const { return m_busyPoll; }
+
+  /// Limit on bytes held back while the socket is not writable.
+  void setSendQueueSize( size_t value ) { m_sendQueueSize = value; }
+  size_t getSendQueueSize() const { return m_sendQueueSize; }
+  size_t getQueueDepth();
+  void wakeup();
+
+  /// Largest single read, reads grow towards it while data keeps arriving.
+  void setMaxReadSize( size_t value )
+  { m_maxReadSize = value > DEFAULT_READ_SIZE ? value : DEFAULT_READ_SIZE; }
+  size_t getMaxReadSize() const { return m_maxReadSize; }
+
+  /// Use io_uring for this connection when built with liburing and
+  /// supported by the kernel, select otherwise.
+  void setIoUring( bool value ) { m_ioUring = value; }
+  bool getIoUring() const { return m_ioUring; }
+
+  /// Hand decoding and application callbacks of the session to a
+  /// pipeline, which must outlive the connection.
+  void setInboundPipeline( InboundPipeline* pPipeline );
+
 private:
+  void busyPollRead() throw( SocketRecvFailed );
+  void pinThread();
+  void openIoUring();
+  void ioUringRead() throw( SocketRecvFailed, SocketSendFailed );
+  void nextTimer();
+  ssize_t receive( int flags );
+  void shrinkReadSize();
   bool readMessage( std::string& msg ) throw( SocketRecvFailed );
-  void processStream();
+  void processStream( SessionRegistry::Reference& pin );
+  void processPipeline();
+  void onDecoded();
+  void signalWakeup();
   bool send( const std::string& );
-  bool setSession( const std::string& msg );
+  bool flushSendQueue();
+  bool setSession( const std::string& msg, SessionRegistry::Reference& pin );
 
   int m_socket;
-  char m_buffer[BUFSIZ];
+  size_t m_readSize;
+  size_t m_maxReadSize;
+  time_t m_lastReceived;
 
   std::string m_address;
   int m_port;
@@ -73,9 +120,32 @@ private:
   Log* m_pLog;
   Parser m_parser;
   Sessions m_sessions;
-  std::shared_ptr<Session> m_pSession;
-  bool m_disconnect;
-  fd_set m_fds;
+  // pinned through its registry handle for one read at a time only, so
+  // destroying the session does not wait for the connection to go
+  Session* m_pSession;
+  int m_handle;
+  std::atomic<bool> m_disconnect;
+
+  Mutex m_sendMutex;
+  std::string m_sendQueue;
+  size_t m_sendOffset;
+  size_t m_sendQueueSize;
+  std::pair<int, int> m_wakeup;
+
+  bool m_ioUring;
+  IoUring* m_pIoUring;
+  size_t m_sendInFlight;
+
+  bool m_busyPoll;
+  int m_busyPollCpu;
+  bool m_pinned;
+  std::atomic<bool> m_timerDue;
+  time_t m_timerDeadline;
+
+  InboundPipeline* m_pPipeline;
+  InboundLane* m_pLane;
+  bool m_backlog;
+  std::atomic<bool> m_decodedDue;
 };
 }
 
@@ -33,8 +33,9 @@ ThreadedSocketInitiator::ThreadedSocketInitiator(
   Application& application,
   MessageStoreFactory& factory ) throw( ConfigError )
 : Initiator( application, factory ),
-  m_lastConnect( 0 ), m_reconnectInterval( 30 ), m_noDelay( false ), 
-  m_sendBufSize( 0 ), m_rcvBufSize( 0 ) 
+  m_reconnectInterval( 30 ), m_noDelay( false ), 
+  m_sendBufSize( 0 ), m_rcvBufSize( 0 ), m_busyPoll( false ),
+  m_busyPollCpu( -1 ), m_busyPollUsec( 0 )
 { 
   socket_init(); 
 }
@@ -44,14 +45,16 @@ ThreadedSocketInitiator::ThreadedSocketInitiator(
   MessageStoreFactory& factory,
   LogFactory& logFactory ) throw( ConfigError )
 : Initiator( application, factory, logFactory ),
-  m_lastConnect( 0 ), m_reconnectInterval( 30 ), m_noDelay( false ), 
-  m_sendBufSize( 0 ), m_rcvBufSize( 0 ) 
+  m_reconnectInterval( 30 ), m_noDelay( false ), 
+  m_sendBufSize( 0 ), m_rcvBufSize( 0 ), m_busyPoll( false ),
+  m_busyPollCpu( -1 ), m_busyPollUsec( 0 )
 { 
   socket_init(); 
 }
 
 ThreadedSocketInitiator::~ThreadedSocketInitiator()
 { 
+  SessionTimer::instance().cancel( &m_reconnector );
   socket_term(); 
 }
 
@@ -68,29 +71,42 @@ throw ( ConfigError )
     m_sendBufSize = dict.getInt( SOCKET_SEND_BUFFER_SIZE );
   if( dict.has( SOCKET_RECEIVE_BUFFER_SIZE ) )
     m_rcvBufSize = dict.getInt( SOCKET_RECEIVE_BUFFER_SIZE );
+  if( dict.has( SOCKET_BUSY_POLL ) )
+    m_busyPoll = dict.getBool( SOCKET_BUSY_POLL );
+  if( dict.has( SOCKET_BUSY_POLL_CPU ) )
+    m_busyPollCpu = dict.getInt( SOCKET_BUSY_POLL_CPU );
+  if( dict.has( SOCKET_BUSY_POLL_USEC ) )
+    m_busyPollUsec = dict.getInt( SOCKET_BUSY_POLL_USEC );
+
+  m_pInboundPipeline.reset();
+  if( dict.has( INBOUND_PIPELINE ) && dict.getBool( INBOUND_PIPELINE ) )
+    m_pInboundPipeline.reset( new InboundPipeline( dict ) );
 }
 
 void ThreadedSocketInitiator::onInitialize( const SessionSettings& s )
 throw ( RuntimeError )
 {
+  if( m_pInboundPipeline )
+    m_pInboundPipeline->start();
 }
 
 void ThreadedSocketInitiator::onStart()
 {
   while ( !isStopped() )
   {
-    time_t now;
-    ::time( &now );
-
-    if ( (now - m_lastConnect) >= m_reconnectInterval )
     {
       Locker l( m_mutex );
       connect();
-      m_lastConnect = now;
     }
 
-    process_sleep( 1 );
+    // sleep until the session timer says the interval is up, or onStop
+    m_reconnector.due = false;
+    SessionTimer::instance().schedule( &m_reconnector, m_reconnectInterval * 1000L );
+    while ( !isStopped() && !m_reconnector.due )
+      m_reconnector.event.wait( m_reconnectInterval );
   }
+
+  SessionTimer::instance().cancel( &m_reconnector );
 }
 
 bool ThreadedSocketInitiator::onPoll( double timeout )
@@ -102,6 +118,8 @@ void ThreadedSocketInitiator::onStop()
 {
   SocketToThread threads;
   SocketToThread::iterator i;
+
+  m_reconnector.event.signal();
   
   {
     Locker l(m_mutex);
@@ -118,14 +136,19 @@ void ThreadedSocketInitiator::onStop()
 
     threads = m_threads;
     m_threads.clear();
+
+    // under the mutex, so no connection is deleted meanwhile
+    SocketToConnection::iterator j;
+    for ( j = m_connections.begin(); j != m_connections.end(); ++j )
+      j->second->disconnect();
   }   
 
-  for ( i = threads.begin(); i != threads.end(); ++i )
-    socket_close( i->first );
-  
   for ( i = threads.begin(); i != threads.end(); ++i )
     thread_join( i->second );
   threads.clear();
+
+  if( m_pInboundPipeline )
+    m_pInboundPipeline->stop();
 }
 
 void ThreadedSocketInitiator::doConnect( const SessionID& s, const Dictionary& d )
@@ -155,6 +178,24 @@ void ThreadedSocketInitiator::doConnect( const SessionID& s, const Dictionary& d
     ThreadedSocketConnection* pConnection =
       new ThreadedSocketConnection( s, socket, address, port, getLog() );
 
+    bool busyPoll = d.has( SOCKET_BUSY_POLL ) ? d.getBool( SOCKET_BUSY_POLL ) : m_busyPoll;
+    if( busyPoll )
+    {
+      int cpu = d.has( SOCKET_BUSY_POLL_CPU ) ? d.getInt( SOCKET_BUSY_POLL_CPU ) : m_busyPollCpu;
+      int usec = d.has( SOCKET_BUSY_POLL_USEC ) ? d.getInt( SOCKET_BUSY_POLL_USEC ) : m_busyPollUsec;
+      pConnection->setBusyPoll( true, cpu, usec );
+    }
+    if( d.has( SEND_QUEUE_SIZE ) )
+      pConnection->setSendQueueSize( d.getInt( SEND_QUEUE_SIZE ) );
+    if( d.has( READ_BUFFER_MAX_SIZE ) )
+      pConnection->setMaxReadSize( d.getInt( READ_BUFFER_MAX_SIZE ) );
+    if( d.has( SOCKET_IO_URING ) )
+      pConnection->setIoUring( d.getBool( SOCKET_IO_URING ) );
+    if( m_pInboundPipeline )
+      pConnection->setInboundPipeline( m_pInboundPipeline.get() );
+
+    ThreadSettings threadSettings( d, THREAD_AFFINITY, THREAD_NAME, THREAD_PRIORITY,
+                                   "fix-" + s.getTargetCompID().getValue() );
     ThreadPair* pair = new ThreadPair( this, pConnection );
 
     {
@@ -162,7 +203,9 @@ void ThreadedSocketInitiator::doConnect( const SessionID& s, const Dictionary& d
       thread_id thread;
       if ( thread_spawn( &socketThread, pair, thread ) )
       {
+        m_connections[ socket ] = pConnection;
         addThread( socket, thread );
+        log->onEvent( "Connection thread " + threadSettings.apply( thread ) );
       }
       else
       {
@@ -183,6 +226,16 @@ void ThreadedSocketInitiator::addThread( int s, thread_id t )
   m_threads[ s ] = t;
 }
 
+void ThreadedSocketInitiator::removeConnection( ThreadedSocketConnection* pConnection )
+{
+  // the socket may already be reused by a newer connection
+  Locker l(m_mutex);
+  SocketToConnection::iterator i = m_connections.find( pConnection->getSocket() );
+
+  if ( i != m_connections.end() && i->second == pConnection )
+    m_connections.erase( i );
+}
+
 void ThreadedSocketInitiator::removeThread( int s )
 {
   Locker l(m_mutex);
@@ -202,7 +255,6 @@ THREAD_PROC ThreadedSocketInitiator::socketThread( void* p )
   ThreadedSocketInitiator* pInitiator = pair->first;
   ThreadedSocketConnection* pConnection = pair->second;
   FIX::SessionID sessionID = pConnection->getSession()->getSessionID();
-  auto pSession = FIX::Session::lookupSession( sessionID );
   int socket = pConnection->getSocket();
   delete pair;
 
@@ -212,6 +264,7 @@ THREAD_PROC ThreadedSocketInitiator::socketThread( void* p )
   {
     pInitiator->getLog()->onEvent( "Connection failed" );
     pConnection->disconnect();
+    pInitiator->removeConnection( pConnection );
     delete pConnection;
     pInitiator->removeThread( socket );
     pInitiator->setDisconnected( sessionID );
@@ -221,10 +274,16 @@ THREAD_PROC ThreadedSocketInitiator::socketThread( void* p )
   pInitiator->setConnected( sessionID );
   pInitiator->getLog()->onEvent( "Connection succeeded" );
 
-  pSession->next();
+  {
+    // pinned for the call only, not for the life of the connection
+    std::shared_ptr<Session> pSession = Session::lookupSession( sessionID );
+    if( pSession )
+      pSession->next();
+  }
 
   while ( pConnection->read() ) {}
 
+  pInitiator->removeConnection( pConnection );
   delete pConnection;
   if( !pInitiator->isStopped() )
     pInitiator->removeThread( socket );
@@ -28,7 +28,12 @@
 
 #include "Initiator.h"
 #include "ThreadedSocketConnection.h"
+#include "InboundPipeline.h"
+#include "TimerWheel.h"
+#include "Event.h"
+#include <atomic>
 #include <map>
+#include <memory>
 
 namespace FIX
 {
@@ -46,9 +51,20 @@ public:
 
 private:
   typedef std::map < int, thread_id > SocketToThread;
+  typedef std::map < int, ThreadedSocketConnection* > SocketToConnection;
   typedef std::map < SessionID, int > SessionToHostNum;
   typedef std::pair < ThreadedSocketInitiator*, ThreadedSocketConnection* > ThreadPair;
 
+  /// Wakes the start thread when the next connection attempt is due.
+  struct Reconnector : public TimerWheel::Timer
+  {
+    Reconnector() : due( false ) {}
+    void onTimer() { due = true; event.signal(); }
+
+    std::atomic<bool> due;
+    Event event;
+  };
+
   void onConfigure( const SessionSettings& ) throw ( ConfigError );
   void onInitialize( const SessionSettings& ) throw ( RuntimeError );
 
@@ -60,6 +76,7 @@ private:
 
   void addThread( int s, thread_id t );
   void removeThread( int s );
+  void removeConnection( ThreadedSocketConnection* pConnection );
   void lock() { Locker l(m_mutex); }
   static THREAD_PROC socketThread( void* p );
 
@@ -67,12 +84,17 @@ private:
 
   
   SessionToHostNum m_sessionToHostNum;
-  time_t m_lastConnect;
+  Reconnector m_reconnector;
   int m_reconnectInterval;
   bool m_noDelay;
   int m_sendBufSize;
   int m_rcvBufSize;
+  bool m_busyPoll;
+  int m_busyPollCpu;
+  int m_busyPollUsec;
+  std::unique_ptr<InboundPipeline> m_pInboundPipeline;
   SocketToThread m_threads;
+  SocketToConnection m_connections;
   Mutex m_mutex;
 };
 /*! @} */
@@ -0,0 +1,409 @@
+/****************************************************************************
+** Copyright (c) 2001-2014
+**
+** This file is part of the QuickFIX FIX Engine
+**
+** This file may be distributed under the terms of the quickfixengine.org
+** license as defined by quickfixengine.org and appearing in the file
+** LICENSE included in the packaging of this file.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** See http://www.quickfixengine.org/LICENSE for licensing information.
+**
+** Contact ask@quickfixengine.org if any conditions of this licensing are
+** not clear to you.
+**
+****************************************************************************/
+
+#ifdef _MSC_VER
+#include "stdafx.h"
+#else
+#include "config.h"
+#endif
+
+#include "TieredStore.h"
+#include "SessionSettings.h"
+#include <algorithm>
+
+namespace FIX
+{
+WriteBehindPolicy::WriteBehindPolicy( const Dictionary& dict )
+throw( ConfigError )
+: m_durability( SEQNUM ), m_interval( 100 ), m_batchSize( 100 ),
+  m_maxLag( 10000 ), m_hotMessages( 10000 )
+{
+  if ( dict.has( TIERED_STORE_DURABILITY ) )
+  {
+    std::string durability = string_toUpper( dict.getString( TIERED_STORE_DURABILITY ) );
+    if ( durability == "ASYNC" ) m_durability = ASYNC;
+    else if ( durability == "SEQNUM" ) m_durability = SEQNUM;
+    else if ( durability == "SYNC" ) m_durability = SYNC;
+    else throw ConfigError( std::string( TIERED_STORE_DURABILITY )
+                            + " must be ASYNC, SEQNUM or SYNC" );
+  }
+
+  if ( dict.has( TIERED_STORE_FLUSH_INTERVAL ) )
+    m_interval = dict.getInt( TIERED_STORE_FLUSH_INTERVAL );
+  if ( m_interval <= 0 )
+    throw ConfigError( std::string( TIERED_STORE_FLUSH_INTERVAL ) + " must be positive" );
+
+  if ( dict.has( TIERED_STORE_BATCH_SIZE ) )
+    m_batchSize = dict.getInt( TIERED_STORE_BATCH_SIZE );
+  if ( m_batchSize <= 0 )
+    throw ConfigError( std::string( TIERED_STORE_BATCH_SIZE ) + " must be positive" );
+
+  if ( dict.has( TIERED_STORE_MAX_LAG ) )
+    m_maxLag = dict.getInt( TIERED_STORE_MAX_LAG );
+  if ( m_maxLag < 0 )
+    throw ConfigError( std::string( TIERED_STORE_MAX_LAG ) + " must not be negative" );
+
+  if ( dict.has( TIERED_STORE_HOT_MESSAGES ) )
+    m_hotMessages = dict.getInt( TIERED_STORE_HOT_MESSAGES );
+  if ( m_hotMessages < 0 )
+    throw ConfigError( std::string( TIERED_STORE_HOT_MESSAGES ) + " must not be negative" );
+}
+
+MessageStore* TieredStoreFactory::create( const SessionID& s )
+{
+  if ( m_hasPolicy )
+    return new TieredStore( m_factory, s, m_policy );
+
+  Dictionary settings = SessionSettings::instance().get( s );
+  return new TieredStore( m_factory, s, WriteBehindPolicy( settings ) );
+}
+
+void TieredStoreFactory::destroy( MessageStore* pStore )
+{
+  delete pStore;
+}
+
+TieredStore::TieredStore( MessageStoreFactory& factory,
+                          const SessionID& sessionID,
+                          const WriteBehindPolicy& policy )
+throw( ConfigError, IOException )
+: m_factory( factory ), m_pCold( 0 ),
+  m_hot( policy.getHotMessages(), 0 ), m_policy( policy ),
+  m_name( sessionID.toString() ), m_hotBegin( 1 ),
+  m_thread( 0 ), m_running( false ), m_stop( false )
+{
+  m_pCold = m_factory.create( sessionID );
+  try
+  {
+    Locker c( m_coldMutex );
+    load();
+  }
+  catch( IOException& )
+  {
+    m_factory.destroy( m_pCold );
+    throw;
+  }
+
+  if ( m_policy.getDurability() != WriteBehindPolicy::SYNC )
+    m_running = thread_spawn( &startThread, this, m_thread );
+}
+
+TieredStore::~TieredStore()
+{
+  if ( m_running )
+  {
+    m_stop = true;
+    m_event.signal();
+    thread_join( m_thread );
+  }
+
+  try
+  {
+    drain();
+  }
+  catch( IOException& ) {}
+  m_factory.destroy( m_pCold );
+}
+
+bool TieredStore::set( int msgSeqNum, const std::string& msg )
+throw ( IOException )
+{
+  check();
+  {
+    Locker l( m_mutex );
+    m_hot.set( msgSeqNum, msg );
+  }
+  update( Change( Change::MESSAGE, msgSeqNum, msg ) );
+  return true;
+}
+
+void TieredStore::get( int begin, int end,
+                       std::vector < std::string > & messages ) const
+throw ( IOException )
+{
+  messages.clear();
+  {
+    Locker l( m_mutex );
+    if ( begin >= getHotBegin() )
+    {
+      m_hot.get( begin, end, messages );
+      return;
+    }
+  }
+
+  // the range starts before what memory holds, so the wrapped store
+  // has to be brought up to date and read instead
+  drain();
+  Locker c( m_coldMutex );
+  m_pCold->get( begin, end, messages );
+}
+
+int TieredStore::getNextSenderMsgSeqNum() const throw ( IOException )
+{
+  Locker l( m_mutex );
+  return m_hot.getNextSenderMsgSeqNum();
+}
+
+int TieredStore::getNextTargetMsgSeqNum() const throw ( IOException )
+{
+  Locker l( m_mutex );
+  return m_hot.getNextTargetMsgSeqNum();
+}
+
+void TieredStore::setNextSenderMsgSeqNum( int value ) throw ( IOException )
+{
+  check();
+  {
+    Locker l( m_mutex );
+    m_hot.setNextSenderMsgSeqNum( value );
+  }
+  update( Change( Change::SENDER, value ) );
+}
+
+void TieredStore::setNextTargetMsgSeqNum( int value ) throw ( IOException )
+{
+  check();
+  {
+    Locker l( m_mutex );
+    m_hot.setNextTargetMsgSeqNum( value );
+  }
+  update( Change( Change::TARGET, value ) );
+}
+
+void TieredStore::incrNextSenderMsgSeqNum() throw ( IOException )
+{
+  check();
+  int value = 0;
+  {
+    Locker l( m_mutex );
+    m_hot.incrNextSenderMsgSeqNum();
+    value = m_hot.getNextSenderMsgSeqNum();
+  }
+  update( Change( Change::SENDER, value ) );
+}
+
+void TieredStore::incrNextTargetMsgSeqNum() throw ( IOException )
+{
+  check();
+  int value = 0;
+  {
+    Locker l( m_mutex );
+    m_hot.incrNextTargetMsgSeqNum();
+    value = m_hot.getNextTargetMsgSeqNum();
+  }
+  update( Change( Change::TARGET, value ) );
+}
+
+UtcTimeStamp TieredStore::getCreationTime() const throw ( IOException )
+{
+  Locker l( m_mutex );
+  return m_hot.getCreationTime();
+}
+
+void TieredStore::reset() throw ( IOException )
+{
+  // queued changes belong to the session being reset, so they are
+  // dropped rather than written
+  Locker c( m_coldMutex );
+  {
+    Locker l( m_mutex );
+    m_changes.clear();
+    m_error.clear();
+  }
+  m_pCold->reset();
+  load();
+}
+
+void TieredStore::refresh() throw ( IOException )
+{
+  drain();
+  Locker c( m_coldMutex );
+  m_pCold->refresh();
+  load();
+}
+
+void TieredStore::flush() throw ( IOException )
+{
+  drain();
+}
+
+size_t TieredStore::getLag() const
+{
+  Locker l( m_mutex );
+  return m_changes.size();
+}
+
+void TieredStore::update( const Change& change ) throw ( IOException )
+{
+  WriteBehindPolicy::Durability durability = m_policy.getDurability();
+  if ( durability == WriteBehindPolicy::SYNC
+       || ( durability == WriteBehindPolicy::SEQNUM
+            && change.type != Change::MESSAGE ) )
+  {
+    Locker c( m_coldMutex );
+    write( change );
+    return;
+  }
+
+  queue( change );
+}
+
+void TieredStore::queue( const Change& change ) throw ( IOException )
+{
+  size_t lag = 0;
+  {
+    Locker l( m_mutex );
+    m_changes.push_back( change );
+    lag = m_changes.size();
+  }
+
+  if ( !m_running )
+  {
+    drain();
+    return;
+  }
+
+  if ( lag >= (size_t)m_policy.getBatchSize() )
+    m_event.signal();
+
+  size_t maxLag = m_policy.getMaxLag();
+  while ( maxLag && lag >= maxLag )
+  {
+    m_event.signal();
+    m_written.wait( m_policy.getInterval() / 1000.0 );
+    check();
+    lag = getLag();
+  }
+}
+
+bool TieredStore::write( size_t count ) const
+{
+  Locker c( m_coldMutex );
+
+  Changes batch;
+  {
+    Locker l( m_mutex );
+    count = std::min( count, m_changes.size() );
+    batch.assign( m_changes.begin(), m_changes.begin() + count );
+    m_changes.erase( m_changes.begin(), m_changes.begin() + count );
+  }
+  if ( batch.empty() ) return false;
+
+  // only the last sequence number of each kind in a batch is written
+  size_t lastSender = batch.size();
+  size_t lastTarget = batch.size();
+  for ( size_t i = 0; i < batch.size(); ++i )
+  {
+    if ( batch[ i ].type == Change::SENDER ) lastSender = i;
+    else if ( batch[ i ].type == Change::TARGET ) lastTarget = i;
+  }
+
+  size_t i = 0;
+  try
+  {
+    for ( ; i < batch.size(); ++i )
+    {
+      if ( batch[ i ].type == Change::SENDER && i != lastSender ) continue;
+      if ( batch[ i ].type == Change::TARGET && i != lastTarget ) continue;
+      write( batch[ i ] );
+    }
+  }
+  catch( IOException& e )
+  {
+    Locker l( m_mutex );
+    m_changes.insert( m_changes.begin(), batch.begin() + i, batch.end() );
+    m_error = e.what();
+    m_written.signal();
+    return false;
+  }
+
+  m_written.signal();
+  return true;
+}
+
+void TieredStore::write( const Change& change ) const throw ( IOException )
+{
+  switch ( change.type )
+  {
+  case Change::MESSAGE:
+    m_pCold->set( change.msgSeqNum, change.message );
+    break;
+  case Change::SENDER:
+    m_pCold->setNextSenderMsgSeqNum( change.msgSeqNum );
+    break;
+  case Change::TARGET:
+    m_pCold->setNextTargetMsgSeqNum( change.msgSeqNum );
+    break;
+  }
+}
+
+void TieredStore::drain() const throw ( IOException )
+{
+  while ( write( m_policy.getBatchSize() ) ) {}
+  check();
+}
+
+void TieredStore::check() const throw ( IOException )
+{
+  Locker l( m_mutex );
+  if ( m_error.empty() ) return;
+
+  std::string error;
+  error.swap( m_error );
+  throw IOException( "Tiered store " + m_name + ": " + error );
+}
+
+void TieredStore::load() throw ( IOException )
+{
+  int sender = m_pCold->getNextSenderMsgSeqNum();
+  int target = m_pCold->getNextTargetMsgSeqNum();
+  UtcTimeStamp creationTime = m_pCold->getCreationTime();
+
+  Locker l( m_mutex );
+  m_hot.reset();
+  m_hot.setNextSenderMsgSeqNum( sender );
+  m_hot.setNextTargetMsgSeqNum( target );
+  m_hot.setCreationTime( creationTime );
+  m_hotBegin = sender;
+}
+
+int TieredStore::getHotBegin() const
+{
+  BoundedMemoryStore::Statistics statistics;
+  m_hot.getStatistics( statistics );
+  if ( statistics.messages && statistics.firstSeqNum > m_hotBegin )
+    return statistics.firstSeqNum;
+  return m_hotBegin;
+}
+
+THREAD_PROC TieredStore::startThread( void* p )
+{
+  TieredStore* pStore = static_cast < TieredStore* > ( p );
+
+  while ( !pStore->m_stop )
+  {
+    pStore->m_event.wait( pStore->m_policy.getInterval() / 1000.0 );
+    while ( !pStore->m_stop
+            && pStore->write( pStore->m_policy.getBatchSize() ) ) {}
+  }
+
+  return 0;
+}
+
+} //namespace FIX
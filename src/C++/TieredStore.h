@@ -0,0 +1,187 @@
+/* -*- C++ -*- */
+
+/****************************************************************************
+** Copyright (c) 2001-2014
+**
+** This file is part of the QuickFIX FIX Engine
+**
+** This file may be distributed under the terms of the quickfixengine.org
+** license as defined by quickfixengine.org and appearing in the file
+** LICENSE included in the packaging of this file.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** See http://www.quickfixengine.org/LICENSE for licensing information.
+**
+** Contact ask@quickfixengine.org if any conditions of this licensing are
+** not clear to you.
+**
+****************************************************************************/
+
+#ifndef FIX_TIEREDSTORE_H
+#define FIX_TIEREDSTORE_H
+
+#ifdef _MSC_VER
+#pragma warning( disable : 4503 4355 4786 4290 )
+#endif
+
+#include "MessageStore.h"
+#include "Dictionary.h"
+#include "Event.h"
+#include "Mutex.h"
+#include "SessionID.h"
+#include "Utility.h"
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace FIX
+{
+/**
+ * How a TieredStore moves writes into the store it wraps.
+ *
+ * ASYNC queues every change, so a crash loses whatever had not been
+ * flushed.  SEQNUM writes sequence numbers through immediately and only
+ * queues messages; after a crash no sequence number is reused and lost
+ * messages are answered with a gap fill.  SYNC writes everything through
+ * and only uses the memory tier to serve resends.
+ */
+class WriteBehindPolicy
+{
+public:
+  enum Durability { ASYNC, SEQNUM, SYNC };
+
+  WriteBehindPolicy( Durability durability = SEQNUM, long interval = 100,
+                     int batchSize = 100, int maxLag = 10000,
+                     int hotMessages = 10000 )
+  : m_durability( durability ), m_interval( interval ),
+    m_batchSize( batchSize ), m_maxLag( maxLag ),
+    m_hotMessages( hotMessages ) {}
+
+  /// Read the TieredStore settings from a dictionary.
+  WriteBehindPolicy( const Dictionary& dict ) throw( ConfigError );
+
+  Durability getDurability() const { return m_durability; }
+  long getInterval() const { return m_interval; }
+  int getBatchSize() const { return m_batchSize; }
+  int getMaxLag() const { return m_maxLag; }
+  int getHotMessages() const { return m_hotMessages; }
+
+private:
+  Durability m_durability;
+  long m_interval;
+  int m_batchSize;
+  int m_maxLag;
+  int m_hotMessages;
+};
+
+/**
+ * Creates a TieredStore in front of the stores made by another factory.
+ *
+ * Without an explicit policy the TieredStore settings of each session
+ * are read from the session settings.
+ */
+class TieredStoreFactory : public MessageStoreFactory
+{
+public:
+  TieredStoreFactory( MessageStoreFactory& factory )
+  : m_factory( factory ), m_hasPolicy( false ) {}
+  TieredStoreFactory( MessageStoreFactory& factory,
+                      const WriteBehindPolicy& policy )
+  : m_factory( factory ), m_policy( policy ), m_hasPolicy( true ) {}
+
+  MessageStore* create( const SessionID& );
+  void destroy( MessageStore* );
+private:
+  MessageStoreFactory& m_factory;
+  WriteBehindPolicy m_policy;
+  bool m_hasPolicy;
+};
+/*! @} */
+
+/**
+ * Write-behind MessageStore layered over a slower store.
+ *
+ * Messages and sequence numbers are kept in a BoundedMemoryStore holding
+ * the most recent messages, and a background thread copies changes to
+ * the wrapped store in batches every flush interval.  Resends are served
+ * from memory when it still holds the start of the range.  Once the
+ * number of queued changes reaches the maximum lag, writers wait for the
+ * thread to catch up.
+ *
+ * A failed write to the wrapped store is kept and retried, and the error
+ * is thrown from the next call that changes the store.  Reset and refresh
+ * flush the queue first and are always applied to the wrapped store
+ * before returning.
+ */
+class TieredStore : public MessageStore
+{
+public:
+  TieredStore( MessageStoreFactory& factory, const SessionID& sessionID,
+               const WriteBehindPolicy& policy ) throw( ConfigError, IOException );
+  ~TieredStore();
+
+  bool set( int, const std::string& ) throw ( IOException );
+  void get( int, int, std::vector < std::string > & ) const throw ( IOException );
+
+  int getNextSenderMsgSeqNum() const throw ( IOException );
+  int getNextTargetMsgSeqNum() const throw ( IOException );
+  void setNextSenderMsgSeqNum( int ) throw ( IOException );
+  void setNextTargetMsgSeqNum( int ) throw ( IOException );
+  void incrNextSenderMsgSeqNum() throw ( IOException );
+  void incrNextTargetMsgSeqNum() throw ( IOException );
+
+  UtcTimeStamp getCreationTime() const throw ( IOException );
+
+  void reset() throw ( IOException );
+  void refresh() throw ( IOException );
+
+  /// Write all queued changes to the wrapped store.
+  void flush() throw ( IOException );
+  /// Number of changes not yet written to the wrapped store.
+  size_t getLag() const;
+
+private:
+  struct Change
+  {
+    enum Type { MESSAGE, SENDER, TARGET };
+
+    Change( Type t, int n, const std::string& m = std::string() )
+    : type( t ), msgSeqNum( n ), message( m ) {}
+
+    Type type;
+    int msgSeqNum;
+    std::string message;
+  };
+  typedef std::deque < Change > Changes;
+
+  void update( const Change& ) throw ( IOException );
+  void queue( const Change& ) throw ( IOException );
+  bool write( size_t ) const;
+  void write( const Change& ) const throw ( IOException );
+  void drain() const throw ( IOException );
+  void check() const throw ( IOException );
+  void load() throw ( IOException );
+  int getHotBegin() const;
+  static THREAD_PROC startThread( void* p );
+
+  MessageStoreFactory& m_factory;
+  MessageStore* m_pCold;
+  BoundedMemoryStore m_hot;
+  WriteBehindPolicy m_policy;
+  std::string m_name;
+  int m_hotBegin;
+  mutable Changes m_changes;
+  mutable std::string m_error;
+  mutable Mutex m_mutex;
+  mutable Mutex m_coldMutex;
+  Event m_event;
+  mutable Event m_written;
+  thread_id m_thread;
+  bool m_running;
+  bool m_stop;
+};
+}
+
+#endif //FIX_TIEREDSTORE_H
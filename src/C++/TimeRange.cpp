@@ -25,6 +25,7 @@
 
 #include "TimeRange.h"
 #include "Utility.h"
+#include <algorithm>
 
 namespace FIX
 {
@@ -170,4 +171,35 @@ namespace FIX
     int absoluteDay2 = time2.getJulianDate() - time2.getWeekDay();
     return absoluteDay1 == absoluteDay2;
   }
+  UtcTimeStamp TimeRange::getNextBoundary( const UtcTimeStamp& now )
+  {
+    DateTime time = now;
+    if( m_useLocalTime )
+      time = LocalTimeStamp( now.getTimeT(), now.getMillisecond() );
+
+    // comparisons are partly made in whole seconds, so a boundary is
+    // only trusted a second either side of it
+    int millis = DateTime::MILLIS_PER_HOUR;
+    DateTime boundaries[] = { m_startTime, m_endTime, UtcTimeOnly( 0, 0, 0 ) };
+    for( int i = 0; i < 3; ++i )
+    {
+      int until = millisUntil( boundaries[ i ], time );
+      if( until > DateTime::MILLIS_PER_DAY - DateTime::MILLIS_PER_SEC )
+        return now;
+      millis = std::min( millis, until );
+    }
+
+    UtcTimeStamp boundary = now;
+    boundary += millis / DateTime::MILLIS_PER_SEC;
+    return boundary;
+  }
+
+  int TimeRange::millisUntil( const DateTime& timeOfDay, const DateTime& time )
+  {
+    int millis = timeOfDay.getMillisecond() - time.getMillisecond()
+      + ( ( timeOfDay.getHour() - time.getHour() ) * DateTime::SECONDS_PER_HOUR
+          + ( timeOfDay.getMinute() - time.getMinute() ) * DateTime::SECONDS_PER_MIN
+          + timeOfDay.getSecond() - time.getSecond() ) * DateTime::MILLIS_PER_SEC;
+    return millis > 0 ? millis : millis + DateTime::MILLIS_PER_DAY;
+  }
 }
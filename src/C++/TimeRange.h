@@ -237,7 +237,15 @@ public:
     return isInSameRange( (DateTime)time1, (DateTime)time2 );
   }
 
+  /// Time up to which isInRange and isInSameRange answer as they do now.
+  /// Either can change when the start or end time or midnight comes
+  /// round, checks are made at least hourly to follow changes of local
+  /// time offset.
+  UtcTimeStamp getNextBoundary( const UtcTimeStamp& now );
+
 private:
+  static int millisUntil( const DateTime& timeOfDay, const DateTime& time );
+
   bool isInSameRange( const DateTime& time1, const DateTime& time2 )
   {
     if( m_startDay < 0 && m_endDay < 0 )
@@ -0,0 +1,290 @@
+/****************************************************************************
+** Copyright (c) 2001-2014
+**
+** This file is part of the QuickFIX FIX Engine
+**
+** This file may be distributed under the terms of the quickfixengine.org
+** license as defined by quickfixengine.org and appearing in the file
+** LICENSE included in the packaging of this file.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** See http://www.quickfixengine.org/LICENSE for licensing information.
+**
+** Contact ask@quickfixengine.org if any conditions of this licensing are
+** not clear to you.
+**
+****************************************************************************/
+
+#ifdef _MSC_VER
+#include "stdafx.h"
+#else
+#include "config.h"
+#endif
+
+#include "TimerWheel.h"
+#include <algorithm>
+
+namespace FIX
+{
+const long long TimerWheel::NO_DEADLINE;
+
+TimerWheel::TimerWheel( long long now )
+: m_current( now ), m_size( 0 )
+{
+  for ( int i = 0; i < ROOT_SIZE; ++i )
+    m_root[ i ] = 0;
+  for ( int level = 0; level < LEVELS; ++level )
+  {
+    for ( int i = 0; i < LEVEL_SIZE; ++i )
+      m_levels[ level ][ i ] = 0;
+  }
+}
+
+void TimerWheel::schedule( Timer* pTimer, long long deadline )
+{
+  cancel( pTimer );
+  pTimer->m_deadline = deadline;
+  link( pTimer );
+}
+
+void TimerWheel::cancel( Timer* pTimer )
+{
+  if ( !pTimer->isScheduled() ) return;
+  *pTimer->m_ppPrev = pTimer->m_pNext;
+  if ( pTimer->m_pNext )
+    pTimer->m_pNext->m_ppPrev = pTimer->m_ppPrev;
+  pTimer->m_pNext = 0;
+  pTimer->m_ppPrev = 0;
+  --m_size;
+}
+
+void TimerWheel::link( Timer* pTimer )
+{
+  long long expires = pTimer->m_deadline;
+  long long delta = expires - m_current;
+  Timer** ppSlot = 0;
+
+  if ( delta < ROOT_SIZE )
+  {
+    // overdue timers go in the slot about to be expired
+    ppSlot = &m_root[ ( delta < 0 ? m_current : expires ) & ( ROOT_SIZE - 1 ) ];
+  }
+  else
+  {
+    int level = 0;
+    while ( level < LEVELS - 1
+            && delta >= 1LL << ( ROOT_BITS + ( level + 1 ) * LEVEL_BITS ) )
+      ++level;
+
+    // beyond the last wheel a timer waits at its far end, and is placed
+    // again from its real deadline when it is cascaded
+    long long limit = 1LL << ( ROOT_BITS + LEVELS * LEVEL_BITS );
+    if ( delta >= limit ) expires = m_current + limit - 1;
+
+    int shift = ROOT_BITS + level * LEVEL_BITS;
+    ppSlot = &m_levels[ level ][ ( expires >> shift ) & ( LEVEL_SIZE - 1 ) ];
+  }
+
+  pTimer->m_pNext = *ppSlot;
+  if ( *ppSlot ) ( *ppSlot )->m_ppPrev = &pTimer->m_pNext;
+  *ppSlot = pTimer;
+  pTimer->m_ppPrev = ppSlot;
+  ++m_size;
+}
+
+void TimerWheel::cascade( int level, int index )
+{
+  Timer* pTimer = m_levels[ level ][ index ];
+  m_levels[ level ][ index ] = 0;
+  while ( pTimer )
+  {
+    Timer* pNext = pTimer->m_pNext;
+    pTimer->m_pNext = 0;
+    pTimer->m_ppPrev = 0;
+    --m_size;
+    link( pTimer );
+    pTimer = pNext;
+  }
+}
+
+void TimerWheel::advance( long long now, std::vector < Timer* > & expired )
+{
+  while ( m_current <= now )
+  {
+    // empty slots are skipped rather than stepped through one by one
+    long long tick = nextTick();
+    if ( tick == NO_DEADLINE || tick > now )
+    {
+      m_current = now + 1;
+      break;
+    }
+    m_current = tick;
+
+    int index = (int)( m_current & ( ROOT_SIZE - 1 ) );
+    if ( !index )
+    {
+      // each time a wheel comes round the next slot of the one above
+      // is spread over it
+      for ( int level = 0; level < LEVELS; ++level )
+      {
+        int shift = ROOT_BITS + level * LEVEL_BITS;
+        int i = (int)( ( m_current >> shift ) & ( LEVEL_SIZE - 1 ) );
+        cascade( level, i );
+        if ( i ) break;
+      }
+    }
+
+    Timer* pTimer = m_root[ index ];
+    m_root[ index ] = 0;
+    while ( pTimer )
+    {
+      Timer* pNext = pTimer->m_pNext;
+      pTimer->m_pNext = 0;
+      pTimer->m_ppPrev = 0;
+      --m_size;
+      expired.push_back( pTimer );
+      pTimer = pNext;
+    }
+    ++m_current;
+  }
+}
+
+long long TimerWheel::nextTick() const
+{
+  if ( !m_size ) return NO_DEADLINE;
+
+  long long tick = m_current;
+  long long end = ( tick | ( ROOT_SIZE - 1 ) ) + 1;
+  for ( ; tick < end; ++tick )
+  {
+    // the coarser wheels are cascaded when the first comes round
+    if ( !( tick & ( ROOT_SIZE - 1 ) ) || m_root[ tick & ( ROOT_SIZE - 1 ) ] )
+      return tick;
+  }
+
+  // nothing left in the first wheel, so look for the next slot of a
+  // coarser one that is cascaded, each wheel starting at its first slot
+  // when the one above moves on
+  bool first = m_root[ 0 ] != 0;
+  for ( int level = 0; level < LEVELS; ++level )
+  {
+    if ( first ) return tick;
+    first = m_levels[ level ][ 0 ] != 0;
+
+    int shift = ROOT_BITS + level * LEVEL_BITS;
+    end = ( tick | ( ( 1LL << ( shift + LEVEL_BITS ) ) - 1 ) ) + 1;
+    for ( ; tick < end; tick += 1LL << shift )
+    {
+      int index = (int)( ( tick >> shift ) & ( LEVEL_SIZE - 1 ) );
+      if ( !index || m_levels[ level ][ index ] )
+        return tick;
+    }
+  }
+  return tick;
+}
+
+SessionTimer::SessionTimer()
+: m_wheel( now() / TICK ), m_pFiring( 0 ), m_wake( TimerWheel::NO_DEADLINE ),
+  m_thread( 0 ), m_running( false ), m_stop( false )
+{
+}
+
+SessionTimer::~SessionTimer()
+{
+  if ( !m_running ) return;
+  m_stop = true;
+  m_event.signal();
+  thread_join( m_thread );
+}
+
+void SessionTimer::schedule( TimerWheel::Timer* pTimer, long delay )
+{
+  Locker l( m_mutex );
+
+  // rounded up, so a timer is never called early
+  long long deadline = ( now() + delay + TICK - 1 ) / TICK;
+  unqueue( pTimer );
+  m_wheel.schedule( pTimer, deadline );
+
+  if ( !m_running )
+    m_running = thread_spawn( &startThread, this, m_thread );
+  else if ( m_wake == TimerWheel::NO_DEADLINE || deadline < m_wake )
+    m_event.signal();
+}
+
+void SessionTimer::cancel( TimerWheel::Timer* pTimer )
+{
+  while ( true )
+  {
+    {
+      Locker l( m_mutex );
+      m_wheel.cancel( pTimer );
+      unqueue( pTimer );
+      if ( m_pFiring != pTimer || thread_self() == m_thread ) return;
+    }
+    process_sleep( 0.001 );
+  }
+}
+
+void SessionTimer::unqueue( TimerWheel::Timer* pTimer )
+{
+  m_expired.erase( std::remove( m_expired.begin(), m_expired.end(), pTimer ),
+                   m_expired.end() );
+}
+
+void SessionTimer::fire()
+{
+  while ( true )
+  {
+    TimerWheel::Timer* pTimer = 0;
+    {
+      Locker l( m_mutex );
+      if ( m_expired.empty() )
+      {
+        m_pFiring = 0;
+        return;
+      }
+      pTimer = m_expired.front();
+      m_expired.pop_front();
+      m_pFiring = pTimer;
+    }
+    pTimer->onTimer();
+  }
+}
+
+THREAD_PROC SessionTimer::startThread( void* p )
+{
+  SessionTimer* pTimer = static_cast < SessionTimer* > ( p );
+  std::vector < TimerWheel::Timer* > expired;
+
+  while ( !pTimer->m_stop )
+  {
+    long long wake = TimerWheel::NO_DEADLINE;
+    {
+      Locker l( pTimer->m_mutex );
+      expired.clear();
+      pTimer->m_wheel.advance( now() / TICK, expired );
+      pTimer->m_expired.insert( pTimer->m_expired.end(), expired.begin(), expired.end() );
+      wake = pTimer->m_wake = pTimer->m_wheel.nextTick();
+    }
+
+    pTimer->fire();
+
+    // sleeps until the first pending tick, or until a sooner timer is
+    // scheduled, rather than waking every tick
+    if ( wake == TimerWheel::NO_DEADLINE )
+    {
+      pTimer->m_event.wait( 60 );
+      continue;
+    }
+    long long delay = wake * TICK - now();
+    if ( delay > 0 )
+      pTimer->m_event.wait( delay / 1000.0 );
+  }
+
+  return 0;
+}
+
+} //namespace FIX
@@ -0,0 +1,148 @@
+/* -*- C++ -*- */
+
+/****************************************************************************
+** Copyright (c) 2001-2014
+**
+** This file is part of the QuickFIX FIX Engine
+**
+** This file may be distributed under the terms of the quickfixengine.org
+** license as defined by quickfixengine.org and appearing in the file
+** LICENSE included in the packaging of this file.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** See http://www.quickfixengine.org/LICENSE for licensing information.
+**
+** Contact ask@quickfixengine.org if any conditions of this licensing are
+** not clear to you.
+**
+****************************************************************************/
+
+#ifndef FIX_TIMERWHEEL_H
+#define FIX_TIMERWHEEL_H
+
+#ifdef _MSC_VER
+#pragma warning( disable : 4503 4355 4786 4290 )
+#endif
+
+#include "Event.h"
+#include "Mutex.h"
+#include "Utility.h"
+#include <deque>
+#include <vector>
+
+namespace FIX
+{
+/**
+ * Hierarchical timer wheel.
+ *
+ * Time is counted in ticks.  Timers due within 256 ticks wait in the
+ * first wheel, later ones in three coarser wheels of 64 slots that are
+ * cascaded down as time reaches them, so scheduling, cancelling and
+ * expiring are constant time however many timers are pending.
+ *
+ * The wheel is not thread safe, SessionTimer serializes access to it.
+ */
+class TimerWheel
+{
+public:
+  /// Something woken at a deadline.
+  class Timer
+  {
+  public:
+    Timer() : m_pNext( 0 ), m_ppPrev( 0 ), m_deadline( 0 ) {}
+    virtual ~Timer() {}
+
+    virtual void onTimer() = 0;
+
+    bool isScheduled() const { return m_ppPrev != 0; }
+    long long getDeadline() const { return m_deadline; }
+
+  private:
+    friend class TimerWheel;
+
+    Timer* m_pNext;
+    Timer** m_ppPrev;
+    long long m_deadline;
+  };
+
+  enum
+  {
+    ROOT_BITS = 8, LEVEL_BITS = 6, LEVELS = 3,
+    ROOT_SIZE = 1 << ROOT_BITS, LEVEL_SIZE = 1 << LEVEL_BITS
+  };
+
+  static const long long NO_DEADLINE = -1;
+
+  TimerWheel( long long now = 0 );
+
+  /// Schedule, or reschedule, the timer for a tick.
+  void schedule( Timer*, long long deadline );
+  void cancel( Timer* );
+
+  /// Move time up to now, collecting the timers that expired.
+  void advance( long long now, std::vector < Timer* > & expired );
+  /// First tick worth advancing to, NO_DEADLINE when nothing is pending.
+  long long nextTick() const;
+
+  size_t size() const { return m_size; }
+  long long getCurrent() const { return m_current; }
+
+private:
+  void link( Timer* );
+  void cascade( int level, int index );
+
+  Timer* m_root[ ROOT_SIZE ];
+  Timer* m_levels[ LEVELS ][ LEVEL_SIZE ];
+  long long m_current;
+  size_t m_size;
+};
+
+/**
+ * Process wide timer for session housekeeping.
+ *
+ * Sessions schedule the moment their next heartbeat, test request,
+ * logon or logout timeout or session time boundary is due, and a single
+ * thread wakes only those sessions, instead of every connection waking
+ * every second to poll its session.  Timers are called on that thread,
+ * one at a time.
+ */
+class SessionTimer
+{
+public:
+  enum { TICK = 100 };
+
+  static SessionTimer& instance()
+  {
+    static SessionTimer timer;
+    return timer;
+  }
+
+  /// Call the timer once the delay in milliseconds has passed.
+  void schedule( TimerWheel::Timer*, long delay );
+  /// Cancel the timer, waiting for it to return if it is being called.
+  void cancel( TimerWheel::Timer* );
+
+private:
+  SessionTimer();
+  ~SessionTimer();
+
+  static long long now() { return process_microseconds() / 1000; }
+  void unqueue( TimerWheel::Timer* );
+  void fire();
+  static THREAD_PROC startThread( void* p );
+
+  TimerWheel m_wheel;
+  std::deque < TimerWheel::Timer* > m_expired;
+  TimerWheel::Timer* m_pFiring;
+  long long m_wake;
+  Mutex m_mutex;
+  Event m_event;
+  thread_id m_thread;
+  bool m_running;
+  bool m_stop;
+};
+}
+
+#endif //FIX_TIMERWHEEL_H
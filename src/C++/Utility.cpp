@@ -29,6 +29,9 @@
 #include <stropts.h>
 #include <sys/conf.h>
 #endif
+#ifdef _MSC_VER
+#include <io.h>
+#endif
 #include <string.h>
 #include <math.h>
 #include <stdio.h>
@@ -221,6 +224,16 @@ int socket_getsockopt( int s, int opt, int& optval )
                        ( char* ) & optval, & length );
 }
 
+int socket_setbusypoll( int s, int usec )
+{
+#ifdef SO_BUSY_POLL
+  return ::setsockopt( s, SOL_SOCKET, SO_BUSY_POLL,
+                       &usec, sizeof( usec ) );
+#else
+  return -1;
+#endif
+}
+
 #ifndef _MSC_VER
 int socket_fcntl( int s, int opt, int arg )
 {
@@ -249,6 +262,16 @@ void socket_setnonblock( int socket )
   socket_setfcntlflag( socket, O_NONBLOCK );
 #endif
 }
+
+bool socket_wouldblock()
+{
+#ifdef _MSC_VER
+  return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+  return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+#endif
+}
+
 bool socket_isValid( int socket )
 {
 #ifdef _MSC_VER
@@ -342,16 +365,27 @@ std::pair<int, int> socket_createpair()
 {
 #ifdef _MSC_VER
   int acceptor = socket_createAcceptor(0, true);
-  const char* host = socket_hostname( acceptor );
+  if( acceptor < 0 ) return std::pair<int, int>( -1, -1 );
   short port = socket_hostport( acceptor );
   int client = socket_createConnector();
-  socket_connect( client, "localhost", port );
+  if( client < 0 || socket_connect( client, "localhost", port ) < 0 )
+  {
+    if( client >= 0 ) socket_close( client );
+    socket_close( acceptor );
+    return std::pair<int, int>( -1, -1 );
+  }
   int server = socket_accept( acceptor );
   socket_close(acceptor);
+  if( server < 0 )
+  {
+    socket_close( client );
+    return std::pair<int, int>( -1, -1 );
+  }
   return std::pair<int, int>( client, server );
 #else
   int pair[2];
-  socketpair( AF_UNIX, SOCK_STREAM, 0, pair );
+  if( socketpair( AF_UNIX, SOCK_STREAM, 0, pair ) < 0 )
+    return std::pair<int, int>( -1, -1 );
   return std::pair<int, int>( pair[0], pair[1] );
 #endif
 }
@@ -388,6 +422,23 @@ tm time_localtime( const time_t* t)
 #endif
 }
 
+long long time_nanoseconds()
+{
+#ifdef _MSC_VER
+  // file times count 100ns intervals from 1601
+  FILETIME time;
+  GetSystemTimeAsFileTime( &time );
+  ULARGE_INTEGER value;
+  value.LowPart = time.dwLowDateTime;
+  value.HighPart = time.dwHighDateTime;
+  return ( (long long)value.QuadPart - 116444736000000000LL ) * 100;
+#else
+  timespec time;
+  clock_gettime( CLOCK_REALTIME, &time );
+  return (long long)time.tv_sec * 1000000000 + time.tv_nsec;
+#endif
+}
+
 bool thread_spawn( THREAD_START_ROUTINE func, void* var, thread_id& thread )
 {
 #ifdef _MSC_VER
@@ -438,6 +489,79 @@ thread_id thread_self()
 #endif
 }
 
+bool thread_setaffinity( int cpu )
+{
+  if( cpu < 0 ) return false;
+#ifdef _MSC_VER
+  return SetThreadAffinityMask( GetCurrentThread(), (DWORD_PTR)1 << cpu ) != 0;
+#elif defined(__linux__)
+  cpu_set_t set;
+  CPU_ZERO( &set );
+  CPU_SET( cpu, &set );
+  return pthread_setaffinity_np( pthread_self(), sizeof( set ), &set ) == 0;
+#else
+  return false;
+#endif
+}
+
+bool thread_setaffinity( thread_id thread, const std::set<int>& cpus )
+{
+  if( cpus.empty() ) return false;
+#ifdef _MSC_VER
+  DWORD_PTR mask = 0;
+  std::set<int>::const_iterator i;
+  for( i = cpus.begin(); i != cpus.end(); ++i )
+  {
+    if( *i < 0 || *i >= (int)(sizeof(DWORD_PTR) * 8) ) return false;
+    mask |= (DWORD_PTR)1 << *i;
+  }
+  return SetThreadAffinityMask( (HANDLE)thread, mask ) != 0;
+#elif defined(__linux__)
+  cpu_set_t set;
+  CPU_ZERO( &set );
+  std::set<int>::const_iterator i;
+  for( i = cpus.begin(); i != cpus.end(); ++i )
+  {
+    if( *i < 0 || *i >= CPU_SETSIZE ) return false;
+    CPU_SET( *i, &set );
+  }
+  return pthread_setaffinity_np( thread, sizeof( set ), &set ) == 0;
+#else
+  return false;
+#endif
+}
+
+bool thread_setname( thread_id thread, const std::string& name )
+{
+  if( name.empty() ) return false;
+#if defined(__linux__)
+  // the kernel limits thread names to 15 characters
+  return pthread_setname_np( thread, name.substr( 0, 15 ).c_str() ) == 0;
+#else
+  return false;
+#endif
+}
+
+bool thread_setpriority( thread_id thread, int priority )
+{
+  if( priority <= 0 ) return false;
+#ifdef _MSC_VER
+  // Windows has no range of realtime priorities, so the 1-99 range is
+  // split over the levels above normal
+  int level = THREAD_PRIORITY_ABOVE_NORMAL;
+  if( priority > 66 )
+    level = THREAD_PRIORITY_TIME_CRITICAL;
+  else if( priority > 33 )
+    level = THREAD_PRIORITY_HIGHEST;
+  return SetThreadPriority( (HANDLE)thread, level ) != 0;
+#else
+  sched_param param;
+  memset( &param, 0, sizeof( param ) );
+  param.sched_priority = priority;
+  return pthread_setschedparam( thread, SCHED_FIFO, &param ) == 0;
+#endif
+}
+
 void process_sleep( double s )
 {
 #ifdef _MSC_VER
@@ -452,6 +576,20 @@ void process_sleep( double s )
 #endif
 }
 
+long long process_microseconds()
+{
+#ifdef _MSC_VER
+  LARGE_INTEGER frequency, counter;
+  QueryPerformanceFrequency( &frequency );
+  QueryPerformanceCounter( &counter );
+  return counter.QuadPart * 1000000 / frequency.QuadPart;
+#else
+  timespec time;
+  clock_gettime( CLOCK_MONOTONIC, &time );
+  return (long long)time.tv_sec * 1000000 + time.tv_nsec / 1000;
+#endif
+}
+
 std::string file_separator()
 {
 #ifdef _MSC_VER
@@ -531,4 +669,76 @@ std::string file_appendpath( const std::string& path, const std::string& file )
   else
     return std::string(path) + file_separator() + file;
 }
+
+void* file_mmap( const char* path, size_t& size )
+{
+#ifdef _MSC_VER
+  HANDLE file = CreateFileA( path, GENERIC_READ | GENERIC_WRITE,
+                             FILE_SHARE_READ, NULL, OPEN_ALWAYS,
+                             FILE_ATTRIBUTE_NORMAL, NULL );
+  if( file == INVALID_HANDLE_VALUE ) return 0;
+
+  LARGE_INTEGER existing;
+  if( GetFileSizeEx( file, &existing ) && (size_t)existing.QuadPart > size )
+    size = (size_t)existing.QuadPart;
+
+  LARGE_INTEGER length;
+  length.QuadPart = size;
+  HANDLE mapping = CreateFileMappingA( file, NULL, PAGE_READWRITE,
+                                       length.HighPart, length.LowPart, NULL );
+  CloseHandle( file );
+  if( !mapping ) return 0;
+
+  void* result = MapViewOfFile( mapping, FILE_MAP_WRITE, 0, 0, size );
+  CloseHandle( mapping );
+  return result;
+#else
+  int fd = ::open( path, O_RDWR | O_CREAT, 0644 );
+  if( fd < 0 ) return 0;
+
+  struct stat buf;
+  if( fstat( fd, &buf ) == 0 && (size_t)buf.st_size > size )
+    size = buf.st_size;
+  if( ftruncate( fd, size ) != 0 )
+  {
+    close( fd );
+    return 0;
+  }
+
+  void* result = mmap( 0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+  close( fd );
+  return result == MAP_FAILED ? 0 : result;
+#endif
+}
+
+void file_munmap( void* address, size_t size )
+{
+#ifdef _MSC_VER
+  UnmapViewOfFile( address );
+#else
+  munmap( address, size );
+#endif
+}
+
+bool file_msync( void* address, size_t size )
+{
+#ifdef _MSC_VER
+  return FlushViewOfFile( address, size ) != 0;
+#else
+  static const size_t page = sysconf( _SC_PAGESIZE );
+  size_t skew = (size_t)address % page;
+  return msync( (char*)address - skew, size + skew, MS_SYNC ) == 0;
+#endif
+}
+
+bool file_datasync( FILE* file )
+{
+#ifdef _MSC_VER
+  return _commit( _fileno( file ) ) == 0;
+#elif defined(__linux__)
+  return fdatasync( fileno( file ) ) == 0;
+#else
+  return fsync( fileno( file ) ) == 0;
+#endif
+}
 }
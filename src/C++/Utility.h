@@ -76,6 +76,7 @@ typedef int  ssize_t;
 #include <sys/ioctl.h>
 #include <sys/time.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
 #include <arpa/inet.h>
@@ -97,6 +98,7 @@ typedef int  ssize_t;
 #include <cstdio>
 #include <cstdlib>
 #include <memory>
+#include <set>
 
 #if defined(HAVE_STD_SHARED_PTR)
   namespace ptr = std;
@@ -130,12 +132,14 @@ bool socket_disconnected( int s );
 int socket_setsockopt( int s, int opt );
 int socket_setsockopt( int s, int opt, int optval );
 int socket_getsockopt( int s, int opt, int& optval );
+int socket_setbusypoll( int s, int usec );
 #ifndef _MSC_VER
 int socket_fcntl( int s, int opt, int arg );
 int socket_getfcntlflag( int s, int arg );
 int socket_setfcntlflag( int s, int arg );
 #endif
 void socket_setnonblock( int s );
+bool socket_wouldblock();
 bool socket_isValid( int socket );
 #ifndef _MSC_VER
 bool socket_isBad( int s );
@@ -149,6 +153,8 @@ std::pair<int, int> socket_createpair();
 
 tm time_gmtime( const time_t* t );
 tm time_localtime( const time_t* t );
+/// Wall clock time in nanoseconds since the epoch.
+long long time_nanoseconds();
 
 #ifdef _MSC_VER
 //typedef unsigned  (_stdcall THREAD_START_ROUTINE)(void *);
@@ -170,8 +176,13 @@ bool thread_spawn( THREAD_START_ROUTINE func, void* var );
 void thread_join( thread_id thread );
 void thread_detach( thread_id thread );
 thread_id thread_self();
+bool thread_setaffinity( int cpu );
+bool thread_setaffinity( thread_id thread, const std::set<int>& cpus );
+bool thread_setname( thread_id thread, const std::string& name );
+bool thread_setpriority( thread_id thread, int priority );
 
 void process_sleep( double s );
+long long process_microseconds();
 
 std::string file_separator();
 void file_mkdir( const char* path );
@@ -181,6 +192,10 @@ bool file_exists( const char* path );
 void file_unlink( const char* path );
 int file_rename( const char* oldpath, const char* newpath );
 std::string file_appendpath( const std::string& path, const std::string& file );
+void* file_mmap( const char* path, size_t& size );
+void file_munmap( void* address, size_t size );
+bool file_msync( void* address, size_t size );
+bool file_datasync( FILE* file );
 }
 
 #if( _MSC_VER >= 1400 )
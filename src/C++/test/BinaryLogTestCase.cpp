@@ -0,0 +1,164 @@
+/****************************************************************************
+** Copyright (c) 2001-2014
+**
+** This file is part of the QuickFIX FIX Engine
+**
+** This file may be distributed under the terms of the quickfixengine.org
+** license as defined by quickfixengine.org and appearing in the file
+** LICENSE included in the packaging of this file.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** See http://www.quickfixengine.org/LICENSE for licensing information.
+**
+** Contact ask@quickfixengine.org if any conditions of this licensing are
+** not clear to you.
+**
+****************************************************************************/
+
+#ifdef _MSC_VER
+#pragma warning( disable : 4503 4355 4786 )
+#include "stdafx.h"
+#else
+#include "config.h"
+#endif
+
+#include <UnitTest++.h>
+#include <BinaryLog.h>
+#include <Utility.h>
+
+using namespace FIX;
+
+SUITE(BinaryLogTests)
+{
+
+struct binaryLogFixture
+{
+  binaryLogFixture()
+  : factory( "binlog" )
+  {
+    file_unlink( "binlog/log.current.bin" );
+  }
+
+  ~binaryLogFixture()
+  {
+    file_unlink( "binlog/log.current.bin" );
+  }
+
+  BinaryLogFactory factory;
+};
+
+TEST_FIXTURE(binaryLogFixture, writeRead)
+{
+  SessionID first( BeginString( "FIX.4.2" ),
+                   SenderCompID( "SENDER" ), TargetCompID( "TARGET" ) );
+  SessionID second( BeginString( "FIX.4.4" ),
+                    SenderCompID( "OTHER" ), TargetCompID( "TARGET" ) );
+
+  long long before = time_nanoseconds();
+  Log* pFirst = factory.create( first );
+  Log* pSecond = factory.create( second );
+  Log* pGlobal = factory.create();
+
+  pFirst->onIncoming( "8=FIX.4.2\0019=5\00135=D\001" );
+  pSecond->onOutgoing( "8=FIX.4.4\0019=5\00135=8\001" );
+  pFirst->onEvent( "EVENT1" );
+  pGlobal->onEvent( "GLOBALEVENT" );
+
+  factory.destroy( pFirst );
+  factory.destroy( pSecond );
+  factory.destroy( pGlobal );
+  long long after = time_nanoseconds();
+
+  BinaryLogReader reader( "binlog/log.current.bin" );
+  BinaryLogRecord record;
+
+  CHECK( reader.next( record ) );
+  CHECK_EQUAL( BinaryLogRecord::INCOMING, record.kind );
+  CHECK_EQUAL( "FIX.4.2:SENDER->TARGET", reader.getSession( record.session ) );
+  CHECK_EQUAL( "8=FIX.4.2\0019=5\00135=D\001", record.data );
+  CHECK( record.time >= before && record.time <= after );
+
+  CHECK( reader.next( record ) );
+  CHECK_EQUAL( BinaryLogRecord::OUTGOING, record.kind );
+  CHECK_EQUAL( "FIX.4.4:OTHER->TARGET", reader.getSession( record.session ) );
+
+  CHECK( reader.next( record ) );
+  CHECK_EQUAL( BinaryLogRecord::EVENT, record.kind );
+  CHECK_EQUAL( "FIX.4.2:SENDER->TARGET", reader.getSession( record.session ) );
+  CHECK_EQUAL( "EVENT1", record.data );
+
+  CHECK( reader.next( record ) );
+  CHECK_EQUAL( "GLOBAL", reader.getSession( record.session ) );
+  CHECK_EQUAL( "GLOBALEVENT", record.data );
+
+  CHECK( !reader.next( record ) );
+}
+
+TEST_FIXTURE(binaryLogFixture, clearAndBackup)
+{
+  SessionID sessionID( BeginString( "FIX.4.2" ),
+                       SenderCompID( "SENDER" ), TargetCompID( "TARGET" ) );
+  SessionID other( BeginString( "FIX.4.2" ),
+                   SenderCompID( "OTHER" ), TargetCompID( "TARGET" ) );
+  Log* pLog = factory.create( sessionID );
+  Log* pOther = factory.create( other );
+  pLog->onIncoming( "BEFORE" );
+  pLog->backup();
+  pOther->onIncoming( "OTHER" );
+  pLog->clear();
+  factory.destroy( pLog );
+  factory.destroy( pOther );
+
+  // only the session's place in the shared file is marked
+  BinaryLogReader reader( "binlog/log.current.bin" );
+  BinaryLogRecord record;
+  CHECK( reader.next( record ) );
+  CHECK_EQUAL( "BEFORE", record.data );
+  CHECK( reader.next( record ) );
+  CHECK_EQUAL( BinaryLogRecord::BACKUP, record.kind );
+  CHECK_EQUAL( "FIX.4.2:SENDER->TARGET", reader.getSession( record.session ) );
+  CHECK( reader.next( record ) );
+  CHECK_EQUAL( "OTHER", record.data );
+  CHECK( reader.next( record ) );
+  CHECK_EQUAL( BinaryLogRecord::CLEAR, record.kind );
+  CHECK_EQUAL( "FIX.4.2:SENDER->TARGET", reader.getSession( record.session ) );
+  CHECK( !reader.next( record ) );
+}
+
+TEST_FIXTURE(binaryLogFixture, truncatedRecord)
+{
+  SessionID sessionID( BeginString( "FIX.4.2" ),
+                       SenderCompID( "SENDER" ), TargetCompID( "TARGET" ) );
+  Log* pLog = factory.create( sessionID );
+  pLog->onIncoming( "COMPLETE" );
+  pLog->onIncoming( "CUT SHORT" );
+  factory.destroy( pLog );
+
+  std::string contents;
+  {
+    std::ifstream stream( "binlog/log.current.bin", std::ios::binary );
+    contents.assign( std::istreambuf_iterator < char > ( stream ),
+                     std::istreambuf_iterator < char > () );
+  }
+  std::ofstream stream( "binlog/log.current.bin",
+                        std::ios::binary | std::ios::trunc );
+  stream.write( contents.data(), contents.size() - 3 );
+  stream.close();
+
+  BinaryLogReader reader( "binlog/log.current.bin" );
+  BinaryLogRecord record;
+  CHECK( reader.next( record ) );
+  CHECK_EQUAL( "COMPLETE", record.data );
+  CHECK( !reader.next( record ) );
+}
+
+TEST(formatTime)
+{
+  // 2014-01-02 03:04:05.678
+  long long time = 1388631845678LL * 1000000 + 999;
+  CHECK_EQUAL( "20140102-03:04:05.678", BinaryLogReader::formatTime( time ) );
+}
+
+}
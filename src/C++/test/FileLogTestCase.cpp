@@ -28,6 +28,7 @@
 #include <FileLog.h>
 #include <Utility.h>
 #include <fstream>
+#include <sstream>
 
 using namespace FIX;
 
@@ -114,4 +115,165 @@ TEST_FIXTURE(generateFileNameFixture, generateFileName)
   CHECK( file_exists("log/backup/FIX.4.2-GENERATEFILENAME-TEST.event.backup.4.log") );
   CHECK( file_exists("log/backup/FIX.4.2-GENERATEFILENAME-TEST.messages.backup.4.log") );
 }
+
+std::string readLog( const std::string& name )
+{
+  std::ifstream stream( name.c_str() );
+  std::stringstream contents;
+  contents << stream.rdbuf();
+  return contents.str();
+}
+
+TEST(logRing)
+{
+  LogRing ring( 3 );
+  CHECK_EQUAL( 4U, ring.capacity() );
+
+  CHECK( ring.push( LogRing::MESSAGE, "LINE1" ) );
+  CHECK( ring.push( LogRing::EVENT, "LINE2" ) );
+  CHECK( ring.push( LogRing::MESSAGE, "LINE3" ) );
+  CHECK( ring.push( LogRing::MESSAGE, "LINE4" ) );
+  CHECK( !ring.push( LogRing::MESSAGE, "LINE5" ) );
+  CHECK_EQUAL( 4U, ring.size() );
+
+  LogRing::Kind kind;
+  std::string text;
+  CHECK( ring.pop( kind, text ) );
+  CHECK_EQUAL( LogRing::MESSAGE, kind );
+  CHECK_EQUAL( "LINE1", text );
+  CHECK( ring.pop( kind, text ) );
+  CHECK_EQUAL( LogRing::EVENT, kind );
+  CHECK_EQUAL( "LINE2", text );
+
+  CHECK( ring.push( LogRing::EVENT, "LINE6" ) );
+  CHECK( ring.pop( kind, text ) );
+  CHECK_EQUAL( "LINE3", text );
+  CHECK( ring.pop( kind, text ) );
+  CHECK_EQUAL( "LINE4", text );
+  CHECK( ring.pop( kind, text ) );
+  CHECK_EQUAL( "LINE6", text );
+  CHECK( !ring.pop( kind, text ) );
+  CHECK_EQUAL( 0U, ring.size() );
+}
+
+struct asyncFileLogFixture
+{
+  asyncFileLogFixture()
+  : fileLogFactory( "log", "log" + file_separator() + "backup",
+                    AsyncLogPolicy( true, 16, AsyncLogPolicy::BLOCK, 1000000 ) )
+  {
+    deleteLogSession( "ASYNC", "TEST" );
+    SessionID sessionID( BeginString( "FIX.4.2" ),
+                         SenderCompID( "ASYNC" ), TargetCompID( "TEST" ) );
+
+    object = (FileLog*)fileLogFactory.create( sessionID );
+  }
+
+  ~asyncFileLogFixture()
+  {
+    fileLogFactory.destroy( object );
+    deleteLogSession( "ASYNC", "TEST" );
+  }
+
+  FileLogFactory fileLogFactory;
+  FileLog* object;
+};
+
+TEST_FIXTURE(asyncFileLogFixture, asyncWrite)
+{
+  CHECK( object->isThreadSafe() );
+
+  // more lines than the queue holds, so the writer has to catch up
+  for( int i = 0; i < 40; ++i )
+    object->onIncoming( "INCOMING" + IntConvertor::convert( i ) );
+  object->onEvent( "EVENT1" );
+  object->flush();
+
+  std::string messages = readLog( "log/FIX.4.2-ASYNC-TEST.messages.current.log" );
+  CHECK( messages.find( " : INCOMING0\n" ) != std::string::npos );
+  CHECK( messages.find( " : INCOMING39\n" ) != std::string::npos );
+  CHECK( messages.find( "INCOMING0" ) < messages.find( "INCOMING39" ) );
+  CHECK_EQUAL( 0, object->getDropped() );
+
+  std::string events = readLog( "log/FIX.4.2-ASYNC-TEST.event.current.log" );
+  CHECK( events.find( " : EVENT1\n" ) != std::string::npos );
+
+  object->onOutgoing( "OUTGOING1" );
+  object->backup();
+  object->onOutgoing( "OUTGOING2" );
+  object->flush();
+  messages = readLog( "log/backup/FIX.4.2-ASYNC-TEST.messages.backup.1.log" );
+  CHECK( messages.find( " : OUTGOING1\n" ) != std::string::npos );
+  CHECK( messages.find( "OUTGOING2" ) == std::string::npos );
+  messages = readLog( "log/FIX.4.2-ASYNC-TEST.messages.current.log" );
+  CHECK( messages.find( " : OUTGOING2\n" ) != std::string::npos );
+}
+
+struct rotateFileLogFixture
+{
+  rotateFileLogFixture()
+  : fileLogFactory( "log", "log" + file_separator() + "backup",
+                    AsyncLogPolicy( true, 16, AsyncLogPolicy::BLOCK, 1000000 ),
+                    LogRotationPolicy( 100, 2 ) )
+  {
+    deleteLogSession( "ROTATE", "TEST" );
+    SessionID sessionID( BeginString( "FIX.4.2" ),
+                         SenderCompID( "ROTATE" ), TargetCompID( "TEST" ) );
+
+    object = (FileLog*)fileLogFactory.create( sessionID );
+  }
+
+  ~rotateFileLogFixture()
+  {
+    fileLogFactory.destroy( object );
+    deleteLogSession( "ROTATE", "TEST" );
+  }
+
+  FileLogFactory fileLogFactory;
+  FileLog* object;
+};
+
+TEST_FIXTURE(rotateFileLogFixture, rotateBySize)
+{
+  // each round writes more than the limit, so every flush rotates
+  for( int i = 1; i <= 4; ++i )
+  {
+    object->onIncoming( "INCOMING" + IntConvertor::convert( i )
+                        + std::string( 100, 'X' ) );
+    object->flush();
+  }
+
+  std::string messages = readLog( "log/backup/FIX.4.2-ROTATE-TEST.messages.backup.1.log" );
+  CHECK( messages.find( " : INCOMING3X" ) != std::string::npos );
+  messages = readLog( "log/backup/FIX.4.2-ROTATE-TEST.messages.backup.2.log" );
+  CHECK( messages.find( " : INCOMING4X" ) != std::string::npos );
+  CHECK( file_exists( "log/backup/FIX.4.2-ROTATE-TEST.event.backup.2.log" ) );
+  CHECK( !file_exists( "log/backup/FIX.4.2-ROTATE-TEST.messages.backup.3.log" ) );
+  CHECK( !file_exists( "log/backup/FIX.4.2-ROTATE-TEST.event.backup.3.log" ) );
+
+  messages = readLog( "log/FIX.4.2-ROTATE-TEST.messages.current.log" );
+  CHECK( messages.empty() );
+}
+
+TEST(rotateOnSchedule)
+{
+  LogRotationPolicy policy( 0, 0,
+    TimeRange( UtcTimeOnly( 8, 0, 0 ), UtcTimeOnly( 18, 0, 0 ) ) );
+  CHECK( policy.enabled() );
+
+  UtcTimeStamp opened( 9, 0, 0, 10, 10, 2000 );
+  CHECK( !policy.isDue( 1000, opened, UtcTimeStamp( 17, 0, 0, 10, 10, 2000 ) ) );
+  // nothing rotates while the session is closed
+  CHECK( !policy.isDue( 1000, opened, UtcTimeStamp( 20, 0, 0, 10, 10, 2000 ) ) );
+  CHECK( policy.isDue( 1000, opened, UtcTimeStamp( 8, 0, 1, 11, 10, 2000 ) ) );
+
+  Dictionary settings;
+  settings.setString( FILE_LOG_ROTATE_SIZE, "10M" );
+  settings.setString( FILE_LOG_RETAIN_COUNT, "5" );
+  LogRotationPolicy configured( settings );
+  CHECK_EQUAL( 10 * 1024 * 1024, configured.getSize() );
+  CHECK_EQUAL( 5, configured.getRetain() );
+  CHECK( configured.isDue( 10 * 1024 * 1024, opened, opened ) );
+  CHECK( !configured.isDue( 1000, opened, UtcTimeStamp( 8, 0, 1, 11, 10, 2000 ) ) );
+}
 }
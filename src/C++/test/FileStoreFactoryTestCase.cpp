@@ -64,9 +64,9 @@ TEST_FIXTURE(callCreateFixture, callCreate)
   CHECK( !messageFile.fail() );
   messageFile.close();
 
-  std::ifstream seqnumsFile( "store/FIX.4.2-FS-FACT.seqnums" );
-  CHECK( !seqnumsFile.fail() );
-  seqnumsFile.close();
+  std::ifstream seqPageFile( "store/FIX.4.2-FS-FACT.seqpage" );
+  CHECK( !seqPageFile.fail() );
+  seqPageFile.close();
 
   std::ifstream sessionFile( "store/FIX.4.2-FS-FACT.session" );
   CHECK( !sessionFile.fail() );
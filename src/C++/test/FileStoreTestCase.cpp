@@ -108,4 +108,109 @@ TEST_FIXTURE(resetAfterFileStoreFixture, refresh)
   CHECK_MESSAGE_STORE_RELOAD
 }
 
+TEST(checkpointAndReplay)
+{
+  SessionID sessionID( BeginString( "FIX.4.2" ),
+                       SenderCompID( "CHECKPOINT" ), TargetCompID( "TEST" ) );
+
+  FileStore store( "store", sessionID, SyncPolicy(), 10 );
+  store.reset();
+  for( int i = 1; i <= 25; ++i )
+    store.set( i, "message " + IntConvertor::convert( i ) );
+
+  // messages 21 to 25 are only in the index until the next checkpoint
+  {
+    FileStore recovered( "store", sessionID, SyncPolicy(), 10 );
+    std::vector < std::string > messages;
+    recovered.get( 1, 25, messages );
+    CHECK_EQUAL( 25U, messages.size() );
+    CHECK_EQUAL( "message 1", messages[ 0 ] );
+    CHECK_EQUAL( "message 25", messages[ 24 ] );
+  }
+
+  store.set( 5, "message 5 again" );
+  store.checkpoint();
+
+  FileStore recovered( "store", sessionID, SyncPolicy(), 10 );
+  std::vector < std::string > messages;
+  recovered.get( 4, 6, messages );
+  CHECK_EQUAL( 3U, messages.size() );
+  CHECK_EQUAL( "message 5 again", messages[ 1 ] );
+  recovered.get( 26, 30, messages );
+  CHECK_EQUAL( 0U, messages.size() );
+
+  store.reset();
+}
+
+TEST(migrateSeqNums)
+{
+  SessionID sessionID( BeginString( "FIX.4.2" ),
+                       SenderCompID( "MIGRATE" ), TargetCompID( "TEST" ) );
+  deleteSession( "MIGRATE", "TEST" );
+  file_mkdir( "store" );
+
+  {
+    std::ofstream seqnums( "store/FIX.4.2-MIGRATE-TEST.seqnums" );
+    seqnums << "0000000012 : 0000000034";
+  }
+
+  {
+    FileStore store( "store", sessionID );
+    CHECK( !file_exists( "store/FIX.4.2-MIGRATE-TEST.seqnums" ) );
+    CHECK_EQUAL( 12, store.getNextSenderMsgSeqNum() );
+    CHECK_EQUAL( 34, store.getNextTargetMsgSeqNum() );
+    store.incrNextSenderMsgSeqNum();
+  }
+
+  FileStore store( "store", sessionID );
+  CHECK_EQUAL( 13, store.getNextSenderMsgSeqNum() );
+  CHECK_EQUAL( 34, store.getNextTargetMsgSeqNum() );
+  store.reset();
+}
+
+TEST(keepUnreadableSeqNums)
+{
+  SessionID sessionID( BeginString( "FIX.4.2" ),
+                       SenderCompID( "MIGRATE" ), TargetCompID( "TEST" ) );
+  deleteSession( "MIGRATE", "TEST" );
+  file_mkdir( "store" );
+
+  {
+    std::ofstream seqnums( "store/FIX.4.2-MIGRATE-TEST.seqnums" );
+    seqnums << "garbage";
+  }
+
+  FileStore store( "store", sessionID );
+  CHECK( file_exists( "store/FIX.4.2-MIGRATE-TEST.seqnums" ) );
+  CHECK_EQUAL( 1, store.getNextSenderMsgSeqNum() );
+  CHECK_EQUAL( 1, store.getNextTargetMsgSeqNum() );
+  store.reset();
+}
+
+TEST(convertHeader)
+{
+  SessionID sessionID( BeginString( "FIX.4.2" ),
+                       SenderCompID( "CONVERT" ), TargetCompID( "TEST" ) );
+  deleteSession( "CONVERT", "TEST" );
+  file_mkdir( "store" );
+
+  std::string prefix = "store/FIX.4.2-CONVERT-TEST.";
+  {
+    std::ofstream body( ( prefix + "body" ).c_str() );
+    body << "firstsecond";
+    std::ofstream header( ( prefix + "header" ).c_str() );
+    header << "1,0,5 2,5,6 ";
+  }
+
+  FileStore store( "store", sessionID );
+  CHECK( !file_exists( ( prefix + "header" ).c_str() ) );
+  std::vector < std::string > messages;
+  store.get( 1, 2, messages );
+  CHECK_EQUAL( 2U, messages.size() );
+  CHECK_EQUAL( "first", messages[ 0 ] );
+  CHECK_EQUAL( "second", messages[ 1 ] );
+
+  store.reset();
+}
+
 }
@@ -0,0 +1,112 @@
+/****************************************************************************
+** Copyright (c) 2001-2014
+**
+** This file is part of the QuickFIX FIX Engine
+**
+** This file may be distributed under the terms of the quickfixengine.org
+** license as defined by quickfixengine.org and appearing in the file
+** LICENSE included in the packaging of this file.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** See http://www.quickfixengine.org/LICENSE for licensing information.
+**
+** Contact ask@quickfixengine.org if any conditions of this licensing are
+** not clear to you.
+**
+****************************************************************************/
+
+#ifdef _MSC_VER
+#pragma warning( disable : 4503 4355 4786 )
+#include "stdafx.h"
+#else
+#include "config.h"
+#endif
+
+#include <UnitTest++.h>
+#include <GapQueue.h>
+
+using namespace FIX;
+
+SUITE(GapQueueTests)
+{
+
+TEST(pushAndPop)
+{
+  GapQueue queue;
+  CHECK( queue.push( 5, "five" ) );
+  CHECK( queue.push( 3, "three" ) );
+  CHECK_EQUAL( 2U, queue.count() );
+  CHECK_EQUAL( 9U, queue.size() );
+
+  std::string message;
+  CHECK( !queue.pop( 4, message ) );
+  CHECK( queue.pop( 3, message ) );
+  CHECK_EQUAL( "three", message );
+  CHECK( !queue.pop( 3, message ) );
+  CHECK( queue.pop( 5, message ) );
+  CHECK_EQUAL( "five", message );
+  CHECK( queue.empty() );
+  CHECK_EQUAL( 0U, queue.size() );
+}
+
+TEST(replace)
+{
+  GapQueue queue( 10 );
+  CHECK( queue.push( 2, "first" ) );
+  CHECK( queue.push( 2, "again" ) );
+  CHECK_EQUAL( 1U, queue.count() );
+  CHECK_EQUAL( 5U, queue.size() );
+
+  std::string message;
+  CHECK( queue.pop( 2, message ) );
+  CHECK_EQUAL( "again", message );
+}
+
+TEST(maxSize)
+{
+  GapQueue queue( 10 );
+  CHECK( queue.push( 1, "12345" ) );
+  CHECK( queue.push( 2, "12345" ) );
+  CHECK( !queue.push( 3, "1" ) );
+  CHECK_EQUAL( 2U, queue.count() );
+
+  std::string message;
+  CHECK( queue.pop( 1, message ) );
+  CHECK( queue.push( 3, "1" ) );
+
+  queue.setMaxSize( 0 );
+  CHECK( queue.push( 4, std::string( 1000, 'x' ) ) );
+}
+
+TEST(compact)
+{
+  GapQueue queue;
+  for( int i = 1; i <= 100; ++i )
+    CHECK( queue.push( i, std::string( i, 'a' + i % 26 ) ) );
+
+  std::string message;
+  for( int i = 1; i <= 100; i += 2 )
+    CHECK( queue.pop( i, message ) );
+  for( int i = 100; i >= 2; i -= 2 )
+  {
+    CHECK( queue.pop( i, message ) );
+    CHECK_EQUAL( std::string( i, 'a' + i % 26 ), message );
+  }
+  CHECK( queue.empty() );
+}
+
+TEST(clear)
+{
+  GapQueue queue;
+  queue.push( 1, "one" );
+  queue.clear();
+  CHECK( queue.empty() );
+  CHECK_EQUAL( 0U, queue.size() );
+
+  std::string message;
+  CHECK( !queue.pop( 1, message ) );
+}
+
+}
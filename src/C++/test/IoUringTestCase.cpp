@@ -0,0 +1,98 @@
+/****************************************************************************
+** Copyright (c) 2001-2014
+**
+** This file is part of the QuickFIX FIX Engine
+**
+** This file may be distributed under the terms of the quickfixengine.org
+** license as defined by quickfixengine.org and appearing in the file
+** LICENSE included in the packaging of this file.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** See http://www.quickfixengine.org/LICENSE for licensing information.
+**
+** Contact ask@quickfixengine.org if any conditions of this licensing are
+** not clear to you.
+**
+****************************************************************************/
+
+#ifdef _MSC_VER
+#pragma warning( disable : 4503 4355 4786 )
+#include "stdafx.h"
+#else
+#include "config.h"
+#endif
+
+#ifdef HAVE_LIBURING
+
+#include <UnitTest++.h>
+#include <IoUring.h>
+#include <string>
+
+using namespace FIX;
+
+SUITE(IoUringTests)
+{
+
+TEST(sendChainCompletes)
+{
+  SendChain chain;
+  std::string data( 100, 'x' );
+  chain.assign( data );
+  CHECK( data.empty() );
+  CHECK_EQUAL( 100U, chain.pending() );
+
+  CHECK_EQUAL( 4U, chain.prepare( 30 ) );
+  CHECK_EQUAL( 10U, chain.length( 3 ) );
+  CHECK( !chain.complete( 0, 30 ) );
+  CHECK( !chain.complete( 1, 30 ) );
+  CHECK( !chain.complete( 2, 30 ) );
+  CHECK( chain.complete( 3, 10 ) );
+  CHECK( chain.empty() );
+  CHECK_EQUAL( 0U, chain.pending() );
+}
+
+TEST(sendChainResumesAfterShortSend)
+{
+  SendChain chain;
+  std::string data;
+  for( int i = 0; i < 100; ++i )
+    data += (char)( 'a' + i % 26 );
+  std::string expected = data;
+  chain.assign( data );
+
+  // the second send only writes part of its range, the third is
+  // cancelled and the last reports bytes that must not count
+  CHECK_EQUAL( 4U, chain.prepare( 30 ) );
+  CHECK( !chain.complete( 0, 30 ) );
+  CHECK( !chain.complete( 1, 12 ) );
+  CHECK( !chain.complete( 2, -ECANCELED ) );
+  CHECK( chain.complete( 3, 10 ) );
+  CHECK_EQUAL( 58U, chain.pending() );
+
+  CHECK_EQUAL( 2U, chain.prepare( 30 ) );
+  CHECK_EQUAL( expected.substr( 42, 30 ), std::string( chain.data( 0 ), chain.length( 0 ) ) );
+  CHECK_EQUAL( expected.substr( 72 ), std::string( chain.data( 1 ), chain.length( 1 ) ) );
+  CHECK( !chain.complete( 0, 30 ) );
+  CHECK( chain.complete( 1, 28 ) );
+  CHECK( chain.empty() );
+}
+
+TEST(sendChainIsLimited)
+{
+  const unsigned sends = SendChain::MAX_SENDS;
+  SendChain chain;
+  std::string data( sends * 10 + 5, 'x' );
+  chain.assign( data );
+
+  CHECK_EQUAL( sends, chain.prepare( 10 ) );
+  for( unsigned i = 0; i < sends; ++i )
+    chain.complete( i, 10 );
+  CHECK_EQUAL( 5U, chain.pending() );
+  CHECK_EQUAL( 1U, chain.prepare( 10 ) );
+}
+
+}
+
+#endif
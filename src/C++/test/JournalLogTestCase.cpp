@@ -0,0 +1,145 @@
+/****************************************************************************
+** Copyright (c) 2001-2014
+**
+** This file is part of the QuickFIX FIX Engine
+**
+** This file may be distributed under the terms of the quickfixengine.org
+** license as defined by quickfixengine.org and appearing in the file
+** LICENSE included in the packaging of this file.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** See http://www.quickfixengine.org/LICENSE for licensing information.
+**
+** Contact ask@quickfixengine.org if any conditions of this licensing are
+** not clear to you.
+**
+****************************************************************************/
+
+#ifdef _MSC_VER
+#pragma warning( disable : 4503 4355 4786 )
+#include "stdafx.h"
+#else
+#include "config.h"
+#endif
+
+#include <UnitTest++.h>
+#include <JournalLog.h>
+#include <Utility.h>
+
+using namespace FIX;
+
+SUITE(JournalLogTests)
+{
+
+void deleteJournals()
+{
+  for( int i = 0; i < 3; ++i )
+    file_unlink( ( "journal/journal." + IntConvertor::convert( i ) + ".bin" ).c_str() );
+}
+
+struct journalLogFixture
+{
+  journalLogFixture()
+  {
+    deleteJournals();
+  }
+
+  ~journalLogFixture()
+  {
+    deleteJournals();
+  }
+};
+
+SessionID journalSession( int i )
+{
+  return SessionID( BeginString( "FIX.4.2" ),
+                    SenderCompID( "SENDER" + IntConvertor::convert( i ) ),
+                    TargetCompID( "TARGET" ) );
+}
+
+TEST_FIXTURE(journalLogFixture, multiplexSessions)
+{
+  {
+    JournalLogFactory factory( "journal", 3 );
+    std::vector < Log* > logs;
+    for( int i = 0; i < 20; ++i )
+      logs.push_back( factory.create( journalSession( i ) ) );
+
+    for( int line = 0; line < 5; ++line )
+    {
+      for( int i = 0; i < 20; ++i )
+        logs[ i ]->onIncoming( IntConvertor::convert( line ) );
+    }
+    logs[ 0 ]->backup();
+    logs[ 0 ]->onEvent( "AFTER BACKUP" );
+    logs[ 1 ]->clear();
+
+    for( int i = 0; i < 20; ++i )
+      factory.destroy( logs[ i ] );
+  }
+
+  // every session is in one journal, with its lines in order
+  std::map < std::string, int > journals;
+  std::map < std::string, int > lines;
+  bool markers[ 2 ] = { false, false };
+  for( int journal = 0; journal < 3; ++journal )
+  {
+    BinaryLogReader reader( "journal/journal." + IntConvertor::convert( journal ) + ".bin" );
+    BinaryLogRecord record;
+    while( reader.next( record ) )
+    {
+      std::string session = reader.getSession( record.session );
+      CHECK( !journals.count( session ) || journals[ session ] == journal );
+      journals[ session ] = journal;
+
+      if( record.kind == BinaryLogRecord::INCOMING )
+        CHECK_EQUAL( IntConvertor::convert( lines[ session ]++ ), record.data );
+      else if( record.kind == BinaryLogRecord::BACKUP )
+      {
+        CHECK_EQUAL( journalSession( 0 ).toString(), session );
+        CHECK_EQUAL( 5, lines[ session ] );
+        markers[ 0 ] = true;
+      }
+      else if( record.kind == BinaryLogRecord::CLEAR )
+      {
+        CHECK_EQUAL( journalSession( 1 ).toString(), session );
+        markers[ 1 ] = true;
+      }
+    }
+  }
+
+  CHECK_EQUAL( 20U, journals.size() );
+  CHECK_EQUAL( 20U, lines.size() );
+  CHECK_EQUAL( 5, lines[ journalSession( 19 ).toString() ] );
+  CHECK( markers[ 0 ] && markers[ 1 ] );
+}
+
+TEST_FIXTURE(journalLogFixture, sameJournalAfterRestart)
+{
+  for( int run = 0; run < 2; ++run )
+  {
+    JournalLogFactory factory( "journal", 3 );
+    Log* pLog = factory.create( journalSession( 7 ) );
+    pLog->onIncoming( IntConvertor::convert( run ) );
+    factory.destroy( pLog );
+  }
+
+  int found = 0;
+  for( int journal = 0; journal < 3; ++journal )
+  {
+    BinaryLogReader reader( "journal/journal." + IntConvertor::convert( journal ) + ".bin" );
+    BinaryLogRecord record;
+    int records = 0;
+    while( reader.next( record ) )
+    {
+      CHECK_EQUAL( journalSession( 7 ).toString(), reader.getSession( record.session ) );
+      CHECK_EQUAL( IntConvertor::convert( records++ ), record.data );
+    }
+    if( records ) ++found;
+  }
+  CHECK_EQUAL( 1, found );
+}
+
+}
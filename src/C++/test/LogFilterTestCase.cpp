@@ -0,0 +1,103 @@
+/****************************************************************************
+** Copyright (c) 2001-2014
+**
+** This file is part of the QuickFIX FIX Engine
+**
+** This file may be distributed under the terms of the quickfixengine.org
+** license as defined by quickfixengine.org and appearing in the file
+** LICENSE included in the packaging of this file.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** See http://www.quickfixengine.org/LICENSE for licensing information.
+**
+** Contact ask@quickfixengine.org if any conditions of this licensing are
+** not clear to you.
+**
+****************************************************************************/
+
+#ifdef _MSC_VER
+#pragma warning( disable : 4503 4355 4786 )
+#include "stdafx.h"
+#else
+#include "config.h"
+#endif
+
+#include <UnitTest++.h>
+#include <LogFilter.h>
+#include <SessionSettings.h>
+
+using namespace FIX;
+
+SUITE(LogFilterTests)
+{
+
+std::string rawMessage( const std::string& msgType )
+{
+  return "8=FIX.4.2\0019=12\00135=" + msgType + "\00149=TW\00110=000\001";
+}
+
+TEST(acceptAllByDefault)
+{
+  LogFilter filter;
+  CHECK( filter.accept( rawMessage( "W" ) ) );
+  CHECK( filter.accept( "garbage" ) );
+  CHECK_EQUAL( 0, filter.getFiltered() );
+}
+
+TEST(includeAndExclude)
+{
+  Dictionary settings;
+  settings.setString( LOG_INCLUDE_MSG_TYPES, "D, 8" );
+  settings.setString( LOG_EXCLUDE_MSG_TYPES, "0" );
+  LogFilter filter( settings );
+
+  CHECK( filter.accept( rawMessage( "D" ) ) );
+  CHECK( filter.accept( rawMessage( "8" ) ) );
+  CHECK( filter.accept( rawMessage( "A" ) ) );
+  CHECK( !filter.accept( rawMessage( "0" ) ) );
+  // nothing else is logged unless it is sampled
+  CHECK( !filter.accept( rawMessage( "W" ) ) );
+  CHECK( !filter.accept( rawMessage( "DD" ) ) );
+  CHECK_EQUAL( 3, filter.getFiltered() );
+}
+
+TEST(sampleRate)
+{
+  LogFilter filter;
+  filter.include( "D" );
+  filter.setSampleRate( 4 );
+
+  int logged = 0;
+  for( int i = 0; i < 100; ++i )
+  {
+    if( filter.accept( rawMessage( "X" ) ) ) ++logged;
+    CHECK( filter.accept( rawMessage( "D" ) ) );
+  }
+  CHECK_EQUAL( 25, logged );
+  CHECK_EQUAL( 75, filter.getFiltered() );
+}
+
+TEST(maxBytesPerSecond)
+{
+  std::string message = rawMessage( "W" );
+  LogFilter filter;
+  filter.setMaxBytesPerSecond( (long)message.size() * 3 );
+
+  int logged = 0;
+  for( int i = 0; i < 10; ++i )
+    if( filter.accept( message ) ) ++logged;
+  // a second may have started during the loop
+  CHECK( logged >= 3 && logged <= 6 );
+  // session level messages are never limited
+  CHECK( filter.accept( rawMessage( "5" ) ) );
+}
+
+TEST(invalidSettings)
+{
+  Dictionary settings;
+  settings.setString( LOG_SAMPLE_RATE, "-1" );
+  CHECK_THROW( LogFilter filter( settings ), ConfigError );
+}
+}
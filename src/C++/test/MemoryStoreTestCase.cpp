@@ -49,4 +49,195 @@ struct memoryStoreFixture
   MessageStore* object;
 };
 
+SUITE(MessageStoreCursorTests)
+{
+
+TEST(pages)
+{
+  MemoryStore store;
+  for( int i = 1; i <= 10; ++i )
+  {
+    if( i != 4 && i != 5 && i != 6 )
+      store.set( i, IntConvertor::convert( i ) );
+  }
+
+  MessageStoreCursor cursor( store, 2, 9, 3 );
+  std::string message;
+  std::vector < std::string > messages;
+  while( cursor.next( message ) )
+    messages.push_back( message );
+
+  CHECK_EQUAL( 5U, messages.size() );
+  CHECK_EQUAL( "2", messages[ 0 ] );
+  CHECK_EQUAL( "3", messages[ 1 ] );
+  CHECK_EQUAL( "7", messages[ 2 ] );
+  CHECK_EQUAL( "9", messages[ 4 ] );
+  CHECK( !cursor.next( message ) );
+}
+
+TEST(emptyRange)
+{
+  MemoryStore store;
+  store.set( 1, "1" );
+  std::string message;
+  MessageStoreCursor cursor( store, 2, 1000 );
+  CHECK( !cursor.next( message ) );
+}
+
+}
+
+SUITE(BoundedMemoryStoreTests)
+{
+
+std::string boundedMessage( int msgSeqNum, size_t size )
+{
+  std::string message = IntConvertor::convert( msgSeqNum ) + ":";
+  message.resize( size, (char)( 'A' + msgSeqNum % 26 ) );
+  return message;
+}
+
+TEST(evictByMessages)
+{
+  BoundedMemoryStore object( 3, 0 );
+  for( int i = 1; i <= 5; ++i )
+    object.set( i, boundedMessage( i, 20 ) );
+
+  std::vector < std::string > messages;
+  object.get( 1, 5, messages );
+  CHECK_EQUAL( 3U, messages.size() );
+  CHECK_EQUAL( boundedMessage( 3, 20 ), messages[ 0 ] );
+  CHECK_EQUAL( boundedMessage( 5, 20 ), messages[ 2 ] );
+
+  BoundedMemoryStore::Statistics statistics;
+  object.getStatistics( statistics );
+  CHECK_EQUAL( 3, statistics.firstSeqNum );
+  CHECK_EQUAL( 5, statistics.lastSeqNum );
+  CHECK_EQUAL( 60U, statistics.bytes );
+  CHECK_EQUAL( 2U, statistics.evictedMessages );
+  CHECK_EQUAL( 40U, statistics.evictedBytes );
+}
+
+TEST(evictByBytes)
+{
+  BoundedMemoryStore object( 0, 100 );
+  for( int i = 1; i <= 50; ++i )
+  {
+    object.set( i, boundedMessage( i, 17 + i % 13 ) );
+
+    BoundedMemoryStore::Statistics statistics;
+    object.getStatistics( statistics );
+    CHECK( statistics.bytes <= 100 );
+    CHECK_EQUAL( 100U, statistics.capacity );
+    CHECK_EQUAL( i, statistics.lastSeqNum );
+
+    std::vector < std::string > messages;
+    object.get( 1, i, messages );
+    CHECK_EQUAL( statistics.messages, messages.size() );
+    for( size_t j = 0; j < messages.size(); ++j )
+    {
+      int msgSeqNum = statistics.firstSeqNum + (int)j;
+      CHECK_EQUAL( boundedMessage( msgSeqNum, 17 + msgSeqNum % 13 ), messages[ j ] );
+    }
+  }
+}
+
+TEST(oversizedMessage)
+{
+  BoundedMemoryStore object( 0, 64 );
+  object.set( 1, boundedMessage( 1, 32 ) );
+  object.set( 2, boundedMessage( 2, 65 ) );
+  object.set( 3, boundedMessage( 3, 16 ) );
+
+  std::vector < std::string > messages;
+  object.get( 1, 3, messages );
+  CHECK_EQUAL( 2U, messages.size() );
+  CHECK_EQUAL( boundedMessage( 1, 32 ), messages[ 0 ] );
+  CHECK_EQUAL( boundedMessage( 3, 16 ), messages[ 1 ] );
+
+  BoundedMemoryStore::Statistics statistics;
+  object.getStatistics( statistics );
+  CHECK_EQUAL( 1U, statistics.evictedMessages );
+}
+
+TEST(growWithoutByteLimit)
+{
+  BoundedMemoryStore object( 100, 0 );
+  for( int i = 1; i <= 150; ++i )
+    object.set( i, boundedMessage( i, 4096 ) );
+
+  std::vector < std::string > messages;
+  object.get( 1, 150, messages );
+  CHECK_EQUAL( 100U, messages.size() );
+  CHECK_EQUAL( boundedMessage( 51, 4096 ), messages.front() );
+  CHECK_EQUAL( boundedMessage( 150, 4096 ), messages.back() );
+
+  BoundedMemoryStore::Statistics statistics;
+  object.getStatistics( statistics );
+  CHECK( statistics.capacity >= 100U * 4096 );
+}
+
+TEST(emptyMessages)
+{
+  BoundedMemoryStore unbounded( 10, 0 );
+  unbounded.set( 1, "" );
+  unbounded.set( 2, boundedMessage( 2, 20 ) );
+  unbounded.set( 3, "" );
+
+  std::vector < std::string > messages;
+  unbounded.get( 1, 3, messages );
+  CHECK_EQUAL( 3U, messages.size() );
+  CHECK_EQUAL( boundedMessage( 2, 20 ), messages[ 1 ] );
+
+  BoundedMemoryStore bounded( 0, 64 );
+  bounded.set( 1, "" );
+  bounded.set( 2, "" );
+  bounded.set( 3, boundedMessage( 3, 64 ) );
+
+  bounded.get( 1, 3, messages );
+  CHECK_EQUAL( 3U, messages.size() );
+  CHECK_EQUAL( boundedMessage( 3, 64 ), messages[ 2 ] );
+
+  BoundedMemoryStore::Statistics statistics;
+  bounded.getStatistics( statistics );
+  CHECK_EQUAL( 0U, statistics.evictedMessages );
+}
+
+TEST(overwriteTail)
+{
+  BoundedMemoryStore object( 10, 0 );
+  for( int i = 1; i <= 5; ++i )
+    object.set( i, boundedMessage( i, 10 ) );
+  object.set( 3, boundedMessage( 30, 12 ) );
+
+  std::vector < std::string > messages;
+  object.get( 1, 5, messages );
+  CHECK_EQUAL( 3U, messages.size() );
+  CHECK_EQUAL( boundedMessage( 30, 12 ), messages[ 2 ] );
+
+  object.reset();
+  object.get( 1, 5, messages );
+  CHECK( messages.empty() );
+  CHECK_EQUAL( 1, object.getNextSenderMsgSeqNum() );
+}
+
+TEST(factory)
+{
+  Dictionary dictionary;
+  dictionary.setString( MEMORY_STORE_MAX_MESSAGES, "5" );
+  MemoryStoreFactory factory( dictionary );
+  SessionID sessionID( BeginString( "FIX.4.2" ),
+                       SenderCompID( "SETGET" ), TargetCompID( "TEST" ) );
+  MessageStore* pStore = factory.create( sessionID );
+  BoundedMemoryStore* pBounded = dynamic_cast < BoundedMemoryStore* > ( pStore );
+  CHECK( pBounded != 0 );
+  if( pBounded )
+    CHECK_EQUAL( 5U, pBounded->getMaxMessages() );
+  factory.destroy( pStore );
+
+  dictionary.setString( MEMORY_STORE_MAX_BYTES, "-1" );
+  CHECK_THROW( MemoryStoreFactory( dictionary ).create( sessionID ), ConfigError );
+}
+
+}
+
 }
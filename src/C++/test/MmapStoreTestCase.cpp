@@ -0,0 +1,176 @@
+/****************************************************************************
+** Copyright (c) 2001-2014
+**
+** This file is part of the QuickFIX FIX Engine
+**
+** This file may be distributed under the terms of the quickfixengine.org
+** license as defined by quickfixengine.org and appearing in the file
+** LICENSE included in the packaging of this file.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** See http://www.quickfixengine.org/LICENSE for licensing information.
+**
+** Contact ask@quickfixengine.org if any conditions of this licensing are
+** not clear to you.
+**
+****************************************************************************/
+
+#ifdef _MSC_VER
+#pragma warning( disable : 4503 4355 4786 )
+#include "stdafx.h"
+#else
+#include "config.h"
+#endif
+
+#include <UnitTest++.h>
+#include <TestHelper.h>
+#include <MmapStore.h>
+#include "MessageStoreTestCase.h"
+
+using namespace FIX;
+
+SUITE(MmapStoreTests)
+{
+
+struct mmapStoreFixture
+{
+  mmapStoreFixture( bool resetBefore, bool resetAfter )
+  : factory( "store" )
+  {
+    SessionID sessionID( BeginString( "FIX.4.2" ),
+                         SenderCompID( "SETGET" ), TargetCompID( "MMAP" ) );
+
+    object = factory.create( sessionID );
+
+    if( resetBefore )
+      object->reset();
+
+    this->resetAfter = resetAfter;
+  }
+
+  ~mmapStoreFixture()
+  {
+    if( resetAfter )
+      object->reset();
+
+    factory.destroy( object );
+  }
+
+  MmapStoreFactory factory;
+  MessageStore* object;
+  bool resetAfter;
+};
+
+struct resetBeforeMmapStoreFixture : mmapStoreFixture
+{
+  resetBeforeMmapStoreFixture() : mmapStoreFixture( true, false ) {}
+};
+
+struct resetAfterMmapStoreFixture : mmapStoreFixture
+{
+  resetAfterMmapStoreFixture() : mmapStoreFixture( false, true ) {}
+};
+
+struct resetBeforeAndAfterMmapStoreFixture : mmapStoreFixture
+{
+  resetBeforeAndAfterMmapStoreFixture() : mmapStoreFixture( true, true ) {}
+};
+
+struct noResetMmapStoreFixture : mmapStoreFixture
+{
+  noResetMmapStoreFixture() : mmapStoreFixture( false, false ) {}
+};
+
+TEST_FIXTURE(resetBeforeAndAfterMmapStoreFixture, setGet)
+{
+  CHECK_MESSAGE_STORE_SET_GET;
+}
+
+TEST_FIXTURE(resetBeforeAndAfterMmapStoreFixture, setGetWithQuote)
+{
+  CHECK_MESSAGE_STORE_SET_GET_WITH_QUOTE;
+}
+
+TEST_FIXTURE(resetBeforeMmapStoreFixture, other)
+{
+  CHECK_MESSAGE_STORE_OTHER
+}
+
+TEST_FIXTURE(noResetMmapStoreFixture, reload)
+{
+  CHECK_MESSAGE_STORE_REFRESH
+}
+
+TEST_FIXTURE(resetAfterMmapStoreFixture, refresh)
+{
+  CHECK_MESSAGE_STORE_RELOAD
+}
+
+TEST(segmentRollover)
+{
+  SessionID sessionID( BeginString( "FIX.4.2" ),
+                       SenderCompID( "ROLLOVER" ), TargetCompID( "MMAP" ) );
+
+  {
+    MmapStore store( "store", sessionID, 4096 );
+    store.reset();
+    for( int i = 1; i <= 100; ++i )
+      store.set( i, std::string( 100 + i, 'A' + i % 26 ) );
+  }
+
+  MmapStore store( "store", sessionID, 4096 );
+  std::vector < MmapStore::View > views;
+  store.get( 1, 100, views );
+  CHECK_EQUAL( 100U, views.size() );
+  CHECK_EQUAL( 200U, views[ 99 ].second );
+  CHECK_EQUAL( std::string( 150, 'A' + 50 % 26 ),
+               std::string( views[ 49 ].first, views[ 49 ].second ) );
+
+  store.set( 101, "after reopen" );
+  std::vector < std::string > messages;
+  store.get( 100, 200, messages );
+  CHECK_EQUAL( 2U, messages.size() );
+  CHECK_EQUAL( "after reopen", messages[ 1 ] );
+
+  CHECK_THROW( store.set( 102, std::string( 8192, 'X' ) ), IOException );
+  store.reset();
+}
+
+TEST(sparseSequenceNumbers)
+{
+  SessionID sessionID( BeginString( "FIX.4.2" ),
+                       SenderCompID( "SPARSE" ), TargetCompID( "MMAP" ) );
+
+  {
+    MmapStore store( "store", sessionID, 4096 );
+    store.reset();
+    for( int i = 1; i <= 10; ++i )
+      store.set( i, "message " + IntConvertor::convert( i ) );
+    store.set( 1000000000, "after jump" );
+    store.set( 1000000001, "after jump and one" );
+    store.set( 20, "behind jump" );
+    store.set( 5, "rewritten" );
+  }
+
+  MmapStore store( "store", sessionID, 4096 );
+  std::vector < std::string > messages;
+  store.get( 1, 2000000000, messages );
+  CHECK_EQUAL( 13U, messages.size() );
+  CHECK_EQUAL( "rewritten", messages[ 4 ] );
+  CHECK_EQUAL( "behind jump", messages[ 10 ] );
+  CHECK_EQUAL( "after jump", messages[ 11 ] );
+  CHECK_EQUAL( "after jump and one", messages[ 12 ] );
+
+  store.get( 10, 999999999, messages );
+  CHECK_EQUAL( 2U, messages.size() );
+  CHECK_EQUAL( "message 10", messages[ 0 ] );
+
+  store.get( 1000000001, 1000000001, messages );
+  CHECK_EQUAL( 1U, messages.size() );
+  CHECK_EQUAL( "after jump and one", messages[ 0 ] );
+  store.reset();
+}
+
+}
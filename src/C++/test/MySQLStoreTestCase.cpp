@@ -80,6 +80,34 @@ struct resetMySQLStoreFixture : mySQLStoreFixture
   resetMySQLStoreFixture() : mySQLStoreFixture( true ) {}
 };
 
+struct batchMySQLStoreFixture
+{
+  static Dictionary settings()
+  {
+    Dictionary settings = TestSettings::sessionSettings.get();
+    settings.setString( STORE_SYNC_POLICY, "COUNT" );
+    settings.setString( STORE_SYNC_COUNT, "3" );
+    return settings;
+  }
+
+  batchMySQLStoreFixture()
+  : factory( settings() )
+  {
+    SessionID sessionID( BeginString( "FIX.4.2" ),
+                         SenderCompID( "BATCH" ), TargetCompID( "TEST" ) );
+    object = factory.create( sessionID );
+    object->reset();
+  }
+
+  ~batchMySQLStoreFixture()
+  {
+    factory.destroy( object );
+  }
+
+  MySQLStoreFactory factory;
+  MessageStore* object;
+};
+
 TEST_FIXTURE(resetMySQLStoreFixture, setGet)
 {
   CHECK_MESSAGE_STORE_SET_GET;
@@ -105,6 +133,21 @@ TEST_FIXTURE(noResetMySQLStoreFixture, refresh)
   CHECK_MESSAGE_STORE_REFRESH
 }
 
+TEST_FIXTURE(batchMySQLStoreFixture, batchSetGet)
+{
+  CHECK_MESSAGE_STORE_SET_GET;
+}
+
+TEST_FIXTURE(batchMySQLStoreFixture, batchSetGetWithQuote)
+{
+  CHECK_MESSAGE_STORE_SET_GET_WITH_QUOTE;
+}
+
+TEST_FIXTURE(batchMySQLStoreFixture, batchOther)
+{
+  CHECK_MESSAGE_STORE_OTHER
+}
+
 }
 
 #endif
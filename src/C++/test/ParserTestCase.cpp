@@ -149,6 +149,69 @@ TEST(readMessagesByteByByte)
   }
 }
 
+TEST(readMessageReceivedInPlace)
+{
+  Parser object;
+  std::string fixMsg = "8=FIX.4.2\0019=12\00135=A\001108=30\00110=31\001";
+  std::string readFixMsg;
+
+  char* buffer = object.prepareStream( 1024 );
+  memcpy( buffer, fixMsg.c_str(), 10 );
+  object.commitStream( 10 );
+  CHECK( !object.readFixMessage( readFixMsg ) );
+
+  buffer = object.prepareStream( 1024 );
+  memcpy( buffer, fixMsg.c_str() + 10, fixMsg.length() - 10 );
+  object.commitStream( fixMsg.length() - 10 );
+  CHECK( object.readFixMessage( readFixMsg ) );
+  CHECK_EQUAL( fixMsg, readFixMsg );
+
+  object.prepareStream( 1024 );
+  object.commitStream( 0 );
+  object.shrinkStream();
+  CHECK( !object.readFixMessage( readFixMsg ) );
+}
+
+TEST(readMessageIgnoresUncommittedBytes)
+{
+  Parser object;
+  std::string fixMsg = "8=FIX.4.2\0019=12\00135=A\001108=30\00110=31\001";
+  std::string readFixMsg;
+
+  char* buffer = object.prepareStream( 1024 );
+  memcpy( buffer, fixMsg.c_str(), fixMsg.length() );
+  object.commitStream( fixMsg.length() - 4 );
+  CHECK( !object.readFixMessage( readFixMsg ) );
+
+  object.addToStream( fixMsg.c_str() + fixMsg.length() - 4, 4 );
+  CHECK( object.readFixMessage( readFixMsg ) );
+  CHECK_EQUAL( fixMsg, readFixMsg );
+}
+
+TEST(readMessagesKeepsRemainderForNextRead)
+{
+  Parser object;
+  std::string fixMsg1 = "8=FIX.4.2\0019=12\00135=A\001108=30\00110=31\001";
+  std::string fixMsg2 = "8=FIX.4.2\0019=17\00135=4\00136=88\001123=Y\00110=34\001";
+  std::string stream = fixMsg1 + fixMsg2 + fixMsg1;
+  std::string readFixMsg;
+
+  object.addToStream( stream.c_str(), stream.length() - 5 );
+  CHECK( object.readFixMessage( readFixMsg ) );
+  CHECK_EQUAL( fixMsg1, readFixMsg );
+  CHECK( object.readFixMessage( readFixMsg ) );
+  CHECK_EQUAL( fixMsg2, readFixMsg );
+  CHECK( !object.readFixMessage( readFixMsg ) );
+
+  // the partial message is moved to the front before the next read
+  char* buffer = object.prepareStream( 5 );
+  memcpy( buffer, stream.c_str() + stream.length() - 5, 5 );
+  object.commitStream( 5 );
+  CHECK( object.readFixMessage( readFixMsg ) );
+  CHECK_EQUAL( fixMsg1, readFixMsg );
+  CHECK( !object.readFixMessage( readFixMsg ) );
+}
+
 struct readMessageWithBadLengthFixture
 {
   readMessageWithBadLengthFixture()
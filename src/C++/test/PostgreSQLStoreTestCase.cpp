@@ -80,6 +80,34 @@ struct resetPostgreSQLStoreFixture : postgreSQLStoreFixture
   resetPostgreSQLStoreFixture() : postgreSQLStoreFixture( true ) {}
 };
 
+struct batchPostgreSQLStoreFixture
+{
+  static Dictionary settings()
+  {
+    Dictionary settings = TestSettings::sessionSettings.get();
+    settings.setString( STORE_SYNC_POLICY, "COUNT" );
+    settings.setString( STORE_SYNC_COUNT, "3" );
+    return settings;
+  }
+
+  batchPostgreSQLStoreFixture()
+  : factory( settings() )
+  {
+    SessionID sessionID( BeginString( "FIX.4.2" ),
+                         SenderCompID( "BATCH" ), TargetCompID( "TEST" ) );
+    object = factory.create( sessionID );
+    object->reset();
+  }
+
+  ~batchPostgreSQLStoreFixture()
+  {
+    factory.destroy( object );
+  }
+
+  PostgreSQLStoreFactory factory;
+  MessageStore* object;
+};
+
 TEST_FIXTURE(resetPostgreSQLStoreFixture, setGet)
 {
   CHECK_MESSAGE_STORE_SET_GET;
@@ -105,6 +133,21 @@ TEST_FIXTURE(noResetPostgreSQLStoreFixture, refresh)
   CHECK_MESSAGE_STORE_RELOAD
 }
 
+TEST_FIXTURE(batchPostgreSQLStoreFixture, batchSetGet)
+{
+  CHECK_MESSAGE_STORE_SET_GET;
+}
+
+TEST_FIXTURE(batchPostgreSQLStoreFixture, batchSetGetWithQuote)
+{
+  CHECK_MESSAGE_STORE_SET_GET_WITH_QUOTE;
+}
+
+TEST_FIXTURE(batchPostgreSQLStoreFixture, batchOther)
+{
+  CHECK_MESSAGE_STORE_OTHER
+}
+
 }
 
 #endif
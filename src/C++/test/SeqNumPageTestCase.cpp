@@ -0,0 +1,96 @@
+/****************************************************************************
+** Copyright (c) 2001-2014
+**
+** This file is part of the QuickFIX FIX Engine
+**
+** This file may be distributed under the terms of the quickfixengine.org
+** license as defined by quickfixengine.org and appearing in the file
+** LICENSE included in the packaging of this file.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** See http://www.quickfixengine.org/LICENSE for licensing information.
+**
+** Contact ask@quickfixengine.org if any conditions of this licensing are
+** not clear to you.
+**
+****************************************************************************/
+#ifdef _MSC_VER
+#pragma warning( disable : 4503 4355 4786 )
+#include "stdafx.h"
+#else
+#include "config.h"
+#endif
+
+#include <UnitTest++.h>
+#include <SeqNumPage.h>
+#include <Utility.h>
+#include <fstream>
+
+using namespace FIX;
+
+SUITE(SeqNumPageTests)
+{
+
+TEST(setAndReload)
+{
+  file_mkdir( "store" );
+  file_unlink( "store/seqnumpage" );
+
+  SeqNumPage object;
+  object.open( "store/seqnumpage" );
+  CHECK( !object.loaded() );
+  CHECK_EQUAL( 1, object.getSender() );
+  CHECK_EQUAL( 1, object.getTarget() );
+
+  object.set( 10, 20 );
+  object.set( 11, 20 );
+  object.close();
+
+  object.open( "store/seqnumpage" );
+  CHECK( object.loaded() );
+  CHECK_EQUAL( 11, object.getSender() );
+  CHECK_EQUAL( 20, object.getTarget() );
+  object.close();
+  file_unlink( "store/seqnumpage" );
+}
+
+TEST(tornWriteKeepsPreviousValue)
+{
+  file_mkdir( "store" );
+  file_unlink( "store/seqnumpage" );
+
+  SeqNumPage object;
+  object.open( "store/seqnumpage" );
+  object.set( 5, 6 );
+  object.set( 7, 8 );
+  object.close();
+
+  // scribble over the sender of the newest slot as a torn write would
+  {
+    std::fstream file( "store/seqnumpage",
+                       std::ios::in | std::ios::out | std::ios::binary );
+    char page[ 96 ];
+    file.read( page, sizeof( page ) );
+    for( int slot = 32; slot < 96; slot += 32 )
+    {
+      int sender;
+      memcpy( &sender, page + slot + 8, sizeof( sender ) );
+      if( sender == 7 )
+      {
+        file.seekp( slot + 8 );
+        file.write( "\xff\xff", 2 );
+      }
+    }
+  }
+
+  object.open( "store/seqnumpage" );
+  CHECK( object.loaded() );
+  CHECK_EQUAL( 5, object.getSender() );
+  CHECK_EQUAL( 6, object.getTarget() );
+  object.close();
+  file_unlink( "store/seqnumpage" );
+}
+
+}
@@ -0,0 +1,139 @@
+/****************************************************************************
+** Copyright (c) 2001-2014
+**
+** This file is part of the QuickFIX FIX Engine
+**
+** This file may be distributed under the terms of the quickfixengine.org
+** license as defined by quickfixengine.org and appearing in the file
+** LICENSE included in the packaging of this file.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** See http://www.quickfixengine.org/LICENSE for licensing information.
+**
+** Contact ask@quickfixengine.org if any conditions of this licensing are
+** not clear to you.
+**
+****************************************************************************/
+
+#ifdef _MSC_VER
+#pragma warning( disable : 4503 4355 4786 )
+#include "stdafx.h"
+#else
+#include "config.h"
+#endif
+
+#include <UnitTest++.h>
+#include <SessionRegistry.h>
+#include <Utility.h>
+#include <atomic>
+
+using namespace FIX;
+
+SUITE(SessionRegistryTests)
+{
+
+// the registry never dereferences sessions, so any address will do
+Session* fakeSession( int i )
+{
+  static char sessions[ 4 ];
+  return reinterpret_cast < Session* > ( sessions + i );
+}
+
+TEST(handles)
+{
+  SessionRegistry& registry = SessionRegistry::instance();
+  SessionID first( "FIX.4.2", "REGISTRY", "FIRST" );
+  SessionID second( "FIX.4.2", "REGISTRY", "SECOND" );
+  size_t size = registry.size();
+
+  int firstHandle = registry.add( first, fakeSession( 0 ) );
+  int secondHandle = registry.add( second, fakeSession( 1 ) );
+  CHECK( firstHandle >= 0 );
+  CHECK( secondHandle >= 0 );
+  CHECK( firstHandle != secondHandle );
+  CHECK_EQUAL( size + 2, registry.size() );
+  CHECK_EQUAL( 1U, registry.getSessionIDs().count( first ) );
+
+  CHECK_EQUAL( firstHandle, registry.find( first ) );
+  CHECK_EQUAL( secondHandle, registry.find( "FIX.4.2:REGISTRY->SECOND" ) );
+  CHECK_EQUAL( -1, registry.find( SessionID( "FIX.4.2", "REGISTRY", "THIRD" ) ) );
+
+  // a second session with a live SessionID is not registered
+  CHECK_EQUAL( -1, registry.add( first, fakeSession( 2 ) ) );
+  registry.remove( first, fakeSession( 2 ) );
+  CHECK( SessionRegistry::Reference( firstHandle ).get() == fakeSession( 0 ) );
+
+  registry.remove( first, fakeSession( 0 ) );
+  CHECK( !SessionRegistry::Reference( firstHandle ) );
+  CHECK_EQUAL( size + 1, registry.size() );
+  CHECK_EQUAL( 0U, registry.getSessionIDs().count( first ) );
+
+  // a session created again keeps its handle
+  CHECK_EQUAL( firstHandle, registry.add( first, fakeSession( 3 ) ) );
+  CHECK( SessionRegistry::Reference( firstHandle ).get() == fakeSession( 3 ) );
+
+  registry.remove( first, fakeSession( 3 ) );
+  registry.remove( second, fakeSession( 1 ) );
+  CHECK_EQUAL( size, registry.size() );
+}
+
+struct ReleaseLater
+{
+  SessionRegistry::Reference* pReference;
+  std::atomic < bool > released;
+};
+
+THREAD_PROC releaseLater( void* p )
+{
+  ReleaseLater* pRelease = static_cast < ReleaseLater* > ( p );
+  process_sleep( 0.05 );
+  pRelease->released = true;
+  delete pRelease->pReference;
+  return 0;
+}
+
+TEST(removeWaitsForReaders)
+{
+  SessionRegistry& registry = SessionRegistry::instance();
+  SessionID sessionID( "FIX.4.2", "REGISTRY", "READER" );
+  int handle = registry.add( sessionID, fakeSession( 0 ) );
+
+  ReleaseLater release;
+  release.pReference = new SessionRegistry::Reference( handle );
+  release.released = false;
+  thread_id thread;
+  CHECK( thread_spawn( &releaseLater, &release, thread ) );
+
+  registry.remove( sessionID, fakeSession( 0 ) );
+  CHECK( release.released.load() );
+  CHECK( !SessionRegistry::Reference( handle ) );
+  thread_join( thread );
+}
+
+TEST(resetReference)
+{
+  SessionRegistry& registry = SessionRegistry::instance();
+  SessionID sessionID( "FIX.4.2", "REGISTRY", "RESET" );
+
+  // a connection pins nothing until its session is known
+  SessionRegistry::Reference reference( -1 );
+  CHECK( !reference );
+  int handle = registry.add( sessionID, fakeSession( 0 ) );
+  reference.reset( handle );
+  CHECK( reference.get() == fakeSession( 0 ) );
+
+  reference.reset( -1 );
+  CHECK( !reference );
+  registry.remove( sessionID, fakeSession( 0 ) );
+  CHECK( !SessionRegistry::Reference( handle ) );
+}
+
+TEST(invalidHandles)
+{
+  CHECK( !SessionRegistry::Reference( -1 ) );
+  CHECK( !SessionRegistry::Reference( SessionRegistry::CHUNK_SIZE * SessionRegistry::MAX_CHUNKS ) );
+  CHECK( !SessionRegistry::Reference( SessionRegistry::CHUNK_SIZE * SessionRegistry::MAX_CHUNKS - 1 ) );
+}
+}
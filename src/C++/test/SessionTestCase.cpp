@@ -26,13 +26,14 @@
 
 #include <UnitTest++.h>
 #include <Session.h>
+#include <InboundPipeline.h>
 #include <Responder.h>
-#include <Acceptor.h>
+#include <Log.h>
 #include <Values.h>
 #include <SessionID.h>
 #include <TimeRange.h>
 #include <Message.h>
-#include <DataDictionaryProvider.h>
+#include <DataDictionary.h>
 #include <fix42/Logon.h>
 #include <fix42/Logout.h>
 #include <fix42/Heartbeat.h>
@@ -51,6 +52,23 @@ using namespace FIX;
 SUITE(SessionTests)
 {
 
+// sessions keep a reference to their dictionaries, so each is loaded once
+const DataDictionary& specDictionary( const std::string& file )
+{
+  static std::map < std::string, DataDictionary > dictionaries;
+  std::map < std::string, DataDictionary > ::iterator i = dictionaries.find( file );
+  if( i == dictionaries.end() )
+    i = dictionaries.insert( std::make_pair( file, DataDictionary( "../spec/" + file ) ) ).first;
+  return i->second;
+}
+
+struct NullLogFactory : public LogFactory
+{
+  Log* create() { return new NullLog; }
+  Log* create( const SessionID& ) { return new NullLog; }
+  void destroy( Log* log ) { delete log; }
+};
+
 class TestCallback : public Responder, public NullApplication
 {
 protected:
@@ -59,6 +77,7 @@ protected:
   UtcTimeStamp startTimeStamp;
   UtcTimeStamp endTimeStamp;
   FIX::Message lastResent;
+  std::string lastSent;
 
 public:
   TestCallback()
@@ -76,10 +95,20 @@ public:
     fromReject( 0 ),
     fromSequenceReset( 0 ),
     resent( 0 ),
-    disconnected( 0 )
+    disconnected( 0 ),
+    queueDepth( 0 ),
+    highWatermark( 0 )
     {}
 
-  bool send( const std::string& ) { return true; }
+  bool send( const std::string& value )
+  {
+    lastSent = value;
+    std::string::size_type pos = value.find( "\00134=" );
+    if( pos != std::string::npos )
+      sentSeqNums.push_back( atoi( value.c_str() + pos + 4 ) );
+    return true;
+  }
+  size_t getQueueDepth() { return queueDepth; }
 
   void toAdmin( FIX::Message& message, const SessionID& )
   {
@@ -155,6 +184,8 @@ public:
 
   void disconnect() { disconnected++; }
 
+  void onHighWatermark( const SessionID&, size_t ) { highWatermark++; }
+
   FIX::Message sentLogon;
   FIX::Message sentResendRequest;
   FIX::Message sentHeartbeat;
@@ -172,8 +203,12 @@ public:
   int fromSequenceReset;
   int resent;
   int disconnected;
+  std::vector<int> sentSeqNums;
+  size_t queueDepth;
+  int highWatermark;
 
   MemoryStoreFactory factory;
+  NullLogFactory logFactory;
 };
 
  void fillHeader( FIX::Header& header, const char* sender, const char* target, int seq )
@@ -351,10 +386,9 @@ struct sessionFixture : public TestCallback
                          SenderCompID( "TW" ), TargetCompID( "ISLD" ) );
     TimeRange sessionTime( startTime, endTime );
 
-    DataDictionaryProvider provider;
-    provider.addTransportDataDictionary( sessionID.getBeginString(), "../spec/FIX42.xml" );
-    object = new Session( *this, factory, sessionID, provider,
-                           sessionTime, heartBtInt, 0 );
+    const DataDictionary& dataDictionary = specDictionary( "FIX42.xml" );
+    object = new Session( *this, factory, sessionID, sessionTime, heartBtInt,
+                          &logFactory, dataDictionary, dataDictionary );
     object->setResponder( this );
   }
 
@@ -390,12 +424,9 @@ struct sessionT11Fixture : public TestCallback
                          SenderCompID( "TW" ), TargetCompID( "ISLD" ) );
     TimeRange sessionTime( startTime, endTime );
 
-    DataDictionaryProvider provider;
-    provider.addTransportDataDictionary( sessionID.getBeginString(), "../spec/FIXT11.xml" );
-    provider.addApplicationDataDictionary( ApplVerID(ApplVerID_FIX50), "../spec/FIX50.xml" );
-    provider.addApplicationDataDictionary( ApplVerID(ApplVerID_FIX42), "../spec/FIX42.xml" );
-    object = new Session( *this, factory, sessionID, provider,
-                           sessionTime, heartBtInt, 0 );
+    object = new Session( *this, factory, sessionID, sessionTime, heartBtInt,
+                          &logFactory, specDictionary( "FIXT11.xml" ),
+                          specDictionary( "FIX50.xml" ) );
     object->setSenderDefaultApplVerID( FIX::Message::toApplVerID(BeginString("FIX.5.0")) );
     object->setResponder( this );
   }
@@ -614,29 +645,33 @@ TEST_FIXTURE(acceptorFixture, callDisconnect)
 
 TEST_FIXTURE(sessionFixture, doesSessionExist)
 {
-  DataDictionaryProvider provider;
-  provider.addTransportDataDictionary( BeginString("FIX.4.2"), std::shared_ptr<DataDictionary>(new DataDictionary()) );
+  DataDictionary dataDictionary;
 
   Session * pSession1 = new Session
     ( *this, factory, SessionID( BeginString( "FIX.4.2" ),
-                                 SenderCompID( "TW" ), TargetCompID( "ISLD" ) ), provider,
-                                 TimeRange(UtcTimeOnly(), UtcTimeOnly()), 0, 0 );
+                                 SenderCompID( "TW" ), TargetCompID( "ISLD" ) ),
+                                 TimeRange(UtcTimeOnly(), UtcTimeOnly()), 0,
+                                 &logFactory, dataDictionary, dataDictionary );
   Session* pSession2 = new Session
     ( *this, factory, SessionID( BeginString( "FIX.4.2" ),
-                                 SenderCompID( "WT" ), TargetCompID( "ISLD" ) ), provider,
-                                 TimeRange(UtcTimeOnly(), UtcTimeOnly()), 0, 0 );
+                                 SenderCompID( "WT" ), TargetCompID( "ISLD" ) ),
+                                 TimeRange(UtcTimeOnly(), UtcTimeOnly()), 0,
+                                 &logFactory, dataDictionary, dataDictionary );
   Session* pSession3 = new Session
     ( *this, factory, SessionID( BeginString( "FIX.4.2" ),
-                                 SenderCompID( "TW" ), TargetCompID( "DLSI" ) ), provider,
-                                 TimeRange(UtcTimeOnly(), UtcTimeOnly()), 0, 0 );
+                                 SenderCompID( "TW" ), TargetCompID( "DLSI" ) ),
+                                 TimeRange(UtcTimeOnly(), UtcTimeOnly()), 0,
+                                 &logFactory, dataDictionary, dataDictionary );
   Session* pSession4 = new Session
     ( *this, factory, SessionID( BeginString( "FIX.4.2" ),
-                                 SenderCompID( "OREN" ), TargetCompID( "NERO" ) ), provider,
-                                 TimeRange(UtcTimeOnly(), UtcTimeOnly()), 0, 0 );
+                                 SenderCompID( "OREN" ), TargetCompID( "NERO" ) ),
+                                 TimeRange(UtcTimeOnly(), UtcTimeOnly()), 0,
+                                 &logFactory, dataDictionary, dataDictionary );
   Session* pSession5 = new Session
     ( *this, factory, SessionID( BeginString( "FIX.4.2" ),
-                                 SenderCompID( "OREN" ), TargetCompID( "NERO" ) ), provider,
-                                 TimeRange(UtcTimeOnly(), UtcTimeOnly()), 0, 0 );
+                                 SenderCompID( "OREN" ), TargetCompID( "NERO" ) ),
+                                 TimeRange(UtcTimeOnly(), UtcTimeOnly()), 0,
+                                 &logFactory, dataDictionary, dataDictionary );
 
   pSession1->setResponder( this );
   pSession2->setResponder( this );
@@ -685,29 +720,33 @@ TEST_FIXTURE(sessionFixture, doesSessionExist)
 
 TEST_FIXTURE(sessionFixture, lookupSession)
 {
-  DataDictionaryProvider provider;
-  provider.addTransportDataDictionary( BeginString("FIX.4.2"), std::shared_ptr<DataDictionary>(new DataDictionary()) );
+  DataDictionary dataDictionary;
 
   Session* pSession1 = new Session
     ( *this, factory, SessionID( BeginString( "FIX.4.2" ),
-                                 SenderCompID( "TW" ), TargetCompID( "ISLD" ) ), provider,
-                                 TimeRange(UtcTimeOnly(), UtcTimeOnly()), 0, 0 );
+                                 SenderCompID( "TW" ), TargetCompID( "ISLD" ) ),
+                                 TimeRange(UtcTimeOnly(), UtcTimeOnly()), 0,
+                                 &logFactory, dataDictionary, dataDictionary );
   Session* pSession2 = new Session
     ( *this, factory, SessionID( BeginString( "FIX.4.2" ),
-                                 SenderCompID( "WT" ), TargetCompID( "ISLD" ) ), provider,
-                                 TimeRange(UtcTimeOnly(), UtcTimeOnly()), 0, 0 );
+                                 SenderCompID( "WT" ), TargetCompID( "ISLD" ) ),
+                                 TimeRange(UtcTimeOnly(), UtcTimeOnly()), 0,
+                                 &logFactory, dataDictionary, dataDictionary );
   Session* pSession3 = new Session
     ( *this, factory, SessionID( BeginString( "FIX.4.2" ),
-                                 SenderCompID( "TW" ), TargetCompID( "DLSI" ) ), provider,
-                                 TimeRange(UtcTimeOnly(), UtcTimeOnly()), 0, 0 );
+                                 SenderCompID( "TW" ), TargetCompID( "DLSI" ) ),
+                                 TimeRange(UtcTimeOnly(), UtcTimeOnly()), 0,
+                                 &logFactory, dataDictionary, dataDictionary );
   Session* pSession4 = new Session
     ( *this, factory, SessionID( BeginString( "FIX.4.2" ),
-                                 SenderCompID( "OREN" ), TargetCompID( "NERO" ) ), provider,
-                                 TimeRange(UtcTimeOnly(), UtcTimeOnly()), 0, 0 );
+                                 SenderCompID( "OREN" ), TargetCompID( "NERO" ) ),
+                                 TimeRange(UtcTimeOnly(), UtcTimeOnly()), 0,
+                                 &logFactory, dataDictionary, dataDictionary );
   Session* pSession5 = new Session
     ( *this, factory, SessionID( BeginString( "FIX.4.2" ),
-                                 SenderCompID( "OREN" ), TargetCompID( "NERO" ) ), provider,
-                                 TimeRange(UtcTimeOnly(), UtcTimeOnly()), 0, 0 );
+                                 SenderCompID( "OREN" ), TargetCompID( "NERO" ) ),
+                                 TimeRange(UtcTimeOnly(), UtcTimeOnly()), 0,
+                                 &logFactory, dataDictionary, dataDictionary );
 
   pSession1->setResponder( this );
   pSession2->setResponder( this );
@@ -717,19 +756,19 @@ TEST_FIXTURE(sessionFixture, lookupSession)
 
   CHECK_EQUAL( pSession1,
                Session::lookupSession( SessionID( BeginString( "FIX.4.2" ),
-                                       SenderCompID( "TW" ), TargetCompID( "ISLD" ) ) ) );
+                                       SenderCompID( "TW" ), TargetCompID( "ISLD" ) ) ).get() );
 
   CHECK_EQUAL( pSession2,
                Session::lookupSession( SessionID( BeginString( "FIX.4.2" ),
-                                       SenderCompID( "WT" ), TargetCompID( "ISLD" ) ) ) );
+                                       SenderCompID( "WT" ), TargetCompID( "ISLD" ) ) ).get() );
 
   CHECK_EQUAL( pSession3,
                Session::lookupSession( SessionID( BeginString( "FIX.4.2" ),
-                                       SenderCompID( "TW" ), TargetCompID( "DLSI" ) ) ) );
+                                       SenderCompID( "TW" ), TargetCompID( "DLSI" ) ) ).get() );
 
   CHECK_EQUAL( pSession4,
                Session::lookupSession( SessionID( BeginString( "FIX.4.2" ),
-                                       SenderCompID( "OREN" ), TargetCompID( "NERO" ) ) ) );
+                                       SenderCompID( "OREN" ), TargetCompID( "NERO" ) ) ).get() );
 
   delete pSession1; 
   delete pSession2; 
@@ -740,33 +779,34 @@ TEST_FIXTURE(sessionFixture, lookupSession)
 
 TEST_FIXTURE(sessionFixture, registerSession)
 {
-  DataDictionaryProvider provider;
-  provider.addTransportDataDictionary( BeginString("FIX.4.2"), std::shared_ptr<DataDictionary>(new DataDictionary()) );
+  DataDictionary dataDictionary;
+  SessionID sessionID( BeginString( "FIX.4.2" ),
+                       SenderCompID( "TW" ), TargetCompID( "ISLD" ) );
 
   Session* pSession = new Session
-    ( *this, factory, SessionID( BeginString( "FIX.4.2" ),
-                      SenderCompID( "TW" ), TargetCompID( "ISLD" ) ), provider,
-                      TimeRange(UtcTimeOnly(), UtcTimeOnly()), 0, 0 );
-
-  CHECK_EQUAL( (Session*)0, Session::registerSession( SessionID( BeginString( "FIX.4.1" ),
-                                                      SenderCompID( "TW" ), TargetCompID( "ISLD" ) ) ) );
-  CHECK_EQUAL( pSession, Session::registerSession( SessionID( BeginString( "FIX.4.2" ),
-                                                   SenderCompID( "TW" ), TargetCompID( "ISLD" ) ) ) );
-  CHECK( Session::isSessionRegistered( SessionID( BeginString( "FIX.4.2" ),
-                                       SenderCompID( "TW" ), TargetCompID( "ISLD" ) ) ) );
-  CHECK_EQUAL( (Session*)0, Session::registerSession( SessionID( BeginString( "FIX.4.2" ),
-                                                      SenderCompID( "TW" ), TargetCompID( "ISLD" ) ) ) );
-  Session::unregisterSession( SessionID( BeginString( "FIX.4.2" ),
-                                         SenderCompID( "TW" ), TargetCompID( "ISLD" ) ) );
-  CHECK( !Session::isSessionRegistered( SessionID( BeginString( "FIX.4.2" ),
-                                        SenderCompID( "TW" ), TargetCompID( "ISLD" ) ) ) );
-  CHECK_EQUAL( pSession, Session::registerSession( SessionID( BeginString( "FIX.4.2" ),
-                                                   SenderCompID( "TW" ), TargetCompID( "ISLD" ) ) ) );
+    ( *this, factory, sessionID, TimeRange(UtcTimeOnly(), UtcTimeOnly()), 0,
+      &logFactory, dataDictionary, dataDictionary );
+  int handle = pSession->getHandle();
+
+  CHECK( !Session::lookupSession( Session::lookupHandle( SessionID( BeginString( "FIX.4.1" ),
+                                   SenderCompID( "TW" ), TargetCompID( "ISLD" ) ) ) ) );
+  CHECK_EQUAL( handle, Session::lookupHandle( sessionID ) );
+  CHECK_EQUAL( pSession, Session::lookupSession( handle ).get() );
+  CHECK( Session::doesSessionExist( sessionID ) );
+  CHECK_EQUAL( -1, SessionRegistry::instance().add( sessionID, pSession ) );
+
   delete pSession;
-  CHECK( !Session::isSessionRegistered( SessionID( BeginString( "FIX.4.2" ),
-                                        SenderCompID( "TW" ), TargetCompID( "ISLD" ) ) ) );
-  CHECK_EQUAL( (Session*)0, Session::registerSession( SessionID( BeginString( "FIX.4.2" ),
-                                                      SenderCompID( "TW" ), TargetCompID( "ISLD" ) ) ) );
+  CHECK( !Session::doesSessionExist( sessionID ) );
+  CHECK( !Session::lookupSession( handle ) );
+  CHECK_EQUAL( handle, Session::lookupHandle( sessionID ) );
+
+  pSession = new Session
+    ( *this, factory, sessionID, TimeRange(UtcTimeOnly(), UtcTimeOnly()), 0,
+      &logFactory, dataDictionary, dataDictionary );
+  CHECK_EQUAL( handle, pSession->getHandle() );
+  CHECK_EQUAL( pSession, Session::lookupSession( handle ).get() );
+  delete pSession;
+  CHECK( !Session::doesSessionExist( sessionID ) );
 }
 
 TEST_FIXTURE(acceptorFixture, nextTestRequest)
@@ -782,6 +822,20 @@ TEST_FIXTURE(acceptorFixture, nextTestRequest)
   CHECK_EQUAL( "HELLO", testReqID );
 }
 
+TEST_FIXTURE(acceptorFixture, sendByHandle)
+{
+  object->next( createLogon( "ISLD", "TW", 1 ), UtcTimeStamp() );
+  int handle = object->getHandle();
+  CHECK( handle >= 0 );
+  CHECK_EQUAL( handle, Session::lookupHandle( SessionID( BeginString( "FIX.4.2" ),
+                                              SenderCompID( "TW" ), TargetCompID( "ISLD" ) ) ) );
+
+  FIX::Message message = createNewOrderSingle( "ISLD", "TW", 2 );
+  CHECK( Session::send( handle, message ) );
+  CHECK_EQUAL( 3, object->getExpectedSenderNum() );
+  CHECK_THROW( Session::send( -1, message ), SessionNotFound );
+}
+
 TEST_FIXTURE(acceptorFixture, outOfOrder)
 {
   CHECK_EQUAL( 1, object->getExpectedSenderNum() );
@@ -802,6 +856,30 @@ TEST_FIXTURE(acceptorFixture, outOfOrder)
   CHECK_EQUAL( 2, fromHeartbeat );
 }
 
+TEST_FIXTURE(acceptorFixture, gapQueueOverflow)
+{
+  object->setResponder( this );
+  object->next( createLogon( "ISLD", "TW", 1 ), UtcTimeStamp() );
+
+  std::string heartbeat = createHeartbeat( "ISLD", "TW", 3 ).toString();
+  object->setGapQueueSize( heartbeat.size() );
+  object->setGapQueueOverflow( GapQueue::RESEND );
+  object->next( heartbeat, UtcTimeStamp() );
+  object->next( createHeartbeat( "ISLD", "TW", 4 ).toString(), UtcTimeStamp() );
+  CHECK_EQUAL( 0, disconnected );
+
+  // 4 was dropped, so only 3 is processed once the gap is filled
+  object->next( createHeartbeat( "ISLD", "TW", 2 ), UtcTimeStamp() );
+  CHECK_EQUAL( 4, object->getExpectedTargetNum() );
+  CHECK_EQUAL( 2, fromHeartbeat );
+
+  object->setGapQueueOverflow( GapQueue::DISCONNECT );
+  object->next( createHeartbeat( "ISLD", "TW", 6 ).toString(), UtcTimeStamp() );
+  CHECK_EQUAL( 0, disconnected );
+  object->next( createHeartbeat( "ISLD", "TW", 7 ).toString(), UtcTimeStamp() );
+  CHECK_EQUAL( 1, disconnected );
+}
+
 TEST_FIXTURE(acceptorFixture, nextLogout)
 {
   object->setResponder( this );
@@ -1049,6 +1127,159 @@ TEST_FIXTURE(acceptorFixture, nextResendRequest)
   CHECK_EQUAL( 11, resent );
 }
 
+TEST_FIXTURE(acceptorFixture, nextResendRequestEvicted)
+{
+  factory = MemoryStoreFactory( 2, 0 );
+  createSession( 0 );
+
+  object->next( createLogon( "ISLD", "TW", 1 ), UtcTimeStamp() );
+  for( int i = 2; i <= 5; ++i )
+  {
+    FIX::Message message = createNewOrderSingle( "ISLD", "TW", i );
+    CHECK( object->send( message ) );
+  }
+
+  object->next( createResendRequest( "ISLD", "TW", 2, 1, 5 ), UtcTimeStamp() );
+  CHECK_EQUAL( 1, toSequenceReset );
+  CHECK_EQUAL( 2, resent );
+  MsgSeqNum msgSeqNum;
+  lastResent.getHeader().getField( msgSeqNum );
+  CHECK_EQUAL( 5, msgSeqNum );
+
+  object->setNextSenderMsgSeqNum( 10 );
+  object->next( createResendRequest( "ISLD", "TW", 3, 5, 9 ), UtcTimeStamp() );
+  CHECK_EQUAL( 2, toSequenceReset );
+  CHECK_EQUAL( 3, resent );
+}
+
+TEST_FIXTURE(acceptorFixture, nextResendRequestPaged)
+{
+  object->setResendPageSize( 2 );
+  object->next( createLogon( "ISLD", "TW", 1 ), UtcTimeStamp() );
+  for( int i = 2; i <= 6; ++i )
+  {
+    FIX::Message message = createNewOrderSingle( "ISLD", "TW", i );
+    CHECK( object->send( message ) );
+  }
+
+  object->next( createResendRequest( "ISLD", "TW", 2, 1, 6 ), UtcTimeStamp() );
+  CHECK( object->isResending() );
+  CHECK( resent < 5 );
+  CHECK_EQUAL( 3, object->getExpectedTargetNum() );
+
+  // a full queue holds the resend back, and new messages wait behind it
+  object->setSendQueueHighWatermark( 1 );
+  queueDepth = 1;
+  size_t sent = sentSeqNums.size();
+  object->next( createTestRequest( "ISLD", "TW", 3, "HELLO" ), UtcTimeStamp() );
+  CHECK( object->isResending() );
+  CHECK_EQUAL( 1, toHeartbeat );
+
+  FIX::Message message = createNewOrderSingle( "ISLD", "TW", 8 );
+  CHECK( object->send( message ) );
+  CHECK_EQUAL( sent, sentSeqNums.size() );
+  queueDepth = 0;
+  while( object->isResending() )
+    object->nextResend();
+  CHECK_EQUAL( 5, resent );
+  CHECK_EQUAL( 1, toSequenceReset );
+  CHECK_EQUAL( 9, object->getExpectedSenderNum() );
+
+  // the heartbeat and the order follow the resend in sequence
+  CHECK( lastSent.find( "\00135=D\001" ) != std::string::npos );
+  CHECK_EQUAL( 7, sentSeqNums[ sentSeqNums.size() - 2 ] );
+  CHECK_EQUAL( 8, sentSeqNums.back() );
+}
+
+TEST_FIXTURE(acceptorFixture, nextResendRequestPagedLogout)
+{
+  object->setResendPageSize( 2 );
+  object->next( createLogon( "ISLD", "TW", 1 ), UtcTimeStamp() );
+  for( int i = 2; i <= 6; ++i )
+  {
+    FIX::Message message = createNewOrderSingle( "ISLD", "TW", i );
+    CHECK( object->send( message ) );
+  }
+
+  object->next( createResendRequest( "ISLD", "TW", 2, 1, 6 ), UtcTimeStamp() );
+  CHECK( object->isResending() );
+  CHECK( resent < 5 );
+
+  FIX::Message message = createNewOrderSingle( "ISLD", "TW", 7 );
+  CHECK( object->send( message ) );
+  size_t sent = sentSeqNums.size();
+
+  // a logout cannot wait for the resend, the rest of the range and the
+  // held back order go first
+  object->next( createLogout( "ISLD", "TW", 3 ), UtcTimeStamp() );
+  CHECK( !object->isResending() );
+  CHECK_EQUAL( 5, resent );
+  CHECK_EQUAL( 1, toLogout );
+  CHECK( lastSent.find( "\00135=5\001" ) != std::string::npos );
+  CHECK( sentSeqNums.size() > sent + 2 );
+  CHECK_EQUAL( 8, sentSeqNums.back() );
+  for( size_t i = sent; i < sentSeqNums.size(); ++i )
+    CHECK_EQUAL( sentSeqNums[ i - 1 ] + 1, sentSeqNums[ i ] );
+}
+
+TEST_FIXTURE(acceptorFixture, nextResendRequestPagedDeferredLimit)
+{
+  object->setResendPageSize( 1 );
+  object->next( createLogon( "ISLD", "TW", 1 ), UtcTimeStamp() );
+  for( int i = 2; i <= 4; ++i )
+  {
+    FIX::Message message = createNewOrderSingle( "ISLD", "TW", i );
+    CHECK( object->send( message ) );
+  }
+
+  object->next( createResendRequest( "ISLD", "TW", 2, 1, 4 ), UtcTimeStamp() );
+  CHECK( object->isResending() );
+
+  // once the limit is reached send fails without using a sequence number
+  FIX::Message message = createNewOrderSingle( "ISLD", "TW", 5 );
+  std::string messageString;
+  object->setDeferredQueueSize( message.toString( messageString ).size() + 64 );
+  CHECK( object->send( message ) );
+  CHECK_EQUAL( 6, object->getExpectedSenderNum() );
+  message = createNewOrderSingle( "ISLD", "TW", 6 );
+  CHECK( !object->send( message ) );
+  CHECK_EQUAL( 6, object->getExpectedSenderNum() );
+
+  while( object->isResending() )
+    object->nextResend();
+  CHECK_EQUAL( 5, sentSeqNums.back() );
+
+  message = createNewOrderSingle( "ISLD", "TW", 6 );
+  CHECK( object->send( message ) );
+  CHECK_EQUAL( 6, sentSeqNums.back() );
+}
+
+TEST_FIXTURE(acceptorFixture, nextResendRequestRaw)
+{
+  object->setRawResend( true );
+  object->next( createLogon( "ISLD", "TW", 1 ), UtcTimeStamp() );
+  FIX::Message message = createNewOrderSingle( "ISLD", "TW", 2 );
+  CHECK( object->send( message ) );
+  object->next( createResendRequest( "ISLD", "TW", 2, 2, 2 ), UtcTimeStamp() );
+  CHECK_EQUAL( 0, resent );
+
+  FIX::Message raw( lastSent );
+  PossDupFlag possDupFlag;
+  OrigSendingTime origSendingTime;
+  SendingTime sendingTime;
+  SendingTime originalSendingTime;
+  raw.getHeader().getField( possDupFlag );
+  raw.getHeader().getField( origSendingTime );
+  raw.getHeader().getField( sendingTime );
+  message.getHeader().getField( originalSendingTime );
+  CHECK( possDupFlag );
+  CHECK_EQUAL( originalSendingTime.getString(), origSendingTime.getString() );
+  message.getHeader().setField( possDupFlag );
+  message.getHeader().setField( origSendingTime );
+  message.getHeader().setField( sendingTime );
+  CHECK_EQUAL( message.toString(), raw.toString() );
+}
+
 TEST_FIXTURE(acceptorFixture, nextResendRequestRepeatingGroup)
 {
   object->next( createLogon( "ISLD", "TW", 1 ), UtcTimeStamp() );
@@ -1330,6 +1561,139 @@ TEST_FIXTURE(acceptorFixture, processQueuedMessages)
   CHECK_EQUAL( 2, toResendRequest );
 }
 
+TEST_FIXTURE(acceptorFixture, chunkedResendRequest)
+{
+  object->setResponder( this );
+  object->setResendRequestChunkSize( 10 );
+  object->next( createLogon( "ISLD", "TW", 1 ), UtcTimeStamp() );
+
+  BeginSeqNo beginSeqNo;
+  EndSeqNo endSeqNo;
+  object->next( createHeartbeat( "ISLD", "TW", 26 ), UtcTimeStamp() );
+  CHECK_EQUAL( 1, toResendRequest );
+  CHECK_EQUAL( 25, object->getResendTarget() );
+  sentResendRequest.getField( beginSeqNo );
+  CHECK_EQUAL( 2, beginSeqNo );
+  sentResendRequest.getField( endSeqNo );
+  CHECK_EQUAL( 11, endSeqNo );
+
+  for( int i = 2; i <= 11; ++i )
+    object->next( createHeartbeat( "ISLD", "TW", i ), UtcTimeStamp() );
+  CHECK_EQUAL( 2, toResendRequest );
+  sentResendRequest.getField( beginSeqNo );
+  CHECK_EQUAL( 12, beginSeqNo );
+  sentResendRequest.getField( endSeqNo );
+  CHECK_EQUAL( 21, endSeqNo );
+
+  // a gap fill to the end of a chunk completes it
+  FIX42::SequenceReset gapFill = createSequenceReset( "ISLD", "TW", 12, 22 );
+  gapFill.set( GapFillFlag( true ) );
+  object->next( gapFill, UtcTimeStamp() );
+  CHECK_EQUAL( 3, toResendRequest );
+  sentResendRequest.getField( beginSeqNo );
+  CHECK_EQUAL( 22, beginSeqNo );
+  sentResendRequest.getField( endSeqNo );
+  CHECK_EQUAL( 0, endSeqNo );
+
+  for( int i = 22; i <= 25; ++i )
+    object->next( createHeartbeat( "ISLD", "TW", i ), UtcTimeStamp() );
+  CHECK_EQUAL( 27, object->getExpectedTargetNum() );
+  CHECK_EQUAL( 0, object->getResendTarget() );
+  CHECK_EQUAL( 3, toResendRequest );
+}
+
+struct NullSource : public InboundSource
+{
+  void onDecoded() {}
+};
+
+TEST_FIXTURE(acceptorFixture, inboundPipeline)
+{
+  object->setResponder( this );
+  object->next( createLogon( "ISLD", "TW", 1 ), UtcTimeStamp() );
+
+  NullSource source;
+  InboundPipeline pipeline( 1, 1, 4 );
+  pipeline.start();
+  InboundLane* pLane = pipeline.add( object, &source );
+  CHECK( object->getInboundLane() == pLane );
+
+  // execution reports are rejected by fromApp on the application stage
+  int framed = 0;
+  int processed = 0;
+  for( int i = 0; i < 5000 && processed < 6; ++i )
+  {
+    std::string* pFrame = framed < 6 ? pLane->nextFrame() : 0;
+    if( pFrame )
+    {
+      *pFrame = framed == 2
+        ? std::string( "8=FIX.4.2\0019=0\00110=000\001" )
+        : createExecutionReport( "ISLD", "TW", 2 + framed - ( framed > 2 ) ).toString();
+      pLane->pushFrame();
+      ++framed;
+    }
+
+    pLane->reject();
+    InboundLane::Decoded* pDecoded = pLane->hold() ? 0 : pLane->nextDecoded();
+    if( !pDecoded )
+    {
+      process_sleep( 0.001 );
+      continue;
+    }
+    CHECK_EQUAL( processed != 2, pDecoded->valid );
+    try
+    {
+      if( pDecoded->valid )
+        object->next( pDecoded->string, pDecoded->message, UtcTimeStamp() );
+      else
+        object->next( pDecoded->string, UtcTimeStamp() );
+    }
+    catch( InvalidMessage& ) {}
+    pLane->popDecoded();
+    ++processed;
+  }
+  CHECK_EQUAL( 6, processed );
+  CHECK_EQUAL( 7, object->getExpectedTargetNum() );
+
+  // rejects come back to this thread, for messages already counted
+  for( int i = 0; i < 5000 && toBusinessMessageReject < 5; ++i )
+  {
+    if( !pLane->reject() )
+      process_sleep( 0.001 );
+  }
+  CHECK_EQUAL( 5, toBusinessMessageReject );
+  CHECK_EQUAL( 7, object->getExpectedTargetNum() );
+
+  // removing the lane waits for the application stage
+  pipeline.remove( pLane );
+  CHECK( !object->getInboundLane() );
+  CHECK_EQUAL( 5, toBusinessMessageReject );
+  CHECK_EQUAL( 7, object->getExpectedTargetNum() );
+}
+
+TEST_FIXTURE(acceptorFixture, sendQueueHighWatermark)
+{
+  object->setSendQueueHighWatermark( 1000 );
+  object->next( createLogon( "ISLD", "TW", 1 ), UtcTimeStamp() );
+  CHECK_EQUAL( 0, highWatermark );
+
+  queueDepth = 1500;
+  CHECK_EQUAL( 1500U, object->getSendQueueDepth() );
+  FIX::Message message = createNewOrderSingle( "TW", "ISLD", 2 );
+  object->send( message );
+  message = createNewOrderSingle( "TW", "ISLD", 3 );
+  object->send( message );
+  CHECK_EQUAL( 1, highWatermark );
+
+  queueDepth = 0;
+  message = createNewOrderSingle( "TW", "ISLD", 4 );
+  object->send( message );
+  queueDepth = 1000;
+  message = createNewOrderSingle( "TW", "ISLD", 5 );
+  object->send( message );
+  CHECK_EQUAL( 2, highWatermark );
+}
+
 struct initiatorCreatedBeforeStartTimeFixture : public TestCallback
 {
   static const int HEARTBTINT = 30;
@@ -1354,9 +1718,9 @@ struct initiatorCreatedBeforeStartTimeFixture : public TestCallback
 
     SessionID sessionID( BeginString( "FIX.4.2" ), SenderCompID( "MJKG" ), TargetCompID( "IZZY" ) );
     
-    DataDictionaryProvider provider;
-    provider.addTransportDataDictionary( sessionID.getBeginString(), "../spec/FIX42.xml" );
-    object = new Session( *this, memStoreFactory, sessionID, provider, sessionTime, HEARTBTINT, 0 );
+    const DataDictionary& dataDictionary = specDictionary( "FIX42.xml" );
+    object = new Session( *this, memStoreFactory, sessionID, sessionTime, HEARTBTINT,
+                          &logFactory, dataDictionary, dataDictionary );
   }
 
   virtual ~initiatorCreatedBeforeStartTimeFixture()
@@ -0,0 +1,128 @@
+/****************************************************************************
+** Copyright (c) 2001-2014
+**
+** This file is part of the QuickFIX FIX Engine
+**
+** This file may be distributed under the terms of the quickfixengine.org
+** license as defined by quickfixengine.org and appearing in the file
+** LICENSE included in the packaging of this file.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** See http://www.quickfixengine.org/LICENSE for licensing information.
+**
+** Contact ask@quickfixengine.org if any conditions of this licensing are
+** not clear to you.
+**
+****************************************************************************/
+
+#ifdef _MSC_VER
+#pragma warning( disable : 4503 4355 4786 )
+#include "stdafx.h"
+#else
+#include "config.h"
+#endif
+
+
+#include <UnitTest++.h>
+#include <SpscRing.h>
+#include <Utility.h>
+#include <string>
+
+using namespace FIX;
+
+SUITE(SpscRingTests)
+{
+
+TEST(claimAndPublish)
+{
+  SpscRing < int > ring( 3 );
+  CHECK_EQUAL( 4U, ring.capacity() );
+  CHECK( ring.empty() );
+  CHECK( !ring.front() );
+
+  for( int i = 0; i < 4; ++i )
+  {
+    int* pSlot = ring.claim();
+    CHECK( pSlot != 0 );
+    *pSlot = i;
+    ring.publish();
+  }
+  CHECK( ring.full() );
+  CHECK( !ring.claim() );
+
+  CHECK_EQUAL( 0, *ring.front() );
+  ring.pop();
+  CHECK_EQUAL( 3U, ring.size() );
+  CHECK( ring.claim() != 0 );
+}
+
+TEST(slotsAreFilledInPlace)
+{
+  SpscRing < std::string > ring( 1 );
+  std::string* pFirst = ring.claim();
+  pFirst->assign( 100, 'x' );
+  ring.publish();
+
+  std::string string;
+  string.swap( *ring.front() );
+  ring.pop();
+  CHECK_EQUAL( 100U, string.size() );
+
+  // the same slot comes round again, holding what was swapped in
+  std::string* pSlot = ring.claim();
+  CHECK( pSlot == pFirst );
+  CHECK( pSlot->empty() );
+}
+
+struct Producer
+{
+  SpscRing < int >* pRing;
+  int count;
+};
+
+THREAD_PROC produce( void* p )
+{
+  Producer* pProducer = static_cast < Producer* > ( p );
+  for( int i = 0; i < pProducer->count; )
+  {
+    int* pSlot = pProducer->pRing->claim();
+    if( !pSlot )
+    {
+      process_sleep( 0 );
+      continue;
+    }
+    *pSlot = i++;
+    pProducer->pRing->publish();
+  }
+  return 0;
+}
+
+TEST(orderAcrossThreads)
+{
+  SpscRing < int > ring( 64 );
+  Producer producer = { &ring, 10000 };
+  thread_id thread;
+  CHECK( thread_spawn( &produce, &producer, thread ) );
+
+  int expected = 0;
+  bool ordered = true;
+  while( expected < producer.count )
+  {
+    int* pSlot = ring.front();
+    if( !pSlot )
+    {
+      process_sleep( 0 );
+      continue;
+    }
+    ordered = ordered && *pSlot == expected++;
+    ring.pop();
+  }
+  thread_join( thread );
+
+  CHECK( ordered );
+  CHECK( ring.empty() );
+}
+
+}
@@ -0,0 +1,118 @@
+/****************************************************************************
+** Copyright (c) 2001-2014
+**
+** This file is part of the QuickFIX FIX Engine
+**
+** This file may be distributed under the terms of the quickfixengine.org
+** license as defined by quickfixengine.org and appearing in the file
+** LICENSE included in the packaging of this file.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** See http://www.quickfixengine.org/LICENSE for licensing information.
+**
+** Contact ask@quickfixengine.org if any conditions of this licensing are
+** not clear to you.
+**
+****************************************************************************/
+#ifdef _MSC_VER
+#pragma warning( disable : 4503 4355 4786 )
+#include "stdafx.h"
+#else
+#include "config.h"
+#endif
+
+#include <UnitTest++.h>
+#include <StoreSyncer.h>
+
+using namespace FIX;
+
+SUITE(StoreSyncerTests)
+{
+
+struct countingSyncable : public Syncable
+{
+  countingSyncable() : syncs( 0 ) {}
+  bool sync() { ++syncs; return true; }
+  int syncs;
+};
+
+TEST(readPolicyFromDictionary)
+{
+  Dictionary dict;
+  SyncPolicy object( dict );
+  CHECK_EQUAL( SyncPolicy::FLUSH, object.getMode() );
+  CHECK( object.flush() && !object.sync() );
+
+  dict.setString( STORE_SYNC_POLICY, "count" );
+  dict.setString( STORE_SYNC_COUNT, "10" );
+  object = SyncPolicy( dict );
+  CHECK_EQUAL( SyncPolicy::COUNT, object.getMode() );
+  CHECK_EQUAL( 10, object.getCount() );
+  CHECK_EQUAL( 1000000, object.getInterval() );
+  CHECK( object.sync() );
+
+  dict.setString( STORE_SYNC_POLICY, "INTERVAL" );
+  dict.setString( STORE_SYNC_INTERVAL, "500" );
+  object = SyncPolicy( dict );
+  CHECK_EQUAL( 500, object.getInterval() );
+
+  dict.setString( STORE_SYNC_POLICY, "NONE" );
+  CHECK( !SyncPolicy( dict ).flush() );
+
+  dict.setString( STORE_SYNC_POLICY, "ALWAYS" );
+  CHECK_THROW( object = SyncPolicy( dict ), ConfigError );
+  dict.setString( STORE_SYNC_POLICY, "COUNT" );
+  dict.setString( STORE_SYNC_COUNT, "0" );
+  CHECK_THROW( object = SyncPolicy( dict ), ConfigError );
+}
+
+TEST(commitAfterCount)
+{
+  SessionID sessionID( BeginString( "FIX.4.2" ),
+                       SenderCompID( "SYNC" ), TargetCompID( "TEST" ) );
+  countingSyncable syncable;
+  StoreSyncer& syncer = StoreSyncer::instance();
+  syncer.add( &syncable, sessionID, SyncPolicy( SyncPolicy::COUNT, 3, 10000000 ) );
+
+  syncer.written( &syncable );
+  syncer.written( &syncable );
+  process_sleep( 0.05 );
+  CHECK_EQUAL( 0, syncable.syncs );
+
+  syncer.written( &syncable );
+  for( int i = 0; i < 100 && !syncable.syncs; ++i )
+    process_sleep( 0.01 );
+  CHECK_EQUAL( 1, syncable.syncs );
+
+  StoreSyncer::Statistics statistics;
+  CHECK( syncer.getStatistics( sessionID, statistics ) );
+  CHECK_EQUAL( 1, statistics.commits );
+  CHECK_EQUAL( 3, statistics.messages );
+
+  syncer.written( &syncable, false );
+  syncer.remove( &syncable );
+  CHECK_EQUAL( 2, syncable.syncs );
+  CHECK( !syncer.getStatistics( sessionID, statistics ) );
+}
+
+TEST(commitAfterInterval)
+{
+  SessionID sessionID( BeginString( "FIX.4.2" ),
+                       SenderCompID( "SYNC" ), TargetCompID( "TEST" ) );
+  countingSyncable syncable;
+  StoreSyncer& syncer = StoreSyncer::instance();
+  syncer.add( &syncable, sessionID, SyncPolicy( SyncPolicy::INTERVAL, 0, 20000 ) );
+
+  syncer.written( &syncable );
+  syncer.written( &syncable );
+  for( int i = 0; i < 100 && !syncable.syncs; ++i )
+    process_sleep( 0.01 );
+  CHECK_EQUAL( 1, syncable.syncs );
+
+  syncer.remove( &syncable );
+  CHECK_EQUAL( 1, syncable.syncs );
+}
+
+}
@@ -24,7 +24,10 @@ inline void deleteSession( std::string sender, std::string target )
 {
   file_unlink( ( "store/FIX.4.2-" + sender + "-" + target + ".messages" ).c_str() );
   file_unlink( ( "store/FIX.4.2-" + sender + "-" + target + ".header" ).c_str() );
+  file_unlink( ( "store/FIX.4.2-" + sender + "-" + target + ".index" ).c_str() );
+  file_unlink( ( "store/FIX.4.2-" + sender + "-" + target + ".checkpoint" ).c_str() );
   file_unlink( ( "store/FIX.4.2-" + sender + "-" + target + ".seqnums" ).c_str() );
+  file_unlink( ( "store/FIX.4.2-" + sender + "-" + target + ".seqpage" ).c_str() );
   file_unlink( ( "store/FIX.4.2-" + sender + "-" + target + ".session" ).c_str() );
 }
 
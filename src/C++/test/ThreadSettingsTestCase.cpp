@@ -0,0 +1,81 @@
+/****************************************************************************
+** Copyright (c) 2001-2014
+**
+** This file is part of the QuickFIX FIX Engine
+**
+** This file may be distributed under the terms of the quickfixengine.org
+** license as defined by quickfixengine.org and appearing in the file
+** LICENSE included in the packaging of this file.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** See http://www.quickfixengine.org/LICENSE for licensing information.
+**
+** Contact ask@quickfixengine.org if any conditions of this licensing are
+** not clear to you.
+**
+****************************************************************************/
+
+#ifdef _MSC_VER
+#pragma warning( disable : 4503 4355 4786 )
+#include "stdafx.h"
+#else
+#include "config.h"
+#endif
+
+#include <UnitTest++.h>
+#include <ThreadSettings.h>
+
+using namespace FIX;
+
+SUITE(ThreadSettingsTests)
+{
+
+TEST(parseCpus)
+{
+  std::set<int> cpus = ThreadSettings::parseCpus( "0, 2,4-6" );
+  CHECK_EQUAL( 5U, cpus.size() );
+  CHECK( cpus.count( 0 ) && cpus.count( 2 ) );
+  CHECK( cpus.count( 4 ) && cpus.count( 5 ) && cpus.count( 6 ) );
+  CHECK( ThreadSettings::parseCpus( "" ).empty() );
+
+  CHECK_THROW( ThreadSettings::parseCpus( "a" ), ConfigError );
+  CHECK_THROW( ThreadSettings::parseCpus( "3-1" ), ConfigError );
+  CHECK_THROW( ThreadSettings::parseCpus( "-1" ), ConfigError );
+}
+
+TEST(readFromDictionary)
+{
+  Dictionary dict;
+  dict.setString( THREAD_AFFINITY, "1-2" );
+  dict.setString( THREAD_PRIORITY, "10" );
+
+  ThreadSettings object( dict, THREAD_AFFINITY, THREAD_NAME,
+                         THREAD_PRIORITY, "fix-test" );
+  CHECK_EQUAL( 2U, object.getCpus().size() );
+  CHECK_EQUAL( "fix-test", object.getName() );
+  CHECK_EQUAL( 10, object.getPriority() );
+
+  dict.setString( THREAD_NAME, "orders" );
+  CHECK_EQUAL( "orders", ThreadSettings( dict, THREAD_AFFINITY, THREAD_NAME,
+                                         THREAD_PRIORITY ).getName() );
+
+  dict.setString( THREAD_PRIORITY, "100" );
+  CHECK_THROW( ThreadSettings( dict, THREAD_AFFINITY, THREAD_NAME,
+                               THREAD_PRIORITY ), ConfigError );
+}
+
+TEST(checkConnection)
+{
+  Dictionary dict;
+  dict.setString( SOCKET_BUSY_POLL_CPU, "3" );
+  ThreadSettings::checkConnection( dict, true );
+
+  // only one of them may pin a busy polling connection thread
+  dict.setString( THREAD_AFFINITY, "1-2" );
+  ThreadSettings::checkConnection( dict, false );
+  CHECK_THROW( ThreadSettings::checkConnection( dict, true ), ConfigError );
+}
+
+}
@@ -0,0 +1,217 @@
+/****************************************************************************
+** Copyright (c) 2001-2014
+**
+** This file is part of the QuickFIX FIX Engine
+**
+** This file may be distributed under the terms of the quickfixengine.org
+** license as defined by quickfixengine.org and appearing in the file
+** LICENSE included in the packaging of this file.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** See http://www.quickfixengine.org/LICENSE for licensing information.
+**
+** Contact ask@quickfixengine.org if any conditions of this licensing are
+** not clear to you.
+**
+****************************************************************************/
+
+#ifdef _MSC_VER
+#pragma warning( disable : 4503 4355 4786 )
+#include "stdafx.h"
+#else
+#include "config.h"
+#endif
+
+#include <UnitTest++.h>
+#include <TestHelper.h>
+#include <TieredStore.h>
+#include <FileStore.h>
+#include "MessageStoreTestCase.h"
+
+using namespace FIX;
+
+SUITE(TieredStoreTests)
+{
+
+struct tieredStoreFixture
+{
+  tieredStoreFixture( bool resetBefore, bool resetAfter )
+  : fileFactory( "store" ),
+    factory( fileFactory, WriteBehindPolicy( WriteBehindPolicy::ASYNC ) )
+  {
+    SessionID sessionID( BeginString( "FIX.4.2" ),
+                         SenderCompID( "SETGET" ), TargetCompID( "TIERED" ) );
+
+    object = factory.create( sessionID );
+
+    if( resetBefore )
+      object->reset();
+
+    this->resetAfter = resetAfter;
+  }
+
+  ~tieredStoreFixture()
+  {
+    if( resetAfter )
+      object->reset();
+
+    factory.destroy( object );
+  }
+
+  FileStoreFactory fileFactory;
+  TieredStoreFactory factory;
+  MessageStore* object;
+  bool resetAfter;
+};
+
+struct resetBeforeTieredStoreFixture : tieredStoreFixture
+{
+  resetBeforeTieredStoreFixture() : tieredStoreFixture( true, false ) {}
+};
+
+struct resetAfterTieredStoreFixture : tieredStoreFixture
+{
+  resetAfterTieredStoreFixture() : tieredStoreFixture( false, true ) {}
+};
+
+struct resetBeforeAndAfterTieredStoreFixture : tieredStoreFixture
+{
+  resetBeforeAndAfterTieredStoreFixture() : tieredStoreFixture( true, true ) {}
+};
+
+struct noResetTieredStoreFixture : tieredStoreFixture
+{
+  noResetTieredStoreFixture() : tieredStoreFixture( false, false ) {}
+};
+
+TEST_FIXTURE(resetBeforeAndAfterTieredStoreFixture, setGet)
+{
+  CHECK_MESSAGE_STORE_SET_GET;
+}
+
+TEST_FIXTURE(resetBeforeAndAfterTieredStoreFixture, setGetWithQuote)
+{
+  CHECK_MESSAGE_STORE_SET_GET_WITH_QUOTE;
+}
+
+TEST_FIXTURE(resetBeforeTieredStoreFixture, other)
+{
+  CHECK_MESSAGE_STORE_OTHER
+}
+
+TEST_FIXTURE(noResetTieredStoreFixture, reload)
+{
+  CHECK_MESSAGE_STORE_RELOAD
+}
+
+TEST_FIXTURE(resetAfterTieredStoreFixture, refresh)
+{
+  CHECK_MESSAGE_STORE_REFRESH
+}
+
+struct coldStoreFactory : public MessageStoreFactory
+{
+  coldStoreFactory() : pStore( 0 ), keep( false ) {}
+  ~coldStoreFactory() { if( keep ) delete pStore; }
+
+  MessageStore* create( const SessionID& )
+  { return pStore = new MemoryStore; }
+  void destroy( MessageStore* pStore )
+  { if( !keep ) delete pStore; }
+
+  MemoryStore* pStore;
+  bool keep;
+};
+
+SessionID tieredSessionID()
+{
+  return SessionID( BeginString( "FIX.4.2" ),
+                    SenderCompID( "COLD" ), TargetCompID( "TIERED" ) );
+}
+
+TEST(writeBehind)
+{
+  coldStoreFactory cold;
+  TieredStore store( cold, tieredSessionID(),
+                     WriteBehindPolicy( WriteBehindPolicy::ASYNC, 60000 ) );
+
+  store.set( 1, "message1" );
+  store.incrNextSenderMsgSeqNum();
+  store.set( 2, "message2" );
+  store.incrNextSenderMsgSeqNum();
+  store.incrNextTargetMsgSeqNum();
+
+  std::vector < std::string > messages;
+  CHECK_EQUAL( 5U, store.getLag() );
+  CHECK_EQUAL( 1, cold.pStore->getNextSenderMsgSeqNum() );
+  cold.pStore->get( 1, 2, messages );
+  CHECK_EQUAL( 0U, messages.size() );
+
+  store.get( 1, 2, messages );
+  CHECK_EQUAL( 2U, messages.size() );
+
+  store.flush();
+  CHECK_EQUAL( 0U, store.getLag() );
+  CHECK_EQUAL( 3, cold.pStore->getNextSenderMsgSeqNum() );
+  CHECK_EQUAL( 2, cold.pStore->getNextTargetMsgSeqNum() );
+  cold.pStore->get( 1, 2, messages );
+  CHECK_EQUAL( 2U, messages.size() );
+  CHECK_EQUAL( "message2", messages[ 1 ] );
+}
+
+TEST(sequenceNumbersWrittenThrough)
+{
+  coldStoreFactory cold;
+  TieredStore store( cold, tieredSessionID(),
+                     WriteBehindPolicy( WriteBehindPolicy::SEQNUM, 60000 ) );
+
+  store.set( 1, "message1" );
+  store.incrNextSenderMsgSeqNum();
+  CHECK_EQUAL( 1U, store.getLag() );
+  CHECK_EQUAL( 2, cold.pStore->getNextSenderMsgSeqNum() );
+
+  store.setNextTargetMsgSeqNum( 10 );
+  CHECK_EQUAL( 10, cold.pStore->getNextTargetMsgSeqNum() );
+}
+
+TEST(resendBeyondMemory)
+{
+  coldStoreFactory cold;
+  TieredStore store( cold, tieredSessionID(),
+                     WriteBehindPolicy( WriteBehindPolicy::ASYNC, 60000,
+                                        100, 0, 2 ) );
+
+  for( int i = 1; i <= 5; ++i )
+    store.set( i, "message" + IntConvertor::convert( i ) );
+
+  std::vector < std::string > messages;
+  store.get( 4, 5, messages );
+  CHECK_EQUAL( 2U, messages.size() );
+  CHECK_EQUAL( 5U, store.getLag() );
+
+  store.get( 1, 5, messages );
+  CHECK_EQUAL( 5U, messages.size() );
+  CHECK_EQUAL( "message1", messages[ 0 ] );
+  CHECK_EQUAL( 0U, store.getLag() );
+}
+
+TEST(flushOnDestroy)
+{
+  coldStoreFactory cold;
+  cold.keep = true;
+  std::vector < std::string > messages;
+  {
+    TieredStore store( cold, tieredSessionID(),
+                       WriteBehindPolicy( WriteBehindPolicy::ASYNC, 60000 ) );
+    store.set( 1, "message1" );
+    cold.pStore->get( 1, 1, messages );
+    CHECK_EQUAL( 0U, messages.size() );
+  }
+
+  cold.pStore->get( 1, 1, messages );
+  CHECK_EQUAL( 1U, messages.size() );
+}
+
+}
@@ -288,4 +288,54 @@ TEST(isInSameRangeWithDay)
   CHECK( TimeRange::isInSameRange(startTime, endTime, startDay, endDay, time1, time2) );
 }
 
+TEST(nextBoundary)
+{
+  TimeRange range( UtcTimeOnly( 8, 0, 0 ), UtcTimeOnly( 17, 30, 0 ) );
+  UtcTimeStamp now( 7, 59, 0, 10, 10, 2014 );
+  CHECK_EQUAL( 60, range.getNextBoundary( now ) - now );
+  now = UtcTimeStamp( 17, 29, 59, 10, 10, 2014 );
+  CHECK_EQUAL( 1, range.getNextBoundary( now ) - now );
+  now = UtcTimeStamp( 23, 0, 0, 10, 10, 2014 );
+  CHECK_EQUAL( 3600, range.getNextBoundary( now ) - now );
+  now = UtcTimeStamp( 23, 59, 0, 10, 10, 2014 );
+  CHECK_EQUAL( 60, range.getNextBoundary( now ) - now );
+
+  // just after a boundary nothing is cached
+  now = UtcTimeStamp( 8, 0, 0, 500, 10, 10, 2014 );
+  CHECK( range.getNextBoundary( now ) == now );
+  now = UtcTimeStamp( 17, 29, 59, 500, 10, 10, 2014 );
+  CHECK( range.getNextBoundary( now ) == now );
+}
+
+TEST(nextBoundaryKeepsAnswer)
+{
+  TimeRange ranges[] =
+  {
+    TimeRange( UtcTimeOnly( 8, 0, 0 ), UtcTimeOnly( 17, 30, 0 ) ),
+    TimeRange( UtcTimeOnly( 18, 0, 0 ), UtcTimeOnly( 3, 0, 0 ) ),
+    TimeRange( UtcTimeOnly( 6, 0, 0 ), UtcTimeOnly( 6, 0, 0 ) ),
+    TimeRange( UtcTimeOnly( 9, 0, 0 ), UtcTimeOnly( 17, 0, 0 ), 2, 6 )
+  };
+
+  for( int i = 0; i < 4; ++i )
+  {
+    UtcTimeStamp creation( 19, 0, 0, 10, 10, 2014 );
+    UtcTimeStamp time = creation;
+    for( int step = 0; step < 10000; ++step )
+    {
+      time += 97;
+      UtcTimeStamp boundary = ranges[ i ].getNextBoundary( time );
+      if( boundary == time ) continue;
+
+      bool inRange = ranges[ i ].isInRange( time );
+      bool sameRange = ranges[ i ].isInSameRange( time, creation );
+      UtcTimeStamp last = boundary;
+      last += -1;
+      CHECK( last >= time );
+      CHECK_EQUAL( inRange, ranges[ i ].isInRange( last ) );
+      CHECK_EQUAL( sameRange, ranges[ i ].isInSameRange( last, creation ) );
+    }
+  }
+}
+
 }
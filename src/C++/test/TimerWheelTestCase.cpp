@@ -0,0 +1,202 @@
+/****************************************************************************
+** Copyright (c) 2001-2014
+**
+** This file is part of the QuickFIX FIX Engine
+**
+** This file may be distributed under the terms of the quickfixengine.org
+** license as defined by quickfixengine.org and appearing in the file
+** LICENSE included in the packaging of this file.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** See http://www.quickfixengine.org/LICENSE for licensing information.
+**
+** Contact ask@quickfixengine.org if any conditions of this licensing are
+** not clear to you.
+**
+****************************************************************************/
+
+#ifdef _MSC_VER
+#pragma warning( disable : 4503 4355 4786 )
+#include "stdafx.h"
+#else
+#include "config.h"
+#endif
+
+#include <UnitTest++.h>
+#include <TimerWheel.h>
+#include <algorithm>
+
+using namespace FIX;
+
+SUITE(TimerWheelTests)
+{
+
+struct CountingTimer : public TimerWheel::Timer
+{
+  CountingTimer() : count( 0 ) {}
+  void onTimer() { ++count; }
+  int count;
+};
+
+bool contains( const std::vector < TimerWheel::Timer* > & timers, TimerWheel::Timer* pTimer )
+{
+  return std::find( timers.begin(), timers.end(), pTimer ) != timers.end();
+}
+
+TEST(expiresAtDeadline)
+{
+  TimerWheel wheel( 1000 );
+  CountingTimer near, far, farther;
+  wheel.schedule( &near, 1010 );
+  wheel.schedule( &far, 1000 + 300 );
+  wheel.schedule( &farther, 1000 + 100000 );
+  CHECK_EQUAL( 3U, wheel.size() );
+
+  std::vector < TimerWheel::Timer* > expired;
+  wheel.advance( 1009, expired );
+  CHECK( expired.empty() );
+  wheel.advance( 1010, expired );
+  CHECK_EQUAL( 1U, expired.size() );
+  CHECK( contains( expired, &near ) );
+  CHECK( !near.isScheduled() );
+
+  expired.clear();
+  wheel.advance( 1299, expired );
+  CHECK( expired.empty() );
+  wheel.advance( 1300, expired );
+  CHECK( contains( expired, &far ) );
+
+  expired.clear();
+  wheel.advance( 1000 + 99999, expired );
+  CHECK( expired.empty() );
+  CHECK_EQUAL( 1U, wheel.size() );
+  wheel.advance( 1000 + 100000, expired );
+  CHECK( contains( expired, &farther ) );
+  CHECK_EQUAL( 0U, wheel.size() );
+}
+
+TEST(beyondLastWheel)
+{
+  TimerWheel wheel;
+  CountingTimer timer;
+  long long deadline = 1LL << 28;
+  wheel.schedule( &timer, deadline );
+
+  std::vector < TimerWheel::Timer* > expired;
+  wheel.advance( deadline - 1, expired );
+  CHECK( expired.empty() );
+  wheel.advance( deadline, expired );
+  CHECK( contains( expired, &timer ) );
+}
+
+TEST(overdueExpiresNext)
+{
+  TimerWheel wheel( 500 );
+  CountingTimer timer;
+  wheel.schedule( &timer, 10 );
+  CHECK_EQUAL( 500, wheel.nextTick() );
+
+  std::vector < TimerWheel::Timer* > expired;
+  wheel.advance( 500, expired );
+  CHECK( contains( expired, &timer ) );
+}
+
+TEST(cancelAndReschedule)
+{
+  TimerWheel wheel;
+  CountingTimer first, second;
+  wheel.schedule( &first, 5 );
+  wheel.schedule( &second, 5 );
+  wheel.cancel( &first );
+  wheel.cancel( &first );
+  CHECK( !first.isScheduled() );
+  CHECK_EQUAL( 1U, wheel.size() );
+
+  wheel.schedule( &second, 20 );
+  CHECK_EQUAL( 1U, wheel.size() );
+  CHECK_EQUAL( 20, second.getDeadline() );
+
+  std::vector < TimerWheel::Timer* > expired;
+  wheel.advance( 19, expired );
+  CHECK( expired.empty() );
+  wheel.advance( 20, expired );
+  CHECK_EQUAL( 1U, expired.size() );
+  CHECK( contains( expired, &second ) );
+}
+
+TEST(nextTick)
+{
+  TimerWheel wheel( 1 );
+  CHECK_EQUAL( TimerWheel::NO_DEADLINE, wheel.nextTick() );
+
+  CountingTimer near, far;
+  wheel.schedule( &near, 40 );
+  wheel.schedule( &far, 5000 );
+  CHECK_EQUAL( 40, wheel.nextTick() );
+
+  std::vector < TimerWheel::Timer* > expired;
+  wheel.advance( 40, expired );
+  // the later timer is moved to the first wheel when its slot comes round
+  CHECK_EQUAL( 4864, wheel.nextTick() );
+
+  for( int i = 0; i < 100 && wheel.nextTick() != 5000; ++i )
+    wheel.advance( wheel.nextTick(), expired );
+  CHECK_EQUAL( 5000, wheel.nextTick() );
+  CHECK_EQUAL( 1U, expired.size() );
+  CHECK( far.isScheduled() );
+}
+
+TEST(randomDeadlines)
+{
+  const int count = 500;
+  TimerWheel wheel( 12345 );
+  CountingTimer timers[ count ];
+  unsigned int seed = 1;
+  for( int i = 0; i < count; ++i )
+  {
+    seed = seed * 1103515245 + 12345;
+    long long delay = ( seed >> 8 ) % ( 1 << ( 4 + i % 24 ) );
+    wheel.schedule( &timers[ i ], wheel.getCurrent() + delay );
+  }
+
+  std::vector < TimerWheel::Timer* > expired;
+  long long now = wheel.getCurrent();
+  while( wheel.size() )
+  {
+    seed = seed * 1103515245 + 12345;
+    long long next = wheel.nextTick();
+    now = ( seed & 1 ) ? next : now + ( seed >> 8 ) % 5000;
+    expired.clear();
+    wheel.advance( now, expired );
+    for( size_t i = 0; i < expired.size(); ++i )
+    {
+      CHECK( expired[ i ]->getDeadline() <= now );
+      static_cast < CountingTimer* > ( expired[ i ] )->onTimer();
+    }
+    for( int i = 0; i < count; ++i )
+    {
+      if( timers[ i ].isScheduled() )
+        CHECK( timers[ i ].getDeadline() > now );
+    }
+  }
+
+  for( int i = 0; i < count; ++i )
+    CHECK_EQUAL( 1, timers[ i ].count );
+}
+
+TEST(sessionTimer)
+{
+  CountingTimer timer;
+  SessionTimer::instance().schedule( &timer, 0 );
+  for( int i = 0; i < 100 && !timer.count; ++i )
+    process_sleep( 0.01 );
+  CHECK_EQUAL( 1, timer.count );
+
+  SessionTimer::instance().schedule( &timer, 60000 );
+  SessionTimer::instance().cancel( &timer );
+  CHECK( !timer.isScheduled() );
+}
+
+}
@@ -0,0 +1,242 @@
+/* -*- C++ -*- */
+
+/****************************************************************************
+** Copyright (c) 2001-2014
+**
+** This file is part of the QuickFIX FIX Engine
+**
+** This file may be distributed under the terms of the quickfixengine.org
+** license as defined by quickfixengine.org and appearing in the file
+** LICENSE included in the packaging of this file.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** See http://www.quickfixengine.org/LICENSE for licensing information.
+**
+** Contact ask@quickfixengine.org if any conditions of this licensing are
+** not clear to you.
+**
+****************************************************************************/
+
+#ifdef _MSC_VER
+#pragma warning( disable : 4503 4355 4786 )
+#include "stdafx.h"
+#else
+#include "config.h"
+#endif
+
+#include "getopt-repl.h"
+#include <iostream>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include "BinaryLog.h"
+#include "FieldConvertors.h"
+#include "SessionID.h"
+#include "Utility.h"
+
+namespace
+{
+struct Filter
+{
+  Filter() : begin( 0 ), end( 0 ) {}
+
+  std::set < std::string > sessions;
+  std::set < std::string > msgTypes;
+  long long begin;
+  long long end;
+};
+
+/// Name FileLog gives the files of a session.
+std::string fileName( const std::string& session )
+{
+  FIX::SessionID parsed( "", "", "" );
+  parsed.fromString( session );
+  if ( parsed.getBeginString().getValue().empty() ) return session;
+  FIX::SessionID sessionID( parsed.getBeginString(), parsed.getSenderCompID(),
+                            parsed.getTargetCompID(), parsed.getSessionQualifier() );
+  return sessionID.getName();
+}
+
+std::string msgType( const std::string& message )
+{
+  std::string::size_type begin = message.find( "\00135=" );
+  if ( begin == std::string::npos ) return "";
+  begin += 4;
+  std::string::size_type end = message.find( '\001', begin );
+  if ( end == std::string::npos ) return "";
+  return message.substr( begin, end - begin );
+}
+
+long long parseTime( const char* value )
+{
+  FIX::UtcTimeStamp time = FIX::UtcTimeStampConvertor::convert( value );
+  return (long long)time.getTimeT() * 1000000000
+    + (long long)time.getMillisecond() * 1000000;
+}
+
+bool matches( const Filter& filter, const std::string& session )
+{
+  return filter.sessions.empty()
+    || filter.sessions.count( session )
+    || filter.sessions.count( fileName( session ) );
+}
+
+bool matches( const Filter& filter, const std::string& session,
+              const FIX::BinaryLogRecord& record )
+{
+  if ( !matches( filter, session ) ) return false;
+  if ( filter.begin && record.time < filter.begin ) return false;
+  if ( filter.end && record.time > filter.end ) return false;
+  if ( filter.msgTypes.size()
+       && ( record.kind == FIX::BinaryLogRecord::EVENT
+            || !filter.msgTypes.count( msgType( record.data ) ) ) )
+    return false;
+  return true;
+}
+
+typedef std::map < std::string, std::shared_ptr < std::ofstream > > Outputs;
+
+std::string outputName( const std::string& directory,
+                        const std::string& session, const std::string& suffix )
+{
+  return FIX::file_appendpath( directory, fileName( session ) + suffix );
+}
+
+std::ostream& output( Outputs& outputs, const std::string& directory,
+                      const std::string& session, bool event )
+{
+  if ( directory.empty() ) return std::cout;
+
+  std::string name = outputName( directory, session,
+    event ? ".event.current.log" : ".messages.current.log" );
+  std::shared_ptr < std::ofstream > & pStream = outputs[ name ];
+  if ( !pStream )
+  {
+    pStream.reset( new std::ofstream
+      ( name.c_str(), std::ios::out | std::ios::app ) );
+    if ( !pStream->is_open() )
+      throw FIX::ConfigError( "Could not open " + name );
+  }
+  return *pStream;
+}
+
+/// Clear or back up a session's files the way FileLog does.
+void replay( Outputs& outputs, const std::string& directory,
+             const std::string& session, FIX::BinaryLogRecord::Kind kind )
+{
+  if ( directory.empty() ) return;
+
+  std::string messages = outputName( directory, session, ".messages.current.log" );
+  std::string event = outputName( directory, session, ".event.current.log" );
+  outputs.erase( messages );
+  outputs.erase( event );
+
+  if ( kind == FIX::BinaryLogRecord::CLEAR )
+  {
+    std::ofstream( messages.c_str(), std::ios::out | std::ios::trunc );
+    std::ofstream( event.c_str(), std::ios::out | std::ios::trunc );
+    return;
+  }
+
+  for ( int i = 1; ; ++i )
+  {
+    std::string number = FIX::IntConvertor::convert( i );
+    std::string messagesBackup
+      = outputName( directory, session, ".messages.backup." + number + ".log" );
+    std::string eventBackup
+      = outputName( directory, session, ".event.backup." + number + ".log" );
+    if ( FIX::file_exists( messagesBackup.c_str() )
+         || FIX::file_exists( eventBackup.c_str() ) )
+      continue;
+
+    FIX::file_rename( messages.c_str(), messagesBackup.c_str() );
+    FIX::file_rename( event.c_str(), eventBackup.c_str() );
+    return;
+  }
+}
+
+int usage( const char* program )
+{
+  std::cout << "usage: " << program
+            << " [-s session] [-t msgtype] [-b time] [-e time] [-o directory]"
+            << " FILE.bin..." << std::endl
+            << "  -s and -t may be repeated, times are YYYYMMDD-HH:MM:SS[.sss]"
+            << std::endl
+            << "  without -o lines are written to standard output, with -o"
+            << std::endl
+            << "  each session's clears and backups are replayed" << std::endl;
+  return 1;
+}
+}
+
+/// Convert BinaryLog and journal files to the text written by FileLog,
+/// either to standard output or to FileLog's per session files in a
+/// directory.
+int main( int argc, char** argv )
+{
+  Filter filter;
+  std::string directory;
+
+  int opt;
+  try
+  {
+    while ( (opt = getopt( argc, argv, "s:t:b:e:o:" )) != -1 )
+    {
+      switch( opt )
+      {
+      case 's': filter.sessions.insert( optarg ); break;
+      case 't': filter.msgTypes.insert( optarg ); break;
+      case 'b': filter.begin = parseTime( optarg ); break;
+      case 'e': filter.end = parseTime( optarg ); break;
+      case 'o': directory = optarg; break;
+      default: return usage( argv[ 0 ] );
+      }
+    }
+  }
+  catch ( FIX::FieldConvertError& e )
+  {
+    std::cerr << "invalid time: " << e.what() << std::endl;
+    return 1;
+  }
+  if ( optind >= argc ) return usage( argv[ 0 ] );
+
+  if ( directory.size() ) FIX::file_mkdir( directory.c_str() );
+
+  int result = 0;
+  Outputs outputs;
+  for ( int i = optind; i < argc; ++i )
+  {
+    try
+    {
+      FIX::BinaryLogReader reader( argv[ i ] );
+      FIX::BinaryLogRecord record;
+      while ( reader.next( record ) )
+      {
+        std::string session = reader.getSession( record.session );
+        if ( record.kind == FIX::BinaryLogRecord::CLEAR
+             || record.kind == FIX::BinaryLogRecord::BACKUP )
+        {
+          if ( matches( filter, session ) )
+            replay( outputs, directory, session, record.kind );
+          continue;
+        }
+        if ( !matches( filter, session, record ) ) continue;
+
+        output( outputs, directory, session,
+                record.kind == FIX::BinaryLogRecord::EVENT )
+          << FIX::BinaryLogReader::formatTime( record.time )
+          << " : " << record.data << '\n';
+      }
+    }
+    catch ( std::exception& e )
+    {
+      std::cerr << argv[ i ] << ": " << e.what() << std::endl;
+      result = 1;
+    }
+  }
+  return result;
+}
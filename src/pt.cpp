@@ -29,17 +29,26 @@
 #include <memory>
 #include "getopt-repl.h"
 #include <iostream>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <fstream>
 #include "Application.h"
 #include "FieldConvertors.h"
 #include "Values.h"
 #include "FileStore.h"
+#include "MmapStore.h"
+#ifdef HAVE_MYSQL
+#include "MySQLStore.h"
+#endif
+#ifdef HAVE_POSTGRESQL
+#include "PostgreSQLStore.h"
+#endif
 #include "SessionID.h"
 #include "Session.h"
 #include "DataDictionary.h"
 #include "Parser.h"
 #include "Utility.h"
-#include "SocketAcceptor.h"
-#include "SocketInitiator.h"
 #include "ThreadedSocketAcceptor.h"
 #include "ThreadedSocketInitiator.h"
 #include "fix42/Heartbeat.h"
@@ -65,16 +74,30 @@ long testSerializeToStringQuoteRequest( int );
 long testSerializeFromStringQuoteRequest( int );
 long testSerializeFromStringAndValidateQuoteRequest( int );
 long testFileStoreNewOrderSingle( int );
+long testMmapStoreNewOrderSingle( int );
+#ifdef HAVE_MYSQL
+long testMySQLStoreNewOrderSingle( int, const FIX::SyncPolicy& );
+#endif
+#ifdef HAVE_POSTGRESQL
+long testPostgreSQLStoreNewOrderSingle( int, const FIX::SyncPolicy& );
+#endif
 long testValidateNewOrderSingle( int );
 long testValidateDictNewOrderSingle( int );
 long testValidateQuoteRequest( int );
 long testValidateDictQuoteRequest( int );
-long testSendOnSocket( int, short );
 long testSendOnThreadedSocket( int, short );
+#ifndef _MSC_VER
+void testPingPongOnSocket( int, short, int, std::vector<long long>& );
+void reportPingPongOnSocket( int, short, bool );
+#endif
 void report( long, int );
+void reportDatabase( long, int );
+void reportLatency( std::vector<long long>& );
 
 #ifndef _MSC_VER
 #include <sys/time.h>
+#include <sys/wait.h>
+#include <unistd.h>
 long GetTickCount()
 {
   timeval tv;
@@ -84,6 +107,13 @@ long GetTickCount()
 
   return ( long ) millsec;
 }
+
+long long GetNanoCount()
+{
+  timespec ts;
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  return ( long long ) ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
 #endif
 
 std::auto_ptr<FIX::DataDictionary> s_dataDictionary;
@@ -173,6 +203,27 @@ int main( int argc, char** argv )
   std::cout << "Storing NewOrderSingle messages: ";
   report( testFileStoreNewOrderSingle( count ), count );
 
+  std::cout << "Storing NewOrderSingle messages in mmap store: ";
+  report( testMmapStoreNewOrderSingle( count ), count );
+
+#ifdef HAVE_MYSQL
+  std::cout << "Storing NewOrderSingle messages in MySQL store: ";
+  reportDatabase( testMySQLStoreNewOrderSingle( count, FIX::SyncPolicy() ), count );
+
+  std::cout << "Storing NewOrderSingle messages in MySQL store with batching: ";
+  reportDatabase( testMySQLStoreNewOrderSingle
+    ( count, FIX::SyncPolicy( FIX::SyncPolicy::COUNT, 100, 100000 ) ), count );
+#endif
+
+#ifdef HAVE_POSTGRESQL
+  std::cout << "Storing NewOrderSingle messages in PostgreSQL store: ";
+  reportDatabase( testPostgreSQLStoreNewOrderSingle( count, FIX::SyncPolicy() ), count );
+
+  std::cout << "Storing NewOrderSingle messages in PostgreSQL store with batching: ";
+  reportDatabase( testPostgreSQLStoreNewOrderSingle
+    ( count, FIX::SyncPolicy( FIX::SyncPolicy::COUNT, 100, 100000 ) ), count );
+#endif
+
   std::cout << "Validating NewOrderSingle messages with no data dictionary: ";
   report( testValidateNewOrderSingle( count ), count );
 
@@ -185,9 +236,15 @@ int main( int argc, char** argv )
   std::cout << "Validating QuoteRequest messages with data dictionary: ";
   report( testValidateDictQuoteRequest( count ), count );
 
-  std::cout << "Sending/Receiving NewOrderSingle/ExecutionReports on Socket";
-  report( testSendOnSocket( count, port ), count );
+#ifndef _MSC_VER
+  std::cout << "Ping-pong round trip of NewOrderSingle on ThreadedSocket with select";
+  reportPingPongOnSocket( count, port, false );
+
+  std::cout << "Ping-pong round trip of NewOrderSingle on ThreadedSocket with busy polling";
+  reportPingPongOnSocket( count, port, true );
+#endif
 
+  // runs last, it fixes the session settings of this process
   std::cout << "Sending/Receiving NewOrderSingle/ExecutionReports on ThreadedSocket";
   report( testSendOnThreadedSocket( count, port ), count );
 
@@ -203,6 +260,30 @@ void report( long time, int count )
   << ", num_per_second: " << num_per_second << std::endl;
 }
 
+void reportDatabase( long time, int count )
+{
+  if( time < 0 )
+    std::cout << std::endl << "    database unavailable" << std::endl;
+  else
+    report( time, count );
+}
+
+void reportLatency( std::vector<long long>& latencies )
+{
+  if( latencies.empty() )
+  {
+    std::cout << std::endl << "    no samples" << std::endl;
+    return;
+  }
+
+  std::sort( latencies.begin(), latencies.end() );
+  double median = latencies[ latencies.size() / 2 ] / 1000.0;
+  double p99 = latencies[ ( latencies.size() * 99 ) / 100 ] / 1000.0;
+  std::cout << std::endl << "    num: " << latencies.size()
+  << ", median_usec: " << median
+  << ", p99_usec: " << p99 << std::endl;
+}
+
 long testIntegerToString( int count )
 {
   count = count - 1;
@@ -629,6 +710,95 @@ long testFileStoreNewOrderSingle( int count )
   return end - start;
 }
 
+long testMmapStoreNewOrderSingle( int count )
+{
+  FIX::BeginString beginString( FIX::BeginString_FIX42 );
+  FIX::SenderCompID senderCompID( "SENDER" );
+  FIX::TargetCompID targetCompID( "TARGET" );
+  FIX::SessionID id( beginString, senderCompID, targetCompID );
+
+  FIX::ClOrdID clOrdID( "ORDERID" );
+  FIX::HandlInst handlInst( '1' );
+  FIX::Symbol symbol( "LNUX" );
+  FIX::Side side( FIX::Side_BUY );
+  FIX::TransactTime transactTime;
+  FIX::OrdType ordType( FIX::OrdType_MARKET );
+  FIX42::NewOrderSingle message
+  ( clOrdID, handlInst, symbol, side, transactTime, ordType );
+  message.getHeader().set( FIX::MsgSeqNum( 1 ) );
+  std::string messageString = message.toString();
+
+  FIX::MmapStore store( "store", id );
+  store.reset();
+  count = count - 1;
+
+  long start = GetTickCount();
+  for ( int i = 0; i <= count; ++i )
+  {
+    store.set( ++i, messageString );
+  }
+  long end = GetTickCount();
+  store.reset();
+  return end - start;
+}
+
+template < typename Store, typename Factory >
+long testDatabaseStoreNewOrderSingle( int count, const FIX::SyncPolicy& policy )
+{
+  FIX::BeginString beginString( FIX::BeginString_FIX42 );
+  FIX::SenderCompID senderCompID( "SENDER" );
+  FIX::TargetCompID targetCompID( "TARGET" );
+  FIX::SessionID id( beginString, senderCompID, targetCompID );
+
+  FIX::ClOrdID clOrdID( "ORDERID" );
+  FIX::HandlInst handlInst( '1' );
+  FIX::Symbol symbol( "LNUX" );
+  FIX::Side side( FIX::Side_BUY );
+  FIX::TransactTime transactTime;
+  FIX::OrdType ordType( FIX::OrdType_MARKET );
+  FIX42::NewOrderSingle message
+  ( clOrdID, handlInst, symbol, side, transactTime, ordType );
+  message.getHeader().set( FIX::MsgSeqNum( 1 ) );
+  std::string messageString = message.toString();
+
+  try
+  {
+    Store store( id, Factory::DEFAULT_DATABASE, Factory::DEFAULT_USER,
+                 Factory::DEFAULT_PASSWORD, Factory::DEFAULT_HOST,
+                 Factory::DEFAULT_PORT, policy );
+    store.reset();
+    count = count - 1;
+
+    long start = GetTickCount();
+    for ( int i = 0; i <= count; ++i )
+    {
+      store.set( ++i, messageString );
+    }
+    store.flush();
+    long end = GetTickCount();
+    store.reset();
+    return end - start;
+  }
+  catch( std::exception& )
+  {
+    return -1;
+  }
+}
+
+#ifdef HAVE_MYSQL
+long testMySQLStoreNewOrderSingle( int count, const FIX::SyncPolicy& policy )
+{
+  return testDatabaseStoreNewOrderSingle < FIX::MySQLStore, FIX::MySQLStoreFactory > ( count, policy );
+}
+#endif
+
+#ifdef HAVE_POSTGRESQL
+long testPostgreSQLStoreNewOrderSingle( int count, const FIX::SyncPolicy& policy )
+{
+  return testDatabaseStoreNewOrderSingle < FIX::PostgreSQLStore, FIX::PostgreSQLStoreFactory > ( count, policy );
+}
+#endif
+
 long testValidateNewOrderSingle( int count )
 {
   FIX::ClOrdID clOrdID( "ORDERID" );
@@ -752,29 +922,52 @@ private:
   int m_count;
 };
 
-long testSendOnSocket( int count, short port )
+// Session settings are read once per process, from the file named here.
+// Defaults win over session sections, so every setting goes in [DEFAULT].
+void useSocketSettings( const char* file, short port,
+                        bool acceptor, bool initiator, int busyPollCpu )
 {
-  std::stringstream stream;
+  std::ofstream stream( file );
   stream
     << "[DEFAULT]" << std::endl
     << "SocketConnectHost=localhost" << std::endl
     << "SocketConnectPort=" << (unsigned short)port << std::endl
     << "SocketAcceptPort=" << (unsigned short)port << std::endl
     << "SocketReuseAddress=Y" << std::endl
+    << "SocketNodelay=Y" << std::endl
     << "StartTime=00:00:00" << std::endl
     << "EndTime=00:00:00" << std::endl
     << "UseDataDictionary=N" << std::endl
+    << "DataDictionary=../spec/FIX42.xml" << std::endl
+    << "AppDataDictionary=../spec/FIX42.xml" << std::endl
     << "BeginString=FIX.4.2" << std::endl
     << "PersistMessages=N" << std::endl
-    << "[SESSION]" << std::endl
-    << "ConnectionType=acceptor" << std::endl
-    << "SenderCompID=SERVER" << std::endl
-    << "TargetCompID=CLIENT" << std::endl
-    << "[SESSION]" << std::endl
-    << "ConnectionType=initiator" << std::endl
-    << "SenderCompID=CLIENT" << std::endl
-    << "TargetCompID=SERVER" << std::endl
     << "HeartBtInt=30" << std::endl;
+  if( busyPollCpu >= 0 )
+    stream
+      << "SocketBusyPoll=Y" << std::endl
+      << "SocketBusyPollCpu=" << busyPollCpu << std::endl
+      << "SocketBusyPollUsec=50" << std::endl;
+  if( acceptor )
+    stream
+      << "[SESSION]" << std::endl
+      << "ConnectionType=acceptor" << std::endl
+      << "SenderCompID=SERVER" << std::endl
+      << "TargetCompID=CLIENT" << std::endl;
+  if( initiator )
+    stream
+      << "[SESSION]" << std::endl
+      << "ConnectionType=initiator" << std::endl
+      << "SenderCompID=CLIENT" << std::endl
+      << "TargetCompID=SERVER" << std::endl;
+  stream.close();
+
+  FIX::SessionSettings::init( file );
+}
+
+long testSendOnThreadedSocket( int count, short port )
+{
+  useSocketSettings( "pt.cfg", port, true, true, -1 );
 
   FIX::ClOrdID clOrdID( "ORDERID" );
   FIX::HandlInst handlInst( '1' );
@@ -788,19 +981,17 @@ long testSendOnSocket( int count, short port )
 
   TestApplication application;
   FIX::MemoryStoreFactory factory;
-  FIX::SessionSettings settings( stream );
-  FIX::ScreenLogFactory logFactory( settings );
+  FIX::ScreenLogFactory logFactory( false, false, false );
 
-  FIX::SocketAcceptor acceptor( application, factory, settings );
+  FIX::ThreadedSocketAcceptor acceptor( application, factory, logFactory );
   acceptor.start();
 
-  FIX::SocketInitiator initiator( application, factory, settings );
+  FIX::ThreadedSocketInitiator initiator( application, factory, logFactory );
   initiator.start();
 
   FIX::process_sleep( 1 );
 
   long start = GetTickCount();
-
   for ( int i = 0; i <= count; ++i )
     FIX::Session::sendToTarget( message, sessionID );
 
@@ -815,29 +1006,56 @@ long testSendOnSocket( int count, short port )
   return ticks;
 }
 
-long testSendOnThreadedSocket( int count, short port )
+#ifndef _MSC_VER
+class PingPongApplication : public FIX::NullApplication
 {
-  std::stringstream stream;
-  stream
-    << "[DEFAULT]" << std::endl
-    << "SocketConnectHost=localhost" << std::endl
-    << "SocketConnectPort=" << (unsigned short)port << std::endl
-    << "SocketAcceptPort=" << (unsigned short)port << std::endl
-    << "SocketReuseAddress=Y" << std::endl
-    << "StartTime=00:00:00" << std::endl
-    << "EndTime=00:00:00" << std::endl
-    << "UseDataDictionary=N" << std::endl
-    << "BeginString=FIX.4.2" << std::endl
-    << "PersistMessages=N" << std::endl
-    << "[SESSION]" << std::endl
-    << "ConnectionType=acceptor" << std::endl
-    << "SenderCompID=SERVER" << std::endl
-    << "TargetCompID=CLIENT" << std::endl
-    << "[SESSION]" << std::endl
-    << "ConnectionType=initiator" << std::endl
-    << "SenderCompID=CLIENT" << std::endl
-    << "TargetCompID=SERVER" << std::endl
-    << "HeartBtInt=30" << std::endl;
+public:
+  PingPongApplication() : m_replies(0) {}
+
+  void fromApp( const FIX::Message& message, const FIX::SessionID& sessionID )
+  throw( FIX::FieldNotFound, FIX::IncorrectDataFormat, FIX::IncorrectTagValue, FIX::UnsupportedMessageType )
+  {
+    // the acceptor echoes each order, the initiator counts the echoes
+    if( sessionID.getSenderCompID().getValue() == "SERVER" )
+    {
+      FIX::Message echo( message );
+      FIX::Session::sendToTarget( echo, sessionID );
+    }
+    else
+      m_replies++;
+  }
+
+  int getReplies() { return m_replies; }
+
+private:
+  std::atomic<int> m_replies;
+};
+
+// Echoes orders back until the parent closes its end of the done pipe
+void servePingPong( short port, int busyPollCpu, int ready, int done )
+{
+  useSocketSettings( "pt_acceptor.cfg", port, true, false, busyPollCpu );
+
+  PingPongApplication application;
+  FIX::MemoryStoreFactory factory;
+  FIX::ScreenLogFactory logFactory( false, false, false );
+
+  FIX::ThreadedSocketAcceptor acceptor( application, factory, logFactory );
+  acceptor.start();
+
+  char byte = 0;
+  if( write( ready, &byte, 1 ) == 1 )
+    read( done, &byte, 1 );
+
+  acceptor.stop();
+}
+
+void testPingPongOnSocket( int count, short port, int busyPollCpu,
+                           std::vector<long long>& latencies )
+{
+  latencies.clear();
+
+  useSocketSettings( "pt_initiator.cfg", port, false, true, busyPollCpu );
 
   FIX::ClOrdID clOrdID( "ORDERID" );
   FIX::HandlInst handlInst( '1' );
@@ -849,29 +1067,91 @@ long testSendOnThreadedSocket( int count, short port )
 
   FIX::SessionID sessionID( "FIX.4.2", "CLIENT", "SERVER" );
 
-  TestApplication application;
+  PingPongApplication application;
   FIX::MemoryStoreFactory factory;
-  FIX::SessionSettings settings( stream );
+  FIX::ScreenLogFactory logFactory( false, false, false );
 
-  FIX::ThreadedSocketAcceptor acceptor( application, factory, settings );
-  acceptor.start();
-
-  FIX::ThreadedSocketInitiator initiator( application, factory, settings );
+  FIX::ThreadedSocketInitiator initiator( application, factory, logFactory );
   initiator.start();
 
   FIX::process_sleep( 1 );
 
-  long start = GetTickCount();
-  for ( int i = 0; i <= count; ++i )
-    FIX::Session::sendToTarget( message, sessionID );
-
-  while( application.getCount() < count )
-    FIX::process_sleep( 0.1 );
+  // keep the measuring thread off the cores the connections spin on
+  bool busyPoll = busyPollCpu >= 0;
+  if( busyPoll )
+    FIX::thread_setaffinity( 0 );
 
-  long ticks = GetTickCount() - start;
+  latencies.reserve( count );
+  for ( int i = 1; i <= count; ++i )
+  {
+    long long start = GetNanoCount();
+    if( !FIX::Session::sendToTarget( message, sessionID ) )
+      break;
+    while( application.getReplies() < i )
+    {
+      if( !busyPoll )
+        FIX::process_sleep( 0 );
+    }
+    latencies.push_back( GetNanoCount() - start );
+  }
 
   initiator.stop();
-  acceptor.stop();
+}
 
-  return ticks;
+// Each side of the pair runs in a child of its own, since a process reads
+// its session settings only once.
+void reportPingPongOnSocket( int count, short port, bool busyPoll )
+{
+  std::vector<long long> latencies;
+
+  // both connection threads spin, each needs a core besides the measuring one
+  long cpus = sysconf( _SC_NPROCESSORS_ONLN );
+  int ready[ 2 ], done[ 2 ];
+  if( ( busyPoll && cpus < 3 ) || pipe( ready ) < 0 )
+  {
+    reportLatency( latencies );
+    return;
+  }
+  if( pipe( done ) < 0 )
+  {
+    close( ready[ 0 ] );
+    close( ready[ 1 ] );
+    reportLatency( latencies );
+    return;
+  }
+
+  std::cout.flush();
+  pid_t acceptor = fork();
+  if( acceptor == 0 )
+  {
+    close( ready[ 0 ] );
+    close( done[ 1 ] );
+    servePingPong( port, busyPoll ? (int)cpus - 1 : -1, ready[ 1 ], done[ 0 ] );
+    _exit( 0 );
+  }
+  close( ready[ 1 ] );
+  close( done[ 0 ] );
+
+  char byte;
+  pid_t initiator = -1;
+  if( acceptor > 0 && read( ready[ 0 ], &byte, 1 ) == 1 )
+    initiator = fork();
+  if( initiator == 0 )
+  {
+    testPingPongOnSocket( count, port, busyPoll ? (int)cpus - 2 : -1, latencies );
+    reportLatency( latencies );
+    std::cout.flush();
+    _exit( 0 );
+  }
+
+  if( initiator > 0 )
+    waitpid( initiator, 0, 0 );
+  else
+    reportLatency( latencies );
+
+  close( done[ 1 ] );
+  if( acceptor > 0 )
+    waitpid( acceptor, 0, 0 );
+  close( ready[ 0 ] );
 }
+#endif
@@ -0,0 +1,75 @@
+/* -*- C++ -*- */
+
+/****************************************************************************
+** Copyright (c) 2001-2014
+**
+** This file is part of the QuickFIX FIX Engine
+**
+** This file may be distributed under the terms of the quickfixengine.org
+** license as defined by quickfixengine.org and appearing in the file
+** LICENSE included in the packaging of this file.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** See http://www.quickfixengine.org/LICENSE for licensing information.
+**
+** Contact ask@quickfixengine.org if any conditions of this licensing are
+** not clear to you.
+**
+****************************************************************************/
+
+#ifdef _MSC_VER
+#pragma warning( disable : 4503 4355 4786 )
+#include "stdafx.h"
+#else
+#include "config.h"
+#endif
+
+#include <iostream>
+#include <string>
+#include "FileStore.h"
+
+/// Convert the text .header index of FileStore directories from earlier
+/// versions to the binary .index format, ahead of the sessions opening them.
+int main( int argc, char** argv )
+{
+  if ( argc < 2 )
+  {
+    std::cout << "usage: " << argv[ 0 ]
+              << " FILE.header..." << std::endl;
+    return 1;
+  }
+
+  int result = 0;
+  for ( int i = 1; i < argc; ++i )
+  {
+    std::string fileName = argv[ i ];
+    const std::string suffix = "header";
+    if ( fileName.size() < suffix.size()
+         || fileName.compare( fileName.size() - suffix.size(), suffix.size(), suffix ) != 0 )
+    {
+      std::cerr << fileName << ": not a .header file" << std::endl;
+      result = 1;
+      continue;
+    }
+
+    try
+    {
+      std::string prefix = fileName.substr( 0, fileName.size() - suffix.size() );
+      if ( FIX::FileStore::convertHeader( prefix ) )
+        std::cout << fileName << ": converted to " << prefix << "index" << std::endl;
+      else
+      {
+        std::cerr << fileName << ": could not be opened" << std::endl;
+        result = 1;
+      }
+    }
+    catch ( std::exception& e )
+    {
+      std::cerr << fileName << ": " << e.what() << std::endl;
+      result = 1;
+    }
+  }
+  return result;
+}
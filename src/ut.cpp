@@ -32,11 +32,21 @@
 #include <FieldBaseTestCase.cpp>
 #include <FieldConvertorsTestCase.cpp>
 #include <FileLogTestCase.cpp>
+#include <BinaryLogTestCase.cpp>
+#include <JournalLogTestCase.cpp>
+#include <LogFilterTestCase.cpp>
 #include <FileStoreFactoryTestCase.cpp>
 #include <FileStoreTestCase.cpp>
+#include <MmapStoreTestCase.cpp>
+#include <StoreSyncerTestCase.cpp>
+#include <TieredStoreTestCase.cpp>
+#include <SeqNumPageTestCase.cpp>
 #include <FileUtilitiesTestCase.cpp>
+#include <GapQueueTestCase.cpp>
+#include <SpscRingTestCase.cpp>
 #include <HttpMessageTestCase.cpp>
 #include <HttpParserTestCase.cpp>
+#include <IoUringTestCase.cpp>
 #include <MemoryStoreTestCase.cpp>
 #include <MessageSortersTestCase.cpp>
 #include <MessagesTestCase.cpp>
@@ -49,12 +59,15 @@
 #include <SessionSettingsTestCase.cpp>
 #include <SessionTestCase.cpp>
 #include <SessionFactoryTestCase.cpp>
+#include <SessionRegistryTestCase.cpp>
 #include <SettingsTestCase.cpp>
 #include <SocketAcceptorTestCase.cpp>
 #include <SocketConnectorTestCase.cpp>
 #include <SocketServerTestCase.cpp>
 #include <TestHelper.cpp>
 #include <TimeRangeTestCase.cpp>
+#include <TimerWheelTestCase.cpp>
+#include <ThreadSettingsTestCase.cpp>
 #include <UtcTimeOnlyTestCase.cpp>
 #include <UtcTimeStampTestCase.cpp>
 #endif